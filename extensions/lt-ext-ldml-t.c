@@ -21,6 +21,7 @@
 #include "lt-ext-module.h"
 #include "lt-list.h"
 #include "lt-messages.h"
+#include "lt-stats-private.h"
 #include "lt-string.h"
 #include "lt-tag.h"
 #include "lt-utils.h"
@@ -97,6 +98,7 @@ _lt_ext_ldml_t_lookup_type(lt_ext_ldml_t_data_t  *data,
 	}
 	xpath_string = lt_strdup_printf("/ldmlBCP47/keyword/key[@extension = 't' and @name = '%s']", key);
 	xobj = xmlXPathEvalExpression((const xmlChar *)xpath_string, xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(error, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s: %s",
@@ -166,6 +168,7 @@ _lt_ext_ldml_t_lookup_key(lt_ext_ldml_t_data_t  *data,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/ldmlBCP47/keyword/key[@extension = 't']", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(error, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
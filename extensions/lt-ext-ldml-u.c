@@ -22,6 +22,7 @@
 #include "lt-ext-module.h"
 #include "lt-list.h"
 #include "lt-messages.h"
+#include "lt-stats-private.h"
 #include "lt-string.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -99,6 +100,7 @@ _lt_ext_ldml_u_lookup_type(lt_ext_ldml_u_data_t  *data,
 	}
 	xpath_string = lt_strdup_printf("/ldmlBCP47/keyword/key[@name = '%s']", key);
 	xobj = xmlXPathEvalExpression((const xmlChar *)xpath_string, xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(error, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s: %s",
@@ -188,6 +190,7 @@ _lt_ext_ldml_u_lookup_key(lt_ext_ldml_u_data_t  *data,
 			goto bail1;
 		}
 		xobj = xmlXPathEvalExpression((const xmlChar *)"/ldmlBCP47/keyword/key", xctxt);
+		LT_STATS_INC (xpath_evals);
 		if (!xobj) {
 			lt_error_set(error, LT_ERR_FAIL_ON_XML,
 				     "No valid elements for %s",
@@ -20,9 +20,12 @@
 #include <liblangtag/lt-extension.h>
 #include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-list.h>
+#include <liblangtag/lt-log.h>
 #include <liblangtag/lt-redundant.h>
+#include <liblangtag/lt-stats.h>
 #include <liblangtag/lt-string.h>
 #include <liblangtag/lt-tag.h>
+#include <liblangtag/lt-tag-dict.h>
 #undef __LANGTAG_H__INSIDE
 
 #endif /* __LANGTAG_H__ */
@@ -25,6 +25,12 @@ LT_BEGIN_DECLS
 LT_INLINE_FUNC int       lt_atomic_int_get         (volatile int *v);
 LT_INLINE_FUNC int       lt_atomic_int_inc         (volatile int *v);
 LT_INLINE_FUNC lt_bool_t lt_atomic_int_dec_and_test(volatile int *v);
+LT_INLINE_FUNC lt_pointer_t lt_atomic_pointer_get  (volatile lt_pointer_t *p);
+LT_INLINE_FUNC void      lt_atomic_pointer_set     (volatile lt_pointer_t *p,
+						    lt_pointer_t           v);
+LT_INLINE_FUNC lt_bool_t lt_atomic_pointer_compare_and_exchange(volatile lt_pointer_t *p,
+								lt_pointer_t           oldval,
+								lt_pointer_t           newval);
 
 #if !defined(LT_HAVE_ATOMIC_BUILTINS) && !defined(_WIN32)
 LT_LOCK_DEFINE_STATIC (atomic);
@@ -58,14 +64,45 @@ lt_atomic_int_dec_and_test(volatile int *v)
 	return !InterlockedDecrement((LONG*)v);
 }
 
+LT_INLINE_FUNC lt_pointer_t
+lt_atomic_pointer_get(volatile lt_pointer_t *p)
+{
+	lt_return_val_if_fail (p != NULL, NULL);
+
+	return InterlockedCompareExchangePointer(p, NULL, NULL);
+}
+
+LT_INLINE_FUNC void
+lt_atomic_pointer_set(volatile lt_pointer_t *p,
+		      lt_pointer_t           v)
+{
+	lt_return_if_fail (p != NULL);
+
+	InterlockedExchangePointer(p, v);
+}
+
+LT_INLINE_FUNC lt_bool_t
+lt_atomic_pointer_compare_and_exchange(volatile lt_pointer_t *p,
+				       lt_pointer_t           oldval,
+				       lt_pointer_t           newval)
+{
+	lt_return_val_if_fail (p != NULL, FALSE);
+
+	return InterlockedCompareExchangePointer(p, newval, oldval) == oldval;
+}
+
 #elif defined(LT_HAVE_ATOMIC_BUILTINS)
 LT_INLINE_FUNC int
 lt_atomic_int_get(volatile int *v)
 {
 	lt_return_val_if_fail (v != NULL, 0);
 
+#ifdef __ATOMIC_SEQ_CST
+	return __atomic_load_n(v, __ATOMIC_SEQ_CST);
+#else
 	__sync_synchronize();
 	return *v;
+#endif
 }
 
 LT_INLINE_FUNC int
@@ -84,6 +121,44 @@ lt_atomic_int_dec_and_test(volatile int *v)
 	return __sync_fetch_and_sub(v, 1) == 1;
 }
 
+LT_INLINE_FUNC lt_pointer_t
+lt_atomic_pointer_get(volatile lt_pointer_t *p)
+{
+	lt_return_val_if_fail (p != NULL, NULL);
+
+#ifdef __ATOMIC_SEQ_CST
+	return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#else
+	__sync_synchronize();
+	return *p;
+#endif
+}
+
+LT_INLINE_FUNC void
+lt_atomic_pointer_set(volatile lt_pointer_t *p,
+		      lt_pointer_t           v)
+{
+	lt_return_if_fail (p != NULL);
+
+#ifdef __ATOMIC_SEQ_CST
+	__atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+#else
+	__sync_synchronize();
+	*p = v;
+	__sync_synchronize();
+#endif
+}
+
+LT_INLINE_FUNC lt_bool_t
+lt_atomic_pointer_compare_and_exchange(volatile lt_pointer_t *p,
+				       lt_pointer_t           oldval,
+				       lt_pointer_t           newval)
+{
+	lt_return_val_if_fail (p != NULL, FALSE);
+
+	return __sync_bool_compare_and_swap(p, oldval, newval);
+}
+
 #else /* !LT_HAVE_ATOMIC_BUILTINS */
 LT_INLINE_FUNC int
 lt_atomic_int_get(volatile int *v)
@@ -126,6 +201,49 @@ lt_atomic_int_dec_and_test(volatile int *v)
 
 	return retval;
 }
+
+LT_INLINE_FUNC lt_pointer_t
+lt_atomic_pointer_get(volatile lt_pointer_t *p)
+{
+	lt_pointer_t retval;
+
+	lt_return_val_if_fail (p != NULL, NULL);
+
+	LT_LOCK (atomic);
+	retval = *p;
+	LT_UNLOCK (atomic);
+
+	return retval;
+}
+
+LT_INLINE_FUNC void
+lt_atomic_pointer_set(volatile lt_pointer_t *p,
+		      lt_pointer_t           v)
+{
+	lt_return_if_fail (p != NULL);
+
+	LT_LOCK (atomic);
+	*p = v;
+	LT_UNLOCK (atomic);
+}
+
+LT_INLINE_FUNC lt_bool_t
+lt_atomic_pointer_compare_and_exchange(volatile lt_pointer_t *p,
+				       lt_pointer_t           oldval,
+				       lt_pointer_t           newval)
+{
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (p != NULL, FALSE);
+
+	LT_LOCK (atomic);
+	retval = *p == oldval;
+	if (retval)
+		*p = newval;
+	LT_UNLOCK (atomic);
+
+	return retval;
+}
 #endif /* LT_HAVE_ATOMIC_BUILTINS */
 
 LT_END_DECLS
@@ -0,0 +1,66 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-database-private.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_DATABASE_PRIVATE_H__
+#define __LT_DATABASE_PRIVATE_H__
+
+#include "lt-macros.h"
+#include "lt-list.h"
+#include "lt-database.h"
+
+LT_BEGIN_DECLS
+
+/* the subtags are at most 8 characters and the longest grandfathered
+ * and redundant tags fit in this. the longer key falls back to the heap.
+ */
+#define LT_DB_KEY_SIZE	64
+
+/* The borrowed view of an entry in the database. the strings are owned by
+ * the database and valid as long as the reference to it is kept.
+ * @prefixes is set for the variants loaded privately and @prefix_list,
+ * which is separated by a space, for ones from the shared image.
+ */
+typedef struct _lt_db_probe_t {
+	const char      *tag;
+	const char      *preferred_tag;
+	const char      *suppress_script;
+	const char      *prefix;
+	const lt_list_t *prefixes;
+	const char      *prefix_list;
+} lt_db_probe_t;
+
+lt_bool_t lt_lang_db_probe         (lt_lang_db_t          *langdb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_extlang_db_probe      (lt_extlang_db_t       *extlangdb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_script_db_probe       (lt_script_db_t        *scriptdb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_region_db_probe       (lt_region_db_t        *regiondb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_variant_db_probe      (lt_variant_db_t       *variantdb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_grandfathered_db_probe(lt_grandfathered_db_t *grandfathereddb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_redundant_db_probe    (lt_redundant_db_t     *redundantdb,
+                                    const char            *key,
+                                    lt_db_probe_t         *probe);
+lt_bool_t lt_db_is_frozen          (void);
+
+LT_END_DECLS
+
+#endif /* __LT_DATABASE_PRIVATE_H__ */
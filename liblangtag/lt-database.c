@@ -14,9 +14,21 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
+#if HAVE_PTHREAD
+#include <sched.h>
+#endif
 #include "lt-mem.h"
 #include "lt-ext-module.h"
+#include "lt-atomic.h"
+#include "lt-db-image.h"
+#include "lt-db-search.h"
+#include "lt-iter-private.h"
+#include "lt-lock.h"
+#include "lt-messages.h"
+#include "lt-stats-private.h"
+#include "lt-xml.h"
 #include "lt-utils.h"
 #include "lt-database.h"
 
@@ -29,18 +41,334 @@
  * This section describes convenient functions to obtain the database instance.
  */
 
-static lt_lang_db_t          *__db_lang = NULL;
-static lt_extlang_db_t       *__db_extlang = NULL;
-static lt_script_db_t        *__db_script = NULL;
-static lt_region_db_t        *__db_region = NULL;
-static lt_variant_db_t       *__db_variant = NULL;
-static lt_grandfathered_db_t *__db_grandfathered = NULL;
-static lt_redundant_db_t     *__db_redundant = NULL;
+typedef struct _lt_db_generation_t {
+	lt_mem_t               parent;
+	lt_lang_db_t          *lang;
+	lt_extlang_db_t       *extlang;
+	lt_script_db_t        *script;
+	lt_region_db_t        *region;
+	lt_variant_db_t       *variant;
+	lt_grandfathered_db_t *grandfathered;
+	lt_redundant_db_t     *redundant;
+	/* built on demand by lt_db_search_description() */
+	lt_db_search_index_t  *search;
+} lt_db_generation_t;
+
+/* The databases currently in use. readers never take a lock to obtain it.
+ * they just mark themselves as active in the current epoch instead, and
+ * the writer replacing the generation waits for the readers in the old
+ * epochs to go away before releasing the old generation.
+ */
+static lt_db_generation_t *volatile __db_generation = NULL;
+static volatile int __db_epoch = 0;
+static volatile int __db_readers[2] = { 0, 0 };
+
+static lt_bool_t __db_lang_loading = FALSE;
+static lt_bool_t __db_extlang_loading = FALSE;
+static lt_bool_t __db_script_loading = FALSE;
+static lt_bool_t __db_region_loading = FALSE;
+static lt_bool_t __db_variant_loading = FALSE;
+static lt_bool_t __db_grandfathered_loading = FALSE;
+static lt_bool_t __db_redundant_loading = FALSE;
+static lt_bool_t __db_async_running = FALSE;
+static lt_bool_t __db_async_ready = FALSE;
+static lt_db_ready_func_t __db_async_func = NULL;
+static lt_pointer_t __db_async_data = NULL;
+static lt_bool_t __db_shared = FALSE;
+static volatile int __db_frozen = FALSE;
+#if HAVE_PTHREAD
+static pthread_t __db_async_thread;
+static lt_bool_t __db_async_joinable = FALSE;
+#endif
 
 static char __lt_db_datadir[LT_PATH_MAX] = { 0 };
 
+LT_LOCK_DEFINE_STATIC (db);
+LT_COND_DEFINE_STATIC (db);
+LT_LOCK_DEFINE_STATIC (db_writer);
+LT_LOCK_DEFINE_STATIC (db_search);
+
 
 /*< private >*/
+static lt_db_generation_t *
+_lt_db_generation_new(void)
+{
+	lt_db_generation_t *retval = lt_mem_alloc_object(sizeof (lt_db_generation_t));
+
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_DATABASE);
+
+	return retval;
+}
+
+static void
+_lt_db_generation_unref(lt_db_generation_t *generation)
+{
+	if (generation)
+		lt_mem_unref(&generation->parent);
+}
+
+static int
+_lt_db_read_lock(void)
+{
+	int epoch = lt_atomic_int_get(&__db_epoch) & 1;
+
+	/* this has to be a full barrier so that the generation isn't
+	 * read before the writer can see us.
+	 */
+	lt_atomic_int_inc(&__db_readers[epoch]);
+
+	return epoch;
+}
+
+static void
+_lt_db_read_unlock(int epoch)
+{
+	lt_atomic_int_dec_and_test(&__db_readers[epoch]);
+}
+
+static lt_db_generation_t *
+_lt_db_generation_get(void)
+{
+	return lt_atomic_pointer_get((volatile lt_pointer_t *)&__db_generation);
+}
+
+/* this has to be called with the writer lock held. */
+static void
+_lt_db_synchronize(void)
+{
+	int i, epoch;
+
+	/* flip twice so that the readers which loaded the epoch before the
+	 * first flip and incremented the counter after the wait can be
+	 * caught as well.
+	 */
+	for (i = 0; i < 2; i++) {
+		epoch = lt_atomic_int_get(&__db_epoch) & 1;
+		lt_atomic_int_inc(&__db_epoch);
+		while (lt_atomic_int_get(&__db_readers[epoch]) > 0) {
+#if HAVE_PTHREAD
+			sched_yield();
+#elif _WIN32
+			Sleep(0);
+#endif
+		}
+	}
+}
+
+static lt_db_generation_t *
+_lt_db_generation_replace(lt_db_generation_t *generation)
+{
+	lt_db_generation_t *retval;
+
+	LT_LOCK (db);
+	retval = __db_generation;
+	lt_atomic_pointer_set((volatile lt_pointer_t *)&__db_generation, generation);
+	LT_UNLOCK (db);
+	/* nobody can see the old one from now on. wait for the readers
+	 * that may still be looking at it.
+	 */
+	_lt_db_synchronize();
+
+	return retval;
+}
+
+static lt_db_generation_t *
+_lt_db_generation_build(void)
+{
+	lt_db_generation_t *retval = _lt_db_generation_new();
+
+	if (!retval)
+		return NULL;
+
+#define LOAD(__type__)							\
+	retval->__type__ = lt_ ##__type__## _db_new();			\
+	if (!retval->__type__)						\
+		goto bail;						\
+	lt_mem_add_ref(&retval->parent, retval->__type__,		\
+		       (lt_destroy_func_t)lt_ ##__type__## _db_unref);
+
+	LOAD (lang);
+	LOAD (extlang);
+	LOAD (script);
+	LOAD (region);
+	LOAD (variant);
+	LOAD (grandfathered);
+	LOAD (redundant);
+
+#undef LOAD
+
+	return retval;
+  bail:
+	_lt_db_generation_unref(retval);
+
+	return NULL;
+}
+
+static void
+_lt_db_freeze_db(lt_iter_tmpl_t *db,
+		 lt_pointer_t    empty)
+{
+	lt_iter_t *iter;
+	lt_pointer_t val;
+
+	/* the entries in the image are materialized at the first lookup.
+	 * lt_db_image_freeze() takes care of them.
+	 */
+	if (!__db_shared) {
+		iter = lt_iter_init(db);
+		if (iter) {
+			while (lt_iter_next(iter, NULL, &val))
+				lt_mem_set_immortal(val);
+			lt_iter_finish(iter);
+		}
+		/* the empty entry isn't visible from the iterator */
+		if (empty)
+			lt_mem_set_immortal(empty);
+	} else if (empty) {
+		lt_mem_unref(empty);
+	}
+	lt_mem_set_immortal(&db->parent);
+}
+
+static void
+_lt_db_load_all(void)
+{
+	lt_lang_db_unref(lt_db_get_lang());
+	lt_extlang_db_unref(lt_db_get_extlang());
+	lt_script_db_unref(lt_db_get_script());
+	lt_region_db_unref(lt_db_get_region());
+	lt_variant_db_unref(lt_db_get_variant());
+	lt_grandfathered_db_unref(lt_db_get_grandfathered());
+	lt_redundant_db_unref(lt_db_get_redundant());
+}
+
+static lt_pointer_t
+_lt_db_load_thread(lt_pointer_t data)
+{
+	lt_db_ready_func_t func;
+	lt_pointer_t user_data;
+
+	_lt_db_load_all();
+
+	LT_LOCK (db);
+	func = __db_async_func;
+	user_data = __db_async_data;
+	__db_async_func = NULL;
+	__db_async_data = NULL;
+	__db_async_running = FALSE;
+	__db_async_ready = TRUE;
+	LT_COND_BROADCAST (db);
+	LT_UNLOCK (db);
+
+	if (func)
+		func(user_data);
+
+	return NULL;
+}
+
+#if HAVE_PTHREAD
+/* takes the loader thread used last time if any. this has to be called
+ * with the lock held. returns %TRUE if @thread has to be joined.
+ */
+static lt_bool_t
+_lt_db_async_take_thread(pthread_t *thread)
+{
+	if (!__db_async_joinable)
+		return FALSE;
+	__db_async_joinable = FALSE;
+	*thread = __db_async_thread;
+	/* called from the callback */
+	if (pthread_equal(*thread, pthread_self())) {
+		pthread_detach(*thread);
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+#endif
+
+static lt_db_search_index_t *
+_lt_db_search_index_get_current(void)
+{
+	lt_db_generation_t *generation;
+	lt_db_search_index_t *retval = NULL, *index;
+	int epoch;
+
+	epoch = _lt_db_read_lock();
+	generation = _lt_db_generation_get();
+	if (generation) {
+		index = lt_atomic_pointer_get((volatile lt_pointer_t *)&generation->search);
+		if (index)
+			retval = lt_db_search_index_ref(index);
+	}
+	_lt_db_read_unlock(epoch);
+
+	return retval;
+}
+
+/* the index is kept in the generation and dropped together with
+ * the databases on lt_db_reload() and lt_db_finalize().
+ */
+static lt_db_search_index_t *
+_lt_db_search_index_get(void)
+{
+	lt_db_generation_t *generation;
+	lt_db_search_index_t *retval;
+	lt_lang_db_t *lang;
+	lt_script_db_t *script;
+	lt_region_db_t *region;
+	lt_variant_db_t *variant;
+
+	retval = _lt_db_search_index_get_current();
+	if (retval)
+		return retval;
+
+	lang = lt_db_get_lang();
+	script = lt_db_get_script();
+	region = lt_db_get_region();
+	variant = lt_db_get_variant();
+	if (!lang || !script || !region || !variant)
+		goto bail;
+
+	/* build it once even if the several threads get here */
+	LT_LOCK (db_search);
+	retval = _lt_db_search_index_get_current();
+	if (!retval) {
+		retval = lt_db_search_index_new(lang, script, region, variant);
+		LT_LOCK (db);
+		generation = __db_generation;
+		/* don't keep it if the databases have been replaced meanwhile */
+		if (retval && generation && !generation->search &&
+		    generation->lang == lang &&
+		    generation->script == script &&
+		    generation->region == region &&
+		    generation->variant == variant) {
+			lt_mem_add_ref(&generation->parent, retval,
+				       (lt_destroy_func_t)lt_db_search_index_unref);
+			lt_atomic_pointer_set((volatile lt_pointer_t *)&generation->search,
+					      retval);
+			lt_db_search_index_ref(retval);
+		}
+		LT_UNLOCK (db);
+	}
+	LT_UNLOCK (db_search);
+  bail:
+	lt_lang_db_unref(lang);
+	lt_script_db_unref(script);
+	lt_region_db_unref(region);
+	lt_variant_db_unref(variant);
+
+	return retval;
+}
+
+/*< protected >*/
+lt_bool_t
+lt_db_is_frozen(void)
+{
+	return lt_atomic_int_get(&__db_frozen) != 0;
+}
 
 /*< public >*/
 /**
@@ -87,48 +415,501 @@ lt_db_get_datadir(void)
 void
 lt_db_initialize(void)
 {
-	lt_db_get_lang();
-	lt_db_get_extlang();
-	lt_db_get_script();
-	lt_db_get_region();
-	lt_db_get_variant();
-	lt_db_get_grandfathered();
-	lt_db_get_redundant();
+	_lt_db_load_all();
+	lt_ext_modules_load();
+
+	LT_LOCK (db);
+	__db_async_ready = TRUE;
+	LT_UNLOCK (db);
+}
+
+/**
+ * lt_db_initialize_shared:
+ *
+ * Initialize all of the language tags database instance like
+ * lt_db_initialize() does, but serves them from an image on the shared
+ * memory instead of the private copy on each processes. The image is
+ * built by the first process and the others just map it read-only. this
+ * is useful to save the memory where many processes are using liblangtag
+ * with the same database files.
+ *
+ * The image is associated with the database files under
+ * lt_db_get_datadir(). the updated files are published as another image.
+ * the image is shared only among the processes of the same user. the one
+ * created by the others is ignored.
+ * This falls back to lt_db_initialize() if the shared memory isn't
+ * available.
+ *
+ * Returns: %TRUE if the database is served from the shared memory,
+ *          otherwise %FALSE.
+ */
+lt_bool_t
+lt_db_initialize_shared(void)
+{
+	lt_db_generation_t *generation = NULL, *old = NULL;
+	lt_db_image_t *image;
+	lt_error_t *err = NULL;
+
+	lt_db_wait();
+
+	LT_LOCK (db_writer);
+	/* the image has to be built from the database files */
+	lt_db_image_set_default(NULL);
+	image = lt_db_image_open(&err);
+	if (image) {
+		lt_db_image_set_default(image);
+		lt_db_image_unref(image);
+		generation = _lt_db_generation_build();
+		if (generation)
+			old = _lt_db_generation_replace(generation);
+		else
+			lt_db_image_set_default(NULL);
+	}
+	__db_shared = (generation != NULL);
+	LT_UNLOCK (db_writer);
+
+	_lt_db_generation_unref(old);
+	if (!generation) {
+		lt_warning("Unable to use the shared database. falling back to the private one.");
+		if (lt_error_is_set(err, LT_ERR_ANY))
+			lt_error_print(err, LT_ERR_ANY);
+		_lt_db_load_all();
+	}
+	lt_error_unref(err);
+	lt_ext_modules_load();
+
+	LT_LOCK (db);
+	__db_async_ready = TRUE;
+	LT_UNLOCK (db);
+
+	return generation != NULL;
+}
+
+/**
+ * lt_db_initialize_async:
+ * @func: (scope async) (allow-none): a #lt_db_ready_func_t to be invoked
+ *        when all of the database is ready, or %NULL.
+ * @user_data: a pointer to be passed to @func.
+ *
+ * Initialize all of the language tags database instance like
+ * lt_db_initialize() does, but loads them on a background thread so that
+ * the caller doesn't need to wait for that. @func is invoked on the loader
+ * thread once everything has been loaded.
+ *
+ * lt_db_get_lang() and friends may be called during the loading. they
+ * wait only until the database requested is ready, or load it
+ * immediately if the loader thread hasn't reached it yet.
+ *
+ * lt_db_finalize() has to be called to release them as same as
+ * lt_db_initialize().
+ *
+ * Returns: %TRUE if the loading has been started or is already done,
+ *          otherwise %FALSE.
+ */
+lt_bool_t
+lt_db_initialize_async(lt_db_ready_func_t func,
+		       lt_pointer_t       user_data)
+{
+#if HAVE_PTHREAD
+	pthread_t previous;
+	lt_bool_t join;
+#endif
+
+	/* claim the loading before dropping the lock so that only one of
+	 * the threads calling this at the same time starts the loader.
+	 */
+	LT_LOCK (db);
+	if (__db_async_running) {
+		LT_UNLOCK (db);
+		lt_warning("The database is already being loaded.");
+
+		return FALSE;
+	}
+	__db_async_running = TRUE;
+	__db_async_ready = FALSE;
+	__db_async_func = func;
+	__db_async_data = user_data;
+#if HAVE_PTHREAD
+	join = _lt_db_async_take_thread(&previous);
+#endif
+	LT_UNLOCK (db);
+#if HAVE_PTHREAD
+	/* clean up the thread used last time, which may be still in
+	 * the callback.
+	 */
+	if (join)
+		pthread_join(previous, NULL);
+#endif
+
+	/* modules are cheap to load and lt_tag_parse() expects them
+	 * being available as soon as lt_db_initialize*() returns.
+	 */
 	lt_ext_modules_load();
+
+#if HAVE_PTHREAD
+	LT_LOCK (db);
+	if (pthread_create(&__db_async_thread, NULL, _lt_db_load_thread, NULL) == 0) {
+		__db_async_joinable = TRUE;
+		LT_UNLOCK (db);
+
+		return TRUE;
+	}
+	LT_UNLOCK (db);
+	lt_warning("Unable to create a thread to load the database. falling back to the synchronous loading.");
+#endif
+	_lt_db_load_thread(NULL);
+
+	return TRUE;
+}
+
+/**
+ * lt_db_is_ready:
+ *
+ * Checks whether all of the language tags database has been loaded with
+ * lt_db_initialize() or lt_db_initialize_async().
+ *
+ * Returns: %TRUE if the database is ready, otherwise %FALSE.
+ */
+lt_bool_t
+lt_db_is_ready(void)
+{
+	lt_bool_t retval;
+
+	LT_LOCK (db);
+	retval = __db_async_ready;
+	LT_UNLOCK (db);
+
+	return retval;
+}
+
+/**
+ * lt_db_wait:
+ *
+ * Blocks until the loading started by lt_db_initialize_async() is
+ * finished. this returns immediately if no loading is in progress.
+ */
+void
+lt_db_wait(void)
+{
+#if HAVE_PTHREAD
+	pthread_t thread;
+	lt_bool_t join = FALSE;
+#endif
+
+	LT_LOCK (db);
+	while (__db_async_running)
+		LT_COND_WAIT (db);
+#if HAVE_PTHREAD
+	join = _lt_db_async_take_thread(&thread);
+#endif
+	LT_UNLOCK (db);
+#if HAVE_PTHREAD
+	/* make sure the thread is entirely gone including the callback */
+	if (join)
+		pthread_join(thread, NULL);
+#endif
+}
+
+/**
+ * lt_db_reload:
+ *
+ * Reads the database files again and replaces all of the language tags
+ * database instance with them. if the database is served from the shared
+ * memory by lt_db_initialize_shared(), the image for the updated files is
+ * used. This is intended to pick up the updates of
+ * the database without restarting a process.
+ *
+ * The new databases are built on the calling thread. lt_db_get_lang() and
+ * friends are never blocked by that and keep returning the previous
+ * instance until the new one is ready. the previous instance is released
+ * once all of the threads that may be obtaining it went away. the
+ * instances already obtained are still valid until they are unref'd.
+ *
+ * Returns: %TRUE if the database has been replaced successfully,
+ *          otherwise %FALSE and the previous instance is kept.
+ */
+lt_bool_t
+lt_db_reload(void)
+{
+	lt_db_generation_t *generation, *old;
+	lt_xml_t *xml;
+
+	lt_db_wait();
+
+	LT_LOCK (db_writer);
+
+	if (lt_atomic_int_get(&__db_frozen)) {
+		LT_UNLOCK (db_writer);
+		lt_warning("Unable to reload the frozen database.");
+
+		return FALSE;
+	}
+	/* make sure the databases don't use the cached xml */
+	xml = lt_xml_reload();
+	if (!xml) {
+		LT_UNLOCK (db_writer);
+		lt_warning("Unable to reload the database. keeping the current one.");
+
+		return FALSE;
+	}
+	if (__db_shared) {
+		lt_db_image_t *image, *new_image;
+
+		image = lt_db_image_get_default();
+		lt_db_image_set_default(NULL);
+		new_image = lt_db_image_open(NULL);
+		lt_db_image_set_default(new_image ? new_image : image);
+		lt_db_image_unref(image);
+		if (!new_image) {
+			LT_UNLOCK (db_writer);
+			lt_xml_unref(xml);
+			lt_warning("Unable to reload the database. keeping the current one.");
+
+			return FALSE;
+		}
+		lt_db_image_unref(new_image);
+	}
+	generation = _lt_db_generation_build();
+	lt_xml_unref(xml);
+	if (!generation) {
+		LT_UNLOCK (db_writer);
+		lt_warning("Unable to reload the database. keeping the current one.");
+
+		return FALSE;
+	}
+	old = _lt_db_generation_replace(generation);
+
+	LT_UNLOCK (db_writer);
+
+	_lt_db_generation_unref(old);
+
+	return TRUE;
+}
+
+/**
+ * lt_db_freeze:
+ *
+ * Loads all of the language tags database and makes them immutable.
+ * The reference count of the database and the entries in it is never
+ * updated after this call and they are never released, even by
+ * lt_db_finalize(). obtaining them doesn't go through any locks and
+ * doesn't write anything into the memory where they are.
+ *
+ * This is intended to be called in the parent process before fork().
+ * the child processes can keep sharing the pages of the database with
+ * the parent then.
+ *
+ * This isn't thread-safe. no other threads must be using the database
+ * during this call. lt_db_reload() doesn't work anymore after this call.
+ *
+ * Returns: %TRUE if the database is frozen, otherwise %FALSE.
+ */
+lt_bool_t
+lt_db_freeze(void)
+{
+	lt_db_generation_t *generation;
+
+	lt_db_wait();
+	_lt_db_load_all();
+
+	LT_LOCK (db_writer);
+	generation = _lt_db_generation_get();
+	if (!generation) {
+		LT_UNLOCK (db_writer);
+		lt_warning("Unable to freeze the database. it isn't loaded.");
+
+		return FALSE;
+	}
+	if (!lt_atomic_int_get(&__db_frozen)) {
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->lang, NULL);
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->extlang,
+				 lt_extlang_db_lookup(generation->extlang, ""));
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->script,
+				 lt_script_db_lookup(generation->script, ""));
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->region,
+				 lt_region_db_lookup(generation->region, ""));
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->variant,
+				 lt_variant_db_lookup(generation->variant, ""));
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->grandfathered, NULL);
+		_lt_db_freeze_db((lt_iter_tmpl_t *)generation->redundant, NULL);
+		if (__db_shared) {
+			lt_db_image_t *image = lt_db_image_get_default();
+
+			if (image) {
+				lt_db_image_freeze(image);
+				lt_db_image_unref(image);
+			}
+		}
+		lt_mem_set_immortal(&generation->parent);
+		/* full barrier */
+		lt_atomic_int_inc(&__db_frozen);
+	}
+	LT_UNLOCK (db_writer);
+
+	return TRUE;
 }
 
 /**
  * lt_db_finalize:
  *
- * Decreases the reference count of the language tags database, which was
- * increased with lt_db_initialize().
+ * Releases the language tags database loaded with lt_db_initialize(),
+ * lt_db_initialize_async() or implicitly with lt_db_get_lang() and friends.
+ * The instances already obtained are still valid until they are unref'd.
  */
 void
 lt_db_finalize(void)
 {
-	lt_lang_db_unref(__db_lang);
-	lt_extlang_db_unref(__db_extlang);
-	lt_script_db_unref(__db_script);
-	lt_region_db_unref(__db_region);
-	lt_variant_db_unref(__db_variant);
-	lt_grandfathered_db_unref(__db_grandfathered);
-	lt_redundant_db_unref(__db_redundant);
+	lt_db_generation_t *old;
+
+	lt_db_wait();
+
+	LT_LOCK (db);
+	__db_async_ready = FALSE;
+	LT_UNLOCK (db);
+
+	LT_LOCK (db_writer);
+	old = _lt_db_generation_replace(NULL);
+	lt_db_image_set_default(NULL);
+	__db_shared = FALSE;
+	/* the frozen one is still alive but no one can see it anymore */
+	__db_frozen = FALSE;
+	LT_UNLOCK (db_writer);
+
+	_lt_db_generation_unref(old);
 	lt_ext_modules_unload();
+	/* the warnings at the load time may be still suppressed */
+	lt_message_site_flush();
+#if ENABLE_STATS
+	/* what is still alive here is likely to be leaked */
+	lt_stats_mem_dump();
+#endif
+}
+
+/**
+ * lt_db_search_description:
+ * @query: the words to search.
+ * @kinds: the bitwise OR of #lt_db_search_kind_t to search.
+ * @max: the maximum number of the entries.
+ * @results: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose description has all the words in @query,
+ * case-insensitively. the last word in @query matches the words starting
+ * with it as well. the entries are ranked by the score in @results, which
+ * prefers the description starting with @query and the whole words.
+ *
+ * The index of the descriptions is built at the first call. the later
+ * calls don't scan the databases.
+ *
+ * Returns: the number of the entries, up to @max. @results is terminated
+ *          by the entry with %NULL and has to be freed with
+ *          lt_db_search_results_free().
+ */
+size_t
+lt_db_search_description(const char             *query,
+			 unsigned int            kinds,
+			 size_t                  max,
+			 lt_db_search_result_t **results)
+{
+	lt_db_search_index_t *index;
+	size_t retval;
+
+	lt_return_val_if_fail (query != NULL, 0);
+	lt_return_val_if_fail (results != NULL, 0);
+
+	*results = NULL;
+	index = _lt_db_search_index_get();
+	if (!index)
+		return 0;
+	retval = lt_db_search_index_lookup(index, query, kinds, max, results);
+	lt_db_search_index_unref(index);
+
+	return retval;
 }
 
+/**
+ * lt_db_search_results_free:
+ * @results: the entries obtained from lt_db_search_description().
+ *
+ * Release the entries in @results and free @results.
+ */
+void
+lt_db_search_results_free(lt_db_search_result_t *results)
+{
+	lt_db_search_result_t *r;
+
+	if (!results)
+		return;
+	for (r = results; r->entry; r++)
+		lt_mem_unref(r->entry);
+	free(results);
+}
+
+/* lt_db_get_*() go through the lock only when the database isn't loaded
+ * yet. the database is loaded without the lock held so that the requests
+ * to the other databases don't have to wait for it.
+ */
 #define DEFUNC_GET_INSTANCE(__type__)					\
 	lt_ ##__type__## _db_t *					\
 	lt_db_get_ ##__type__ (void)					\
 	{								\
-		if (!__db_ ##__type__) {				\
-			__db_ ##__type__ = lt_ ##__type__## _db_new();	\
-			lt_mem_add_weak_pointer((lt_mem_t *)__db_ ##__type__, \
-						(lt_pointer_t *)&__db_ ##__type__); \
-		} else {						\
-			lt_ ##__type__## _db_ref(__db_ ##__type__);	\
+		lt_db_generation_t *generation;				\
+		lt_ ##__type__## _db_t *retval = NULL, *db;		\
+		int epoch;						\
+									\
+		/* the frozen generation is never released */		\
+		if (lt_atomic_int_get(&__db_frozen)) {			\
+			generation = _lt_db_generation_get();		\
+			if (generation && generation->__type__)		\
+				return lt_ ##__type__## _db_ref(generation->__type__); \
+		}							\
+		epoch = _lt_db_read_lock();				\
+		generation = _lt_db_generation_get();			\
+		if (generation && generation->__type__)			\
+			retval = lt_ ##__type__## _db_ref(generation->__type__); \
+		_lt_db_read_unlock(epoch);				\
+		if (retval)						\
+			return retval;					\
+									\
+		LT_LOCK (db);						\
+		while (__db_ ##__type__## _loading)			\
+			LT_COND_WAIT (db);				\
+		generation = __db_generation;				\
+		if (generation && generation->__type__) {		\
+			retval = lt_ ##__type__## _db_ref(generation->__type__); \
+			LT_UNLOCK (db);					\
+									\
+			return retval;					\
+		}							\
+		__db_ ##__type__## _loading = TRUE;			\
+		LT_UNLOCK (db);						\
+									\
+		db = lt_ ##__type__## _db_new();			\
+									\
+		LT_LOCK (db);						\
+		/* the generation may be replaced during the loading */	\
+		generation = __db_generation;				\
+		if (!generation && db) {				\
+			generation = _lt_db_generation_new();		\
+			lt_atomic_pointer_set((volatile lt_pointer_t *)&__db_generation, \
+					      generation);		\
+		}							\
+		if (generation && generation->__type__) {		\
+			retval = lt_ ##__type__## _db_ref(generation->__type__); \
+		} else if (generation && db) {				\
+			lt_mem_add_ref(&generation->parent, db,		\
+				       (lt_destroy_func_t)lt_ ##__type__## _db_unref); \
+			lt_atomic_pointer_set((volatile lt_pointer_t *)&generation->__type__, \
+					      db);			\
+			retval = lt_ ##__type__## _db_ref(db);		\
+			db = NULL;					\
 		}							\
+		__db_ ##__type__## _loading = FALSE;			\
+		LT_COND_BROADCAST (db);					\
+		LT_UNLOCK (db);						\
+		if (db)							\
+			lt_ ##__type__## _db_unref(db);			\
 									\
-		return __db_ ##__type__;				\
+		return retval;						\
 	}
 
 /**
@@ -136,7 +917,7 @@ lt_db_finalize(void)
  *
  * Obtains the instance of #lt_lang_db_t. This still allows to use without
  * lt_db_initialize(). but it will takes some time to load the database on
- * the memory every time.
+ * the memory at the first time.
  *
  * Returns: The instance of #lt_lang_db_t.
  */
@@ -146,7 +927,7 @@ DEFUNC_GET_INSTANCE(lang)
  *
  * Obtains the instance of #lt_extlang_db_t. This still allows to use without
  * lt_db_initialize(). but it will takes some time to load the database on
- * the memory every time.
+ * the memory at the first time.
  *
  * Returns: The instance of #lt_extlang_db_t.
  */
@@ -156,7 +937,7 @@ DEFUNC_GET_INSTANCE(extlang)
  *
  * Obtains the instance of #lt_grandfathered_db_t. This still allows to use
  * without lt_db_initialize(). but it will takes some time to load the database
- * on the memory every time.
+ * on the memory at the first time.
  *
  * Returns: The instance of #lt_grandfathered_db_t.
  */
@@ -166,7 +947,7 @@ DEFUNC_GET_INSTANCE(grandfathered)
  *
  * Obtains the instance of #lt_redundant_db_t. This still allows to use
  * without lt_db_initialize(). but it will takes some time to load the database
- * on the memory every time.
+ * on the memory at the first time.
  *
  * Returns: The instance of #lt_redundant_db_t.
  */
@@ -176,7 +957,7 @@ DEFUNC_GET_INSTANCE(redundant)
  *
  * Obtains the instance of #lt_region_db_t. This still allows to use without
  * lt_db_initialize(). but it will takes some time to load the database on
- * the memory every time.
+ * the memory at the first time.
  *
  * Returns: The instance of #lt_region_db_t.
  */
@@ -186,7 +967,7 @@ DEFUNC_GET_INSTANCE(region)
  *
  * Obtains the instance of #lt_script_db_t. This still allows to use without
  * lt_db_initialize(). but it will takes some time to load the database on
- * the memory every time.
+ * the memory at the first time.
  *
  * Returns: The instance of #lt_script_db_t.
  */
@@ -196,7 +977,7 @@ DEFUNC_GET_INSTANCE(script)
  *
  * Obtains the instance of #lt_variant_db_t. This still allows to use without
  * lt_db_initialize(). but it will takes some time to load the database on
- * the memory every time.
+ * the memory at the first time.
  *
  * Returns: The instance of #lt_variant_db_t.
  */
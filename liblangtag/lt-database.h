@@ -28,9 +28,63 @@
 
 LT_BEGIN_DECLS
 
+/**
+ * lt_db_ready_func_t:
+ * @user_data: a pointer passed to lt_db_initialize_async().
+ *
+ * The type of the callback function invoked when the database loaded with
+ * lt_db_initialize_async() is ready.
+ */
+typedef void (* lt_db_ready_func_t) (lt_pointer_t user_data);
+
+/**
+ * lt_db_search_kind_t:
+ * @LT_DB_SEARCH_LANG: search #lt_lang_t.
+ * @LT_DB_SEARCH_SCRIPT: search #lt_script_t.
+ * @LT_DB_SEARCH_REGION: search #lt_region_t.
+ * @LT_DB_SEARCH_VARIANT: search #lt_variant_t.
+ * @LT_DB_SEARCH_ALL: search all of the above.
+ *
+ * The flags to specify the databases searched by
+ * lt_db_search_description().
+ */
+typedef enum _lt_db_search_kind_t {
+	LT_DB_SEARCH_LANG    = 1 << 0,
+	LT_DB_SEARCH_SCRIPT  = 1 << 1,
+	LT_DB_SEARCH_REGION  = 1 << 2,
+	LT_DB_SEARCH_VARIANT = 1 << 3,
+	LT_DB_SEARCH_ALL     = 0xf
+} lt_db_search_kind_t;
+
+typedef struct _lt_db_search_result_t	lt_db_search_result_t;
+
+/**
+ * lt_db_search_result_t:
+ * @kind: the kind of @entry.
+ * @subtag: the subtag of @entry.
+ * @entry: the entry found. #lt_lang_t, #lt_script_t, #lt_region_t or
+ *         #lt_variant_t according to @kind.
+ * @score: the score of @entry. the higher is the better match.
+ *
+ * An entry found by lt_db_search_description().
+ */
+struct _lt_db_search_result_t {
+	lt_db_search_kind_t  kind;
+	const char          *subtag;
+	lt_pointer_t         entry;
+	int                  score;
+};
+
 void                   lt_db_set_datadir      (const char *path);
 const char            *lt_db_get_datadir      (void);
 void                   lt_db_initialize       (void);
+lt_bool_t              lt_db_initialize_async (lt_db_ready_func_t  func,
+                                               lt_pointer_t        user_data);
+lt_bool_t              lt_db_initialize_shared(void);
+lt_bool_t              lt_db_is_ready         (void);
+void                   lt_db_wait             (void);
+lt_bool_t              lt_db_reload           (void);
+lt_bool_t              lt_db_freeze           (void);
 void                   lt_db_finalize         (void);
 lt_lang_db_t          *lt_db_get_lang         (void);
 lt_extlang_db_t       *lt_db_get_extlang      (void);
@@ -39,6 +93,11 @@ lt_region_db_t        *lt_db_get_region       (void);
 lt_variant_db_t       *lt_db_get_variant      (void);
 lt_grandfathered_db_t *lt_db_get_grandfathered(void);
 lt_redundant_db_t     *lt_db_get_redundant    (void);
+size_t                 lt_db_search_description(const char             *query,
+                                                unsigned int            kinds,
+                                                size_t                  max,
+                                                lt_db_search_result_t **results);
+void                   lt_db_search_results_free(lt_db_search_result_t *results);
 
 LT_END_DECLS
 
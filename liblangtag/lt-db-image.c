@@ -0,0 +1,1247 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-db-image.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "lt-stdint.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(HAVE_SHM_OPEN) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_FILE_H)
+#include <sys/mman.h>
+#include <sys/file.h>
+#define LT_DB_IMAGE_SHM	1
+#endif
+#include "lt-atomic.h"
+#include "lt-database.h"
+#include "lt-iter-private.h"
+#include "lt-lock.h"
+#include "lt-mem.h"
+#include "lt-messages.h"
+#include "lt-string.h"
+#include "lt-utils.h"
+#include "lt-lang-private.h"
+#include "lt-extlang-private.h"
+#include "lt-script-private.h"
+#include "lt-region-private.h"
+#include "lt-variant-private.h"
+#include "lt-grandfathered-private.h"
+#include "lt-redundant-private.h"
+#include "lt-db-image.h"
+
+
+/* The image is a pointer-free representation of the whole database so
+ * that it can be mapped at any address in any process. it consists of:
+ *
+ *   - the header
+ *   - the records of each kind sorted by the key. a record is an array
+ *     of the offsets to the strings. the first field is the key.
+ *   - the string pool.
+ *
+ * All of the offsets are relative to the top of the image and 0 means
+ * no string.
+ */
+#define LT_DB_IMAGE_MAGIC	"LTDBIMG"
+#define LT_DB_IMAGE_VERSION	1
+#define LT_DB_IMAGE_WAIT	5000
+
+typedef struct _lt_db_image_header_t {
+	char     magic[8];
+	uint32_t version;
+	uint32_t complete;
+	uint64_t size;
+	struct {
+		uint32_t offset;
+		uint32_t n_entries;
+	} tables[LT_DB_IMAGE_END];
+} lt_db_image_header_t;
+
+struct _lt_db_image_t {
+	lt_mem_t                    parent;
+	const lt_db_image_header_t *header;
+	size_t                      size;
+};
+
+struct _lt_db_image_table_t {
+	lt_iter_tmpl_t      parent;
+	lt_db_image_t      *image;
+	lt_db_image_kind_t  kind;
+	const uint32_t     *records;
+	size_t              n_entries;
+	/* the entries materialized from the records so far. they are
+	 * created at the first lookup and kept until the table is gone.
+	 */
+	lt_pointer_t       *entries;
+	/* the entries are immortal after lt_db_image_freeze() */
+	volatile int        frozen;
+	lt_db_image_table_t *next;
+};
+typedef struct _lt_db_image_table_iter_t {
+	lt_iter_t     parent;
+	size_t        pos;
+	size_t        end;
+} lt_db_image_table_iter_t;
+
+typedef struct _lt_db_image_entry_t {
+	char         *key;
+	lt_pointer_t  entry;
+} lt_db_image_entry_t;
+
+static const size_t __lt_db_image_n_fields[LT_DB_IMAGE_END] = {
+	7, /* key, tag, name, scope, macrolanguage, preferred-value, suppress-script */
+	6, /* key, tag, name, macrolanguage, preferred-value, prefix */
+	3, /* key, tag, name */
+	4, /* key, tag, name, preferred-value */
+	5, /* key, tag, name, preferred-value, prefixes */
+	4, /* key, tag, name, preferred-value */
+	4  /* key, tag, name, preferred-value */
+};
+static lt_db_image_t *__lt_db_image_default = NULL;
+/* all of the tables alive. protected by the db_image_table lock */
+static lt_db_image_table_t *__lt_db_image_tables = NULL;
+LT_LOCK_DEFINE_STATIC (db_image);
+LT_LOCK_DEFINE_STATIC (db_image_table);
+
+/*< private >*/
+static const char *
+_lt_db_image_get_string(const lt_db_image_t *image,
+			uint32_t             offset)
+{
+	if (offset == 0 || offset >= image->size)
+		return NULL;
+
+	return (const char *)image->header + offset;
+}
+
+#define SET(_t_,_f_,_i_)						\
+	LT_STMT_START {							\
+		const char *__s = _lt_db_image_get_string(table->image,	\
+							  record[_i_]);	\
+		if (__s)						\
+			lt_ ## _t_ ## _set_ ## _f_ (retval, __s);	\
+	} LT_STMT_END
+
+static lt_pointer_t
+_lt_db_image_table_create_entry(lt_db_image_table_t *table,
+				const uint32_t      *record)
+{
+	switch (table->kind) {
+	    case LT_DB_IMAGE_LANG:
+		    {
+			    lt_lang_t *retval = lt_lang_create();
+
+			    if (retval) {
+				    SET (lang, tag, 1);
+				    SET (lang, name, 2);
+				    SET (lang, scope, 3);
+				    SET (lang, macro_language, 4);
+				    SET (lang, preferred_tag, 5);
+				    SET (lang, suppress_script, 6);
+			    }
+
+			    return retval;
+		    }
+	    case LT_DB_IMAGE_EXTLANG:
+		    {
+			    lt_extlang_t *retval = lt_extlang_create();
+			    const char *s;
+
+			    if (retval) {
+				    SET (extlang, tag, 1);
+				    SET (extlang, name, 2);
+				    SET (extlang, macro_language, 3);
+				    SET (extlang, preferred_tag, 4);
+				    s = _lt_db_image_get_string(table->image, record[5]);
+				    if (s)
+					    lt_extlang_add_prefix(retval, s);
+			    }
+
+			    return retval;
+		    }
+	    case LT_DB_IMAGE_SCRIPT:
+		    {
+			    lt_script_t *retval = lt_script_create();
+
+			    if (retval) {
+				    SET (script, tag, 1);
+				    SET (script, name, 2);
+			    }
+
+			    return retval;
+		    }
+	    case LT_DB_IMAGE_REGION:
+		    {
+			    lt_region_t *retval = lt_region_create();
+
+			    if (retval) {
+				    SET (region, tag, 1);
+				    SET (region, name, 2);
+				    SET (region, preferred_tag, 3);
+			    }
+
+			    return retval;
+		    }
+	    case LT_DB_IMAGE_VARIANT:
+		    {
+			    lt_variant_t *retval = lt_variant_create();
+			    const char *s, *p;
+			    char *prefix;
+
+			    if (retval) {
+				    SET (variant, tag, 1);
+				    SET (variant, name, 2);
+				    SET (variant, preferred_tag, 3);
+				    /* the prefixes are separated by a space */
+				    s = _lt_db_image_get_string(table->image, record[4]);
+				    while (s && *s) {
+					    p = strchr(s, ' ');
+					    if (!p)
+						    p = s + strlen(s);
+					    prefix = strndup(s, p - s);
+					    if (prefix) {
+						    lt_variant_add_prefix(retval, prefix);
+						    free(prefix);
+					    }
+					    s = *p ? p + 1 : p;
+				    }
+			    }
+
+			    return retval;
+		    }
+	    case LT_DB_IMAGE_GRANDFATHERED:
+		    {
+			    lt_grandfathered_t *retval = lt_grandfathered_create();
+
+			    if (retval) {
+				    SET (grandfathered, tag, 1);
+				    SET (grandfathered, name, 2);
+				    SET (grandfathered, preferred_tag, 3);
+			    }
+
+			    return retval;
+		    }
+	    case LT_DB_IMAGE_REDUNDANT:
+		    {
+			    lt_redundant_t *retval = lt_redundant_create();
+
+			    if (retval) {
+				    SET (redundant, tag, 1);
+				    SET (redundant, name, 2);
+				    SET (redundant, preferred_tag, 3);
+			    }
+
+			    return retval;
+		    }
+	    default:
+		    break;
+	}
+
+	return NULL;
+}
+
+#undef SET
+
+/* the index of the first record whose key isn't less than @key, or
+ * greater than @key if @upper is %TRUE, comparing the first @len bytes only.
+ */
+static size_t
+_lt_db_image_table_bound(lt_db_image_table_t *table,
+			 const char          *key,
+			 size_t               len,
+			 lt_bool_t            upper)
+{
+	size_t n_fields, lo = 0, hi, mid;
+	const char *s;
+	int r;
+
+	n_fields = __lt_db_image_n_fields[table->kind];
+	hi = table->n_entries;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		s = _lt_db_image_get_string(table->image,
+					    table->records[n_fields * mid]);
+		r = strncmp(key, s ? s : "", len);
+		if (r < 0 || (r == 0 && !upper))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+static const uint32_t *
+_lt_db_image_table_find(lt_db_image_table_t *table,
+			const char          *key)
+{
+	size_t n_fields, lo = 0, hi, mid;
+	const uint32_t *record;
+	const char *s;
+	int r;
+
+	n_fields = __lt_db_image_n_fields[table->kind];
+	hi = table->n_entries;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		record = &table->records[n_fields * mid];
+		s = _lt_db_image_get_string(table->image, record[0]);
+		r = strcmp(key, s ? s : "");
+		if (r == 0)
+			return record;
+		if (r < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+static void
+_lt_db_image_table_unref_entry(lt_db_image_kind_t kind,
+			       lt_pointer_t       entry)
+{
+	if (!entry)
+		return;
+	switch (kind) {
+	    case LT_DB_IMAGE_LANG:
+		    lt_lang_unref(entry);
+		    break;
+	    case LT_DB_IMAGE_EXTLANG:
+		    lt_extlang_unref(entry);
+		    break;
+	    case LT_DB_IMAGE_SCRIPT:
+		    lt_script_unref(entry);
+		    break;
+	    case LT_DB_IMAGE_REGION:
+		    lt_region_unref(entry);
+		    break;
+	    case LT_DB_IMAGE_VARIANT:
+		    lt_variant_unref(entry);
+		    break;
+	    case LT_DB_IMAGE_GRANDFATHERED:
+		    lt_grandfathered_unref(entry);
+		    break;
+	    case LT_DB_IMAGE_REDUNDANT:
+		    lt_redundant_unref(entry);
+		    break;
+	    default:
+		    break;
+	}
+}
+
+static void
+_lt_db_image_table_clear(lt_db_image_table_t *table)
+{
+	lt_db_image_table_t **p;
+	size_t i;
+
+	LT_LOCK (db_image_table);
+	for (p = &__lt_db_image_tables; *p != NULL; p = &(*p)->next) {
+		if (*p == table) {
+			*p = table->next;
+			break;
+		}
+	}
+	LT_UNLOCK (db_image_table);
+
+	for (i = 0; i < table->n_entries; i++)
+		_lt_db_image_table_unref_entry(table->kind, table->entries[i]);
+	free(table->entries);
+}
+
+/* the entry for @record. it's owned by @table */
+static lt_pointer_t
+_lt_db_image_table_get_entry(lt_db_image_table_t *table,
+			     const uint32_t      *record)
+{
+	volatile lt_pointer_t *p;
+	lt_pointer_t retval;
+
+	p = &table->entries[(record - table->records) / __lt_db_image_n_fields[table->kind]];
+	retval = lt_atomic_pointer_get(p);
+	if (!retval && lt_atomic_int_get(&table->frozen)) {
+		/* the immortal entry can't be released when someone else
+		 * has created it at the same time. create it with the lock.
+		 */
+		LT_LOCK (db_image_table);
+		retval = lt_atomic_pointer_get(p);
+		if (!retval) {
+			retval = _lt_db_image_table_create_entry(table, record);
+			if (retval) {
+				lt_mem_set_immortal(retval);
+				lt_atomic_pointer_set(p, retval);
+			}
+		}
+		LT_UNLOCK (db_image_table);
+	} else if (!retval) {
+		retval = _lt_db_image_table_create_entry(table, record);
+		if (!retval)
+			return NULL;
+		/* someone else may have created it at the same time */
+		if (!lt_atomic_pointer_compare_and_exchange(p, NULL, retval)) {
+			_lt_db_image_table_unref_entry(table->kind, retval);
+			retval = lt_atomic_pointer_get(p);
+		}
+	}
+
+	return retval;
+}
+
+static lt_iter_t *
+_lt_db_image_table_iter_init(lt_iter_tmpl_t *tmpl)
+{
+	lt_db_image_table_iter_t *retval;
+
+	retval = malloc(sizeof (lt_db_image_table_iter_t));
+	if (retval) {
+		retval->pos = 0;
+		retval->end = ((lt_db_image_table_t *)tmpl)->n_entries;
+	}
+
+	return &retval->parent;
+}
+
+static void
+_lt_db_image_table_iter_fini(lt_iter_t *iter)
+{
+}
+
+static lt_bool_t
+_lt_db_image_table_iter_next(lt_iter_t    *iter,
+			     lt_pointer_t *key,
+			     lt_pointer_t *val)
+{
+	lt_db_image_table_iter_t *table_iter = (lt_db_image_table_iter_t *)iter;
+	lt_db_image_table_t *table = (lt_db_image_table_t *)iter->target;
+	size_t n_fields = __lt_db_image_n_fields[table->kind];
+	const uint32_t *record;
+	const char *k;
+
+	/* the empty entry is only for the lookup as the trie does */
+	do {
+		if (table_iter->pos >= table_iter->end)
+			return FALSE;
+		record = &table->records[n_fields * table_iter->pos++];
+		k = _lt_db_image_get_string(table->image, record[0]);
+	} while (!k || !*k);
+	if (key)
+		*key = (lt_pointer_t)k;
+	/* the values are created on demand and owned by the table as
+	 * the trie does.
+	 */
+	if (val)
+		*val = _lt_db_image_table_get_entry(table, record);
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_db_image_validate(const lt_db_image_header_t *header,
+		      size_t                      size)
+{
+	const char *p = (const char *)header;
+	int i;
+
+	if (size < sizeof (lt_db_image_header_t))
+		return FALSE;
+	if (memcmp(header->magic, LT_DB_IMAGE_MAGIC, sizeof (header->magic)) != 0 ||
+	    header->version != LT_DB_IMAGE_VERSION ||
+	    header->size != size)
+		return FALSE;
+	/* every string has to be terminated within the image */
+	if (p[size - 1] != 0)
+		return FALSE;
+	for (i = 0; i < LT_DB_IMAGE_END; i++) {
+		uint64_t end = (uint64_t)header->tables[i].offset +
+			(uint64_t)header->tables[i].n_entries * __lt_db_image_n_fields[i] * sizeof (uint32_t);
+
+		if (header->tables[i].offset % sizeof (uint32_t) != 0 ||
+		    end > size)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int
+_lt_db_image_entry_compare(const void *v1,
+			   const void *v2)
+{
+	const lt_db_image_entry_t *e1 = v1, *e2 = v2;
+
+	return strcmp(e1->key, e2->key);
+}
+
+static uint32_t
+_lt_db_image_add_string(lt_string_t *pool,
+			const char  *string)
+{
+	uint32_t retval;
+
+	if (!string)
+		return 0;
+	retval = lt_string_length(pool);
+	lt_string_append(pool, string);
+	lt_string_append_c(pool, 0);
+
+	return retval;
+}
+
+/* this has to be called without the default image.
+ * otherwise we would serialize the image itself.
+ */
+static lt_iter_tmpl_t *
+_lt_db_image_load_db(lt_db_image_kind_t kind)
+{
+	switch (kind) {
+	    case LT_DB_IMAGE_LANG:
+		    return (lt_iter_tmpl_t *)lt_lang_db_new();
+	    case LT_DB_IMAGE_EXTLANG:
+		    return (lt_iter_tmpl_t *)lt_extlang_db_new();
+	    case LT_DB_IMAGE_SCRIPT:
+		    return (lt_iter_tmpl_t *)lt_script_db_new();
+	    case LT_DB_IMAGE_REGION:
+		    return (lt_iter_tmpl_t *)lt_region_db_new();
+	    case LT_DB_IMAGE_VARIANT:
+		    return (lt_iter_tmpl_t *)lt_variant_db_new();
+	    case LT_DB_IMAGE_GRANDFATHERED:
+		    return (lt_iter_tmpl_t *)lt_grandfathered_db_new();
+	    case LT_DB_IMAGE_REDUNDANT:
+		    return (lt_iter_tmpl_t *)lt_redundant_db_new();
+	    default:
+		    break;
+	}
+
+	return NULL;
+}
+
+static lt_pointer_t
+_lt_db_image_lookup_empty(lt_iter_tmpl_t     *db,
+			  lt_db_image_kind_t  kind)
+{
+	/* the iterator doesn't give us the entry for the empty key */
+	switch (kind) {
+	    case LT_DB_IMAGE_EXTLANG:
+		    return lt_extlang_db_lookup((lt_extlang_db_t *)db, "");
+	    case LT_DB_IMAGE_SCRIPT:
+		    return lt_script_db_lookup((lt_script_db_t *)db, "");
+	    case LT_DB_IMAGE_REGION:
+		    return lt_region_db_lookup((lt_region_db_t *)db, "");
+	    case LT_DB_IMAGE_VARIANT:
+		    return lt_variant_db_lookup((lt_variant_db_t *)db, "");
+	    default:
+		    break;
+	}
+
+	return NULL;
+}
+
+static void
+_lt_db_image_fill_record(lt_db_image_kind_t   kind,
+			 lt_pointer_t         entry,
+			 uint32_t            *record,
+			 lt_string_t         *pool)
+{
+	switch (kind) {
+	    case LT_DB_IMAGE_LANG:
+		    record[1] = _lt_db_image_add_string(pool, lt_lang_get_tag(entry));
+		    record[2] = _lt_db_image_add_string(pool, lt_lang_get_name(entry));
+		    record[3] = _lt_db_image_add_string(pool, lt_lang_get_scope(entry));
+		    record[4] = _lt_db_image_add_string(pool, lt_lang_get_macro_language(entry));
+		    record[5] = _lt_db_image_add_string(pool, lt_lang_get_preferred_tag(entry));
+		    record[6] = _lt_db_image_add_string(pool, lt_lang_get_suppress_script(entry));
+		    break;
+	    case LT_DB_IMAGE_EXTLANG:
+		    record[1] = _lt_db_image_add_string(pool, lt_extlang_get_tag(entry));
+		    record[2] = _lt_db_image_add_string(pool, lt_extlang_get_name(entry));
+		    record[3] = _lt_db_image_add_string(pool, lt_extlang_get_macro_language(entry));
+		    record[4] = _lt_db_image_add_string(pool, lt_extlang_get_preferred_tag(entry));
+		    record[5] = _lt_db_image_add_string(pool, lt_extlang_get_prefix(entry));
+		    break;
+	    case LT_DB_IMAGE_SCRIPT:
+		    record[1] = _lt_db_image_add_string(pool, lt_script_get_tag(entry));
+		    record[2] = _lt_db_image_add_string(pool, lt_script_get_name(entry));
+		    break;
+	    case LT_DB_IMAGE_REGION:
+		    record[1] = _lt_db_image_add_string(pool, lt_region_get_tag(entry));
+		    record[2] = _lt_db_image_add_string(pool, lt_region_get_name(entry));
+		    record[3] = _lt_db_image_add_string(pool, lt_region_get_preferred_tag(entry));
+		    break;
+	    case LT_DB_IMAGE_VARIANT:
+		    {
+			    const lt_list_t *l;
+			    lt_string_t *prefixes = lt_string_new(NULL);
+
+			    record[1] = _lt_db_image_add_string(pool, lt_variant_get_tag(entry));
+			    record[2] = _lt_db_image_add_string(pool, lt_variant_get_name(entry));
+			    record[3] = _lt_db_image_add_string(pool, lt_variant_get_preferred_tag(entry));
+			    for (l = lt_variant_get_prefix(entry); l != NULL; l = lt_list_next(l)) {
+				    if (lt_string_length(prefixes) > 0)
+					    lt_string_append_c(prefixes, ' ');
+				    lt_string_append(prefixes, lt_list_value(l));
+			    }
+			    if (lt_string_length(prefixes) > 0)
+				    record[4] = _lt_db_image_add_string(pool, lt_string_value(prefixes));
+			    lt_string_unref(prefixes);
+			    break;
+		    }
+	    case LT_DB_IMAGE_GRANDFATHERED:
+		    record[1] = _lt_db_image_add_string(pool, lt_grandfathered_get_tag(entry));
+		    record[2] = _lt_db_image_add_string(pool, lt_grandfathered_get_name(entry));
+		    record[3] = _lt_db_image_add_string(pool, lt_grandfathered_get_preferred_tag(entry));
+		    break;
+	    case LT_DB_IMAGE_REDUNDANT:
+		    record[1] = _lt_db_image_add_string(pool, lt_redundant_get_tag(entry));
+		    record[2] = _lt_db_image_add_string(pool, lt_redundant_get_name(entry));
+		    record[3] = _lt_db_image_add_string(pool, lt_redundant_get_preferred_tag(entry));
+		    break;
+	    default:
+		    break;
+	}
+}
+
+/* serialize the databases loaded privately */
+static char *
+_lt_db_image_build(size_t      *size,
+		   lt_error_t **error)
+{
+	lt_db_image_header_t *header;
+	lt_string_t *pool = lt_string_new(NULL);
+	uint32_t *records[LT_DB_IMAGE_END];
+	size_t n_entries[LT_DB_IMAGE_END];
+	size_t len, offset, pool_offset, n_records = 0;
+	lt_error_t *err = NULL;
+	char *retval = NULL;
+	int i;
+
+	memset(records, 0, sizeof (records));
+	memset(n_entries, 0, sizeof (n_entries));
+	if (!pool) {
+		lt_error_set(&err, LT_ERR_OOM,
+			     "Unable to allocate a memory for the database image.");
+		goto bail;
+	}
+	/* the offset 0 is reserved for no string */
+	lt_string_append_c(pool, 0);
+
+	for (i = 0; i < LT_DB_IMAGE_END; i++) {
+		lt_iter_tmpl_t *db = _lt_db_image_load_db(i);
+		lt_db_image_entry_t *entries = NULL;
+		size_t n = 0, allocated = 0, j, n_fields = __lt_db_image_n_fields[i];
+		lt_iter_t *iter;
+		lt_pointer_t key, val, empty;
+
+		if (!db) {
+			lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+				     "Unable to load the database.");
+			goto bail;
+		}
+		empty = _lt_db_image_lookup_empty(db, i);
+		iter = lt_iter_init(db);
+		while (1) {
+			if (n == allocated) {
+				lt_db_image_entry_t *e;
+
+				allocated = allocated ? allocated * 2 : 256;
+				e = realloc(entries, sizeof (lt_db_image_entry_t) * allocated);
+				if (!e) {
+					lt_error_set(&err, LT_ERR_OOM,
+						     "Unable to allocate a memory for the database image.");
+					break;
+				}
+				entries = e;
+			}
+			if (!lt_iter_next(iter, &key, &val)) {
+				if (empty) {
+					entries[n].key = strdup("");
+					entries[n++].entry = empty;
+				}
+				break;
+			}
+			/* the key is valid until the next iteration */
+			entries[n].key = strdup(key);
+			entries[n++].entry = val;
+		}
+		lt_iter_finish(iter);
+
+		if (!lt_error_is_set(err, LT_ERR_ANY)) {
+			qsort(entries, n, sizeof (lt_db_image_entry_t),
+			      _lt_db_image_entry_compare);
+			records[i] = calloc(n * n_fields + 1, sizeof (uint32_t));
+			if (!records[i]) {
+				lt_error_set(&err, LT_ERR_OOM,
+					     "Unable to allocate a memory for the database image.");
+			}
+		}
+		for (j = 0; j < n; j++) {
+			if (records[i] && entries[j].key) {
+				uint32_t *record = &records[i][n_fields * j];
+
+				record[0] = _lt_db_image_add_string(pool, entries[j].key);
+				_lt_db_image_fill_record(i, entries[j].entry, record, pool);
+			}
+			free(entries[j].key);
+		}
+		free(entries);
+		_lt_db_image_table_unref_entry(i, empty);
+		lt_mem_unref(&db->parent);
+		n_entries[i] = n;
+		n_records += n * n_fields;
+		if (lt_error_is_set(err, LT_ERR_ANY))
+			goto bail;
+	}
+
+	pool_offset = sizeof (lt_db_image_header_t) + n_records * sizeof (uint32_t);
+	len = pool_offset + lt_string_length(pool);
+	if (len > UINT32_MAX) {
+		lt_error_set(&err, LT_ERR_INVALID,
+			     "Too big database to create an image.");
+		goto bail;
+	}
+	retval = calloc(1, len);
+	if (!retval) {
+		lt_error_set(&err, LT_ERR_OOM,
+			     "Unable to allocate a memory for the database image.");
+		goto bail;
+	}
+	header = (lt_db_image_header_t *)retval;
+	memcpy(header->magic, LT_DB_IMAGE_MAGIC, sizeof (header->magic));
+	header->version = LT_DB_IMAGE_VERSION;
+	header->complete = 0;
+	header->size = len;
+	offset = sizeof (lt_db_image_header_t);
+	for (i = 0; i < LT_DB_IMAGE_END; i++) {
+		size_t j, n = n_entries[i] * __lt_db_image_n_fields[i];
+		uint32_t *p = (uint32_t *)(retval + offset);
+
+		header->tables[i].offset = offset;
+		header->tables[i].n_entries = n_entries[i];
+		for (j = 0; j < n; j++)
+			p[j] = records[i][j] ? records[i][j] + pool_offset : 0;
+		offset += n * sizeof (uint32_t);
+	}
+	memcpy(retval + pool_offset, lt_string_value(pool), lt_string_length(pool));
+	*size = len;
+
+  bail:
+	for (i = 0; i < LT_DB_IMAGE_END; i++) {
+		if (records[i])
+			free(records[i]);
+	}
+	lt_string_unref(pool);
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+		lt_error_unref(err);
+		if (retval)
+			free(retval);
+		retval = NULL;
+	}
+
+	return retval;
+}
+
+#ifdef LT_DB_IMAGE_SHM
+static void
+_lt_db_image_unmap(lt_db_image_t *image)
+{
+	munmap((void *)image->header, image->size);
+}
+
+static uint64_t
+_lt_db_image_hash(uint64_t    hash,
+		  const void *data,
+		  size_t      len)
+{
+	const unsigned char *p = data;
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+/* the name is unique to the registry file and the user. so the processes
+ * using the different data never share the image, the updated registry
+ * gets a new image, and the image of the other users isn't trusted.
+ */
+static char *
+_lt_db_image_get_name(void)
+{
+	lt_string_t *regfile = lt_string_new(NULL);
+	struct stat st;
+	uint64_t hash = 14695981039346656037ULL, v;
+	char *retval = NULL;
+
+	lt_string_append_filename(regfile,
+				  lt_db_get_datadir(),
+				  "language-subtag-registry.xml", NULL);
+	if (stat(lt_string_value(regfile), &st) == 0) {
+		hash = _lt_db_image_hash(hash, lt_string_value(regfile),
+					 lt_string_length(regfile));
+		v = st.st_dev;
+		hash = _lt_db_image_hash(hash, &v, sizeof (v));
+		v = st.st_ino;
+		hash = _lt_db_image_hash(hash, &v, sizeof (v));
+		v = st.st_size;
+		hash = _lt_db_image_hash(hash, &v, sizeof (v));
+		v = st.st_mtime;
+		hash = _lt_db_image_hash(hash, &v, sizeof (v));
+		retval = lt_strdup_printf("/liblangtag-%d-%lu-%016llx",
+					  LT_DB_IMAGE_VERSION,
+					  (unsigned long)geteuid(),
+					  (unsigned long long)hash);
+	}
+	lt_string_unref(regfile);
+
+	return retval;
+}
+
+static lt_db_image_t *
+_lt_db_image_new(const char *data,
+		 size_t      size)
+{
+	lt_db_image_t *retval = lt_mem_alloc_object(sizeof (lt_db_image_t));
+
+	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_DB_IMAGE);
+		retval->header = (const lt_db_image_header_t *)data;
+		retval->size = size;
+		lt_mem_add_ref(&retval->parent, retval,
+			       (lt_destroy_func_t)_lt_db_image_unmap);
+	}
+
+	return retval;
+}
+
+/* the name is predictable. so anyone could create the shared memory
+ * under it before us and feed the crafted data.
+ */
+static lt_bool_t
+_lt_db_image_is_trusted(const char        *name,
+			const struct stat *st)
+{
+	if (st->st_uid != geteuid() ||
+	    (st->st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+		lt_warning("The shared memory %s isn't owned by the current user or is writable by the others. ignoring it.",
+			   name);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* @stale is set to %TRUE if the image exists but isn't usable, i.e.
+ * it's incomplete, truncated or broken.
+ */
+static lt_db_image_t *
+_lt_db_image_attach(const char *name,
+		    lt_bool_t  *stale)
+{
+	const lt_db_image_header_t *header;
+	lt_db_image_t *retval = NULL;
+	struct stat st;
+	void *p;
+	int fd;
+
+	if (stale)
+		*stale = FALSE;
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1 ||
+	    !_lt_db_image_is_trusted(name, &st))
+		goto bail;
+	if (st.st_size < sizeof (lt_db_image_header_t)) {
+		if (stale)
+			*stale = TRUE;
+		goto bail;
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		goto bail;
+	header = p;
+	/* still being written if not completed */
+	if (!header->complete ||
+	    !_lt_db_image_validate(header, st.st_size)) {
+		if (stale)
+			*stale = TRUE;
+		munmap(p, st.st_size);
+		goto bail;
+	}
+	retval = _lt_db_image_new(p, st.st_size);
+	if (!retval)
+		munmap(p, st.st_size);
+  bail:
+	close(fd);
+
+	return retval;
+}
+
+static lt_bool_t
+_lt_db_image_publish(const char  *name,
+		     const char  *data,
+		     size_t       size,
+		     lt_error_t **error)
+{
+	uint32_t complete = 1;
+	size_t len = 0;
+	ssize_t n;
+	int fd;
+
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0444);
+	if (fd == -1) {
+		lt_error_set(error, LT_ERR_UNKNOWN,
+			     "Unable to create a shared memory %s: %s",
+			     name, strerror(errno));
+		return FALSE;
+	}
+	if (ftruncate(fd, size) == -1)
+		goto bail;
+	while (len < size) {
+		n = write(fd, data + len, size - len);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			goto bail;
+		}
+		len += n;
+	}
+	/* mark it usable at last */
+	if (pwrite(fd, &complete, sizeof (complete),
+		   offsetof (lt_db_image_header_t, complete)) != sizeof (complete))
+		goto bail;
+	close(fd);
+
+	return TRUE;
+  bail:
+	lt_error_set(error, LT_ERR_UNKNOWN,
+		     "Unable to write the database image into %s: %s",
+		     name, strerror(errno));
+	close(fd);
+	shm_unlink(name);
+
+	return FALSE;
+}
+
+/* the lock is released automatically even if the process is gone */
+static int
+_lt_db_image_lock(const char *name)
+{
+	char *lockname = lt_strdup_printf("%s.lock", name);
+	struct stat st;
+	int fd;
+
+	fd = shm_open(lockname, O_RDONLY | O_CREAT, 0444);
+	/* don't wait for the lock which the others may hold forever */
+	if (fd != -1 &&
+	    (fstat(fd, &st) == -1 || !_lt_db_image_is_trusted(lockname, &st))) {
+		close(fd);
+		fd = -1;
+	}
+	free(lockname);
+	if (fd != -1) {
+		while (flock(fd, LOCK_EX) == -1) {
+			if (errno != EINTR) {
+				close(fd);
+				return -1;
+			}
+		}
+	}
+
+	return fd;
+}
+
+static void
+_lt_db_image_unlock(int fd)
+{
+	if (fd != -1) {
+		flock(fd, LOCK_UN);
+		close(fd);
+	}
+}
+#endif /* LT_DB_IMAGE_SHM */
+
+/*< public >*/
+lt_db_image_t *
+lt_db_image_open(lt_error_t **error)
+{
+	lt_db_image_t *retval = NULL;
+	lt_error_t *err = NULL;
+#ifdef LT_DB_IMAGE_SHM
+	char *name, *data;
+	size_t size = 0;
+	lt_bool_t stale;
+	int fd;
+
+	name = _lt_db_image_get_name();
+	if (!name) {
+		lt_error_set(&err, LT_ERR_UNKNOWN,
+			     "Unable to find the subtag registry in %s",
+			     lt_db_get_datadir());
+		goto bail;
+	}
+	retval = _lt_db_image_attach(name, NULL);
+	if (retval)
+		goto bail;
+	/* nobody published it yet. do it by ourselves but make sure
+	 * that only one process is doing it at the same time.
+	 */
+	fd = _lt_db_image_lock(name);
+	retval = _lt_db_image_attach(name, &stale);
+	if (!retval && stale && fd != -1) {
+		/* the image is written with the lock held. so the incomplete
+		 * one is left by the publisher which crashed. it would never
+		 * be completed.
+		 */
+		lt_debug(LT_MSGCAT_DEBUG, "Removing the stale shared memory %s", name);
+		shm_unlink(name);
+	}
+	if (!retval) {
+		data = _lt_db_image_build(&size, &err);
+		if (data) {
+			if (_lt_db_image_publish(name, data, size, &err))
+				retval = _lt_db_image_attach(name, NULL);
+			free(data);
+		}
+		if (!retval && !lt_error_is_set(err, LT_ERR_ANY))
+			lt_error_set(&err, LT_ERR_UNKNOWN,
+				     "Unable to attach the shared memory %s",
+				     name);
+	}
+	_lt_db_image_unlock(fd);
+  bail:
+	if (name)
+		free(name);
+#else
+	lt_error_set(&err, LT_ERR_UNKNOWN,
+		     "No shared memory support available");
+#endif
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+		lt_error_unref(err);
+	}
+
+	return retval;
+}
+
+lt_db_image_t *
+lt_db_image_ref(lt_db_image_t *image)
+{
+	lt_return_val_if_fail (image != NULL, NULL);
+
+	return lt_mem_ref(&image->parent);
+}
+
+void
+lt_db_image_unref(lt_db_image_t *image)
+{
+	if (image)
+		lt_mem_unref(&image->parent);
+}
+
+void
+lt_db_image_set_default(lt_db_image_t *image)
+{
+	lt_db_image_t *old;
+
+	LT_LOCK (db_image);
+	old = __lt_db_image_default;
+	__lt_db_image_default = image ? lt_db_image_ref(image) : NULL;
+	LT_UNLOCK (db_image);
+
+	lt_db_image_unref(old);
+}
+
+lt_db_image_t *
+lt_db_image_get_default(void)
+{
+	lt_db_image_t *retval = NULL;
+
+	LT_LOCK (db_image);
+	if (__lt_db_image_default)
+		retval = lt_db_image_ref(__lt_db_image_default);
+	LT_UNLOCK (db_image);
+
+	return retval;
+}
+
+lt_db_image_table_t *
+lt_db_image_table_new(lt_db_image_t      *image,
+		      lt_db_image_kind_t  kind)
+{
+	lt_db_image_table_t *retval;
+
+	lt_return_val_if_fail (image != NULL, NULL);
+	lt_return_val_if_fail (kind < LT_DB_IMAGE_END, NULL);
+
+	retval = lt_mem_alloc_object(sizeof (lt_db_image_table_t));
+	if (retval) {
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DB_IMAGE);
+		LT_ITER_TMPL_INIT (&retval->parent, _lt_db_image_table);
+		retval->image = lt_db_image_ref(image);
+		lt_mem_add_ref(&retval->parent.parent, retval->image,
+			       (lt_destroy_func_t)lt_db_image_unref);
+		retval->kind = kind;
+		retval->records = (const uint32_t *)((const char *)image->header + image->header->tables[kind].offset);
+		retval->n_entries = image->header->tables[kind].n_entries;
+		retval->entries = calloc(retval->n_entries + 1, sizeof (lt_pointer_t));
+		if (!retval->entries) {
+			lt_mem_unref(&retval->parent.parent);
+			return NULL;
+		}
+		lt_mem_add_ref(&retval->parent.parent, retval,
+			       (lt_destroy_func_t)_lt_db_image_table_clear);
+		LT_LOCK (db_image_table);
+		retval->next = __lt_db_image_tables;
+		__lt_db_image_tables = retval;
+		LT_UNLOCK (db_image_table);
+	}
+
+	return retval;
+}
+
+/* makes the entries materialized from @image immortal, including
+ * the ones materialized later. so the lookups don't write their
+ * reference count. this has to be called when no other threads are
+ * using @image.
+ */
+void
+lt_db_image_freeze(lt_db_image_t *image)
+{
+	lt_db_image_table_t *table;
+	size_t i;
+
+	lt_return_if_fail (image != NULL);
+
+	LT_LOCK (db_image_table);
+	for (table = __lt_db_image_tables; table != NULL; table = table->next) {
+		if (table->image != image || table->frozen)
+			continue;
+		for (i = 0; i < table->n_entries; i++) {
+			if (table->entries[i])
+				lt_mem_set_immortal(table->entries[i]);
+		}
+		lt_atomic_int_inc(&table->frozen);
+	}
+	LT_UNLOCK (db_image_table);
+	lt_mem_set_immortal(&image->parent);
+}
+
+void
+lt_db_image_table_unref(lt_db_image_table_t *table)
+{
+	if (table)
+		lt_mem_unref(&table->parent.parent);
+}
+
+lt_pointer_t
+lt_db_image_table_lookup(lt_db_image_table_t *table,
+			 const char          *key)
+{
+	const uint32_t *record;
+	lt_pointer_t entry;
+
+	lt_return_val_if_fail (table != NULL, NULL);
+	lt_return_val_if_fail (key != NULL, NULL);
+
+	record = _lt_db_image_table_find(table, key);
+	if (record) {
+		entry = _lt_db_image_table_get_entry(table, record);
+		if (entry)
+			return lt_mem_ref(entry);
+	}
+
+	return NULL;
+}
+
+lt_bool_t
+lt_db_image_table_probe(lt_db_image_table_t *table,
+			const char          *key,
+			lt_db_probe_t       *probe)
+{
+	const uint32_t *record;
+
+	lt_return_val_if_fail (table != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	record = _lt_db_image_table_find(table, key);
+	if (!record)
+		return FALSE;
+
+	probe->tag = _lt_db_image_get_string(table->image, record[1]);
+	switch (table->kind) {
+	    case LT_DB_IMAGE_LANG:
+		    probe->preferred_tag = _lt_db_image_get_string(table->image, record[5]);
+		    probe->suppress_script = _lt_db_image_get_string(table->image, record[6]);
+		    break;
+	    case LT_DB_IMAGE_EXTLANG:
+		    probe->preferred_tag = _lt_db_image_get_string(table->image, record[4]);
+		    probe->prefix = _lt_db_image_get_string(table->image, record[5]);
+		    break;
+	    case LT_DB_IMAGE_VARIANT:
+		    probe->preferred_tag = _lt_db_image_get_string(table->image, record[3]);
+		    probe->prefix_list = _lt_db_image_get_string(table->image, record[4]);
+		    break;
+	    case LT_DB_IMAGE_REGION:
+	    case LT_DB_IMAGE_GRANDFATHERED:
+	    case LT_DB_IMAGE_REDUNDANT:
+		    probe->preferred_tag = _lt_db_image_get_string(table->image, record[3]);
+		    break;
+	    default:
+		    break;
+	}
+
+	return TRUE;
+}
+
+/* iterates the records whose key starts with @prefix. they are sorted
+ * in the image, so this only looks up the range.
+ */
+lt_iter_t *
+lt_db_image_table_prefix_iter(lt_db_image_table_t *table,
+			      const char          *prefix)
+{
+	lt_db_image_table_iter_t *retval;
+	size_t len;
+
+	lt_return_val_if_fail (table != NULL, NULL);
+	lt_return_val_if_fail (prefix != NULL, NULL);
+
+	retval = (lt_db_image_table_iter_t *)lt_iter_init(&table->parent);
+	if (retval && *prefix) {
+		len = strlen(prefix);
+		retval->pos = _lt_db_image_table_bound(table, prefix, len, FALSE);
+		retval->end = _lt_db_image_table_bound(table, prefix, len, TRUE);
+	}
+
+	return &retval->parent;
+}
@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-db-image.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_DB_IMAGE_H__
+#define __LT_DB_IMAGE_H__
+
+#include "lt-macros.h"
+#include "lt-error.h"
+#include "lt-database-private.h"
+
+LT_BEGIN_DECLS
+
+typedef struct _lt_db_image_t		lt_db_image_t;
+typedef struct _lt_db_image_table_t	lt_db_image_table_t;
+typedef enum _lt_db_image_kind_t {
+	LT_DB_IMAGE_LANG = 0,
+	LT_DB_IMAGE_EXTLANG,
+	LT_DB_IMAGE_SCRIPT,
+	LT_DB_IMAGE_REGION,
+	LT_DB_IMAGE_VARIANT,
+	LT_DB_IMAGE_GRANDFATHERED,
+	LT_DB_IMAGE_REDUNDANT,
+	LT_DB_IMAGE_END
+} lt_db_image_kind_t;
+
+lt_db_image_t       *lt_db_image_open        (lt_error_t          **error);
+lt_db_image_t       *lt_db_image_ref         (lt_db_image_t        *image);
+void                 lt_db_image_unref       (lt_db_image_t        *image);
+void                 lt_db_image_set_default (lt_db_image_t        *image);
+lt_db_image_t       *lt_db_image_get_default (void);
+void                 lt_db_image_freeze      (lt_db_image_t        *image);
+lt_db_image_table_t *lt_db_image_table_new   (lt_db_image_t        *image,
+                                              lt_db_image_kind_t    kind);
+void                 lt_db_image_table_unref (lt_db_image_table_t  *table);
+lt_pointer_t         lt_db_image_table_lookup(lt_db_image_table_t  *table,
+                                              const char           *key);
+lt_bool_t            lt_db_image_table_probe (lt_db_image_table_t  *table,
+                                              const char           *key,
+                                              lt_db_probe_t        *probe);
+lt_iter_t           *lt_db_image_table_prefix_iter(lt_db_image_table_t *table,
+                                                   const char          *prefix);
+
+LT_END_DECLS
+
+#endif /* __LT_DB_IMAGE_H__ */
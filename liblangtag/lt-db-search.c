@@ -0,0 +1,630 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-db-search.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "lt-iter-private.h"
+#include "lt-mem.h"
+#include "lt-messages.h"
+#include "lt-string.h"
+#include "lt-db-search.h"
+
+
+/* the words in the query more than this are ignored */
+#define LT_DB_SEARCH_MAX_WORDS	16
+
+/* the index is an inverted index from the words in the case-folded
+ * descriptions to the entries. the words are sorted so that the prefix
+ * of the word can be looked up as a range.
+ */
+typedef struct _lt_db_search_doc_t {
+	lt_db_search_kind_t  kind;
+	size_t               key;
+	size_t               name;
+	size_t               length;
+} lt_db_search_doc_t;
+typedef struct _lt_db_search_word_t {
+	size_t  offset;
+	size_t  length;
+	size_t  postings;
+	size_t  n_postings;
+} lt_db_search_word_t;
+struct _lt_db_search_index_t {
+	lt_mem_t             parent;
+	lt_lang_db_t        *lang;
+	lt_script_db_t      *script;
+	lt_region_db_t      *region;
+	lt_variant_db_t     *variant;
+	char                *pool;
+	lt_db_search_doc_t  *docs;
+	size_t               n_docs;
+	lt_db_search_word_t *words;
+	size_t               n_words;
+	size_t              *postings;
+};
+
+typedef struct _lt_db_search_pair_t {
+	const char *word;
+	size_t      length;
+	size_t      doc;
+} lt_db_search_pair_t;
+typedef struct _lt_db_search_span_t {
+	const char *word;
+	size_t      length;
+} lt_db_search_span_t;
+typedef struct _lt_db_search_candidate_t {
+	size_t  doc;
+	int     score;
+} lt_db_search_candidate_t;
+
+/*< private >*/
+#define LT_DB_SEARCH_IS_WORD_CHAR(_c_)				\
+	(((_c_) >= 'a' && (_c_) <= 'z') ||			\
+	 ((_c_) >= '0' && (_c_) <= '9') ||			\
+	 ((unsigned char)(_c_) >= 0x80))
+
+static char
+_lt_db_search_fold(char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A' + 'a';
+
+	return c;
+}
+
+/* splits the case-folded @s into the words. the bytes not in ASCII are
+ * kept in the words as they are.
+ */
+static size_t
+_lt_db_search_split(const char          *s,
+		    size_t               length,
+		    lt_db_search_span_t *spans,
+		    size_t               max)
+{
+	size_t i = 0, n = 0, start;
+
+	while (i < length && n < max) {
+		while (i < length && !LT_DB_SEARCH_IS_WORD_CHAR(s[i]))
+			i++;
+		if (i == length)
+			break;
+		start = i;
+		while (i < length && LT_DB_SEARCH_IS_WORD_CHAR(s[i]))
+			i++;
+		spans[n].word = &s[start];
+		spans[n++].length = i - start;
+	}
+
+	return n;
+}
+
+static int
+_lt_db_search_word_compare(const char *w1,
+			   size_t      l1,
+			   const char *w2,
+			   size_t      l2)
+{
+	int r = memcmp(w1, w2, l1 < l2 ? l1 : l2);
+
+	if (r != 0)
+		return r;
+
+	return l1 < l2 ? -1 : l1 > l2 ? 1 : 0;
+}
+
+static int
+_lt_db_search_pair_compare(const void *v1,
+			   const void *v2)
+{
+	const lt_db_search_pair_t *p1 = v1, *p2 = v2;
+	int r = _lt_db_search_word_compare(p1->word, p1->length,
+					   p2->word, p2->length);
+
+	if (r != 0)
+		return r;
+
+	return p1->doc < p2->doc ? -1 : p1->doc > p2->doc ? 1 : 0;
+}
+
+static const char *
+_lt_db_search_get_name(lt_db_search_kind_t kind,
+		       lt_pointer_t        entry)
+{
+	switch (kind) {
+	    case LT_DB_SEARCH_LANG:
+		    return lt_lang_get_name(entry);
+	    case LT_DB_SEARCH_SCRIPT:
+		    return lt_script_get_name(entry);
+	    case LT_DB_SEARCH_REGION:
+		    return lt_region_get_name(entry);
+	    case LT_DB_SEARCH_VARIANT:
+		    return lt_variant_get_name(entry);
+	    default:
+		    break;
+	}
+
+	return NULL;
+}
+
+/* the descriptions are collected into @pool. the words in @pairs point to
+ * the offsets in @pool until it's ready.
+ */
+static lt_bool_t
+_lt_db_search_index_add_db(lt_db_search_index_t  *index,
+			   lt_db_search_kind_t    kind,
+			   lt_iter_tmpl_t        *db,
+			   lt_string_t           *pool,
+			   lt_db_search_pair_t  **pairs,
+			   size_t                *n_pairs,
+			   size_t                *allocated)
+{
+	lt_db_search_span_t spans[64];
+	lt_iter_t *iter;
+	lt_pointer_t key, val;
+	const char *name, *s;
+	size_t n_docs = index->n_docs, len, offset, i, n;
+	lt_bool_t retval = FALSE;
+
+	iter = lt_iter_init(db);
+	if (!iter)
+		return FALSE;
+	while (lt_iter_next(iter, &key, &val)) {
+		name = _lt_db_search_get_name(kind, val);
+		/* the wildcard entry isn't worth searching */
+		if (!name || !*name || strcmp(key, "*") == 0)
+			continue;
+		if (n_docs % 256 == 0) {
+			lt_db_search_doc_t *d = realloc(index->docs, sizeof (lt_db_search_doc_t) * (n_docs + 256));
+
+			if (!d)
+				goto bail;
+			index->docs = d;
+		}
+		len = strlen(key);
+		index->docs[n_docs].kind = kind;
+		index->docs[n_docs].key = lt_string_length(pool);
+		lt_string_append_len(pool, key, len + 1);
+		len = strlen(name);
+		offset = lt_string_length(pool);
+		index->docs[n_docs].name = offset;
+		index->docs[n_docs].length = len;
+		for (i = 0; i < len; i++)
+			lt_string_append_c(pool, _lt_db_search_fold(name[i]));
+		lt_string_append_c(pool, 0);
+		if (lt_string_length(pool) != offset + len + 1)
+			goto bail;
+		s = lt_string_value(pool) + offset;
+		n = _lt_db_search_split(s, len, spans, 64);
+		for (i = 0; i < n; i++) {
+			if (*n_pairs == *allocated) {
+				size_t size = *allocated ? *allocated * 2 : 4096;
+				lt_db_search_pair_t *p = realloc(*pairs, sizeof (lt_db_search_pair_t) * size);
+
+				if (!p)
+					goto bail;
+				*pairs = p;
+				*allocated = size;
+			}
+			(*pairs)[*n_pairs].word = (const char *)(offset + (spans[i].word - s));
+			(*pairs)[*n_pairs].length = spans[i].length;
+			(*pairs)[(*n_pairs)++].doc = n_docs;
+		}
+		n_docs++;
+	}
+	retval = TRUE;
+  bail:
+	index->n_docs = n_docs;
+	lt_iter_finish(iter);
+
+	return retval;
+}
+
+/* the range of the words starting with @word, or the same as @word
+ * unless @prefix is %TRUE.
+ */
+static void
+_lt_db_search_index_find(lt_db_search_index_t *index,
+			 const char           *word,
+			 size_t                length,
+			 lt_bool_t             prefix,
+			 size_t               *first,
+			 size_t               *last)
+{
+	size_t lo = 0, hi = index->n_words, mid;
+	lt_db_search_word_t *w;
+
+	/* the first word which isn't less than @word */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		w = &index->words[mid];
+		if (_lt_db_search_word_compare(index->pool + w->offset, w->length,
+					       word, length) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*first = lo;
+	if (!prefix) {
+		w = &index->words[lo];
+		*last = lo < index->n_words && w->length == length &&
+			memcmp(index->pool + w->offset, word, length) == 0 ? lo + 1 : lo;
+		return;
+	}
+	/* and the first one which doesn't start with @word */
+	hi = index->n_words;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		w = &index->words[mid];
+		if (w->length >= length &&
+		    memcmp(index->pool + w->offset, word, length) == 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*last = lo;
+}
+
+/* scores the document if all the words in the query are found in it.
+ * only the last word in the query can be the prefix. the whole words and
+ * the description starting with the query are preferred. -1 if it
+ * doesn't match.
+ */
+static int
+_lt_db_search_index_score(lt_db_search_index_t      *index,
+			  const lt_db_search_doc_t  *doc,
+			  const lt_db_search_span_t *words,
+			  size_t                     n_words)
+{
+	lt_db_search_span_t spans[64];
+	size_t i, j, n;
+	int score = 0, n_whole = 0;
+	lt_bool_t found, whole, leading = TRUE;
+
+	n = _lt_db_search_split(index->pool + doc->name, doc->length, spans, 64);
+	for (i = 0; i < n_words; i++) {
+		found = FALSE;
+		whole = FALSE;
+		for (j = 0; j < n; j++) {
+			if (spans[j].length < words[i].length ||
+			    memcmp(spans[j].word, words[i].word, words[i].length) != 0)
+				continue;
+			found = TRUE;
+			if (spans[j].length == words[i].length) {
+				whole = TRUE;
+				break;
+			}
+		}
+		if (!found || (!whole && i + 1 < n_words))
+			return -1;
+		if (whole)
+			n_whole++;
+		if (i >= n ||
+		    spans[i].length < words[i].length ||
+		    memcmp(spans[i].word, words[i].word, words[i].length) != 0 ||
+		    (i + 1 < n_words && spans[i].length != words[i].length))
+			leading = FALSE;
+	}
+	if (leading) {
+		score += 100;
+		/* the same as the query */
+		if (n == n_words && spans[n - 1].length == words[n - 1].length)
+			score += 100;
+	}
+	score += n_whole * 10;
+
+	return score;
+}
+
+static int
+_lt_db_search_candidate_compare_doc(const void *v1,
+				    const void *v2)
+{
+	const lt_db_search_candidate_t *c1 = v1, *c2 = v2;
+
+	return c1->doc < c2->doc ? -1 : c1->doc > c2->doc ? 1 : 0;
+}
+
+/* qsort() has no room for the context */
+typedef struct _lt_db_search_ranked_t {
+	int                       score;
+	const lt_db_search_doc_t *doc;
+	const char               *key;
+} lt_db_search_ranked_t;
+
+static int
+_lt_db_search_ranked_compare(const void *v1,
+			     const void *v2)
+{
+	const lt_db_search_ranked_t *r1 = v1, *r2 = v2;
+
+	if (r1->score != r2->score)
+		return r1->score > r2->score ? -1 : 1;
+	if (r1->doc->length != r2->doc->length)
+		return r1->doc->length < r2->doc->length ? -1 : 1;
+	if (r1->doc->kind != r2->doc->kind)
+		return r1->doc->kind < r2->doc->kind ? -1 : 1;
+
+	return strcmp(r1->key, r2->key);
+}
+
+static lt_pointer_t
+_lt_db_search_index_lookup_entry(lt_db_search_index_t *index,
+				 lt_db_search_kind_t   kind,
+				 const char           *key,
+				 const char          **subtag)
+{
+	lt_pointer_t retval = NULL;
+
+	switch (kind) {
+	    case LT_DB_SEARCH_LANG:
+		    if ((retval = lt_lang_db_lookup(index->lang, key)))
+			    *subtag = lt_lang_get_tag(retval);
+		    break;
+	    case LT_DB_SEARCH_SCRIPT:
+		    if ((retval = lt_script_db_lookup(index->script, key)))
+			    *subtag = lt_script_get_tag(retval);
+		    break;
+	    case LT_DB_SEARCH_REGION:
+		    if ((retval = lt_region_db_lookup(index->region, key)))
+			    *subtag = lt_region_get_tag(retval);
+		    break;
+	    case LT_DB_SEARCH_VARIANT:
+		    if ((retval = lt_variant_db_lookup(index->variant, key)))
+			    *subtag = lt_variant_get_tag(retval);
+		    break;
+	    default:
+		    break;
+	}
+
+	return retval;
+}
+
+/*< protected >*/
+lt_db_search_index_t *
+lt_db_search_index_new(lt_lang_db_t    *lang,
+		       lt_script_db_t  *script,
+		       lt_region_db_t  *region,
+		       lt_variant_db_t *variant)
+{
+	lt_db_search_index_t *retval;
+	lt_db_search_pair_t *pairs = NULL;
+	lt_string_t *pool = NULL;
+	size_t n_pairs = 0, allocated = 0, i, n;
+	const char *base;
+
+	lt_return_val_if_fail (lang != NULL, NULL);
+	lt_return_val_if_fail (script != NULL, NULL);
+	lt_return_val_if_fail (region != NULL, NULL);
+	lt_return_val_if_fail (variant != NULL, NULL);
+
+	retval = lt_mem_alloc_object(sizeof (lt_db_search_index_t));
+	if (!retval)
+		return NULL;
+	lt_mem_set_type(&retval->parent, LT_STATS_MEM_DATABASE);
+	retval->lang = lt_lang_db_ref(lang);
+	lt_mem_add_ref(&retval->parent, retval->lang,
+		       (lt_destroy_func_t)lt_lang_db_unref);
+	retval->script = lt_script_db_ref(script);
+	lt_mem_add_ref(&retval->parent, retval->script,
+		       (lt_destroy_func_t)lt_script_db_unref);
+	retval->region = lt_region_db_ref(region);
+	lt_mem_add_ref(&retval->parent, retval->region,
+		       (lt_destroy_func_t)lt_region_db_unref);
+	retval->variant = lt_variant_db_ref(variant);
+	lt_mem_add_ref(&retval->parent, retval->variant,
+		       (lt_destroy_func_t)lt_variant_db_unref);
+
+	pool = lt_string_new(NULL);
+	if (!pool ||
+	    !_lt_db_search_index_add_db(retval, LT_DB_SEARCH_LANG,
+					(lt_iter_tmpl_t *)lang, pool,
+					&pairs, &n_pairs, &allocated) ||
+	    !_lt_db_search_index_add_db(retval, LT_DB_SEARCH_SCRIPT,
+					(lt_iter_tmpl_t *)script, pool,
+					&pairs, &n_pairs, &allocated) ||
+	    !_lt_db_search_index_add_db(retval, LT_DB_SEARCH_REGION,
+					(lt_iter_tmpl_t *)region, pool,
+					&pairs, &n_pairs, &allocated) ||
+	    !_lt_db_search_index_add_db(retval, LT_DB_SEARCH_VARIANT,
+					(lt_iter_tmpl_t *)variant, pool,
+					&pairs, &n_pairs, &allocated)) {
+		free(retval->docs);
+		retval->docs = NULL;
+		goto bail;
+	}
+	if (retval->docs)
+		lt_mem_add_ref(&retval->parent, retval->docs, free);
+	retval->pool = lt_string_free(pool, FALSE);
+	pool = NULL;
+	if (!retval->pool)
+		goto bail;
+	lt_mem_add_ref(&retval->parent, retval->pool, free);
+
+	base = retval->pool;
+	for (i = 0; i < n_pairs; i++)
+		pairs[i].word = base + (size_t)pairs[i].word;
+	qsort(pairs, n_pairs, sizeof (lt_db_search_pair_t),
+	      _lt_db_search_pair_compare);
+
+	retval->words = malloc(sizeof (lt_db_search_word_t) * (n_pairs + 1));
+	retval->postings = malloc(sizeof (size_t) * (n_pairs + 1));
+	if (!retval->words || !retval->postings) {
+		free(retval->words);
+		free(retval->postings);
+		retval->words = NULL;
+		retval->postings = NULL;
+		goto bail;
+	}
+	lt_mem_add_ref(&retval->parent, retval->words, free);
+	lt_mem_add_ref(&retval->parent, retval->postings, free);
+	for (i = 0, n = 0; i < n_pairs; i++) {
+		lt_db_search_word_t *w = retval->n_words > 0 ? &retval->words[retval->n_words - 1] : NULL;
+
+		if (!w ||
+		    _lt_db_search_word_compare(base + w->offset, w->length,
+					       pairs[i].word, pairs[i].length) != 0) {
+			w = &retval->words[retval->n_words++];
+			w->offset = pairs[i].word - base;
+			w->length = pairs[i].length;
+			w->postings = n;
+			w->n_postings = 0;
+		} else if (retval->postings[n - 1] == pairs[i].doc) {
+			/* the same word appears twice in the description */
+			continue;
+		}
+		retval->postings[n++] = pairs[i].doc;
+		w->n_postings++;
+	}
+	free(pairs);
+
+	return retval;
+  bail:
+	lt_critical("Unable to allocate a memory for the search index.");
+	if (pool)
+		lt_string_unref(pool);
+	free(pairs);
+	lt_db_search_index_unref(retval);
+
+	return NULL;
+}
+
+lt_db_search_index_t *
+lt_db_search_index_ref(lt_db_search_index_t *index)
+{
+	lt_return_val_if_fail (index != NULL, NULL);
+
+	return lt_mem_ref(&index->parent);
+}
+
+void
+lt_db_search_index_unref(lt_db_search_index_t *index)
+{
+	if (index)
+		lt_mem_unref(&index->parent);
+}
+
+/* looks up the entries which have all the words in @query. the last
+ * word can be the prefix so that this works while typing.
+ */
+size_t
+lt_db_search_index_lookup(lt_db_search_index_t   *index,
+			  const char             *query,
+			  unsigned int            kinds,
+			  size_t                  max,
+			  lt_db_search_result_t **results)
+{
+	lt_db_search_span_t words[LT_DB_SEARCH_MAX_WORDS];
+	lt_db_search_candidate_t *candidates = NULL;
+	lt_db_search_ranked_t *ranked = NULL;
+	lt_db_search_result_t *r = NULL;
+	char buffer[256], *s;
+	size_t len, n_words, i, j, n, best = 0, best_count = (size_t)-1, first, last;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (index != NULL, 0);
+	lt_return_val_if_fail (query != NULL, 0);
+	lt_return_val_if_fail (results != NULL, 0);
+
+	*results = NULL;
+	len = strlen(query);
+	s = len < sizeof (buffer) ? buffer : malloc(len + 1);
+	if (!s)
+		return 0;
+	for (i = 0; i < len; i++)
+		s[i] = _lt_db_search_fold(query[i]);
+	s[len] = 0;
+	n_words = _lt_db_search_split(s, len, words, LT_DB_SEARCH_MAX_WORDS);
+	if (n_words == 0 || max == 0)
+		goto bail;
+
+	/* start from the word which has the fewest entries */
+	for (i = 0; i < n_words; i++) {
+		_lt_db_search_index_find(index, words[i].word, words[i].length,
+					 i + 1 == n_words, &first, &last);
+		for (j = first, n = 0; j < last; j++)
+			n += index->words[j].n_postings;
+		if (n == 0)
+			goto bail;
+		if (n < best_count) {
+			best = i;
+			best_count = n;
+		}
+	}
+	candidates = malloc(sizeof (lt_db_search_candidate_t) * best_count);
+	if (!candidates)
+		goto bail;
+	_lt_db_search_index_find(index, words[best].word, words[best].length,
+				 best + 1 == n_words, &first, &last);
+	for (i = first, n = 0; i < last; i++) {
+		const size_t *p = &index->postings[index->words[i].postings];
+
+		for (j = 0; j < index->words[i].n_postings; j++) {
+			if (index->docs[p[j]].kind & kinds)
+				candidates[n++].doc = p[j];
+		}
+	}
+	/* the entry can be found from the several words with the prefix */
+	qsort(candidates, n, sizeof (lt_db_search_candidate_t),
+	      _lt_db_search_candidate_compare_doc);
+	ranked = malloc(sizeof (lt_db_search_ranked_t) * (n + 1));
+	if (!ranked)
+		goto bail;
+	for (i = 0, j = 0; i < n; i++) {
+		const lt_db_search_doc_t *doc = &index->docs[candidates[i].doc];
+		int score;
+
+		if (i > 0 && candidates[i].doc == candidates[i - 1].doc)
+			continue;
+		score = _lt_db_search_index_score(index, doc, words, n_words);
+		if (score < 0)
+			continue;
+		ranked[j].score = score;
+		ranked[j].doc = doc;
+		ranked[j++].key = index->pool + doc->key;
+	}
+	n = j;
+	qsort(ranked, n, sizeof (lt_db_search_ranked_t),
+	      _lt_db_search_ranked_compare);
+	if (n > max)
+		n = max;
+	if (n == 0)
+		goto bail;
+	r = malloc(sizeof (lt_db_search_result_t) * (n + 1));
+	if (!r)
+		goto bail;
+	for (i = 0, j = 0; i < n; i++) {
+		r[j].entry = _lt_db_search_index_lookup_entry(index, ranked[i].doc->kind,
+							      ranked[i].key,
+							      &r[j].subtag);
+		if (!r[j].entry)
+			continue;
+		r[j].kind = ranked[i].doc->kind;
+		r[j++].score = ranked[i].score;
+	}
+	r[j].kind = 0;
+	r[j].subtag = NULL;
+	r[j].entry = NULL;
+	r[j].score = 0;
+	*results = r;
+	retval = j;
+  bail:
+	free(ranked);
+	free(candidates);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
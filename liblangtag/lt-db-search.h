@@ -0,0 +1,37 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-db-search.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_DB_SEARCH_H__
+#define __LT_DB_SEARCH_H__
+
+#include "lt-macros.h"
+#include "lt-database.h"
+
+LT_BEGIN_DECLS
+
+typedef struct _lt_db_search_index_t	lt_db_search_index_t;
+
+lt_db_search_index_t *lt_db_search_index_new   (lt_lang_db_t           *lang,
+                                                lt_script_db_t         *script,
+                                                lt_region_db_t         *region,
+                                                lt_variant_db_t        *variant);
+lt_db_search_index_t *lt_db_search_index_ref   (lt_db_search_index_t   *index);
+void                  lt_db_search_index_unref (lt_db_search_index_t   *index);
+size_t                lt_db_search_index_lookup(lt_db_search_index_t   *index,
+                                                const char             *query,
+                                                unsigned int            kinds,
+                                                size_t                  max,
+                                                lt_db_search_result_t **results);
+
+LT_END_DECLS
+
+#endif /* __LT_DB_SEARCH_H__ */
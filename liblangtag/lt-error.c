@@ -18,6 +18,7 @@
 #include <execinfo.h>
 #endif
 #include <stdlib.h>
+#include <string.h>
 #include "lt-list.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
@@ -32,7 +33,7 @@ typedef struct _lt_error_data_t {
 	lt_mem_t          parent;
 	lt_error_type_t   type;
 	char             *message;
-	char            **traces;
+	void            **traces;
 	size_t            stack_size;
 } lt_error_data_t;
 
@@ -47,7 +48,12 @@ typedef struct _lt_error_data_t {
 lt_error_t *
 lt_error_new(void)
 {
-	return lt_mem_alloc_object(sizeof (lt_error_t));
+	lt_error_t *retval = lt_mem_alloc_object(sizeof (lt_error_t));
+
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_ERROR);
+
+	return retval;
 }
 
 /*< public >*/
@@ -111,6 +117,7 @@ lt_error_set(lt_error_t      **error,
 
 	if (!d)
 		goto bail0;
+	lt_mem_set_type(&d->parent, LT_STATS_MEM_ERROR);
 	if (!*error)
 		*error = lt_error_new();
 	if (!*error)
@@ -122,9 +129,17 @@ lt_error_set(lt_error_t      **error,
 	va_end(ap);
 
 #if HAVE_BACKTRACE
+	/* the symbols are resolved when it's printed. this is much cheaper
+	 * for the callers that discard the errors.
+	 */
 	size = backtrace(traces, 1024);
-	if (size > 0)
-		d->traces = backtrace_symbols(traces, size);
+	if (size > 0) {
+		d->traces = malloc(sizeof (void *) * size);
+		if (d->traces)
+			memcpy(d->traces, traces, sizeof (void *) * size);
+		else
+			size = 0;
+	}
 #else
 	d->traces = NULL;
 #endif
@@ -214,18 +229,24 @@ lt_error_print(lt_error_t      *error,
 		lt_warning("Error raised:");
 		for (l = error->data; l != NULL; l = lt_list_next(l)) {
 			lt_error_data_t *d = lt_list_value(l);
+			char **symbols = NULL;
 			int i;
 
 			if (type == LT_ERR_ANY || type == d->type) {
 				lt_warning("  %s", d->message);
-				if (d->stack_size > 0) {
+#if HAVE_BACKTRACE
+				if (d->stack_size > 0)
+					symbols = backtrace_symbols(d->traces, d->stack_size);
+#endif
+				if (symbols) {
 					lt_warning("  Backtraces:");
 				} else {
 					lt_warning("  No backtraces");
 				}
-				for (i = 1; i < d->stack_size; i++) {
-					lt_warning("    %d. %s", i - 1, d->traces[i]);
+				for (i = 1; symbols && i < d->stack_size; i++) {
+					lt_warning("    %d. %s", i - 1, symbols[i]);
 				}
+				free(symbols);
 			}
 		}
 	}
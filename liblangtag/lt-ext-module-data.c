@@ -32,7 +32,6 @@
 typedef struct _lt_ext_module_data_private_t {
 	lt_mem_t          parent;
 	lt_destroy_func_t finalizer;
-	lt_pointer_t      dummy[3];
 } lt_ext_module_data_private_t;
 
 /*< private >*/
@@ -60,13 +59,14 @@ lt_ext_module_data_new(size_t            size,
 {
 	lt_ext_module_data_private_t *retval;
 
-	lt_assert(sizeof (lt_ext_module_data_t) == sizeof (lt_ext_module_data_private_t));
+	lt_assert(sizeof (lt_ext_module_data_t) >= sizeof (lt_ext_module_data_private_t));
 
 	if (size < sizeof (lt_ext_module_data_private_t))
 		size += sizeof (lt_ext_module_data_private_t);
 
 	retval = lt_mem_alloc_object(size);
 	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_EXT_MODULE_DATA);
 		retval->finalizer = finalizer;
 	}
 
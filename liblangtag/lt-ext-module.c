@@ -29,6 +29,8 @@
 #include <string.h>
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-ext-module-data.h"
 #include "lt-ext-module.h"
 #include "lt-ext-module-private.h"
@@ -309,6 +311,7 @@ lt_ext_module_new_with_data(const char                  *name,
 
 	retval = lt_mem_alloc_object(sizeof (lt_ext_module_t));
 	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_EXT_MODULE);
 		retval->name = strdup(name);
 		lt_mem_add_ref(&retval->parent, retval->name,
 			       (lt_destroy_func_t)free);
@@ -391,6 +394,8 @@ lt_ext_module_new(const char *name)
 		char *filename = basename(n), *module = NULL;
 		static const char *prefix = "liblangtag-ext-";
 		static size_t prefix_len = 0;
+
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_EXT_MODULE);
 		char singleton_c;
 		int singleton;
 
@@ -488,6 +493,8 @@ lt_ext_module_create_data(lt_ext_module_t *module)
 	lt_return_val_if_fail (module->funcs != NULL, NULL);
 	lt_return_val_if_fail (module->funcs->create_data != NULL, NULL);
 
+	LT_STATS_INC (module_calls);
+
 	return module->funcs->create_data();
 }
 
@@ -497,13 +504,20 @@ lt_ext_module_parse_tag(lt_ext_module_t       *module,
 			const char            *subtag,
 			lt_error_t           **error)
 {
+	lt_bool_t retval;
+
 	lt_return_val_if_fail (module != NULL, FALSE);
 	lt_return_val_if_fail (data != NULL, FALSE);
 	lt_return_val_if_fail (subtag != NULL, FALSE);
 	lt_return_val_if_fail (module->funcs != NULL, FALSE);
 	lt_return_val_if_fail (module->funcs->parse_tag != NULL, FALSE);
 
-	return module->funcs->parse_tag(data, subtag, error);
+	LT_STATS_INC (module_calls);
+	LT_PROBE2 (ext_module_parse_start, module->name, subtag);
+	retval = module->funcs->parse_tag(data, subtag, error);
+	LT_PROBE3 (ext_module_parse_done, module->name, subtag, (int)retval);
+
+	return retval;
 }
 
 char *
@@ -515,6 +529,8 @@ lt_ext_module_get_tag(lt_ext_module_t      *module,
 	lt_return_val_if_fail (module->funcs != NULL, NULL);
 	lt_return_val_if_fail (module->funcs->get_tag != NULL, NULL);
 
+	LT_STATS_INC (module_calls);
+
 	return module->funcs->get_tag(data);
 }
 
@@ -527,6 +543,8 @@ lt_ext_module_validate_tag(lt_ext_module_t      *module,
 	lt_return_val_if_fail (module->funcs != NULL, FALSE);
 	lt_return_val_if_fail (module->funcs->validate_tag != NULL, FALSE);
 
+	LT_STATS_INC (module_calls);
+
 	return module->funcs->validate_tag(data);
 }
 
@@ -544,6 +562,7 @@ lt_ext_module_precheck_tag(lt_ext_module_t       *module,
 	lt_return_val_if_fail (module->funcs != NULL, FALSE);
 	lt_return_val_if_fail (module->funcs->precheck_tag != NULL, FALSE);
 
+	LT_STATS_INC (module_calls);
 	retval = module->funcs->precheck_tag(data, tag, &err);
 	if (lt_error_is_set(err, LT_ERR_ANY)) {
 		if (error)
@@ -49,6 +49,7 @@ lt_extension_create(void)
 	lt_extension_t *retval = lt_mem_alloc_object(sizeof (lt_extension_t));
 
 	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_EXTENSION);
 		retval->cached_tag = lt_string_new(NULL);
 		lt_mem_add_ref(&retval->parent, retval->cached_tag,
 			       (lt_destroy_func_t)lt_string_unref);
@@ -335,7 +336,7 @@ lt_extension_get_canonicalized_tag(lt_extension_t *extension)
 					free(s);
 					lt_ext_module_unref(m);
 				} else {
-					lt_warning("Unable to obtain the certain module instance: singleton = '%c", c);
+					lt_warning_ratelimited("Unable to obtain the certain module instance: singleton = '%c", c);
 					break;
 				}
 			}
@@ -14,14 +14,19 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <libxml/xpath.h>
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-extlang.h"
 #include "lt-extlang-private.h"
 #include "lt-iter-private.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -40,6 +45,7 @@ struct _lt_extlang_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *extlang_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_extlang_db_iter_t {
 	lt_iter_t  parent;
@@ -61,6 +67,11 @@ lt_extlang_db_parse(lt_extlang_db_t  *extlangdb,
 	lt_return_val_if_fail (extlangdb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(extlangdb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -68,6 +79,7 @@ lt_extlang_db_parse(lt_extlang_db_t  *extlangdb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/extlang", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -92,8 +104,8 @@ lt_extlang_db_parse(lt_extlang_db_t  *extlangdb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"subtag") == 0) {
 				if (subtag) {
-					lt_warning("Duplicate subtag element in extlang: previous value was '%s'",
-						   subtag);
+					lt_warning_ratelimited("Duplicate subtag element in extlang: previous value was '%s'",
+							       subtag);
 				} else {
 					subtag = xmlNodeGetContent(cnode);
 				}
@@ -106,38 +118,38 @@ lt_extlang_db_parse(lt_extlang_db_t  *extlangdb,
 					desc = xmlNodeGetContent(cnode);
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"macrolanguage") == 0) {
 				if (macrolang) {
-					lt_warning("Duplicate macrolanguage element in extlang: previous value was '%s'",
-						   macrolang);
+					lt_warning_ratelimited("Duplicate macrolanguage element in extlang: previous value was '%s'",
+							       macrolang);
 				} else {
 					macrolang = xmlNodeGetContent(cnode);
 				}
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"preferred-value") == 0) {
 				if (preferred) {
-					lt_warning("Duplicate preferred-value element in extlang: previous value was '%s'",
-						   preferred);
+					lt_warning_ratelimited("Duplicate preferred-value element in extlang: previous value was '%s'",
+							       preferred);
 				} else {
 					preferred = xmlNodeGetContent(cnode);
 				}
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"prefix") == 0) {
 				if (prefix) {
-					lt_warning("Duplicate prefix element in extlang: previous value was '%s'",
-						   prefix);
+					lt_warning_ratelimited("Duplicate prefix element in extlang: previous value was '%s'",
+							       prefix);
 				} else {
 					prefix = xmlNodeGetContent(cnode);
 				}
 			} else {
-				lt_warning("Unknown node under /registry/extlang: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/extlang: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!subtag) {
-			lt_warning("No subtag node: description = '%s', macrolanguage = '%s', preferred-value = '%s', prefix = '%s'",
-				   desc, macrolang, preferred, prefix);
+			lt_warning_ratelimited("No subtag node: description = '%s', macrolanguage = '%s', preferred-value = '%s', prefix = '%s'",
+					       desc, macrolang, preferred, prefix);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: subtag = '%s', macrolanguage = '%s', preferred-value = '%s', prefix = '%s'",
-				   subtag, macrolang, preferred, prefix);
+			lt_warning_ratelimited("No description node: subtag = '%s', macrolanguage = '%s', preferred-value = '%s', prefix = '%s'",
+					       subtag, macrolang, preferred, prefix);
 			goto bail1;
 		}
 		le = lt_extlang_create();
@@ -200,7 +212,10 @@ _lt_extlang_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_extlang_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)extlangdb->extlang_entries);
+		if (extlangdb->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)extlangdb->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)extlangdb->extlang_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -228,6 +243,40 @@ _lt_extlang_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_extlang_db_probe(lt_extlang_db_t *extlangdb,
+		    const char      *key,
+		    lt_db_probe_t   *probe)
+{
+	lt_extlang_t *extlang;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (extlangdb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (extlangdb->image) {
+		retval = lt_db_image_table_probe(extlangdb->image, key, probe);
+		LT_STATS_DB_LOOKUP (EXTLANG, retval);
+		LT_PROBE_DB_LOOKUP (EXTLANG, key, retval);
+
+		return retval;
+	}
+	extlang = lt_trie_lookup(extlangdb->extlang_entries, key);
+	LT_STATS_DB_LOOKUP (EXTLANG, extlang != NULL);
+	LT_PROBE_DB_LOOKUP (EXTLANG, key, extlang != NULL);
+	if (!extlang)
+		return FALSE;
+	probe->tag = lt_extlang_get_tag(extlang);
+	probe->preferred_tag = lt_extlang_get_preferred_tag(extlang);
+	probe->prefix = lt_extlang_get_prefix(extlang);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_extlang_db_new:
@@ -242,11 +291,28 @@ lt_extlang_db_new(void)
 	lt_extlang_db_t *retval = lt_mem_alloc_object(sizeof (lt_extlang_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 		lt_extlang_t *le;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_extlang_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_EXTLANG);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_extlang_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->extlang_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->extlang_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -330,19 +396,120 @@ lt_extlang_db_unref(lt_extlang_db_t *extlangdb)
 lt_extlang_t *
 lt_extlang_db_lookup(lt_extlang_db_t *extlangdb,
 		     const char      *subtag)
+{
+	lt_return_val_if_fail (subtag != NULL, NULL);
+
+	return lt_extlang_db_lookup_len(extlangdb, subtag, strlen(subtag));
+}
+
+/**
+ * lt_extlang_db_lookup_len:
+ * @extlangdb: a #lt_extlang_db_t.
+ * @subtag: a subtag name to lookup.
+ * @length: the length of @subtag in bytes.
+ *
+ * Lookup @lt_extlang_t if @subtag is valid and registered into the database.
+ * This is the same as lt_extlang_db_lookup() but @subtag doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_extlang_t that meets with @subtag.
+ *                           otherwise %NULL.
+ */
+lt_extlang_t *
+lt_extlang_db_lookup_len(lt_extlang_db_t *extlangdb,
+			 const char      *subtag,
+			 size_t           length)
 {
 	lt_extlang_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (extlangdb != NULL, NULL);
 	lt_return_val_if_fail (subtag != NULL, NULL);
 
-	s = strdup(subtag);
-	retval = lt_trie_lookup(extlangdb->extlang_entries,
-				lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_extlang_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), subtag, length);
+	if (!s)
+		return NULL;
+	if (extlangdb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(extlangdb->image, s);
+	} else {
+		retval = lt_trie_lookup(extlangdb->extlang_entries, s);
+		if (retval)
+			lt_extlang_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (EXTLANG, retval != NULL);
+	LT_PROBE_DB_LOOKUP (EXTLANG, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_extlang_db_export:
+ * @extlangdb: a #lt_extlang_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @extlangdb at once. @entries is filled with
+ * the pairs of the key and #lt_extlang_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_extlang_db_export(lt_extlang_db_t  *extlangdb,
+		     lt_iter_entry_t **entries)
+{
+	lt_return_val_if_fail (extlangdb != NULL, 0);
+
+	return lt_iter_export(&extlangdb->parent, entries);
+}
+
+/**
+ * lt_extlang_db_complete:
+ * @extlangdb: a #lt_extlang_db_t.
+ * @prefix: the prefix of the subtag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose subtag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_extlang_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_extlang_db_complete(lt_extlang_db_t  *extlangdb,
+		       const char       *prefix,
+		       size_t            max,
+		       lt_iter_entry_t **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (extlangdb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (extlangdb->image)
+		iter = lt_db_image_table_prefix_iter(extlangdb->image, s);
+	else
+		iter = lt_trie_prefix_iter(extlangdb->extlang_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
@@ -18,6 +18,7 @@
 #define __LT_EXTLANG_DB_H__
 
 #include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-extlang.h>
 
 LT_BEGIN_DECLS
@@ -31,11 +32,20 @@ LT_BEGIN_DECLS
 typedef struct _lt_extlang_db_t	lt_extlang_db_t;
 
 
-lt_extlang_db_t *lt_extlang_db_new   (void);
-lt_extlang_db_t *lt_extlang_db_ref   (lt_extlang_db_t *extlangdb);
-void             lt_extlang_db_unref (lt_extlang_db_t *extlangdb);
-lt_extlang_t    *lt_extlang_db_lookup(lt_extlang_db_t *extlangdb,
-                                      const char      *subtag);
+lt_extlang_db_t *lt_extlang_db_new       (void);
+lt_extlang_db_t *lt_extlang_db_ref       (lt_extlang_db_t *extlangdb);
+void             lt_extlang_db_unref     (lt_extlang_db_t *extlangdb);
+lt_extlang_t    *lt_extlang_db_lookup    (lt_extlang_db_t *extlangdb,
+                                          const char      *subtag);
+lt_extlang_t    *lt_extlang_db_lookup_len(lt_extlang_db_t *extlangdb,
+                                          const char      *subtag,
+                                          size_t           length);
+size_t           lt_extlang_db_export    (lt_extlang_db_t *extlangdb,
+                                          lt_iter_entry_t **entries);
+size_t           lt_extlang_db_complete  (lt_extlang_db_t *extlangdb,
+                                          const char      *prefix,
+                                          size_t           max,
+                                          lt_iter_entry_t **entries);
 
 LT_END_DECLS
 
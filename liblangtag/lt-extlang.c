@@ -51,6 +51,9 @@ lt_extlang_create(void)
 
 	retval = lt_mem_alloc_object(sizeof (lt_extlang_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_EXTLANG);
+
 	return retval;
 }
 
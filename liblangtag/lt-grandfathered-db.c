@@ -14,14 +14,19 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <libxml/xpath.h>
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-grandfathered.h"
 #include "lt-grandfathered-private.h"
 #include "lt-iter-private.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -40,6 +45,7 @@ struct _lt_grandfathered_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *grandfathered_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_grandfathered_db_iter_t {
 	lt_iter_t  parent;
@@ -61,6 +67,11 @@ lt_grandfathered_db_parse(lt_grandfathered_db_t  *grandfathereddb,
 	lt_return_val_if_fail (grandfathereddb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(grandfathereddb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -68,6 +79,7 @@ lt_grandfathered_db_parse(lt_grandfathered_db_t  *grandfathereddb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/grandfathered", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -92,8 +104,8 @@ lt_grandfathered_db_parse(lt_grandfathered_db_t  *grandfathereddb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"tag") == 0) {
 				if (tag) {
-					lt_warning("Duplicate tag element in grandfathered: previous value was '%s'",
-						   tag);
+					lt_warning_ratelimited("Duplicate tag element in grandfathered: previous value was '%s'",
+							       tag);
 				} else {
 					tag = xmlNodeGetContent(cnode);
 				}
@@ -107,24 +119,24 @@ lt_grandfathered_db_parse(lt_grandfathered_db_t  *grandfathereddb,
 					desc = xmlNodeGetContent(cnode);
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"preferred-value") == 0) {
 				if (preferred) {
-					lt_warning("Duplicate preferred-value element in grandfathered: previous value was '%s'",
-						   preferred);
+					lt_warning_ratelimited("Duplicate preferred-value element in grandfathered: previous value was '%s'",
+							       preferred);
 				} else {
 					preferred = xmlNodeGetContent(cnode);
 				}
 			} else {
-				lt_warning("Unknown node under /registry/grandfathered: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/grandfathered: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!tag) {
-			lt_warning("No tag node: description = '%s', preferred-value = '%s'",
-				   desc, preferred);
+			lt_warning_ratelimited("No tag node: description = '%s', preferred-value = '%s'",
+					       desc, preferred);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: tag = '%s', preferred-value = '%s'",
-				   tag, preferred);
+			lt_warning_ratelimited("No description node: tag = '%s', preferred-value = '%s'",
+					       tag, preferred);
 			goto bail1;
 		}
 		le = lt_grandfathered_create();
@@ -179,7 +191,10 @@ _lt_grandfathered_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_grandfathered_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->grandfathered_entries);
+		if (db->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->grandfathered_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -207,6 +222,39 @@ _lt_grandfathered_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_grandfathered_db_probe(lt_grandfathered_db_t *grandfathereddb,
+			  const char            *key,
+			  lt_db_probe_t         *probe)
+{
+	lt_grandfathered_t *grandfathered;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (grandfathereddb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (grandfathereddb->image) {
+		retval = lt_db_image_table_probe(grandfathereddb->image, key, probe);
+		LT_STATS_DB_LOOKUP (GRANDFATHERED, retval);
+		LT_PROBE_DB_LOOKUP (GRANDFATHERED, key, retval);
+
+		return retval;
+	}
+	grandfathered = lt_trie_lookup(grandfathereddb->grandfathered_entries, key);
+	LT_STATS_DB_LOOKUP (GRANDFATHERED, grandfathered != NULL);
+	LT_PROBE_DB_LOOKUP (GRANDFATHERED, key, grandfathered != NULL);
+	if (!grandfathered)
+		return FALSE;
+	probe->tag = lt_grandfathered_get_tag(grandfathered);
+	probe->preferred_tag = lt_grandfathered_get_preferred_tag(grandfathered);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_grandfathered_db_new:
@@ -221,10 +269,27 @@ lt_grandfathered_db_new(void)
 	lt_grandfathered_db_t *retval = lt_mem_alloc_object(sizeof (lt_grandfathered_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_grandfathered_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_GRANDFATHERED);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_grandfathered_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->grandfathered_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->grandfathered_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -294,19 +359,120 @@ lt_grandfathered_db_unref(lt_grandfathered_db_t *grandfathereddb)
 lt_grandfathered_t *
 lt_grandfathered_db_lookup(lt_grandfathered_db_t *grandfathereddb,
 			   const char            *tag)
+{
+	lt_return_val_if_fail (tag != NULL, NULL);
+
+	return lt_grandfathered_db_lookup_len(grandfathereddb, tag, strlen(tag));
+}
+
+/**
+ * lt_grandfathered_db_lookup_len:
+ * @grandfathereddb: a #lt_grandfathered_db_t.
+ * @tag: a tag name to lookup.
+ * @length: the length of @tag in bytes.
+ *
+ * Lookup @lt_grandfathered_t if @tag is valid and registered into the database.
+ * This is the same as lt_grandfathered_db_lookup() but @tag doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_grandfathered_t that meets with @tag.
+ *                           otherwise %NULL.
+ */
+lt_grandfathered_t *
+lt_grandfathered_db_lookup_len(lt_grandfathered_db_t *grandfathereddb,
+			       const char            *tag,
+			       size_t                 length)
 {
 	lt_grandfathered_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (grandfathereddb != NULL, NULL);
 	lt_return_val_if_fail (tag != NULL, NULL);
 
-	s = strdup(tag);
-	retval = lt_trie_lookup(grandfathereddb->grandfathered_entries,
-				lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_grandfathered_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), tag, length);
+	if (!s)
+		return NULL;
+	if (grandfathereddb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(grandfathereddb->image, s);
+	} else {
+		retval = lt_trie_lookup(grandfathereddb->grandfathered_entries, s);
+		if (retval)
+			lt_grandfathered_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (GRANDFATHERED, retval != NULL);
+	LT_PROBE_DB_LOOKUP (GRANDFATHERED, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_grandfathered_db_export:
+ * @grandfathereddb: a #lt_grandfathered_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @grandfathereddb at once. @entries is filled with
+ * the pairs of the key and #lt_grandfathered_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_grandfathered_db_export(lt_grandfathered_db_t *grandfathereddb,
+			   lt_iter_entry_t      **entries)
+{
+	lt_return_val_if_fail (grandfathereddb != NULL, 0);
+
+	return lt_iter_export(&grandfathereddb->parent, entries);
+}
+
+/**
+ * lt_grandfathered_db_complete:
+ * @grandfathereddb: a #lt_grandfathered_db_t.
+ * @prefix: the prefix of the tag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose tag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_grandfathered_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_grandfathered_db_complete(lt_grandfathered_db_t *grandfathereddb,
+			     const char            *prefix,
+			     size_t                 max,
+			     lt_iter_entry_t      **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (grandfathereddb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (grandfathereddb->image)
+		iter = lt_db_image_table_prefix_iter(grandfathereddb->image, s);
+	else
+		iter = lt_trie_prefix_iter(grandfathereddb->grandfathered_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
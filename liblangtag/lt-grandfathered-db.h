@@ -18,6 +18,7 @@
 #define __LT_GRANDFATHERED_DB_H__
 
 #include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-grandfathered.h>
 
 LT_BEGIN_DECLS
@@ -31,11 +32,20 @@ LT_BEGIN_DECLS
 typedef struct _lt_grandfathered_db_t	lt_grandfathered_db_t;
 
 
-lt_grandfathered_db_t *lt_grandfathered_db_new   (void);
-lt_grandfathered_db_t *lt_grandfathered_db_ref   (lt_grandfathered_db_t *grandfathereddb);
-void                   lt_grandfathered_db_unref (lt_grandfathered_db_t *grandfathereddb);
-lt_grandfathered_t    *lt_grandfathered_db_lookup(lt_grandfathered_db_t *grandfathereddb,
-                                                  const char            *tag);
+lt_grandfathered_db_t *lt_grandfathered_db_new       (void);
+lt_grandfathered_db_t *lt_grandfathered_db_ref       (lt_grandfathered_db_t *grandfathereddb);
+void                   lt_grandfathered_db_unref     (lt_grandfathered_db_t *grandfathereddb);
+lt_grandfathered_t    *lt_grandfathered_db_lookup    (lt_grandfathered_db_t *grandfathereddb,
+                                                      const char            *tag);
+lt_grandfathered_t    *lt_grandfathered_db_lookup_len(lt_grandfathered_db_t *grandfathereddb,
+                                                      const char            *tag,
+                                                      size_t                 length);
+size_t                 lt_grandfathered_db_export    (lt_grandfathered_db_t *grandfathereddb,
+                                                      lt_iter_entry_t      **entries);
+size_t                 lt_grandfathered_db_complete  (lt_grandfathered_db_t *grandfathereddb,
+                                                      const char            *prefix,
+                                                      size_t                 max,
+                                                      lt_iter_entry_t      **entries);
 
 LT_END_DECLS
 
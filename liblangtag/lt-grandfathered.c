@@ -48,6 +48,9 @@ lt_grandfathered_create(void)
 
 	retval = lt_mem_alloc_object(sizeof (lt_grandfathered_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_GRANDFATHERED);
+
 	return retval;
 }
 
@@ -40,7 +40,12 @@ struct _lt_iter_tmpl_t {
 		(_instance_)->next = _prefix_ ## _iter_next;	\
 	} LT_STMT_END
 
-void lt_iter_tmpl_init(lt_iter_tmpl_t *tmpl);
+void   lt_iter_tmpl_init(lt_iter_tmpl_t   *tmpl);
+size_t lt_iter_collect  (lt_iter_t        *iter,
+			 size_t            max,
+			 lt_iter_entry_t **entries);
+size_t lt_iter_export   (lt_iter_tmpl_t   *tmpl,
+			 lt_iter_entry_t **entries);
 
 LT_END_DECLS
 
@@ -15,7 +15,9 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include "lt-messages.h"
+#include "lt-string.h"
 #include "lt-iter-private.h"
 
 #define MAGIC_CODE	0xB1C023FF
@@ -31,6 +33,101 @@ lt_iter_tmpl_init(lt_iter_tmpl_t *tmpl)
 	tmpl->magic_code = MAGIC_CODE;
 }
 
+/* collects at most @max pairs from @iter, or all of them if @max is 0,
+ * into one block terminated by the entry with the NULL key. the keys are
+ * copied into the block after the entries and the values are referenced.
+ * the values have to be lt_mem_t objects.
+ */
+size_t
+lt_iter_collect(lt_iter_t        *iter,
+		size_t            max,
+		lt_iter_entry_t **entries)
+{
+	lt_iter_entry_t *e = NULL, *p;
+	lt_string_t *keys;
+	lt_pointer_t key, val;
+	size_t n = 0, allocated = 0, i, offset, len;
+	char *s;
+
+	lt_return_val_if_fail (iter != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	keys = lt_string_new(NULL);
+	if (!keys)
+		return 0;
+	while ((max == 0 || n < max) && lt_iter_next(iter, &key, &val)) {
+		if (n == allocated) {
+			if (allocated)
+				allocated *= 2;
+			else
+				allocated = max > 0 && max < 256 ? max : 256;
+			p = realloc(e, sizeof (lt_iter_entry_t) * (allocated + 1));
+			if (!p)
+				goto bail;
+			e = p;
+		}
+		offset = lt_string_length(keys);
+		len = strlen(key) + 1;
+		lt_string_append_len(keys, key, len);
+		if (lt_string_length(keys) != offset + len)
+			goto bail;
+		/* keep the offset until the keys are copied into the block */
+		e[n].key = (const char *)offset;
+		e[n++].value = lt_mem_ref(val);
+	}
+	if (n == 0) {
+		lt_string_unref(keys);
+
+		return 0;
+	}
+
+	offset = sizeof (lt_iter_entry_t) * (n + 1);
+	len = lt_string_length(keys);
+	p = realloc(e, offset + len);
+	if (!p)
+		goto bail;
+	e = p;
+	s = (char *)e + offset;
+	memcpy(s, lt_string_value(keys), len);
+	for (i = 0; i < n; i++)
+		e[i].key = s + (size_t)e[i].key;
+	e[n].key = NULL;
+	e[n].value = NULL;
+	*entries = e;
+	lt_string_unref(keys);
+
+	return n;
+  bail:
+	lt_critical("Unable to allocate a memory for the exported entries.");
+	for (i = 0; i < n; i++)
+		lt_mem_unref(e[i].value);
+	free(e);
+	lt_string_unref(keys);
+
+	return 0;
+}
+
+size_t
+lt_iter_export(lt_iter_tmpl_t   *tmpl,
+	       lt_iter_entry_t **entries)
+{
+	lt_iter_t *iter;
+	size_t retval;
+
+	lt_return_val_if_fail (tmpl != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	iter = lt_iter_init(tmpl);
+	if (!iter)
+		return 0;
+	retval = lt_iter_collect(iter, 0, entries);
+	lt_iter_finish(iter);
+
+	return retval;
+}
+
 /*< public >*/
 lt_iter_t *
 lt_iter_ref(lt_iter_t *iter)
@@ -91,3 +188,21 @@ lt_iter_next(lt_iter_t    *iter,
 
 	return iter->target->next(iter, key, val);
 }
+
+/**
+ * lt_iter_entries_free:
+ * @entries: the entries exported from the database.
+ *
+ * Release the values in @entries and free @entries.
+ */
+void
+lt_iter_entries_free(lt_iter_entry_t *entries)
+{
+	lt_iter_entry_t *e;
+
+	if (!entries)
+		return;
+	for (e = entries; e->key; e++)
+		lt_mem_unref(e->value);
+	free(entries);
+}
@@ -23,11 +23,25 @@ LT_BEGIN_DECLS
 
 typedef struct _lt_iter_tmpl_t	lt_iter_tmpl_t;
 typedef struct _lt_iter_t	lt_iter_t;
+typedef struct _lt_iter_entry_t	lt_iter_entry_t;
 
 struct _lt_iter_t {
 	lt_iter_tmpl_t *target;
 };
 
+/**
+ * lt_iter_entry_t:
+ * @key: the key.
+ * @value: the value for @key.
+ *
+ * A pair of the key and the value exported from the database.
+ * see lt_lang_db_export() for example.
+ */
+struct _lt_iter_entry_t {
+	const char   *key;
+	lt_pointer_t  value;
+};
+
 lt_iter_t *lt_iter_ref   (lt_iter_t      *iter);
 void       lt_iter_unref (lt_iter_t      *iter);
 lt_iter_t *lt_iter_init  (lt_iter_tmpl_t *tmpl);
@@ -35,6 +49,7 @@ void       lt_iter_finish(lt_iter_t      *iter);
 lt_bool_t  lt_iter_next  (lt_iter_t      *iter,
                           lt_pointer_t   *key,
                           lt_pointer_t   *val);
+void       lt_iter_entries_free(lt_iter_entry_t *entries);
 
 LT_END_DECLS
 
@@ -14,12 +14,17 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <libxml/xpath.h>
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-iter-private.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -39,6 +44,7 @@ struct _lt_lang_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *lang_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_lang_db_iter_t {
 	lt_iter_t  parent;
@@ -60,6 +66,11 @@ lt_lang_db_parse(lt_lang_db_t  *langdb,
 	lt_return_val_if_fail (langdb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(langdb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -67,6 +78,7 @@ lt_lang_db_parse(lt_lang_db_t  *langdb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/language", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -92,8 +104,8 @@ lt_lang_db_parse(lt_lang_db_t  *langdb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"subtag") == 0) {
 				if (subtag) {
-					lt_warning("Duplicate subtag element in language: previous value was '%s'",
-						   subtag);
+					lt_warning_ratelimited("Duplicate subtag element in language: previous value was '%s'",
+							       subtag);
 				} else {
 					subtag = xmlNodeGetContent(cnode);
 				}
@@ -108,45 +120,45 @@ lt_lang_db_parse(lt_lang_db_t  *langdb,
 					desc = xmlNodeGetContent(cnode);
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"scope") == 0) {
 				if (scope) {
-					lt_warning("Duplicate scope element in language: previous value was '%s'",
-						   scope);
+					lt_warning_ratelimited("Duplicate scope element in language: previous value was '%s'",
+							       scope);
 				} else {
 					scope = xmlNodeGetContent(cnode);
 				}
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"macrolanguage") == 0) {
 				if (macrolang) {
-					lt_warning("Duplicate macrolanguage element in language: previous value was '%s'",
-						   macrolang);
+					lt_warning_ratelimited("Duplicate macrolanguage element in language: previous value was '%s'",
+							       macrolang);
 				} else {
 					macrolang = xmlNodeGetContent(cnode);
 				}
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"preferred-value") == 0) {
 				if (preferred) {
-					lt_warning("Duplicate preferred-value element in language: previous value was '%s'",
-						   preferred);
+					lt_warning_ratelimited("Duplicate preferred-value element in language: previous value was '%s'",
+							       preferred);
 				} else {
 					preferred = xmlNodeGetContent(cnode);
 				}
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"suppress-script") == 0) {
 				if (suppress) {
-					lt_warning("Duplicate suppress-script element in language: previous value was '%s'",
-						   suppress);
+					lt_warning_ratelimited("Duplicate suppress-script element in language: previous value was '%s'",
+							       suppress);
 				} else {
 					suppress = xmlNodeGetContent(cnode);
 				}
 			} else {
-				lt_warning("Unknown node under /registry/language: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/language: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!subtag) {
-			lt_warning("No subtag node: description = '%s', scope = '%s', macrolanguage = '%s'",
-				   desc, scope, macrolang);
+			lt_warning_ratelimited("No subtag node: description = '%s', scope = '%s', macrolanguage = '%s'",
+					       desc, scope, macrolang);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: subtag = '%s', scope = '%s', macrolanguage = '%s'",
-				   subtag, scope, macrolang);
+			lt_warning_ratelimited("No description node: subtag = '%s', scope = '%s', macrolanguage = '%s'",
+					       subtag, scope, macrolang);
 			goto bail1;
 		}
 		le = lt_lang_create();
@@ -213,7 +225,10 @@ _lt_lang_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_lang_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)langdb->lang_entries);
+		if (langdb->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)langdb->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)langdb->lang_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -241,6 +256,40 @@ _lt_lang_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_lang_db_probe(lt_lang_db_t  *langdb,
+		 const char    *key,
+		 lt_db_probe_t *probe)
+{
+	lt_lang_t *lang;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (langdb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (langdb->image) {
+		retval = lt_db_image_table_probe(langdb->image, key, probe);
+		LT_STATS_DB_LOOKUP (LANG, retval);
+		LT_PROBE_DB_LOOKUP (LANG, key, retval);
+
+		return retval;
+	}
+	lang = lt_trie_lookup(langdb->lang_entries, key);
+	LT_STATS_DB_LOOKUP (LANG, lang != NULL);
+	LT_PROBE_DB_LOOKUP (LANG, key, lang != NULL);
+	if (!lang)
+		return FALSE;
+	probe->tag = lt_lang_get_tag(lang);
+	probe->preferred_tag = lt_lang_get_preferred_tag(lang);
+	probe->suppress_script = lt_lang_get_suppress_script(lang);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_lang_db_new:
@@ -255,11 +304,28 @@ lt_lang_db_new(void)
 	lt_lang_db_t *retval = lt_mem_alloc_object(sizeof (lt_lang_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 		lt_lang_t *le;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_lang_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_LANG);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_lang_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->lang_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->lang_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -337,18 +403,120 @@ lt_lang_db_unref(lt_lang_db_t *langdb)
 lt_lang_t *
 lt_lang_db_lookup(lt_lang_db_t *langdb,
 		  const char   *subtag)
+{
+	lt_return_val_if_fail (subtag != NULL, NULL);
+
+	return lt_lang_db_lookup_len(langdb, subtag, strlen(subtag));
+}
+
+/**
+ * lt_lang_db_lookup_len:
+ * @langdb: a #lt_lang_db_t.
+ * @subtag: a subtag name to lookup.
+ * @length: the length of @subtag in bytes.
+ *
+ * Lookup @lt_lang_t if @subtag is valid and registered into the database.
+ * This is the same as lt_lang_db_lookup() but @subtag doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_lang_t that meets with @subtag.
+ *                           otherwise %NULL.
+ */
+lt_lang_t *
+lt_lang_db_lookup_len(lt_lang_db_t *langdb,
+		      const char   *subtag,
+		      size_t        length)
 {
 	lt_lang_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (langdb != NULL, NULL);
 	lt_return_val_if_fail (subtag != NULL, NULL);
 
-	s = strdup(subtag);
-	retval = lt_trie_lookup(langdb->lang_entries, lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_lang_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), subtag, length);
+	if (!s)
+		return NULL;
+	if (langdb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(langdb->image, s);
+	} else {
+		retval = lt_trie_lookup(langdb->lang_entries, s);
+		if (retval)
+			lt_lang_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (LANG, retval != NULL);
+	LT_PROBE_DB_LOOKUP (LANG, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_lang_db_export:
+ * @langdb: a #lt_lang_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @langdb at once. @entries is filled with
+ * the pairs of the key and #lt_lang_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_lang_db_export(lt_lang_db_t     *langdb,
+		  lt_iter_entry_t **entries)
+{
+	lt_return_val_if_fail (langdb != NULL, 0);
+
+	return lt_iter_export(&langdb->parent, entries);
+}
+
+/**
+ * lt_lang_db_complete:
+ * @langdb: a #lt_lang_db_t.
+ * @prefix: the prefix of the subtag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose subtag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_lang_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_lang_db_complete(lt_lang_db_t     *langdb,
+		    const char       *prefix,
+		    size_t            max,
+		    lt_iter_entry_t **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (langdb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (langdb->image)
+		iter = lt_db_image_table_prefix_iter(langdb->image, s);
+	else
+		iter = lt_trie_prefix_iter(langdb->lang_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
@@ -31,11 +31,20 @@ LT_BEGIN_DECLS
  */
 typedef struct _lt_lang_db_t		lt_lang_db_t;
 
-lt_lang_db_t *lt_lang_db_new   (void);
-lt_lang_db_t *lt_lang_db_ref   (lt_lang_db_t *langdb);
-void          lt_lang_db_unref (lt_lang_db_t *langdb);
-lt_lang_t    *lt_lang_db_lookup(lt_lang_db_t *langdb,
-                                const char   *subtag);
+lt_lang_db_t *lt_lang_db_new       (void);
+lt_lang_db_t *lt_lang_db_ref       (lt_lang_db_t *langdb);
+void          lt_lang_db_unref     (lt_lang_db_t *langdb);
+lt_lang_t    *lt_lang_db_lookup    (lt_lang_db_t *langdb,
+                                    const char   *subtag);
+lt_lang_t    *lt_lang_db_lookup_len(lt_lang_db_t *langdb,
+                                    const char   *subtag,
+                                    size_t        length);
+size_t        lt_lang_db_export    (lt_lang_db_t *langdb,
+                                    lt_iter_entry_t **entries);
+size_t        lt_lang_db_complete  (lt_lang_db_t *langdb,
+                                    const char   *prefix,
+                                    size_t        max,
+                                    lt_iter_entry_t **entries);
 
 LT_END_DECLS
 
@@ -49,6 +49,9 @@ lt_lang_create(void)
 {
 	lt_lang_t *retval = lt_mem_alloc_object(sizeof (lt_lang_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_LANG);
+
 	return retval;
 }
 
@@ -35,6 +35,8 @@ struct _lt_list_t {
 	lt_pointer_t  value;
 };
 
+static lt_mem_pool_t __lt_list_pool = LT_MEM_POOL_INIT (sizeof (lt_list_t));
+
 /*< private >*/
 static void
 _lt_list_update(lt_pointer_t data)
@@ -78,7 +80,13 @@ _lt_list_sort_merge(lt_list_t         *l1,
 lt_list_t *
 lt_list_new(void)
 {
-	return lt_mem_alloc_object(sizeof (lt_list_t));
+	/* the nodes are created and destroyed very often */
+	lt_list_t *retval = lt_mem_pool_alloc_object(&__lt_list_pool);
+
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_LIST);
+
+	return retval;
 }
 
 /*< public >*/
@@ -0,0 +1,160 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-lock.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <time.h>
+#include "lt-lock.h"
+
+
+#if HAVE_PTHREAD && ENABLE_LOCK_STATS
+/* this can't be LT_LOCK_DEFINE_STATIC. the locks are registered with this
+ * held at the first use.
+ */
+static pthread_mutex_t __lt_lock_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static lt_lock_stats_t *__lt_lock_stats = NULL;
+
+/*< private >*/
+static unsigned long long
+_lt_lock_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* this has to be called with @lock held */
+static void
+_lt_lock_stats_acquired(lt_lock_t          *lock,
+			unsigned long long  start)
+{
+	lock->stats.acquired = _lt_lock_stats_now();
+	lock->stats.n_locks++;
+	if (start) {
+		lock->stats.n_contended++;
+		lock->stats.wait_ns += lock->stats.acquired - start;
+	}
+	if (!lock->stats.registered) {
+		pthread_mutex_lock(&__lt_lock_stats_lock);
+		lock->stats.next = __lt_lock_stats;
+		__lt_lock_stats = &lock->stats;
+		lock->stats.registered = 1;
+		pthread_mutex_unlock(&__lt_lock_stats_lock);
+	}
+}
+
+/*< protected >*/
+void
+lt_lock_stats_init(lt_lock_t  *lock,
+		   const char *name,
+		   const char *file)
+{
+	pthread_mutex_init(&lock->lock, NULL);
+	memset(&lock->stats, 0, sizeof (lt_lock_stats_t));
+	lock->stats.name = name;
+	lock->stats.file = file;
+}
+
+/* the statistics of @lock are gone with it */
+void
+lt_lock_stats_fini(lt_lock_t *lock)
+{
+	lt_lock_stats_t **p;
+
+	if (lock->stats.registered) {
+		pthread_mutex_lock(&__lt_lock_stats_lock);
+		for (p = &__lt_lock_stats; *p != NULL; p = &(*p)->next) {
+			if (*p == &lock->stats) {
+				*p = lock->stats.next;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&__lt_lock_stats_lock);
+	}
+	pthread_mutex_destroy(&lock->lock);
+}
+
+void
+lt_lock_stats_lock(lt_lock_t *lock)
+{
+	unsigned long long start = 0;
+
+	/* don't see the clock for the locks not contended */
+	if (pthread_mutex_trylock(&lock->lock) != 0) {
+		start = _lt_lock_stats_now();
+		pthread_mutex_lock(&lock->lock);
+	}
+	_lt_lock_stats_acquired(lock, start);
+}
+
+void
+lt_lock_stats_unlock(lt_lock_t *lock)
+{
+	lock->stats.hold_ns += _lt_lock_stats_now() - lock->stats.acquired;
+	pthread_mutex_unlock(&lock->lock);
+}
+
+void
+lt_lock_stats_cond_wait(pthread_cond_t *cond,
+			lt_lock_t      *lock)
+{
+	/* the time to wait for the condition isn't the time to hold the lock */
+	lock->stats.hold_ns += _lt_lock_stats_now() - lock->stats.acquired;
+	pthread_cond_wait(cond, &lock->lock);
+	lock->stats.acquired = _lt_lock_stats_now();
+}
+#endif
+
+/*< public >*/
+/* the values may be changed by the other threads during this call.
+ * this returns FALSE if the statistics aren't recorded.
+ */
+lt_bool_t
+lt_lock_stats_foreach(lt_lock_stats_func_t func,
+		      lt_pointer_t         user_data)
+{
+#if HAVE_PTHREAD && ENABLE_LOCK_STATS
+	lt_lock_stats_t *stats;
+
+	pthread_mutex_lock(&__lt_lock_stats_lock);
+	for (stats = __lt_lock_stats; stats != NULL; stats = stats->next)
+		func(stats, user_data);
+	pthread_mutex_unlock(&__lt_lock_stats_lock);
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/* this has to be called when no threads are using the locks */
+void
+lt_lock_stats_reset(void)
+{
+#if HAVE_PTHREAD && ENABLE_LOCK_STATS
+	lt_lock_stats_t *stats;
+
+	pthread_mutex_lock(&__lt_lock_stats_lock);
+	for (stats = __lt_lock_stats; stats != NULL; stats = stats->next) {
+		stats->n_locks = 0;
+		stats->n_contended = 0;
+		stats->wait_ns = 0;
+		stats->hold_ns = 0;
+	}
+	pthread_mutex_unlock(&__lt_lock_stats_lock);
+#endif
+}
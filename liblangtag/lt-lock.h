@@ -26,21 +26,95 @@
 
 LT_BEGIN_DECLS
 
+typedef struct _lt_lock_stats_t		lt_lock_stats_t;
+
+/* The statistics of a lock, which is recorded when configured with
+ * --enable-lock-stats. the fields but @next are updated with the lock held.
+ */
+struct _lt_lock_stats_t {
+	const char         *name;
+	const char         *file;
+	unsigned long long  n_locks;
+	unsigned long long  n_contended;
+	unsigned long long  wait_ns;
+	unsigned long long  hold_ns;
+	unsigned long long  acquired;
+	int                 registered;
+	lt_lock_stats_t    *next;
+};
+
+typedef void (* lt_lock_stats_func_t) (const lt_lock_stats_t *stats,
+				       lt_pointer_t           user_data);
+
 #define LT_LOCK_DEFINE_STATIC(v)	static LT_LOCK_DEFINE(v)
-#define LT_LOCK_NAME(v)			__lt_ ## name ## _lock
+#define LT_LOCK_NAME(v)			__lt_ ## v ## _lock
+#define LT_COND_DEFINE_STATIC(v)	static LT_COND_DEFINE(v)
+#define LT_COND_NAME(v)			__lt_ ## v ## _cond
+/* the locks in the objects. @l is the lock itself, not the name, and it has
+ * to be initialized with LT_LOCK_INIT() and destroyed with LT_LOCK_FINI().
+ * @v is the name recorded in the statistics.
+ */
+#define LT_LOCK_DEFINE_DYNAMIC(l)	lt_lock_t l
+
+#if HAVE_PTHREAD && ENABLE_LOCK_STATS
+typedef struct _lt_lock_t {
+	pthread_mutex_t lock;
+	lt_lock_stats_t stats;
+} lt_lock_t;
+
+#define LT_LOCK_DEFINE(v)		lt_lock_t LT_LOCK_NAME (v) = { PTHREAD_MUTEX_INITIALIZER, { #v, __FILE__, 0, 0, 0, 0, 0, 0, NULL } }
+#define LT_LOCK(v)			lt_lock_stats_lock(&LT_LOCK_NAME (v))
+#define LT_UNLOCK(v)			lt_lock_stats_unlock(&LT_LOCK_NAME (v))
+#define LT_COND_DEFINE(v)		pthread_cond_t LT_COND_NAME (v) = PTHREAD_COND_INITIALIZER
+#define LT_COND_WAIT(v)			lt_lock_stats_cond_wait(&LT_COND_NAME (v), &LT_LOCK_NAME (v))
+#define LT_COND_BROADCAST(v)		pthread_cond_broadcast(&LT_COND_NAME (v))
+#define LT_LOCK_INIT(l,v)		lt_lock_stats_init(&(l), #v, __FILE__)
+#define LT_LOCK_FINI(l)			lt_lock_stats_fini(&(l))
+#define LT_LOCK_DYNAMIC(l)		lt_lock_stats_lock(&(l))
+#define LT_UNLOCK_DYNAMIC(l)		lt_lock_stats_unlock(&(l))
+
+void lt_lock_stats_init     (lt_lock_t      *lock,
+                             const char     *name,
+                             const char     *file);
+void lt_lock_stats_fini     (lt_lock_t      *lock);
+void lt_lock_stats_lock     (lt_lock_t      *lock);
+void lt_lock_stats_unlock   (lt_lock_t      *lock);
+void lt_lock_stats_cond_wait(pthread_cond_t *cond,
+                             lt_lock_t      *lock);
+#elif HAVE_PTHREAD
+typedef pthread_mutex_t lt_lock_t;
 
-#if HAVE_PTHREAD
 #define LT_LOCK_DEFINE(v)		pthread_mutex_t LT_LOCK_NAME (v) = PTHREAD_MUTEX_INITIALIZER
 #define LT_LOCK(v)			pthread_mutex_lock(&LT_LOCK_NAME (v))
 #define LT_UNLOCK(v)			pthread_mutex_unlock(&LT_LOCK_NAME (v))
+#define LT_COND_DEFINE(v)		pthread_cond_t LT_COND_NAME (v) = PTHREAD_COND_INITIALIZER
+#define LT_COND_WAIT(v)			pthread_cond_wait(&LT_COND_NAME (v), &LT_LOCK_NAME (v))
+#define LT_COND_BROADCAST(v)		pthread_cond_broadcast(&LT_COND_NAME (v))
+#define LT_LOCK_INIT(l,v)		pthread_mutex_init(&(l), NULL)
+#define LT_LOCK_FINI(l)			pthread_mutex_destroy(&(l))
+#define LT_LOCK_DYNAMIC(l)		pthread_mutex_lock(&(l))
+#define LT_UNLOCK_DYNAMIC(l)		pthread_mutex_unlock(&(l))
 #elif _WIN32
+typedef HANDLE lt_lock_t;
+
 #define LT_LOCK_DEFINE(v)		HANDLE LT_LOCK_NAME (v)
 #define LT_LOCK(v)			LT_LOCK_NAME (v) = CreateMutex(NULL, FALSE, NULL)
 #define LT_UNLOCK(v)			ReleaseMutex(LT_LOCK_NAME (v))
+#define LT_COND_DEFINE(v)		int LT_COND_NAME (v)
+#define LT_COND_WAIT(v)			LT_STMT_START { LT_UNLOCK (v); Sleep(1); LT_LOCK (v); } LT_STMT_END
+#define LT_COND_BROADCAST(v)		LT_COND_NAME (v) = 0
+#define LT_LOCK_INIT(l,v)		(l) = CreateMutex(NULL, FALSE, NULL)
+#define LT_LOCK_FINI(l)			CloseHandle(l)
+#define LT_LOCK_DYNAMIC(l)		WaitForSingleObject((l), INFINITE)
+#define LT_UNLOCK_DYNAMIC(l)		ReleaseMutex(l)
 #else
 #error No Mutex Lock available
 #endif
 
+lt_bool_t lt_lock_stats_foreach(lt_lock_stats_func_t func,
+                                lt_pointer_t         user_data);
+void      lt_lock_stats_reset  (void);
+
 LT_END_DECLS
 
 #endif /* __LT_LOCK_H__ */
@@ -0,0 +1,38 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-log-private.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_LOG_PRIVATE_H__
+#define __LT_LOG_PRIVATE_H__
+
+#include <stdarg.h>
+#include "lt-messages.h"
+#include "lt-log.h"
+
+LT_BEGIN_DECLS
+
+/* the number of the messages kept in the queue. this has to be
+ * a power of 2.
+ */
+#define LT_LOG_QUEUE_SIZE		256
+/* the messages longer than this are truncated in the queue */
+#define LT_LOG_MESSAGE_SIZE		256
+
+lt_bool_t lt_log_is_deferred(void);
+lt_bool_t lt_log_push       (lt_message_type_t      type,
+			     lt_message_flags_t     flags,
+			     lt_message_category_t  category,
+			     const char            *format,
+			     va_list                args);
+
+LT_END_DECLS
+
+#endif /* __LT_LOG_PRIVATE_H__ */
@@ -0,0 +1,280 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-log.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "lt-lock.h"
+#include "lt-log.h"
+#include "lt-log-private.h"
+
+
+/**
+ * SECTION: lt-log
+ * @Short_Description: The deferred delivery of the messages
+ * @Title: Logging
+ *
+ * The messages from the library, such as the warnings on the invalid data,
+ * are written into stderr by default while the caller is waiting. once
+ * lt_log_set_deferred() is enabled, they are kept in the bounded queue
+ * instead, and the application can deliver them with lt_log_drain() at
+ * any time, say, from the background thread. the messages are dropped
+ * when the queue is full.
+ */
+
+typedef struct _lt_log_entry_t {
+	volatile size_t        seq;
+	lt_message_type_t      type;
+	lt_message_flags_t     flags;
+	lt_message_category_t  category;
+	char                   message[LT_LOG_MESSAGE_SIZE];
+} lt_log_entry_t;
+
+/* the bounded queue which can be pushed and popped from any threads
+ * without the locks. each entry has the sequence number to see whether
+ * it's ready to be pushed or popped. the sequence number is kept
+ * relative to the index of the entry so that the queue works from
+ * the zero-initialized state.
+ */
+static lt_log_entry_t __lt_log_queue[LT_LOG_QUEUE_SIZE];
+static volatile size_t __lt_log_head = 0;
+static volatile size_t __lt_log_tail = 0;
+static volatile int __lt_log_deferred = FALSE;
+static unsigned long long __lt_log_dropped = 0;
+
+#ifndef __ATOMIC_RELAXED
+LT_LOCK_DEFINE_STATIC (log);
+#endif
+
+/*< private >*/
+static size_t
+_lt_log_load(volatile size_t *p)
+{
+#ifdef __ATOMIC_RELAXED
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+	return *p;
+#endif
+}
+
+static void
+_lt_log_store(volatile size_t *p,
+	      size_t           v)
+{
+#ifdef __ATOMIC_RELAXED
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+	*p = v;
+#endif
+}
+
+/* @old is updated with the current value on failure */
+static lt_bool_t
+_lt_log_cas(volatile size_t *p,
+	    size_t          *old,
+	    size_t           v)
+{
+#ifdef __ATOMIC_RELAXED
+	return __atomic_compare_exchange_n(p, old, v, FALSE,
+					   __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#else
+	if (*p == *old) {
+		*p = v;
+
+		return TRUE;
+	}
+	*old = *p;
+
+	return FALSE;
+#endif
+}
+
+static lt_bool_t
+_lt_log_pop(lt_log_entry_t *entry)
+{
+	lt_log_entry_t *e;
+	size_t pos, seq, i;
+	lt_bool_t retval = FALSE;
+
+#ifndef __ATOMIC_RELAXED
+	LT_LOCK (log);
+#endif
+	pos = _lt_log_load(&__lt_log_head);
+	for (;;) {
+		i = pos & (LT_LOG_QUEUE_SIZE - 1);
+		e = &__lt_log_queue[i];
+		seq = _lt_log_load(&e->seq) + i;
+		if (seq == pos + 1) {
+			if (_lt_log_cas(&__lt_log_head, &pos, pos + 1))
+				break;
+		} else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+			/* empty */
+			goto bail;
+		} else {
+			pos = _lt_log_load(&__lt_log_head);
+		}
+	}
+	entry->type = e->type;
+	entry->flags = e->flags;
+	entry->category = e->category;
+	memcpy(entry->message, e->message, LT_LOG_MESSAGE_SIZE);
+	/* ready to be pushed in the next round */
+	_lt_log_store(&e->seq, pos + LT_LOG_QUEUE_SIZE - i);
+	retval = TRUE;
+  bail:
+#ifndef __ATOMIC_RELAXED
+	LT_UNLOCK (log);
+#endif
+
+	return retval;
+}
+
+/*< protected >*/
+lt_bool_t
+lt_log_is_deferred(void)
+{
+#ifdef __ATOMIC_RELAXED
+	return __atomic_load_n(&__lt_log_deferred, __ATOMIC_RELAXED);
+#else
+	return __lt_log_deferred;
+#endif
+}
+
+/* formats the message into the queue. %FALSE if the queue is full. */
+lt_bool_t
+lt_log_push(lt_message_type_t      type,
+	    lt_message_flags_t     flags,
+	    lt_message_category_t  category,
+	    const char            *format,
+	    va_list                args)
+{
+	lt_log_entry_t *e;
+	size_t pos, seq, i;
+	lt_bool_t retval = FALSE;
+
+#ifndef __ATOMIC_RELAXED
+	LT_LOCK (log);
+#endif
+	pos = _lt_log_load(&__lt_log_tail);
+	for (;;) {
+		i = pos & (LT_LOG_QUEUE_SIZE - 1);
+		e = &__lt_log_queue[i];
+		seq = _lt_log_load(&e->seq) + i;
+		if (seq == pos) {
+			if (_lt_log_cas(&__lt_log_tail, &pos, pos + 1))
+				break;
+		} else if ((ptrdiff_t)(seq - pos) < 0) {
+			/* full */
+#ifdef __ATOMIC_RELAXED
+			__atomic_fetch_add(&__lt_log_dropped, 1, __ATOMIC_RELAXED);
+#else
+			__lt_log_dropped++;
+#endif
+			goto bail;
+		} else {
+			pos = _lt_log_load(&__lt_log_tail);
+		}
+	}
+	e->type = type;
+	e->flags = flags;
+	e->category = category;
+	vsnprintf(e->message, LT_LOG_MESSAGE_SIZE, format, args);
+	/* ready to be popped */
+	_lt_log_store(&e->seq, pos + 1 - i);
+	retval = TRUE;
+  bail:
+#ifndef __ATOMIC_RELAXED
+	LT_UNLOCK (log);
+#endif
+
+	return retval;
+}
+
+/*< public >*/
+
+/**
+ * lt_log_set_deferred:
+ * @flag: %TRUE to keep the messages in the queue.
+ *
+ * Enable or disable the deferred delivery of the messages. the messages
+ * but the fatal errors are formatted into the queue while it's enabled,
+ * and they are delivered when lt_log_drain() is called. the messages
+ * still queued aren't lost when it's disabled.
+ *
+ * Returns: the previous state.
+ */
+lt_bool_t
+lt_log_set_deferred(lt_bool_t flag)
+{
+#ifdef __ATOMIC_RELAXED
+	return __atomic_exchange_n(&__lt_log_deferred, flag ? TRUE : FALSE, __ATOMIC_RELAXED);
+#else
+	lt_bool_t retval = __lt_log_deferred;
+
+	__lt_log_deferred = flag ? TRUE : FALSE;
+
+	return retval;
+#endif
+}
+
+/**
+ * lt_log_drain:
+ * @func: (allow-none): a #lt_log_func_t to receive the messages, or %NULL.
+ * @user_data: the data passed to @func.
+ *
+ * Deliver the messages in the queue to @func in order. they are written
+ * into stderr, or passed to the handlers of the messages if any, when
+ * @func is %NULL. this can be called from any threads. the numbers of
+ * the messages suppressed by lt_warning_ratelimited() so far are reported
+ * first.
+ *
+ * Returns: the number of the messages delivered.
+ */
+size_t
+lt_log_drain(lt_log_func_t func,
+	     lt_pointer_t  user_data)
+{
+	lt_log_entry_t e;
+	size_t retval = 0;
+
+	lt_message_site_flush();
+	while (_lt_log_pop(&e)) {
+		if (func)
+			func((lt_log_level_t)e.type, e.message, user_data);
+		else
+			lt_message_dispatch(e.type, e.flags, e.category, e.message);
+		retval++;
+	}
+
+	return retval;
+}
+
+/**
+ * lt_log_get_dropped:
+ *
+ * Obtain the number of the messages dropped because the queue was full.
+ *
+ * Returns: the number of the messages dropped so far.
+ */
+unsigned long long
+lt_log_get_dropped(void)
+{
+#ifdef __ATOMIC_RELAXED
+	return __atomic_load_n(&__lt_log_dropped, __ATOMIC_RELAXED);
+#else
+	return __lt_log_dropped;
+#endif
+}
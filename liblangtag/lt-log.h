@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-log.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#if !defined (__LANGTAG_H__INSIDE) && !defined (__LANGTAG_COMPILATION)
+#error "Only <liblangtag/langtag.h> can be included directly."
+#endif
+
+#ifndef __LT_LOG_H__
+#define __LT_LOG_H__
+
+#include <liblangtag/lt-macros.h>
+
+LT_BEGIN_DECLS
+
+/**
+ * lt_log_level_t:
+ * @LT_LOG_CRITICAL: the critical errors, such as the invalid arguments.
+ * @LT_LOG_WARNING: the warnings.
+ * @LT_LOG_INFO: the informational messages.
+ * @LT_LOG_DEBUG: the debugging messages enabled by LT_DEBUG.
+ *
+ * The level of the messages from the library.
+ */
+enum _lt_log_level_t {
+	LT_LOG_CRITICAL = 2,
+	LT_LOG_WARNING,
+	LT_LOG_INFO,
+	LT_LOG_DEBUG
+};
+
+typedef enum _lt_log_level_t	lt_log_level_t;
+
+/**
+ * lt_log_func_t:
+ * @level: the level of @message.
+ * @message: the message.
+ * @user_data: the data passed to lt_log_drain().
+ *
+ * The function to receive the messages queued.
+ */
+typedef void (* lt_log_func_t) (lt_log_level_t  level,
+				const char     *message,
+				lt_pointer_t    user_data);
+
+lt_bool_t          lt_log_set_deferred(lt_bool_t      flag);
+size_t             lt_log_drain       (lt_log_func_t  func,
+                                       lt_pointer_t   user_data);
+unsigned long long lt_log_get_dropped (void);
+
+LT_END_DECLS
+
+#endif /* __LT_LOG_H__ */
@@ -15,134 +15,493 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include "lt-atomic.h"
+#include "lt-lock.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-stats-private.h"
+
+/* the reference count of the object which is never finalized */
+#define LT_MEM_REF_IMMORTAL	((int)0x7fffffff)
+/* n_slots in lt_mem_t when the references are moved to the table */
+#define LT_MEM_TABLE		((unsigned short)-1)
+/* this has to be power of 2 */
+#define LT_MEM_TABLE_SIZE	8
+#define LT_MEM_BUCKET_EMPTY	0
+#define LT_MEM_BUCKET_DELETED	((unsigned int)-1)
+/* the object is allocated from the arena. it isn't freed on finalizing */
+#define LT_MEM_FLAG_ARENA	(1 << 0)
+/* the object owns the arena placed in front of it */
+#define LT_MEM_FLAG_ARENA_OWNER	(1 << 1)
+/* the object is recycled through the pool */
+#define LT_MEM_FLAG_POOLED	(1 << 2)
+/* the memory of the object is accounted to its type */
+#define LT_MEM_FLAG_ACCOUNTED	(1 << 3)
+/* the upper bits of the flags keep the type of the object */
+#define LT_MEM_TYPE_SHIFT	8
+#define LT_MEM_FLAGS_MASK	((1 << LT_MEM_TYPE_SHIFT) - 1)
+#define LT_MEM_GET_TYPE(_o_)	((lt_stats_mem_type_t)((_o_)->flags >> LT_MEM_TYPE_SHIFT))
+/* the default size of the arena and the chunks added to it */
+#define LT_MEM_ARENA_SIZE	512
+#define LT_MEM_ALIGN(_s_)						\
+	(((_s_) + 2 * sizeof (lt_pointer_t) - 1) & ~(2 * sizeof (lt_pointer_t) - 1))
+#define LT_MEM_ARENA_HEADER_SIZE	LT_MEM_ALIGN (sizeof (lt_mem_arena_t))
+/* the pooled objects have a pointer to the pool in front of them */
+#define LT_MEM_POOL_HEADER_SIZE		LT_MEM_ALIGN (sizeof (lt_pointer_t))
+/* the number of the objects kept in the pool at most */
+#define LT_MEM_POOL_MAX_FREE		1024
+/* the objects accounted on the heap have the size in front of them */
+#define LT_MEM_SIZE_HEADER_SIZE		LT_MEM_ALIGN (sizeof (size_t))
+
+#if HAVE_PTHREAD && defined (LT_HAVE_TLS)
+#define LT_MEM_POOL_PER_THREAD	1
+/* the number of the pools which a thread keeps the objects for */
+#define LT_MEM_POOL_N_CACHES	4
+/* the number of the objects kept in a thread for each pool at most */
+#define LT_MEM_POOL_CACHE_MAX	64
+#endif
 
-struct _lt_mem_slist_t {
-	lt_mem_slist_t    *next;
-	lt_pointer_t       key;
-	lt_destroy_func_t  func;
+/* the references are kept in the order of the registration so that
+ * they are destroyed in the same order. the buckets are the open
+ * addressing hash table to look up the slot by the key.
+ */
+struct _lt_mem_table_t {
+	size_t         size;
+	size_t         n_slots;
+	size_t         n_live;
+	unsigned int  *buckets;
+	lt_mem_slot_t  slots[1];
+};
+/* the bump allocator. the memory allocated from it is never freed
+ * until the owner object is finalized.
+ */
+struct _lt_mem_arena_t {
+	char          *pos;
+	char          *end;
+	lt_pointer_t   chunks;
+	lt_bool_t      allocated;
+	size_t         size;
 };
 
-lt_mem_slist_t *lt_mem_slist_new        (void);
-void            lt_mem_slist_free       (lt_mem_slist_t     *list);
-lt_mem_slist_t *lt_mem_slist_last       (lt_mem_slist_t     *list);
-lt_mem_slist_t *lt_mem_slist_append     (lt_mem_slist_t     *list,
-                                         lt_pointer_t        key,
-                                         lt_destroy_func_t   func);
-lt_mem_slist_t *lt_mem_slist_delete     (lt_mem_slist_t     *list,
-                                         lt_pointer_t       *data);
-lt_mem_slist_t *lt_mem_slist_delete_link(lt_mem_slist_t     *list,
-                                         lt_mem_slist_t     *link_);
-lt_mem_slist_t *lt_mem_slist_find       (lt_mem_slist_t     *list,
-                                         const lt_pointer_t  data);
 
+#ifdef LT_MEM_POOL_PER_THREAD
+/* the objects freed in a thread are kept in the thread, so that
+ * the threads allocating and freeing them don't contend for the lock.
+ * they are moved to the pool when the thread exits.
+ */
+typedef struct _lt_mem_pool_cache_t {
+	lt_mem_pool_t *pool;
+	lt_pointer_t   free_list;
+	size_t         n_free;
+} lt_mem_pool_cache_t;
+#endif
+
+LT_LOCK_DEFINE_STATIC (mem_pool);
+#ifdef LT_MEM_POOL_PER_THREAD
+static __thread lt_mem_pool_cache_t __lt_mem_pool_caches[LT_MEM_POOL_N_CACHES];
+static __thread lt_bool_t __lt_mem_pool_registered = FALSE;
+static pthread_key_t __lt_mem_pool_key;
+static pthread_once_t __lt_mem_pool_once = PTHREAD_ONCE_INIT;
+static lt_bool_t __lt_mem_pool_has_key = FALSE;
+#endif
 
 /*< private >*/
+static void
+_lt_mem_clear_weak_pointer(lt_pointer_t data)
+{
+	lt_pointer_t *p = data;
+
+	*p = NULL;
+}
+
+#define LT_MEM_SLOT_IS_WEAK(_slot_)		\
+	((_slot_)->func == _lt_mem_clear_weak_pointer)
 
-/*< protected >*/
-lt_mem_slist_t *
-lt_mem_slist_new(void)
+static size_t
+_lt_mem_hash(lt_pointer_t p)
 {
-	return malloc(sizeof (lt_mem_slist_t));
+	size_t h = (size_t)p >> 3;
+
+	h ^= h >> 16;
+	h *= 0x45d9f3bU;
+	h ^= h >> 16;
+
+	return h;
 }
 
-void
-lt_mem_slist_free(lt_mem_slist_t *list)
+static lt_mem_table_t *
+_lt_mem_table_new(size_t size)
+{
+	lt_mem_table_t *retval;
+
+	retval = malloc(sizeof (lt_mem_table_t) +
+			sizeof (lt_mem_slot_t) * (size - 1) +
+			sizeof (unsigned int) * size * 2);
+	if (retval) {
+		retval->size = size;
+		retval->n_slots = 0;
+		retval->n_live = 0;
+		retval->buckets = (unsigned int *)&retval->slots[size];
+		memset(retval->buckets, 0, sizeof (unsigned int) * size * 2);
+	}
+
+	return retval;
+}
+
+static void
+_lt_mem_table_append(lt_mem_table_t    *table,
+		     lt_pointer_t       key,
+		     lt_destroy_func_t  func)
+{
+	size_t mask = table->size * 2 - 1;
+	size_t i = _lt_mem_hash(key) & mask;
+
+	/* the table is never filled more than a half */
+	while (table->buckets[i] != LT_MEM_BUCKET_EMPTY &&
+	       table->buckets[i] != LT_MEM_BUCKET_DELETED)
+		i = (i + 1) & mask;
+	table->slots[table->n_slots].key = key;
+	table->slots[table->n_slots].func = func;
+	table->buckets[i] = ++table->n_slots;
+	table->n_live++;
+}
+
+/* drops the deleted slots and grows the table if needed */
+static lt_mem_table_t *
+_lt_mem_table_resize(lt_mem_table_t *table)
 {
-	lt_mem_slist_t *l = list;
+	lt_mem_table_t *retval;
+	size_t i, n = 0, size = table->size;
+
+	if (table->n_live < size / 2) {
+		/* compact it in place. the objects reused for many times,
+		 * such as the tags being parsed, keep deleting and adding
+		 * the references and shouldn't allocate a table every time.
+		 */
+		for (i = 0; i < table->n_slots; i++) {
+			if (table->slots[i].key)
+				table->slots[n++] = table->slots[i];
+		}
+		table->n_slots = 0;
+		table->n_live = 0;
+		memset(table->buckets, 0, sizeof (unsigned int) * size * 2);
+		for (i = 0; i < n; i++)
+			_lt_mem_table_append(table,
+					     table->slots[i].key,
+					     table->slots[i].func);
+
+		return table;
+	}
+	retval = _lt_mem_table_new(size * 2);
+	if (retval) {
+		for (i = 0; i < table->n_slots; i++) {
+			if (table->slots[i].key)
+				_lt_mem_table_append(retval,
+						     table->slots[i].key,
+						     table->slots[i].func);
+		}
+		free(table);
+	}
+
+	return retval;
+}
 
-	while (l) {
-		list = l;
-		l = l->next;
-		free(list);
+static lt_mem_slot_t *
+_lt_mem_table_find(lt_mem_table_t *table,
+		   lt_pointer_t    key,
+		   lt_bool_t       weak,
+		   size_t         *bucket)
+{
+	size_t mask = table->size * 2 - 1;
+	size_t i = _lt_mem_hash(key) & mask;
+	lt_mem_slot_t *s;
+
+	while (table->buckets[i] != LT_MEM_BUCKET_EMPTY) {
+		if (table->buckets[i] != LT_MEM_BUCKET_DELETED) {
+			s = &table->slots[table->buckets[i] - 1];
+			if (s->key == key && LT_MEM_SLOT_IS_WEAK (s) == weak) {
+				if (bucket)
+					*bucket = i;
+				return s;
+			}
+		}
+		i = (i + 1) & mask;
+	}
+
+	return NULL;
+}
+
+static void
+_lt_mem_add(lt_mem_t          *object,
+	    lt_pointer_t       key,
+	    lt_destroy_func_t  func)
+{
+	lt_mem_table_t *table;
+	size_t i;
+
+	if (object->n_slots < LT_MEM_N_INLINE_SLOTS) {
+		object->refs.slots[object->n_slots].key = key;
+		object->refs.slots[object->n_slots].func = func;
+		object->n_slots++;
+
+		return;
+	}
+	if (object->n_slots != LT_MEM_TABLE) {
+		/* no more space in the object. move them to the table */
+		table = _lt_mem_table_new(LT_MEM_TABLE_SIZE);
+		if (!table)
+			goto bail;
+		for (i = 0; i < object->n_slots; i++)
+			_lt_mem_table_append(table,
+					     object->refs.slots[i].key,
+					     object->refs.slots[i].func);
+		object->refs.table = table;
+		object->n_slots = LT_MEM_TABLE;
 	}
+	table = object->refs.table;
+	if (table->n_slots == table->size) {
+		table = _lt_mem_table_resize(table);
+		if (!table)
+			goto bail;
+		object->refs.table = table;
+	}
+	_lt_mem_table_append(table, key, func);
+
+	return;
+  bail:
+	lt_critical("Out of memory");
 }
 
-lt_mem_slist_t *
-lt_mem_slist_last(lt_mem_slist_t *list)
+/* removes the reference without destroying it.
+ * the slot is copied into @slot if any.
+ */
+static lt_bool_t
+_lt_mem_remove(lt_mem_t      *object,
+	       lt_pointer_t   key,
+	       lt_bool_t      weak,
+	       lt_mem_slot_t *slot)
 {
-	if (list) {
-		while (list->next)
-			list = list->next;
+	lt_mem_slot_t *s;
+	size_t i;
+
+	if (object->n_slots == LT_MEM_TABLE) {
+		lt_mem_table_t *table = object->refs.table;
+
+		s = _lt_mem_table_find(table, key, weak, &i);
+		if (!s)
+			return FALSE;
+		if (slot)
+			*slot = *s;
+		s->key = NULL;
+		s->func = NULL;
+		table->buckets[i] = LT_MEM_BUCKET_DELETED;
+		table->n_live--;
+
+		return TRUE;
 	}
+	for (i = 0; i < object->n_slots; i++) {
+		s = &object->refs.slots[i];
+		if (s->key == key && LT_MEM_SLOT_IS_WEAK (s) == weak) {
+			if (slot)
+				*slot = *s;
+			object->n_slots--;
+			memmove(s, s + 1, sizeof (lt_mem_slot_t) * (object->n_slots - i));
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+_lt_mem_destroy_slots(lt_mem_slot_t *slots,
+		      size_t         n_slots)
+{
+	size_t i;
 
-	return list;
+	/* destroy the references first and clear the weak pointers then */
+	for (i = 0; i < n_slots; i++) {
+		if (slots[i].key && !LT_MEM_SLOT_IS_WEAK (&slots[i]))
+			slots[i].func(slots[i].key);
+	}
+	for (i = 0; i < n_slots; i++) {
+		if (slots[i].key && LT_MEM_SLOT_IS_WEAK (&slots[i]))
+			slots[i].func(slots[i].key);
+	}
 }
 
-lt_mem_slist_t *
-lt_mem_slist_append(lt_mem_slist_t    *list,
-		    lt_pointer_t       key,
-		    lt_destroy_func_t  func)
+static void
+_lt_mem_arena_free(lt_mem_arena_t *arena)
 {
-	lt_mem_slist_t *l = lt_mem_slist_new();
-	lt_mem_slist_t *last;
+	lt_pointer_t p, next;
 
-	l->key = key;
-	l->func = func;
-	l->next = NULL;
-	if (list) {
-		last = lt_mem_slist_last(list);
-		last->next = l;
+	for (p = arena->chunks; p != NULL; p = next) {
+		next = *(lt_pointer_t *)p;
+		free(p);
+	}
+	if (arena->allocated)
+		free(arena);
+}
+
+/* this has to be called with the lock held. the object is freed
+ * if the pool is full.
+ */
+static void
+_lt_mem_pool_push(lt_mem_pool_t *pool,
+		  lt_mem_t      *object)
+{
+	if (pool->n_free < LT_MEM_POOL_MAX_FREE) {
+		*(lt_pointer_t *)object = pool->free_list;
+		pool->free_list = object;
+		pool->n_free++;
 	} else {
-		list = l;
+		free((char *)object - LT_MEM_POOL_HEADER_SIZE);
 	}
+}
 
-	return list;
+#ifdef LT_MEM_POOL_PER_THREAD
+static void
+_lt_mem_pool_caches_free(void *data)
+{
+	lt_mem_pool_cache_t *caches = data;
+	lt_pointer_t next;
+	lt_mem_t *object;
+	int i;
+
+	LT_LOCK (mem_pool);
+	for (i = 0; i < LT_MEM_POOL_N_CACHES; i++) {
+		for (object = caches[i].free_list; object != NULL; object = next) {
+			next = *(lt_pointer_t *)object;
+			_lt_mem_pool_push(caches[i].pool, object);
+		}
+		caches[i].free_list = NULL;
+		caches[i].n_free = 0;
+	}
+	LT_UNLOCK (mem_pool);
+	/* register again if the objects are freed in the destructors
+	 * called later
+	 */
+	__lt_mem_pool_registered = FALSE;
 }
 
-lt_mem_slist_t *
-lt_mem_slist_delete(lt_mem_slist_t *list,
-		    lt_pointer_t   *data)
+static void
+_lt_mem_pool_key_init(void)
 {
-	lt_mem_slist_t *l = list;
+	__lt_mem_pool_has_key = pthread_key_create(&__lt_mem_pool_key, _lt_mem_pool_caches_free) == 0;
+}
 
-	while (l) {
-		if (l->key == data) {
-			list = lt_mem_slist_delete_link(list, l);
-			break;
-		} else {
-			l = l->next;
+/* the objects kept in the current thread for @pool, or %NULL if
+ * the thread can't keep them.
+ */
+static lt_mem_pool_cache_t *
+_lt_mem_pool_get_cache(lt_mem_pool_t *pool)
+{
+	int i;
+
+	if (!__lt_mem_pool_registered) {
+		pthread_once(&__lt_mem_pool_once, _lt_mem_pool_key_init);
+		if (!__lt_mem_pool_has_key ||
+		    pthread_setspecific(__lt_mem_pool_key, __lt_mem_pool_caches) != 0)
+			return NULL;
+		__lt_mem_pool_registered = TRUE;
+	}
+	for (i = 0; i < LT_MEM_POOL_N_CACHES; i++) {
+		if (__lt_mem_pool_caches[i].pool == pool)
+			return &__lt_mem_pool_caches[i];
+		if (!__lt_mem_pool_caches[i].pool) {
+			__lt_mem_pool_caches[i].pool = pool;
+			return &__lt_mem_pool_caches[i];
 		}
 	}
 
-	return list;
+	return NULL;
 }
+#endif
 
-lt_mem_slist_t *
-lt_mem_slist_delete_link(lt_mem_slist_t *list,
-			 lt_mem_slist_t *link_)
+static void
+_lt_mem_pool_release(lt_mem_t *object)
 {
-	lt_mem_slist_t *prev = NULL, *l = list;
+	char *p = (char *)object - LT_MEM_POOL_HEADER_SIZE;
+	lt_mem_pool_t *pool = *(lt_mem_pool_t **)p;
+#ifdef LT_MEM_POOL_PER_THREAD
+	lt_mem_pool_cache_t *cache = _lt_mem_pool_get_cache(pool);
+
+	if (cache && cache->n_free < LT_MEM_POOL_CACHE_MAX) {
+		*(lt_pointer_t *)object = cache->free_list;
+		cache->free_list = object;
+		cache->n_free++;
+		return;
+	}
+#endif
 
-	while (l) {
-		if (l == link_) {
-			if (prev)
-				prev->next = l->next;
-			if (list == l)
-				list = list->next;
-			free(link_);
-			break;
-		}
-		prev = l;
-		l = l->next;
+	LT_LOCK (mem_pool);
+	if (pool->n_free < LT_MEM_POOL_MAX_FREE) {
+		/* the object itself is used for the link */
+		*(lt_pointer_t *)object = pool->free_list;
+		pool->free_list = object;
+		pool->n_free++;
+		p = NULL;
 	}
+	LT_UNLOCK (mem_pool);
+	free(p);
+}
 
-	return list;
+#if ENABLE_STATS
+/* the memory on the heap which is owned by @object */
+static size_t
+_lt_mem_get_size(lt_mem_t *object)
+{
+	if (object->flags & LT_MEM_FLAG_ARENA_OWNER)
+		return ((lt_mem_arena_t *)((char *)object - LT_MEM_ARENA_HEADER_SIZE))->size;
+	else if (object->flags & LT_MEM_FLAG_POOLED)
+		return (*(lt_mem_pool_t **)((char *)object - LT_MEM_POOL_HEADER_SIZE))->size;
+	else if (object->flags & LT_MEM_FLAG_ARENA)
+		return 0;
+
+	return *(size_t *)((char *)object - LT_MEM_SIZE_HEADER_SIZE);
 }
 
-lt_mem_slist_t *
-lt_mem_slist_find(lt_mem_slist_t     *list,
-		  const lt_pointer_t  data)
+static void
+_lt_mem_account(lt_mem_t *object,
+		size_t    size)
 {
-	while (list) {
-		if (list->key == data)
-			break;
-		list = list->next;
+	if (lt_stats_mem_is_enabled()) {
+		object->flags |= LT_MEM_FLAG_ACCOUNTED;
+		lt_stats_mem_add(LT_STATS_MEM_UNKNOWN, 1, size);
 	}
+}
+#endif
+
+static void
+_lt_mem_finalize(lt_mem_t *object)
+{
+	char *p = (char *)object;
+
+	if (object->n_slots == LT_MEM_TABLE) {
+		lt_mem_table_t *table = object->refs.table;
 
-	return list;
+		_lt_mem_destroy_slots(table->slots, table->n_slots);
+		free(table);
+	} else {
+		_lt_mem_destroy_slots(object->refs.slots,
+				      object->n_slots);
+	}
+#if ENABLE_STATS
+	if (object->flags & LT_MEM_FLAG_ACCOUNTED) {
+		lt_stats_mem_add(LT_MEM_GET_TYPE (object), -1,
+				 -(long long)_lt_mem_get_size(object));
+		if ((object->flags & (LT_MEM_FLAG_ARENA | LT_MEM_FLAG_POOLED)) == 0)
+			p -= LT_MEM_SIZE_HEADER_SIZE;
+	}
+#endif
+	if (object->flags & LT_MEM_FLAG_ARENA_OWNER)
+		_lt_mem_arena_free((lt_mem_arena_t *)((char *)object - LT_MEM_ARENA_HEADER_SIZE));
+	else if (object->flags & LT_MEM_FLAG_POOLED)
+		_lt_mem_pool_release(object);
+	else if ((object->flags & LT_MEM_FLAG_ARENA) == 0)
+		free(p);
 }
 
 /*< public >*/
@@ -153,11 +512,29 @@ lt_mem_alloc_object(size_t size)
 
 	lt_return_val_if_fail (size > 0, NULL);
 
+#if ENABLE_STATS
+	if (lt_stats_mem_is_enabled()) {
+		char *p = calloc(1, LT_MEM_SIZE_HEADER_SIZE + size);
+
+		if (!p)
+			return NULL;
+		*(size_t *)p = size;
+		retval = (lt_mem_t *)(p + LT_MEM_SIZE_HEADER_SIZE);
+		retval->ref_count = 1;
+		retval->flags = LT_MEM_FLAG_ACCOUNTED;
+		lt_stats_mem_add(LT_STATS_MEM_UNKNOWN, 1, size);
+		LT_STATS_INC (objects_allocated);
+		LT_STATS_ADD (bytes_allocated, size);
+
+		return retval;
+	}
+#endif
 	retval = calloc(1, size);
 	if (retval) {
 		retval->ref_count = 1;
-		retval->refs = NULL;
-		retval->size = size;
+		retval->n_slots = 0;
+		LT_STATS_INC (objects_allocated);
+		LT_STATS_ADD (bytes_allocated, size);
 	}
 
 	return retval;
@@ -168,6 +545,12 @@ lt_mem_ref(lt_mem_t *object)
 {
 	lt_return_val_if_fail (object != NULL, NULL);
 
+	/* don't write anything into the immortal objects.
+	 * the pages are shared with the parent process after fork()
+	 * as long as no one writes them.
+	 */
+	if (lt_atomic_int_get((volatile int *)&object->ref_count) == LT_MEM_REF_IMMORTAL)
+		return object;
 	lt_atomic_int_inc((volatile int *)&object->ref_count);
 
 	return object;
@@ -178,33 +561,30 @@ lt_mem_unref(lt_mem_t *object)
 {
 	lt_return_if_fail (object != NULL);
 
-	if (lt_atomic_int_dec_and_test((volatile int *)&object->ref_count)) {
-		lt_mem_slist_t *ll, *l;
-
-		if (object->refs) {
-			ll = object->refs;
-			while (ll) {
-				l = ll;
-				ll = ll->next;
-				if (l->func)
-					l->func(l->key);
-				free(l);
-			}
-		}
-		if (object->weak_pointers) {
-			ll = object->weak_pointers;
-			while (ll) {
-				lt_pointer_t *p;
-
-				l = ll;
-				ll = ll->next;
-				p = (lt_pointer_t *)l->key;
-				*p = NULL;
-				free(l);
-			}
-		}
-		free(object);
-	}
+	if (lt_atomic_int_get((volatile int *)&object->ref_count) == LT_MEM_REF_IMMORTAL)
+		return;
+	if (lt_atomic_int_dec_and_test((volatile int *)&object->ref_count))
+		_lt_mem_finalize(object);
+}
+
+/* the object is never finalized and its reference count is never
+ * updated after this call. this isn't thread-safe. it has to be done
+ * before sharing the object with other threads.
+ */
+void
+lt_mem_set_immortal(lt_mem_t *object)
+{
+	lt_return_if_fail (object != NULL);
+
+	object->ref_count = LT_MEM_REF_IMMORTAL;
+}
+
+lt_bool_t
+lt_mem_is_immortal(lt_mem_t *object)
+{
+	lt_return_val_if_fail (object != NULL, FALSE);
+
+	return lt_atomic_int_get((volatile int *)&object->ref_count) == LT_MEM_REF_IMMORTAL;
 }
 
 void
@@ -216,48 +596,56 @@ lt_mem_add_ref(lt_mem_t          *object,
 	lt_return_if_fail (p != NULL);
 	lt_return_if_fail (func != NULL);
 
-	object->refs = lt_mem_slist_append(object->refs, p, func);
+	_lt_mem_add(object, p, func);
 }
 
 void
 lt_mem_remove_ref(lt_mem_t     *object,
 		  lt_pointer_t  p)
 {
-	lt_mem_slist_t *l;
-
 	lt_return_if_fail (object != NULL);
 	lt_return_if_fail (p != NULL);
 
-	if ((l = lt_mem_slist_find(object->refs, p)) != NULL) {
-		object->refs = lt_mem_slist_delete_link(object->refs, l);
-	}
+	_lt_mem_remove(object, p, FALSE, NULL);
 }
 
 void
 lt_mem_delete_ref(lt_mem_t     *object,
 		  lt_pointer_t  p)
 {
-	lt_mem_slist_t *l;
+	lt_mem_slot_t slot;
 
 	lt_return_if_fail (object != NULL);
 	lt_return_if_fail (p != NULL);
 
-	if ((l = lt_mem_slist_find(object->refs, p)) != NULL) {
-		if (l->func)
-			l->func(l->key);
-		object->refs = lt_mem_slist_delete_link(object->refs, l);
-	}
+	/* detach it before destroying so that the destructor can
+	 * touch the references in @object safely.
+	 */
+	if (_lt_mem_remove(object, p, FALSE, &slot))
+		slot.func(slot.key);
 }
 
 void
 lt_mem_add_weak_pointer(lt_mem_t     *object,
 			lt_pointer_t *p)
 {
+	lt_mem_slot_t *s;
+	size_t i;
+
 	lt_return_if_fail (object != NULL);
 	lt_return_if_fail (p != NULL);
 
-	if (!lt_mem_slist_find(object->weak_pointers, p))
-		object->weak_pointers = lt_mem_slist_append(object->weak_pointers, p, NULL);
+	if (object->n_slots == LT_MEM_TABLE) {
+		if (_lt_mem_table_find(object->refs.table, p, TRUE, NULL))
+			return;
+	} else {
+		for (i = 0; i < object->n_slots; i++) {
+			s = &object->refs.slots[i];
+			if (s->key == p && LT_MEM_SLOT_IS_WEAK (s))
+				return;
+		}
+	}
+	_lt_mem_add(object, p, _lt_mem_clear_weak_pointer);
 }
 
 void
@@ -267,5 +655,197 @@ lt_mem_remove_weak_pointer(lt_mem_t     *object,
 	lt_return_if_fail (object != NULL);
 	lt_return_if_fail (p != NULL);
 
-	object->weak_pointers = lt_mem_slist_delete(object->weak_pointers, p);
+	_lt_mem_remove(object, p, TRUE, NULL);
+}
+
+/* allocates the object in front of the arena. everything allocated from
+ * the arena is freed at once when the object is finalized.
+ * the arena is placed in @buffer if given. it has to be aligned to the pointer
+ * and be available until the object is finalized. otherwise the arena of
+ * @buffer_size bytes is allocated.
+ */
+lt_pointer_t
+lt_mem_alloc_object_with_arena(size_t       size,
+			       lt_pointer_t buffer,
+			       size_t       buffer_size)
+{
+	lt_mem_arena_t *arena;
+	lt_mem_t *retval;
+
+	lt_return_val_if_fail (size > 0, NULL);
+	lt_return_val_if_fail (((size_t)buffer & (sizeof (lt_pointer_t) - 1)) == 0, NULL);
+
+	size = LT_MEM_ALIGN (size);
+	if (buffer && buffer_size >= LT_MEM_ARENA_HEADER_SIZE + size) {
+		arena = buffer;
+		arena->allocated = FALSE;
+	} else {
+		if (buffer_size == 0)
+			buffer_size = LT_MEM_ARENA_SIZE;
+		if (buffer_size < LT_MEM_ARENA_HEADER_SIZE + size)
+			buffer_size = LT_MEM_ARENA_HEADER_SIZE + size;
+		arena = malloc(buffer_size);
+		if (!arena)
+			return NULL;
+		arena->allocated = TRUE;
+	}
+	arena->chunks = NULL;
+	arena->pos = (char *)arena + LT_MEM_ARENA_HEADER_SIZE;
+	arena->end = (char *)arena + buffer_size;
+	arena->size = arena->allocated ? buffer_size : 0;
+	retval = lt_mem_arena_alloc_object(arena, size);
+	retval->flags |= LT_MEM_FLAG_ARENA_OWNER;
+	LT_STATS_INC (objects_allocated);
+	LT_STATS_ADD (bytes_allocated, size);
+#if ENABLE_STATS
+	/* the owner is accounted for the whole arena on the heap */
+	if (retval->flags & LT_MEM_FLAG_ACCOUNTED)
+		lt_stats_mem_add(LT_STATS_MEM_UNKNOWN, 0, arena->size);
+#endif
+
+	return retval;
+}
+
+lt_mem_arena_t *
+lt_mem_get_arena(lt_mem_t *object)
+{
+	lt_return_val_if_fail (object != NULL, NULL);
+
+	if ((object->flags & LT_MEM_FLAG_ARENA_OWNER) == 0)
+		return NULL;
+
+	return (lt_mem_arena_t *)((char *)object - LT_MEM_ARENA_HEADER_SIZE);
+}
+
+lt_pointer_t
+lt_mem_arena_alloc(lt_mem_arena_t *arena,
+		   size_t          size)
+{
+	lt_pointer_t retval;
+
+	lt_return_val_if_fail (arena != NULL, NULL);
+	lt_return_val_if_fail (size > 0, NULL);
+
+	size = LT_MEM_ALIGN (size);
+	if ((size_t)(arena->end - arena->pos) < size) {
+		size_t chunk_size = LT_MEM_ALIGN (sizeof (lt_pointer_t)) + size;
+		char *chunk;
+
+		if (chunk_size < LT_MEM_ARENA_SIZE)
+			chunk_size = LT_MEM_ARENA_SIZE;
+		chunk = malloc(chunk_size);
+		if (!chunk)
+			return NULL;
+		*(lt_pointer_t *)chunk = arena->chunks;
+		arena->chunks = chunk;
+		arena->pos = chunk + LT_MEM_ALIGN (sizeof (lt_pointer_t));
+		arena->end = chunk + chunk_size;
+		arena->size += chunk_size;
+#if ENABLE_STATS
+		{
+			/* the owner is always placed in front of the arena */
+			lt_mem_t *owner = (lt_mem_t *)((char *)arena + LT_MEM_ARENA_HEADER_SIZE);
+
+			if (owner->flags & LT_MEM_FLAG_ACCOUNTED)
+				lt_stats_mem_add(LT_MEM_GET_TYPE (owner), 0, chunk_size);
+		}
+#endif
+	}
+	retval = arena->pos;
+	arena->pos += size;
+	memset(retval, 0, size);
+
+	return retval;
+}
+
+/* the object allocated from the arena has to be finalized before
+ * the owner of the arena.
+ */
+lt_pointer_t
+lt_mem_arena_alloc_object(lt_mem_arena_t *arena,
+			  size_t          size)
+{
+	lt_mem_t *retval;
+
+	lt_return_val_if_fail (arena != NULL, NULL);
+	lt_return_val_if_fail (size >= sizeof (lt_mem_t), NULL);
+
+	retval = lt_mem_arena_alloc(arena, size);
+	if (retval) {
+		retval->ref_count = 1;
+		retval->n_slots = 0;
+		retval->flags = LT_MEM_FLAG_ARENA;
+#if ENABLE_STATS
+		_lt_mem_account(retval, 0);
+#endif
+	}
+
+	return retval;
+}
+
+/* the object is recycled when it's finalized. the memory kept in
+ * the pool is never freed.
+ */
+lt_pointer_t
+lt_mem_pool_alloc_object(lt_mem_pool_t *pool)
+{
+	lt_mem_t *retval;
+	char *p;
+#ifdef LT_MEM_POOL_PER_THREAD
+	lt_mem_pool_cache_t *cache;
+#endif
+
+	lt_return_val_if_fail (pool != NULL, NULL);
+	lt_return_val_if_fail (pool->size >= sizeof (lt_mem_t), NULL);
+
+#ifdef LT_MEM_POOL_PER_THREAD
+	cache = _lt_mem_pool_get_cache(pool);
+	if (cache && cache->free_list) {
+		retval = cache->free_list;
+		cache->free_list = *(lt_pointer_t *)retval;
+		cache->n_free--;
+	} else
+#endif
+	{
+		LT_LOCK (mem_pool);
+		retval = pool->free_list;
+		if (retval) {
+			pool->free_list = *(lt_pointer_t *)retval;
+			pool->n_free--;
+		}
+		LT_UNLOCK (mem_pool);
+	}
+	if (!retval) {
+		p = malloc(LT_MEM_POOL_HEADER_SIZE + pool->size);
+		if (!p)
+			return NULL;
+		*(lt_mem_pool_t **)p = pool;
+		retval = (lt_mem_t *)(p + LT_MEM_POOL_HEADER_SIZE);
+	}
+	memset(retval, 0, pool->size);
+	retval->ref_count = 1;
+	retval->flags = LT_MEM_FLAG_POOLED;
+#if ENABLE_STATS
+	_lt_mem_account(retval, pool->size);
+#endif
+
+	return retval;
+}
+
+/* classifies @object for lt_stats_get_memory(). this has to be called
+ * right after allocating @object.
+ */
+void
+lt_mem_set_type(lt_mem_t            *object,
+		lt_stats_mem_type_t  type)
+{
+	lt_return_if_fail (object != NULL);
+	lt_return_if_fail (type < LT_STATS_MEM_END);
+
+#if ENABLE_STATS
+	if (object->flags & LT_MEM_FLAG_ACCOUNTED)
+		lt_stats_mem_move(LT_MEM_GET_TYPE (object), type,
+				  _lt_mem_get_size(object));
+	object->flags = (object->flags & LT_MEM_FLAGS_MASK) | (type << LT_MEM_TYPE_SHIFT);
+#endif
 }
@@ -14,22 +14,53 @@
 #define __LT_MEM_H__
 
 #include "lt-macros.h"
+#include "lt-stats.h"
 
 LT_BEGIN_DECLS
 
 typedef struct _lt_mem_t		lt_mem_t;
-typedef struct _lt_mem_slist_t		lt_mem_slist_t;
+typedef struct _lt_mem_slot_t		lt_mem_slot_t;
+typedef struct _lt_mem_table_t		lt_mem_table_t;
+typedef struct _lt_mem_arena_t		lt_mem_arena_t;
+typedef struct _lt_mem_pool_t		lt_mem_pool_t;
+
+struct _lt_mem_slot_t {
+	lt_pointer_t       key;
+	lt_destroy_func_t  func;
+};
+
+/* the number of the references kept in the object itself.
+ * lt_mem_t has to fit in lt_ext_module_data_t with a finalizer. that is,
+ * 3 on LP64 and 2 on ILP32.
+ */
+#define LT_MEM_N_INLINE_SLOTS						\
+	((7 * sizeof (lt_pointer_t) - sizeof (unsigned int) -		\
+	  2 * sizeof (unsigned short)) / sizeof (lt_mem_slot_t))
 
 struct _lt_mem_t {
 	volatile unsigned int  ref_count;
-	size_t                 size;
-	lt_mem_slist_t        *refs;
-	lt_mem_slist_t        *weak_pointers;
+	unsigned short         n_slots;
+	unsigned short         flags;
+	union {
+		lt_mem_slot_t   slots[LT_MEM_N_INLINE_SLOTS];
+		lt_mem_table_t *table;
+	} refs;
 };
 
+/* the objects of the same size are recycled through the pool */
+struct _lt_mem_pool_t {
+	size_t        size;
+	lt_pointer_t  free_list;
+	size_t        n_free;
+};
+
+#define LT_MEM_POOL_INIT(_size_)	{ (_size_), NULL, 0 }
+
 lt_pointer_t lt_mem_alloc_object       (size_t             size);
 lt_pointer_t lt_mem_ref                (lt_mem_t          *object);
 void         lt_mem_unref              (lt_mem_t          *object);
+void         lt_mem_set_immortal       (lt_mem_t          *object);
+lt_bool_t    lt_mem_is_immortal        (lt_mem_t          *object);
 void         lt_mem_add_ref            (lt_mem_t          *object,
                                         lt_pointer_t       p,
                                         lt_destroy_func_t  func);
@@ -42,6 +73,19 @@ void         lt_mem_add_weak_pointer   (lt_mem_t          *object,
 void         lt_mem_remove_weak_pointer(lt_mem_t          *object,
                                         lt_pointer_t      *p);
 
+void         lt_mem_set_type           (lt_mem_t            *object,
+                                        lt_stats_mem_type_t  type);
+
+lt_pointer_t    lt_mem_alloc_object_with_arena(size_t          size,
+                                               lt_pointer_t    buffer,
+                                               size_t          buffer_size);
+lt_mem_arena_t *lt_mem_get_arena              (lt_mem_t       *object);
+lt_pointer_t    lt_mem_arena_alloc            (lt_mem_arena_t *arena,
+                                               size_t          size);
+lt_pointer_t    lt_mem_arena_alloc_object     (lt_mem_arena_t *arena,
+                                               size_t          size);
+lt_pointer_t    lt_mem_pool_alloc_object      (lt_mem_pool_t  *pool);
+
 LT_END_DECLS
 
 #endif /* __LT_MEM_H__ */
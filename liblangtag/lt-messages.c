@@ -23,6 +23,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include "lt-lock.h"
+#include "lt-log-private.h"
 #include "lt-messages.h"
 
 static void _lt_message_default_handler(lt_message_type_t      type,
@@ -37,10 +40,22 @@ static lt_pointer_t __lt_message_default_handler_data = NULL;
 static lt_message_func_t __lt_message_handler[LT_MSG_END];
 static lt_pointer_t __lt_message_handler_data[LT_MSG_END];
 
+/* the sites which have suppressed any messages. they are never
+ * unlinked because they are static in the library.
+ */
+static lt_message_site_t *__lt_message_sites = NULL;
+
+#ifndef __ATOMIC_RELAXED
+LT_LOCK_DEFINE_STATIC (message_site);
+#endif
+
 /*< private >*/
-static char *
+/* the prefix is always shorter than 32 bytes */
+static void
 _lt_message_get_prefix(lt_message_type_t     type,
-		       lt_message_category_t category)
+		       lt_message_category_t category,
+		       char                 *buffer,
+		       size_t                size)
 {
 	static const char *type_string[LT_MSG_END + 1] = {
 		NULL,
@@ -57,14 +72,13 @@ _lt_message_get_prefix(lt_message_type_t     type,
 		" TRACE",
 		"MODULE",
 		"   TAG",
+		"   MEM",
 		NULL
 	};
 	static const char unknown_type[] = "?: ";
 	static const char unknown_cat[] = "???";
 	static const char no_cat[] = "";
 	const char *ts, *cs;
-	char *retval = NULL, *catstring = NULL;
-	size_t tlen = 0, clen = 0, len;
 
 	type = LT_MIN (type, LT_MSG_END);
 	category = LT_MIN (category, LT_MSGCAT_END);
@@ -73,7 +87,6 @@ _lt_message_get_prefix(lt_message_type_t     type,
 	} else {
 		ts = unknown_type;
 	}
-	tlen = strlen(ts);
 	if (category_string[category]) {
 		cs = category_string[category];
 	} else if (category == 0) {
@@ -81,21 +94,10 @@ _lt_message_get_prefix(lt_message_type_t     type,
 	} else {
 		cs = unknown_cat;
 	}
-	clen = strlen(cs);
-	if (clen > 0) {
-		catstring = malloc(sizeof (char) * (clen + 6));
-		snprintf(catstring, clen + 6, "[%s]: ", cs);
-		clen = strlen(catstring);
-	}
-	len = tlen + clen + 1;
-	retval = malloc(sizeof (char) * len);
-	if (retval) {
-		snprintf(retval, len, "%s%s ", ts, catstring ? catstring : "");
-	}
-	if (catstring)
-		free(catstring);
-
-	return retval;
+	if (*cs)
+		snprintf(buffer, size, "%s[%s]: ", ts, cs);
+	else
+		snprintf(buffer, size, "%s ", ts);
 }
 
 static void
@@ -133,19 +135,16 @@ _lt_message_default_handler(lt_message_type_t      type,
 			    const char            *message,
 			    lt_pointer_t           user_data)
 {
-	char *prefix = NULL;
+	char prefix[32] = { 0 };
 
 	if (flags == 0 || (flags & LT_MSG_FLAG_NO_PREFIX) == 0)
-		prefix = _lt_message_get_prefix(type, category);
-	fprintf(stderr, "%s%s%s", prefix ? prefix : "", message, flags == 0 || (flags & LT_MSG_FLAG_NO_LINEFEED) == 0 ? "\n" : "");
+		_lt_message_get_prefix(type, category, prefix, sizeof (prefix));
+	fprintf(stderr, "%s%s%s", prefix, message, flags == 0 || (flags & LT_MSG_FLAG_NO_LINEFEED) == 0 ? "\n" : "");
 	if (lt_message_is_enabled(LT_MSGCAT_TRACE) && category != LT_MSGCAT_TRACE)
 		_lt_message_stacktrace();
 	if (lt_message_is_enabled(LT_MSGCAT_DEBUG) &&
 	    type != LT_MSG_DEBUG)
 		LT_BREAKPOINT();
-
-	if (prefix)
-		free(prefix);
 }
 
 /*< public >*/
@@ -236,14 +235,134 @@ lt_message_vprintf(lt_message_type_t      type,
 			return;
 	}
 
+	/* the caller doesn't wait for the output then */
+	if (type != LT_MSG_FATAL && lt_log_is_deferred()) {
+		lt_log_push(type, flags, category, format, args);
+		return;
+	}
+
 	vsnprintf(buffer, 4096, format, args);
+	lt_message_dispatch(type, flags, category, buffer);
+	if (type == LT_MSG_FATAL)
+		abort();
+}
+
+/* passes the formatted @message to the handlers */
+void
+lt_message_dispatch(lt_message_type_t      type,
+		    lt_message_flags_t     flags,
+		    lt_message_category_t  category,
+		    const char            *message)
+{
 	if (__lt_message_handler[type]) {
-		__lt_message_handler[type](type, flags, category, buffer, __lt_message_handler_data[type]);
+		__lt_message_handler[type](type, flags, category, message, __lt_message_handler_data[type]);
 	} else if (__lt_message_default_handler) {
-		__lt_message_default_handler(type, flags, category, buffer, __lt_message_default_handler_data);
+		__lt_message_default_handler(type, flags, category, message, __lt_message_default_handler_data);
+	}
+}
+
+static void
+_lt_message_site_report(int suppressed)
+{
+	if (suppressed > 0)
+		lt_warning("%d similar messages were suppressed", suppressed);
+}
+
+/* links @site to __lt_message_sites once. this has to be called with
+ * the lock held when the atomic builtins aren't available.
+ */
+static void
+_lt_message_site_register(lt_message_site_t *site)
+{
+#ifdef __ATOMIC_RELAXED
+	if (__atomic_load_n(&site->registered, __ATOMIC_RELAXED) ||
+	    __atomic_exchange_n(&site->registered, TRUE, __ATOMIC_RELAXED))
+		return;
+	site->next = __atomic_load_n(&__lt_message_sites, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&__lt_message_sites, &site->next, site, TRUE,
+					    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#else
+	if (site->registered)
+		return;
+	site->registered = TRUE;
+	site->next = __lt_message_sites;
+	__lt_message_sites = site;
+#endif
+}
+
+/* %TRUE if the message from @site can be raised now. the number of
+ * the messages suppressed is reported when the next window starts,
+ * or by lt_message_site_flush() if the site doesn't fire again.
+ */
+lt_bool_t
+lt_message_site_check(lt_message_site_t *site)
+{
+	long now = (long)time(NULL);
+	long window;
+	int n, suppressed = 0;
+
+#ifdef __ATOMIC_RELAXED
+	window = __atomic_load_n(&site->window, __ATOMIC_RELAXED);
+	if (now - window >= LT_MESSAGE_SITE_INTERVAL &&
+	    __atomic_compare_exchange_n(&site->window, &window, now, FALSE,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		suppressed = __atomic_exchange_n(&site->n_suppressed, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&site->n_messages, 0, __ATOMIC_RELAXED);
+	}
+	n = __atomic_add_fetch(&site->n_messages, 1, __ATOMIC_RELAXED);
+	if (n > LT_MESSAGE_SITE_BURST) {
+		__atomic_fetch_add(&site->n_suppressed, 1, __ATOMIC_RELAXED);
+		_lt_message_site_register(site);
+	}
+#else
+	LT_LOCK (message_site);
+	window = site->window;
+	if (now - window >= LT_MESSAGE_SITE_INTERVAL) {
+		site->window = now;
+		suppressed = site->n_suppressed;
+		site->n_suppressed = 0;
+		site->n_messages = 0;
+	}
+	n = ++site->n_messages;
+	if (n > LT_MESSAGE_SITE_BURST) {
+		site->n_suppressed++;
+		_lt_message_site_register(site);
+	}
+	LT_UNLOCK (message_site);
+#endif
+	_lt_message_site_report(suppressed);
+
+	return n <= LT_MESSAGE_SITE_BURST;
+}
+
+/* reports the messages suppressed so far at all the sites. the bursts
+ * at the load time are likely not to fire again, which would lose
+ * the counts otherwise.
+ */
+void
+lt_message_site_flush(void)
+{
+	lt_message_site_t *site;
+	int suppressed;
+
+#ifdef __ATOMIC_RELAXED
+	site = __atomic_load_n(&__lt_message_sites, __ATOMIC_ACQUIRE);
+#else
+	LT_LOCK (message_site);
+	site = __lt_message_sites;
+	LT_UNLOCK (message_site);
+#endif
+	for (; site != NULL; site = site->next) {
+#ifdef __ATOMIC_RELAXED
+		suppressed = __atomic_exchange_n(&site->n_suppressed, 0, __ATOMIC_RELAXED);
+#else
+		LT_LOCK (message_site);
+		suppressed = site->n_suppressed;
+		site->n_suppressed = 0;
+		LT_UNLOCK (message_site);
+#endif
+		_lt_message_site_report(suppressed);
 	}
-	if (type == LT_MSG_FATAL)
-		abort();
 }
 
 void
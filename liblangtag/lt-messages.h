@@ -27,6 +27,7 @@ LT_BEGIN_DECLS
 typedef enum _lt_message_type_t		lt_message_type_t;
 typedef enum _lt_message_flags_t	lt_message_flags_t;
 typedef enum _lt_message_category_t	lt_message_category_t;
+typedef struct _lt_message_site_t	lt_message_site_t;
 typedef void (* lt_message_func_t)	(lt_message_type_t      type,
 					 lt_message_flags_t     flags,
 					 lt_message_category_t  category,
@@ -54,9 +55,29 @@ enum _lt_message_category_t {
 	LT_MSGCAT_TRACE,	/* 2 */
 	LT_MSGCAT_MODULE,	/* 4 */
 	LT_MSGCAT_TAG,		/* 8 */
+	LT_MSGCAT_MEM,		/* 16 */
 	LT_MSGCAT_END
 };
 
+/* the messages from a call site are limited to LT_MESSAGE_SITE_BURST
+ * in LT_MESSAGE_SITE_INTERVAL seconds. see lt_warning_ratelimited().
+ */
+#define LT_MESSAGE_SITE_BURST		5
+#define LT_MESSAGE_SITE_INTERVAL	10
+
+struct _lt_message_site_t {
+	volatile int        n_messages;
+	volatile int        n_suppressed;
+	volatile long       window;
+	/* the sites which have suppressed any messages are linked to
+	 * flush the counts by lt_message_site_flush().
+	 */
+	volatile int        registered;
+	lt_message_site_t  *next;
+};
+
+#define LT_MESSAGE_SITE_INIT	{ 0, 0, 0, 0, NULL }
+
 
 lt_message_func_t lt_message_set_default_handler(lt_message_func_t      func,
                                                  lt_pointer_t           user_data);
@@ -74,6 +95,12 @@ void              lt_message_vprintf            (lt_message_type_t      type,
                                                  lt_message_category_t  category,
                                                  const char            *format,
                                                  va_list                args);
+void              lt_message_dispatch           (lt_message_type_t      type,
+						 lt_message_flags_t     flags,
+						 lt_message_category_t  category,
+						 const char            *message);
+lt_bool_t         lt_message_site_check         (lt_message_site_t     *site);
+void              lt_message_site_flush         (void);
 void              lt_return_if_fail_warning     (const char            *pretty_function,
 						 const char            *expression);
 
@@ -123,6 +150,15 @@ void              lt_return_if_fail_warning     (const char            *pretty_f
 			  (_f_),		\
 			  (_c_),		\
 			  __VA_ARGS__)
+/* for the warnings which may be raised on every call with the bad
+ * input. the message isn't formatted at all when it's suppressed.
+ */
+#define lt_warning_ratelimited(...)					\
+	LT_STMT_START {							\
+		static lt_message_site_t __lt_message_site = LT_MESSAGE_SITE_INIT; \
+		if (lt_message_site_check(&__lt_message_site))		\
+			lt_warning(__VA_ARGS__);			\
+	} LT_STMT_END
 
 #elif defined(LT_HAVE_GNUC_VARARGS)
 
@@ -159,6 +195,12 @@ void              lt_return_if_fail_warning     (const char            *pretty_f
 			  (_f_),		\
 			  (_c_),		\
 			  format)
+#define lt_warning_ratelimited(format...)				\
+	LT_STMT_START {							\
+		static lt_message_site_t __lt_message_site = LT_MESSAGE_SITE_INIT; \
+		if (lt_message_site_check(&__lt_message_site))		\
+			lt_warning(format);				\
+	} LT_STMT_END
 #else
 static void
 lt_fatal(const char *format,
@@ -225,6 +267,8 @@ lt_debug0(lt_message_category_t  category,
 	lt_message_vprintf(LT_MSG_DEBUG, flags, category, format, args);
 	va_end(args);
 }
+/* no way to keep the state per call site */
+#define lt_warning_ratelimited	lt_warning
 #endif
 
 #ifdef __GNUC__
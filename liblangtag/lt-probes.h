@@ -0,0 +1,69 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-probes.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_PROBES_H__
+#define __LT_PROBES_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "lt-macros.h"
+#include "lt-stats.h"
+
+LT_BEGIN_DECLS
+
+/* The USDT probes for the dynamic tracing tools such as bpftrace, perf
+ * and SystemTap. they are available in the provider "liblangtag" when
+ * the library is configured with --enable-sdt, and cost a nop each
+ * unless someone attaches to them.
+ *
+ *   parse_start(const char *tag, size_t length)
+ *   parse_done(const char *tag, size_t length, int state, int success)
+ *   db_lookup(int table, const char *key, int found)
+ *     table is lt_stats_db_t.
+ *   canonicalize_start(lt_tag_t *tag)
+ *   canonicalize_done(lt_tag_t *tag, int success)
+ *   transform_start(lt_tag_t *tag)
+ *   transform_done(lt_tag_t *tag, lt_tag_t *result)
+ *   ext_module_parse_start(const char *module, const char *subtag)
+ *   ext_module_parse_done(const char *module, const char *subtag, int success)
+ *   xml_load_start(const char *filename)
+ *   xml_load_done(const char *filename, int success)
+ */
+#if ENABLE_SDT
+#include <sys/sdt.h>
+
+#define LT_PROBE(_n_)					\
+	DTRACE_PROBE (liblangtag, _n_)
+#define LT_PROBE1(_n_,_a1_)				\
+	DTRACE_PROBE1 (liblangtag, _n_, _a1_)
+#define LT_PROBE2(_n_,_a1_,_a2_)			\
+	DTRACE_PROBE2 (liblangtag, _n_, _a1_, _a2_)
+#define LT_PROBE3(_n_,_a1_,_a2_,_a3_)			\
+	DTRACE_PROBE3 (liblangtag, _n_, _a1_, _a2_, _a3_)
+#define LT_PROBE4(_n_,_a1_,_a2_,_a3_,_a4_)		\
+	DTRACE_PROBE4 (liblangtag, _n_, _a1_, _a2_, _a3_, _a4_)
+#else
+#define LT_PROBE(_n_)				LT_STMT_START {} LT_STMT_END
+#define LT_PROBE1(_n_,_a1_)			LT_STMT_START {} LT_STMT_END
+#define LT_PROBE2(_n_,_a1_,_a2_)		LT_STMT_START {} LT_STMT_END
+#define LT_PROBE3(_n_,_a1_,_a2_,_a3_)		LT_STMT_START {} LT_STMT_END
+#define LT_PROBE4(_n_,_a1_,_a2_,_a3_,_a4_)	LT_STMT_START {} LT_STMT_END
+#endif
+
+#define LT_PROBE_DB_LOOKUP(_db_,_key_,_found_)				\
+	LT_PROBE3 (db_lookup, (int)LT_STATS_DB_ ## _db_, (_key_), (int)((_found_) != 0))
+
+LT_END_DECLS
+
+#endif /* __LT_PROBES_H__ */
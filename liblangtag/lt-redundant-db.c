@@ -18,11 +18,15 @@
 #include <string.h>
 #include <libxml/xpath.h>
 #include "lt-iter-private.h"
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-redundant.h"
 #include "lt-redundant-private.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -42,6 +46,7 @@ struct _lt_redundant_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *redundant_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_redundant_db_iter_t {
 	lt_iter_t  parent;
@@ -63,6 +68,11 @@ lt_redundant_db_parse(lt_redundant_db_t  *redundantdb,
 	lt_return_val_if_fail (redundantdb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(redundantdb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -70,6 +80,7 @@ lt_redundant_db_parse(lt_redundant_db_t  *redundantdb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/redundant", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -94,8 +105,8 @@ lt_redundant_db_parse(lt_redundant_db_t  *redundantdb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"tag") == 0) {
 				if (tag) {
-					lt_warning("Duplicate tag element in redundant: previous value was '%s'",
-						   tag);
+					lt_warning_ratelimited("Duplicate tag element in redundant: previous value was '%s'",
+							       tag);
 				} else {
 					tag = xmlNodeGetContent(cnode);
 				}
@@ -109,24 +120,24 @@ lt_redundant_db_parse(lt_redundant_db_t  *redundantdb,
 					desc = xmlNodeGetContent(cnode);
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"preferred-value") == 0) {
 				if (preferred) {
-					lt_warning("Duplicate preferred-value element in redundant: previous value was '%s'",
-						   preferred);
+					lt_warning_ratelimited("Duplicate preferred-value element in redundant: previous value was '%s'",
+							       preferred);
 				} else {
 					preferred = xmlNodeGetContent(cnode);
 				}
 			} else {
-				lt_warning("Unknown node under /registry/redundant: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/redundant: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!tag) {
-			lt_warning("No tag node: description = '%s', preferred-value = '%s'",
-				   desc, preferred);
+			lt_warning_ratelimited("No tag node: description = '%s', preferred-value = '%s'",
+					       desc, preferred);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: tag = '%s', preferred-value = '%s'",
-				   tag, preferred);
+			lt_warning_ratelimited("No description node: tag = '%s', preferred-value = '%s'",
+					       tag, preferred);
 			goto bail1;
 		}
 		le = lt_redundant_create();
@@ -181,7 +192,10 @@ _lt_redundant_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_redundant_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->redundant_entries);
+		if (db->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->redundant_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -209,6 +223,39 @@ _lt_redundant_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_redundant_db_probe(lt_redundant_db_t *redundantdb,
+		      const char        *key,
+		      lt_db_probe_t     *probe)
+{
+	lt_redundant_t *redundant;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (redundantdb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (redundantdb->image) {
+		retval = lt_db_image_table_probe(redundantdb->image, key, probe);
+		LT_STATS_DB_LOOKUP (REDUNDANT, retval);
+		LT_PROBE_DB_LOOKUP (REDUNDANT, key, retval);
+
+		return retval;
+	}
+	redundant = lt_trie_lookup(redundantdb->redundant_entries, key);
+	LT_STATS_DB_LOOKUP (REDUNDANT, redundant != NULL);
+	LT_PROBE_DB_LOOKUP (REDUNDANT, key, redundant != NULL);
+	if (!redundant)
+		return FALSE;
+	probe->tag = lt_redundant_get_tag(redundant);
+	probe->preferred_tag = lt_redundant_get_preferred_tag(redundant);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_redundant_db_new:
@@ -223,10 +270,27 @@ lt_redundant_db_new(void)
 	lt_redundant_db_t *retval = lt_mem_alloc_object(sizeof (lt_redundant_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_redundant_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_REDUNDANT);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_redundant_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->redundant_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->redundant_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -296,19 +360,120 @@ lt_redundant_db_unref(lt_redundant_db_t *redundantdb)
 lt_redundant_t *
 lt_redundant_db_lookup(lt_redundant_db_t *redundantdb,
 		       const char        *tag)
+{
+	lt_return_val_if_fail (tag != NULL, NULL);
+
+	return lt_redundant_db_lookup_len(redundantdb, tag, strlen(tag));
+}
+
+/**
+ * lt_redundant_db_lookup_len:
+ * @redundantdb: a #lt_redundant_db_t.
+ * @tag: a tag name to lookup.
+ * @length: the length of @tag in bytes.
+ *
+ * Lookup @lt_redundant_t if @tag is valid and registered into the database.
+ * This is the same as lt_redundant_db_lookup() but @tag doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_redundant_t that meets with @tag.
+ *                           otherwise %NULL.
+ */
+lt_redundant_t *
+lt_redundant_db_lookup_len(lt_redundant_db_t *redundantdb,
+			   const char        *tag,
+			   size_t             length)
 {
 	lt_redundant_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (redundantdb != NULL, NULL);
 	lt_return_val_if_fail (tag != NULL, NULL);
 
-	s = strdup(tag);
-	retval = lt_trie_lookup(redundantdb->redundant_entries,
-				lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_redundant_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), tag, length);
+	if (!s)
+		return NULL;
+	if (redundantdb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(redundantdb->image, s);
+	} else {
+		retval = lt_trie_lookup(redundantdb->redundant_entries, s);
+		if (retval)
+			lt_redundant_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (REDUNDANT, retval != NULL);
+	LT_PROBE_DB_LOOKUP (REDUNDANT, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_redundant_db_export:
+ * @redundantdb: a #lt_redundant_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @redundantdb at once. @entries is filled with
+ * the pairs of the key and #lt_redundant_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_redundant_db_export(lt_redundant_db_t *redundantdb,
+		       lt_iter_entry_t  **entries)
+{
+	lt_return_val_if_fail (redundantdb != NULL, 0);
+
+	return lt_iter_export(&redundantdb->parent, entries);
+}
+
+/**
+ * lt_redundant_db_complete:
+ * @redundantdb: a #lt_redundant_db_t.
+ * @prefix: the prefix of the tag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose tag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_redundant_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_redundant_db_complete(lt_redundant_db_t *redundantdb,
+			 const char        *prefix,
+			 size_t             max,
+			 lt_iter_entry_t  **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (redundantdb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (redundantdb->image)
+		iter = lt_db_image_table_prefix_iter(redundantdb->image, s);
+	else
+		iter = lt_trie_prefix_iter(redundantdb->redundant_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
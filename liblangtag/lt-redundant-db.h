@@ -18,6 +18,7 @@
 #define __LT_REDUNDANT_DB_H__
 
 #include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-redundant.h>
 
 LT_BEGIN_DECLS
@@ -31,11 +32,20 @@ LT_BEGIN_DECLS
 typedef struct _lt_redundant_db_t	lt_redundant_db_t;
 
 
-lt_redundant_db_t *lt_redundant_db_new   (void);
-lt_redundant_db_t *lt_redundant_db_ref   (lt_redundant_db_t *redundantdb);
-void               lt_redundant_db_unref (lt_redundant_db_t *redundantdb);
-lt_redundant_t    *lt_redundant_db_lookup(lt_redundant_db_t *redundantdb,
-                                          const char        *tag);
+lt_redundant_db_t *lt_redundant_db_new       (void);
+lt_redundant_db_t *lt_redundant_db_ref       (lt_redundant_db_t *redundantdb);
+void               lt_redundant_db_unref     (lt_redundant_db_t *redundantdb);
+lt_redundant_t    *lt_redundant_db_lookup    (lt_redundant_db_t *redundantdb,
+                                              const char        *tag);
+lt_redundant_t    *lt_redundant_db_lookup_len(lt_redundant_db_t *redundantdb,
+                                              const char        *tag,
+                                              size_t             length);
+size_t             lt_redundant_db_export    (lt_redundant_db_t *redundantdb,
+                                              lt_iter_entry_t  **entries);
+size_t             lt_redundant_db_complete  (lt_redundant_db_t *redundantdb,
+                                              const char        *prefix,
+                                              size_t             max,
+                                              lt_iter_entry_t  **entries);
 
 LT_END_DECLS
 
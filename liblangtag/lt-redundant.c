@@ -48,6 +48,9 @@ lt_redundant_create(void)
 
 	retval = lt_mem_alloc_object(sizeof (lt_redundant_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_REDUNDANT);
+
 	return retval;
 }
 
@@ -17,10 +17,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <libxml/xpath.h>
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-iter-private.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -41,6 +45,7 @@ struct _lt_region_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *region_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_region_db_iter_t {
 	lt_iter_t  parent;
@@ -62,6 +67,11 @@ lt_region_db_parse(lt_region_db_t  *regiondb,
 	lt_return_val_if_fail (regiondb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(regiondb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -69,6 +79,7 @@ lt_region_db_parse(lt_region_db_t  *regiondb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/region", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -93,8 +104,8 @@ lt_region_db_parse(lt_region_db_t  *regiondb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"subtag") == 0) {
 				if (subtag) {
-					lt_warning("Duplicate subtag element in region: previous value was '%s'",
-						   subtag);
+					lt_warning_ratelimited("Duplicate subtag element in region: previous value was '%s'",
+							       subtag);
 				} else {
 					subtag = xmlNodeGetContent(cnode);
 				}
@@ -109,24 +120,24 @@ lt_region_db_parse(lt_region_db_t  *regiondb,
 					desc = xmlNodeGetContent(cnode);
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"preferred-value") == 0) {
 				if (preferred) {
-					lt_warning("Duplicate preferred-value element in region: previous value was '%s'",
-						   preferred);
+					lt_warning_ratelimited("Duplicate preferred-value element in region: previous value was '%s'",
+							       preferred);
 				} else {
 					preferred = xmlNodeGetContent(cnode);
 				}
 			} else {
-				lt_warning("Unknown node under /registry/region: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/region: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!subtag) {
-			lt_warning("No subtag node: description = '%s', preferred-value = '%s'",
-				   desc, preferred);
+			lt_warning_ratelimited("No subtag node: description = '%s', preferred-value = '%s'",
+					       desc, preferred);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: subtag = '%s', preferred-value = '%s'",
-				   subtag, preferred);
+			lt_warning_ratelimited("No description node: subtag = '%s', preferred-value = '%s'",
+					       subtag, preferred);
 			goto bail1;
 		}
 		le = lt_region_create();
@@ -181,7 +192,10 @@ _lt_region_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_region_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->region_entries);
+		if (db->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->region_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -209,6 +223,39 @@ _lt_region_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_region_db_probe(lt_region_db_t *regiondb,
+		   const char     *key,
+		   lt_db_probe_t  *probe)
+{
+	lt_region_t *region;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (regiondb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (regiondb->image) {
+		retval = lt_db_image_table_probe(regiondb->image, key, probe);
+		LT_STATS_DB_LOOKUP (REGION, retval);
+		LT_PROBE_DB_LOOKUP (REGION, key, retval);
+
+		return retval;
+	}
+	region = lt_trie_lookup(regiondb->region_entries, key);
+	LT_STATS_DB_LOOKUP (REGION, region != NULL);
+	LT_PROBE_DB_LOOKUP (REGION, key, region != NULL);
+	if (!region)
+		return FALSE;
+	probe->tag = lt_region_get_tag(region);
+	probe->preferred_tag = lt_region_get_preferred_tag(region);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_region_db_new:
@@ -223,11 +270,28 @@ lt_region_db_new(void)
 	lt_region_db_t *retval = lt_mem_alloc_object(sizeof (lt_region_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 		lt_region_t *le;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_region_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_REGION);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_region_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->region_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->region_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -313,19 +377,121 @@ lt_region_db_unref(lt_region_db_t *regiondb)
 lt_region_t *
 lt_region_db_lookup(lt_region_db_t *regiondb,
 		    const char     *language_or_code)
+{
+	lt_return_val_if_fail (language_or_code != NULL, NULL);
+
+	return lt_region_db_lookup_len(regiondb, language_or_code, strlen(language_or_code));
+}
+
+/**
+ * lt_region_db_lookup_len:
+ * @regiondb: a #lt_region_db_t.
+ * @language_or_code: a region code to lookup.
+ * @length: the length of @language_or_code in bytes.
+ *
+ * Lookup @lt_region_t if @language_or_code is valid and registered into
+ * the database.
+ * This is the same as lt_region_db_lookup() but @language_or_code doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_region_t that meets with @language_or_code.
+ *                           otherwise %NULL.
+ */
+lt_region_t *
+lt_region_db_lookup_len(lt_region_db_t *regiondb,
+			const char     *language_or_code,
+			size_t          length)
 {
 	lt_region_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (regiondb != NULL, NULL);
 	lt_return_val_if_fail (language_or_code != NULL, NULL);
 
-	s = strdup(language_or_code);
-	retval = lt_trie_lookup(regiondb->region_entries,
-				lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_region_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), language_or_code, length);
+	if (!s)
+		return NULL;
+	if (regiondb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(regiondb->image, s);
+	} else {
+		retval = lt_trie_lookup(regiondb->region_entries, s);
+		if (retval)
+			lt_region_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (REGION, retval != NULL);
+	LT_PROBE_DB_LOOKUP (REGION, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_region_db_export:
+ * @regiondb: a #lt_region_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @regiondb at once. @entries is filled with
+ * the pairs of the key and #lt_region_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_region_db_export(lt_region_db_t   *regiondb,
+		    lt_iter_entry_t **entries)
+{
+	lt_return_val_if_fail (regiondb != NULL, 0);
+
+	return lt_iter_export(&regiondb->parent, entries);
+}
+
+/**
+ * lt_region_db_complete:
+ * @regiondb: a #lt_region_db_t.
+ * @prefix: the prefix of the subtag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose subtag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_region_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_region_db_complete(lt_region_db_t   *regiondb,
+		      const char       *prefix,
+		      size_t            max,
+		      lt_iter_entry_t **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (regiondb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (regiondb->image)
+		iter = lt_db_image_table_prefix_iter(regiondb->image, s);
+	else
+		iter = lt_trie_prefix_iter(regiondb->region_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
@@ -18,6 +18,7 @@
 #define __LT_REGION_DB_H__
 
 #include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-region.h>
 
 LT_BEGIN_DECLS
@@ -31,11 +32,20 @@ LT_BEGIN_DECLS
 typedef struct _lt_region_db_t		lt_region_db_t;
 
 
-lt_region_db_t *lt_region_db_new   (void);
-lt_region_db_t *lt_region_db_ref   (lt_region_db_t *regiondb);
-void            lt_region_db_unref (lt_region_db_t *regiondb);
-lt_region_t    *lt_region_db_lookup(lt_region_db_t *regiondb,
-                                    const char     *language_or_code);
+lt_region_db_t *lt_region_db_new       (void);
+lt_region_db_t *lt_region_db_ref       (lt_region_db_t *regiondb);
+void            lt_region_db_unref     (lt_region_db_t *regiondb);
+lt_region_t    *lt_region_db_lookup    (lt_region_db_t *regiondb,
+                                        const char     *language_or_code);
+lt_region_t    *lt_region_db_lookup_len(lt_region_db_t *regiondb,
+                                        const char     *language_or_code,
+                                        size_t          length);
+size_t          lt_region_db_export    (lt_region_db_t *regiondb,
+                                        lt_iter_entry_t **entries);
+size_t          lt_region_db_complete  (lt_region_db_t *regiondb,
+                                        const char     *prefix,
+                                        size_t          max,
+                                        lt_iter_entry_t **entries);
 
 LT_END_DECLS
 
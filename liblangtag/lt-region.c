@@ -47,6 +47,9 @@ lt_region_create(void)
 {
 	lt_region_t *retval = lt_mem_alloc_object(sizeof (lt_region_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_REGION);
+
 	return retval;
 }
 
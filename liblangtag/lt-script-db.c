@@ -17,10 +17,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <libxml/xpath.h>
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-iter-private.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -40,6 +44,7 @@ struct _lt_script_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *script_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_script_db_iter_t {
 	lt_iter_t  parent;
@@ -61,6 +66,11 @@ lt_script_db_parse(lt_script_db_t  *scriptdb,
 	lt_return_val_if_fail (scriptdb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(scriptdb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -68,6 +78,7 @@ lt_script_db_parse(lt_script_db_t  *scriptdb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/script", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -92,8 +103,8 @@ lt_script_db_parse(lt_script_db_t  *scriptdb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"subtag") == 0) {
 				if (subtag) {
-					lt_warning("Duplicate subtag element in script: previous value was '%s'",
-						   subtag);
+					lt_warning_ratelimited("Duplicate subtag element in script: previous value was '%s'",
+							       subtag);
 				} else {
 					subtag = xmlNodeGetContent(cnode);
 				}
@@ -106,18 +117,18 @@ lt_script_db_parse(lt_script_db_t  *scriptdb,
 				if (!desc)
 					desc = xmlNodeGetContent(cnode);
 			} else {
-				lt_warning("Unknown node under /registry/script: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/script: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!subtag) {
-			lt_warning("No subtag node: description = '%s'",
-				   desc);
+			lt_warning_ratelimited("No subtag node: description = '%s'",
+					       desc);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: subtag = '%s'",
-				   subtag);
+			lt_warning_ratelimited("No description node: subtag = '%s'",
+					       subtag);
 			goto bail1;
 		}
 		le = lt_script_create();
@@ -168,7 +179,10 @@ _lt_script_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_script_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->script_entries);
+		if (db->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->script_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -196,6 +210,38 @@ _lt_script_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_script_db_probe(lt_script_db_t *scriptdb,
+		   const char     *key,
+		   lt_db_probe_t  *probe)
+{
+	lt_script_t *script;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (scriptdb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (scriptdb->image) {
+		retval = lt_db_image_table_probe(scriptdb->image, key, probe);
+		LT_STATS_DB_LOOKUP (SCRIPT, retval);
+		LT_PROBE_DB_LOOKUP (SCRIPT, key, retval);
+
+		return retval;
+	}
+	script = lt_trie_lookup(scriptdb->script_entries, key);
+	LT_STATS_DB_LOOKUP (SCRIPT, script != NULL);
+	LT_PROBE_DB_LOOKUP (SCRIPT, key, script != NULL);
+	if (!script)
+		return FALSE;
+	probe->tag = lt_script_get_tag(script);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_script_db_new:
@@ -210,11 +256,28 @@ lt_script_db_new(void)
 	lt_script_db_t *retval = lt_mem_alloc_object(sizeof (lt_script_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 		lt_script_t *le;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_script_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_SCRIPT);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_script_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->script_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->script_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -299,19 +362,120 @@ lt_script_db_unref(lt_script_db_t *scriptdb)
 lt_script_t *
 lt_script_db_lookup(lt_script_db_t *scriptdb,
 		    const char     *subtag)
+{
+	lt_return_val_if_fail (subtag != NULL, NULL);
+
+	return lt_script_db_lookup_len(scriptdb, subtag, strlen(subtag));
+}
+
+/**
+ * lt_script_db_lookup_len:
+ * @scriptdb: a #lt_script_db_t.
+ * @subtag: a subtag name to lookup.
+ * @length: the length of @subtag in bytes.
+ *
+ * Lookup @lt_script_t if @subtag is valid and registered into the database.
+ * This is the same as lt_script_db_lookup() but @subtag doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_script_t that meets with @subtag.
+ *                           otherwise %NULL.
+ */
+lt_script_t *
+lt_script_db_lookup_len(lt_script_db_t *scriptdb,
+			const char     *subtag,
+			size_t          length)
 {
 	lt_script_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (scriptdb != NULL, NULL);
 	lt_return_val_if_fail (subtag != NULL, NULL);
 
-	s = strdup(subtag);
-	retval = lt_trie_lookup(scriptdb->script_entries,
-				lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_script_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), subtag, length);
+	if (!s)
+		return NULL;
+	if (scriptdb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(scriptdb->image, s);
+	} else {
+		retval = lt_trie_lookup(scriptdb->script_entries, s);
+		if (retval)
+			lt_script_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (SCRIPT, retval != NULL);
+	LT_PROBE_DB_LOOKUP (SCRIPT, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_script_db_export:
+ * @scriptdb: a #lt_script_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @scriptdb at once. @entries is filled with
+ * the pairs of the key and #lt_script_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_script_db_export(lt_script_db_t   *scriptdb,
+		    lt_iter_entry_t **entries)
+{
+	lt_return_val_if_fail (scriptdb != NULL, 0);
+
+	return lt_iter_export(&scriptdb->parent, entries);
+}
+
+/**
+ * lt_script_db_complete:
+ * @scriptdb: a #lt_script_db_t.
+ * @prefix: the prefix of the subtag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose subtag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_script_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_script_db_complete(lt_script_db_t   *scriptdb,
+		      const char       *prefix,
+		      size_t            max,
+		      lt_iter_entry_t **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (scriptdb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (scriptdb->image)
+		iter = lt_db_image_table_prefix_iter(scriptdb->image, s);
+	else
+		iter = lt_trie_prefix_iter(scriptdb->script_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
@@ -18,6 +18,7 @@
 #define __LT_SCRIPT_DB_H__
 
 #include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-script.h>
 
 LT_BEGIN_DECLS
@@ -31,11 +32,20 @@ LT_BEGIN_DECLS
 typedef struct _lt_script_db_t	lt_script_db_t;
 
 
-lt_script_db_t *lt_script_db_new        (void);
-lt_script_db_t *lt_script_db_ref        (lt_script_db_t *scriptdb);
-void            lt_script_db_unref      (lt_script_db_t *scriptdb);
-lt_script_t    *lt_script_db_lookup     (lt_script_db_t *scriptdb,
-                                         const char     *subtag);
+lt_script_db_t *lt_script_db_new       (void);
+lt_script_db_t *lt_script_db_ref       (lt_script_db_t *scriptdb);
+void            lt_script_db_unref     (lt_script_db_t *scriptdb);
+lt_script_t    *lt_script_db_lookup    (lt_script_db_t *scriptdb,
+                                        const char     *subtag);
+lt_script_t    *lt_script_db_lookup_len(lt_script_db_t *scriptdb,
+                                        const char     *subtag,
+                                        size_t          length);
+size_t          lt_script_db_export    (lt_script_db_t *scriptdb,
+                                        lt_iter_entry_t **entries);
+size_t          lt_script_db_complete  (lt_script_db_t *scriptdb,
+                                        const char     *prefix,
+                                        size_t          max,
+                                        lt_iter_entry_t **entries);
 
 LT_END_DECLS
 
@@ -45,6 +45,9 @@ lt_script_create(void)
 {
 	lt_script_t *retval = lt_mem_alloc_object(sizeof (lt_script_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_SCRIPT);
+
 	return retval;
 }
 
@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-stats-private.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_STATS_PRIVATE_H__
+#define __LT_STATS_PRIVATE_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include "lt-stats.h"
+
+LT_BEGIN_DECLS
+
+#define LT_STATS_N_COUNTERS	(sizeof (lt_stats_t) / sizeof (unsigned long long))
+#define LT_STATS_INDEX(_f_)	(offsetof (lt_stats_t, _f_) / sizeof (unsigned long long))
+
+#if ENABLE_STATS
+#define LT_STATS_ADD_INDEX(_i_,_n_)	lt_stats_add((_i_), (_n_))
+#else
+#define LT_STATS_ADD_INDEX(_i_,_n_)	LT_STMT_START {} LT_STMT_END
+#endif
+#define LT_STATS_ADD(_f_,_n_)		LT_STATS_ADD_INDEX (LT_STATS_INDEX (_f_), (_n_))
+#define LT_STATS_INC(_f_)		LT_STATS_ADD (_f_, 1)
+#define LT_STATS_PARSE_FAILURE(_t_)					\
+	LT_STATS_ADD_INDEX (LT_STATS_INDEX (parse_failures) + (_t_) - LT_ERR_UNKNOWN, 1)
+#define LT_STATS_DB_LOOKUP(_db_,_found_)				\
+	LT_STMT_START {							\
+		LT_STATS_ADD_INDEX (LT_STATS_INDEX (db_lookups) + LT_STATS_DB_ ## _db_, 1); \
+		if (!(_found_))						\
+			LT_STATS_ADD_INDEX (LT_STATS_INDEX (db_misses) + LT_STATS_DB_ ## _db_, 1); \
+	} LT_STMT_END
+
+void      lt_stats_add           (size_t               index,
+				  unsigned long long   n);
+lt_bool_t lt_stats_mem_is_enabled(void);
+void      lt_stats_mem_add       (lt_stats_mem_type_t  type,
+				  int                  n,
+				  long long            bytes);
+void      lt_stats_mem_move      (lt_stats_mem_type_t  from,
+				  lt_stats_mem_type_t  to,
+				  long long            bytes);
+void      lt_stats_mem_dump      (void);
+
+LT_END_DECLS
+
+#endif /* __LT_STATS_PRIVATE_H__ */
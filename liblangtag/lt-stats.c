@@ -0,0 +1,494 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-stats.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "lt-lock.h"
+#include "lt-messages.h"
+#include "lt-stats.h"
+#include "lt-stats-private.h"
+
+
+/**
+ * SECTION: lt-stats
+ * @Short_Description: The runtime statistics
+ * @Title: Statistics
+ *
+ * The statistics of the operations in this library, such as the number of
+ * the tags parsed, the lookups in the databases and the objects allocated.
+ * this is available unless the library is configured with --disable-stats.
+ */
+
+static const char *__lt_stats_mem_names[LT_STATS_MEM_END] = {
+	"unknown",
+	"tag",
+	"string",
+	"list",
+	"trie",
+	"trie_node",
+	"lang",
+	"extlang",
+	"script",
+	"region",
+	"variant",
+	"grandfathered",
+	"redundant",
+	"extension",
+	"ext_module",
+	"ext_module_data",
+	"database",
+	"db_image",
+	"xml",
+	"error",
+	"tag_dict"
+};
+
+#if ENABLE_STATS
+#if HAVE_PTHREAD && defined (LT_HAVE_TLS) && defined (__ATOMIC_RELAXED)
+#define LT_STATS_PER_THREAD	1
+#endif
+
+typedef struct _lt_stats_block_t	lt_stats_block_t;
+
+/* the counters of a thread. only the owner thread updates them. */
+struct _lt_stats_block_t {
+	unsigned long long  counters[LT_STATS_N_COUNTERS];
+	lt_stats_block_t   *prev;
+	lt_stats_block_t   *next;
+};
+
+LT_LOCK_DEFINE_STATIC (stats);
+/* the counters of the threads exited and of the threads without
+ * the own block. these are updated atomically.
+ */
+static unsigned long long __lt_stats_shared[LT_STATS_N_COUNTERS];
+/* the counters at the last lt_stats_reset(). */
+static unsigned long long __lt_stats_base[LT_STATS_N_COUNTERS];
+/* the memory used by each type. -1 in __lt_stats_mem_enabled means
+ * it isn't determined by LT_DEBUG yet.
+ */
+static lt_stats_mem_t __lt_stats_mem[LT_STATS_MEM_END];
+static int __lt_stats_mem_enabled = -1;
+#ifdef LT_STATS_PER_THREAD
+static lt_stats_block_t *__lt_stats_blocks = NULL;
+static __thread lt_stats_block_t *__lt_stats_block = NULL;
+static pthread_key_t __lt_stats_key;
+static pthread_once_t __lt_stats_once = PTHREAD_ONCE_INIT;
+static lt_bool_t __lt_stats_has_key = FALSE;
+#endif
+
+/*< private >*/
+static void
+_lt_stats_shared_add(size_t             index,
+		     unsigned long long n)
+{
+#ifdef __ATOMIC_RELAXED
+	__atomic_fetch_add(&__lt_stats_shared[index], n, __ATOMIC_RELAXED);
+#else
+	LT_LOCK (stats);
+	__lt_stats_shared[index] += n;
+	LT_UNLOCK (stats);
+#endif
+}
+
+/* this has to be called with the lock held */
+static void
+_lt_stats_sum(unsigned long long *counters)
+{
+	size_t i;
+#ifdef LT_STATS_PER_THREAD
+	lt_stats_block_t *b;
+#endif
+
+	for (i = 0; i < LT_STATS_N_COUNTERS; i++) {
+#ifdef __ATOMIC_RELAXED
+		counters[i] = __atomic_load_n(&__lt_stats_shared[i], __ATOMIC_RELAXED);
+#else
+		counters[i] = __lt_stats_shared[i];
+#endif
+	}
+#ifdef LT_STATS_PER_THREAD
+	for (b = __lt_stats_blocks; b != NULL; b = b->next) {
+		for (i = 0; i < LT_STATS_N_COUNTERS; i++)
+			counters[i] += __atomic_load_n(&b->counters[i], __ATOMIC_RELAXED);
+	}
+#endif
+}
+
+#ifdef LT_STATS_PER_THREAD
+static void
+_lt_stats_block_free(void *data)
+{
+	lt_stats_block_t *block = data;
+	size_t i;
+
+	/* move the counters to the shared ones not to lose them */
+	LT_LOCK (stats);
+	for (i = 0; i < LT_STATS_N_COUNTERS; i++) {
+		if (block->counters[i])
+			_lt_stats_shared_add(i, block->counters[i]);
+	}
+	if (block->prev)
+		block->prev->next = block->next;
+	else
+		__lt_stats_blocks = block->next;
+	if (block->next)
+		block->next->prev = block->prev;
+	LT_UNLOCK (stats);
+	__lt_stats_block = NULL;
+	free(block);
+}
+
+static void
+_lt_stats_key_init(void)
+{
+	__lt_stats_has_key = pthread_key_create(&__lt_stats_key, _lt_stats_block_free) == 0;
+}
+
+static lt_stats_block_t *
+_lt_stats_block_new(void)
+{
+	lt_stats_block_t *block;
+
+	pthread_once(&__lt_stats_once, _lt_stats_key_init);
+	if (!__lt_stats_has_key)
+		return NULL;
+	block = calloc(1, sizeof (lt_stats_block_t));
+	if (!block)
+		return NULL;
+	if (pthread_setspecific(__lt_stats_key, block) != 0) {
+		free(block);
+		return NULL;
+	}
+	LT_LOCK (stats);
+	block->next = __lt_stats_blocks;
+	if (__lt_stats_blocks)
+		__lt_stats_blocks->prev = block;
+	__lt_stats_blocks = block;
+	LT_UNLOCK (stats);
+	__lt_stats_block = block;
+
+	return block;
+}
+#endif
+
+static int
+_lt_stats_mem_get_enabled(void)
+{
+#ifdef __ATOMIC_RELAXED
+	return __atomic_load_n(&__lt_stats_mem_enabled, __ATOMIC_RELAXED);
+#else
+	return __lt_stats_mem_enabled;
+#endif
+}
+
+static void
+_lt_stats_mem_set_enabled(int v)
+{
+#ifdef __ATOMIC_RELAXED
+	__atomic_store_n(&__lt_stats_mem_enabled, v, __ATOMIC_RELAXED);
+#else
+	__lt_stats_mem_enabled = v;
+#endif
+}
+
+#ifdef __ATOMIC_RELAXED
+static void
+_lt_stats_mem_update_max(unsigned long long *max,
+			 unsigned long long  v)
+{
+	unsigned long long old = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+	while (v > old &&
+	       !__atomic_compare_exchange_n(max, &old, v, TRUE,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+#endif
+
+/* the negative values are added as the unsigned integers. the counters
+ * wrap around to the right values.
+ */
+static void
+_lt_stats_mem_update(lt_stats_mem_type_t type,
+		     int                 n_allocated,
+		     int                 n,
+		     long long           bytes)
+{
+	lt_stats_mem_t *m = &__lt_stats_mem[type];
+	unsigned long long n_live, live_bytes;
+
+#ifdef __ATOMIC_RELAXED
+	if (n_allocated)
+		__atomic_fetch_add(&m->n_allocated, (unsigned long long)n_allocated, __ATOMIC_RELAXED);
+	n_live = __atomic_add_fetch(&m->n_live, (unsigned long long)n, __ATOMIC_RELAXED);
+	live_bytes = __atomic_add_fetch(&m->live_bytes, (unsigned long long)bytes, __ATOMIC_RELAXED);
+	if (n > 0)
+		_lt_stats_mem_update_max(&m->n_live_max, n_live);
+	if (bytes > 0)
+		_lt_stats_mem_update_max(&m->live_bytes_max, live_bytes);
+#else
+	LT_LOCK (stats);
+	m->n_allocated += n_allocated;
+	n_live = m->n_live += n;
+	live_bytes = m->live_bytes += bytes;
+	if (n_live > m->n_live_max)
+		m->n_live_max = n_live;
+	if (live_bytes > m->live_bytes_max)
+		m->live_bytes_max = live_bytes;
+	LT_UNLOCK (stats);
+#endif
+}
+
+/*< protected >*/
+void
+lt_stats_add(size_t             index,
+	     unsigned long long n)
+{
+#ifdef LT_STATS_PER_THREAD
+	lt_stats_block_t *block = __lt_stats_block;
+
+	if (LT_UNLIKELY (!block))
+		block = _lt_stats_block_new();
+	if (LT_LIKELY (block != NULL)) {
+		/* no other threads write it. the store has to be atomic
+		 * only for lt_stats_get().
+		 */
+		__atomic_store_n(&block->counters[index],
+				 block->counters[index] + n,
+				 __ATOMIC_RELAXED);
+		return;
+	}
+#endif
+	_lt_stats_shared_add(index, n);
+}
+
+/* the accounting is enabled if 16 is set in LT_DEBUG, unless
+ * lt_stats_set_memory_accounting() is called earlier.
+ */
+lt_bool_t
+lt_stats_mem_is_enabled(void)
+{
+	int v = _lt_stats_mem_get_enabled();
+
+	if (LT_UNLIKELY (v < 0)) {
+		v = lt_message_is_enabled(LT_MSGCAT_MEM) ? 1 : 0;
+		_lt_stats_mem_set_enabled(v);
+	}
+
+	return v > 0;
+}
+
+void
+lt_stats_mem_add(lt_stats_mem_type_t type,
+		 int                 n,
+		 long long           bytes)
+{
+	_lt_stats_mem_update(type, n > 0 ? n : 0, n, bytes);
+}
+
+/* moves an object of @bytes accounted as @from to @to */
+void
+lt_stats_mem_move(lt_stats_mem_type_t from,
+		  lt_stats_mem_type_t to,
+		  long long           bytes)
+{
+	_lt_stats_mem_update(to, 1, 1, bytes);
+	_lt_stats_mem_update(from, -1, -1, -bytes);
+}
+
+void
+lt_stats_mem_dump(void)
+{
+	lt_stats_mem_t m;
+	int i;
+
+	if (!lt_message_is_enabled(LT_MSGCAT_MEM))
+		return;
+	for (i = 0; i < LT_STATS_MEM_END; i++) {
+		lt_stats_get_memory(i, &m);
+		if (m.n_allocated == 0 && m.n_live == 0)
+			continue;
+		lt_debug(LT_MSGCAT_MEM, "%-16s allocated: %llu, live: %llu (max %llu), bytes: %llu (max %llu)",
+			 __lt_stats_mem_names[i], m.n_allocated,
+			 m.n_live, m.n_live_max,
+			 m.live_bytes, m.live_bytes_max);
+	}
+}
+#endif /* ENABLE_STATS */
+
+/*< public >*/
+
+/**
+ * lt_stats_get:
+ * @stats: a #lt_stats_t to store the counters.
+ *
+ * Obtain the counters since the library is loaded or lt_stats_reset() is
+ * called last time. the counters updated by the other threads during this
+ * call may or may not be contained.
+ *
+ * Returns: %TRUE if the statistics are available, otherwise %FALSE and
+ *          @stats is filled with zero.
+ */
+lt_bool_t
+lt_stats_get(lt_stats_t *stats)
+{
+#if ENABLE_STATS
+	unsigned long long *counters = (unsigned long long *)stats;
+	size_t i;
+#endif
+
+	lt_return_val_if_fail (stats != NULL, FALSE);
+
+#if ENABLE_STATS
+	LT_LOCK (stats);
+	_lt_stats_sum(counters);
+	for (i = 0; i < LT_STATS_N_COUNTERS; i++)
+		counters[i] -= __lt_stats_base[i];
+	LT_UNLOCK (stats);
+
+	return TRUE;
+#else
+	memset(stats, 0, sizeof (lt_stats_t));
+
+	return FALSE;
+#endif
+}
+
+/**
+ * lt_stats_reset:
+ *
+ * Reset all the counters to zero.
+ */
+void
+lt_stats_reset(void)
+{
+#if ENABLE_STATS
+	/* don't clear the counters. the threads update them without
+	 * the lock. just remember the current values instead.
+	 */
+	LT_LOCK (stats);
+	_lt_stats_sum(__lt_stats_base);
+	LT_UNLOCK (stats);
+#endif
+}
+
+/**
+ * lt_stats_get_parse_failures:
+ * @stats: a #lt_stats_t.
+ * @type: a #lt_error_type_t.
+ *
+ * Obtain the number of the tags failed to parse with @type of the error.
+ * if %LT_ERR_ANY is given to @type, the total number of the failures is
+ * returned.
+ *
+ * Returns: the number of the failures.
+ */
+unsigned long long
+lt_stats_get_parse_failures(const lt_stats_t *stats,
+			    lt_error_type_t   type)
+{
+	unsigned long long retval = 0;
+	size_t i;
+
+	lt_return_val_if_fail (stats != NULL, 0);
+
+	if (type == LT_ERR_ANY) {
+		for (i = 0; i < LT_STATS_N_ERRORS; i++)
+			retval += stats->parse_failures[i];
+	} else if (type >= LT_ERR_UNKNOWN && type < LT_ERR_ANY) {
+		retval = stats->parse_failures[type - LT_ERR_UNKNOWN];
+	}
+
+	return retval;
+}
+
+/**
+ * lt_stats_set_memory_accounting:
+ * @flag: %TRUE to account the memory for each type of the objects.
+ *
+ * Enable or disable the accounting of the memory for lt_stats_get_memory().
+ * it's disabled by default unless 16 is set in the environment variable
+ * LT_DEBUG. the objects allocated while it's disabled aren't accounted
+ * even after it's enabled.
+ *
+ * The accounting puts the size in front of each object allocated on the heap
+ * and updates the counters shared between the threads. it's for debugging.
+ */
+void
+lt_stats_set_memory_accounting(lt_bool_t flag)
+{
+#if ENABLE_STATS
+	_lt_stats_mem_set_enabled(flag ? 1 : 0);
+#endif
+}
+
+/**
+ * lt_stats_get_memory:
+ * @type: a #lt_stats_mem_type_t.
+ * @stats: a #lt_stats_mem_t to store the result.
+ *
+ * Obtain the number and the size of the objects of @type. the memory
+ * allocated by the objects for their own use, such as the arena of
+ * #lt_tag_t, is accounted to them. the objects allocated in the arena
+ * of the others are counted, but their size is accounted to the owner
+ * of the arena.
+ *
+ * Returns: %TRUE if the statistics are available, otherwise %FALSE and
+ *          @stats is filled with zero.
+ */
+lt_bool_t
+lt_stats_get_memory(lt_stats_mem_type_t  type,
+		    lt_stats_mem_t      *stats)
+{
+	lt_return_val_if_fail (stats != NULL, FALSE);
+
+	memset(stats, 0, sizeof (lt_stats_mem_t));
+	lt_return_val_if_fail (type < LT_STATS_MEM_END, FALSE);
+
+#if ENABLE_STATS
+#ifdef __ATOMIC_RELAXED
+	stats->n_allocated = __atomic_load_n(&__lt_stats_mem[type].n_allocated, __ATOMIC_RELAXED);
+	stats->n_live = __atomic_load_n(&__lt_stats_mem[type].n_live, __ATOMIC_RELAXED);
+	stats->n_live_max = __atomic_load_n(&__lt_stats_mem[type].n_live_max, __ATOMIC_RELAXED);
+	stats->live_bytes = __atomic_load_n(&__lt_stats_mem[type].live_bytes, __ATOMIC_RELAXED);
+	stats->live_bytes_max = __atomic_load_n(&__lt_stats_mem[type].live_bytes_max, __ATOMIC_RELAXED);
+#else
+	LT_LOCK (stats);
+	*stats = __lt_stats_mem[type];
+	LT_UNLOCK (stats);
+#endif
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/**
+ * lt_stats_mem_type_get_name:
+ * @type: a #lt_stats_mem_type_t.
+ *
+ * Obtain the name of @type.
+ *
+ * Returns: the name of @type, or %NULL if @type is invalid.
+ */
+const char *
+lt_stats_mem_type_get_name(lt_stats_mem_type_t type)
+{
+	lt_return_val_if_fail (type < LT_STATS_MEM_END, NULL);
+
+	return __lt_stats_mem_names[type];
+}
@@ -0,0 +1,175 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-stats.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#if !defined (__LANGTAG_H__INSIDE) && !defined (__LANGTAG_COMPILATION)
+#error "Only <liblangtag/langtag.h> can be included directly."
+#endif
+
+#ifndef __LT_STATS_H__
+#define __LT_STATS_H__
+
+#include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-error.h>
+
+LT_BEGIN_DECLS
+
+/**
+ * lt_stats_db_t:
+ * @LT_STATS_DB_LANG: the language database.
+ * @LT_STATS_DB_EXTLANG: the extlang database.
+ * @LT_STATS_DB_SCRIPT: the script database.
+ * @LT_STATS_DB_REGION: the region database.
+ * @LT_STATS_DB_VARIANT: the variant database.
+ * @LT_STATS_DB_GRANDFATHERED: the grandfathered database.
+ * @LT_STATS_DB_REDUNDANT: the redundant database.
+ * @LT_STATS_DB_END: the number of the databases.
+ *
+ * The index of the per-database counters in #lt_stats_t.
+ */
+enum _lt_stats_db_t {
+	LT_STATS_DB_LANG = 0,
+	LT_STATS_DB_EXTLANG,
+	LT_STATS_DB_SCRIPT,
+	LT_STATS_DB_REGION,
+	LT_STATS_DB_VARIANT,
+	LT_STATS_DB_GRANDFATHERED,
+	LT_STATS_DB_REDUNDANT,
+	LT_STATS_DB_END
+};
+
+/**
+ * lt_stats_mem_type_t:
+ * @LT_STATS_MEM_UNKNOWN: the objects not classified.
+ * @LT_STATS_MEM_TAG: #lt_tag_t.
+ * @LT_STATS_MEM_STRING: #lt_string_t.
+ * @LT_STATS_MEM_LIST: #lt_list_t.
+ * @LT_STATS_MEM_TRIE: the tries of the databases.
+ * @LT_STATS_MEM_TRIE_NODE: the nodes of the tries.
+ * @LT_STATS_MEM_LANG: #lt_lang_t.
+ * @LT_STATS_MEM_EXTLANG: #lt_extlang_t.
+ * @LT_STATS_MEM_SCRIPT: #lt_script_t.
+ * @LT_STATS_MEM_REGION: #lt_region_t.
+ * @LT_STATS_MEM_VARIANT: #lt_variant_t.
+ * @LT_STATS_MEM_GRANDFATHERED: #lt_grandfathered_t.
+ * @LT_STATS_MEM_REDUNDANT: #lt_redundant_t.
+ * @LT_STATS_MEM_EXTENSION: #lt_extension_t.
+ * @LT_STATS_MEM_EXT_MODULE: #lt_ext_module_t.
+ * @LT_STATS_MEM_EXT_MODULE_DATA: #lt_ext_module_data_t.
+ * @LT_STATS_MEM_DATABASE: the databases.
+ * @LT_STATS_MEM_DB_IMAGE: the images of the databases.
+ * @LT_STATS_MEM_XML: the XML documents.
+ * @LT_STATS_MEM_ERROR: #lt_error_t.
+ * @LT_STATS_MEM_TAG_DICT: #lt_tag_dict_t.
+ * @LT_STATS_MEM_END: the number of the types.
+ *
+ * The type of the objects to account the memory for. see
+ * lt_stats_get_memory().
+ */
+enum _lt_stats_mem_type_t {
+	LT_STATS_MEM_UNKNOWN = 0,
+	LT_STATS_MEM_TAG,
+	LT_STATS_MEM_STRING,
+	LT_STATS_MEM_LIST,
+	LT_STATS_MEM_TRIE,
+	LT_STATS_MEM_TRIE_NODE,
+	LT_STATS_MEM_LANG,
+	LT_STATS_MEM_EXTLANG,
+	LT_STATS_MEM_SCRIPT,
+	LT_STATS_MEM_REGION,
+	LT_STATS_MEM_VARIANT,
+	LT_STATS_MEM_GRANDFATHERED,
+	LT_STATS_MEM_REDUNDANT,
+	LT_STATS_MEM_EXTENSION,
+	LT_STATS_MEM_EXT_MODULE,
+	LT_STATS_MEM_EXT_MODULE_DATA,
+	LT_STATS_MEM_DATABASE,
+	LT_STATS_MEM_DB_IMAGE,
+	LT_STATS_MEM_XML,
+	LT_STATS_MEM_ERROR,
+	LT_STATS_MEM_TAG_DICT,
+	LT_STATS_MEM_END
+};
+
+/**
+ * LT_STATS_N_ERRORS:
+ *
+ * The number of the error types counted in #lt_stats_t.
+ */
+#define LT_STATS_N_ERRORS	(LT_ERR_ANY - LT_ERR_UNKNOWN)
+
+typedef enum _lt_stats_db_t		lt_stats_db_t;
+typedef enum _lt_stats_mem_type_t	lt_stats_mem_type_t;
+typedef struct _lt_stats_t		lt_stats_t;
+typedef struct _lt_stats_mem_t		lt_stats_mem_t;
+
+/**
+ * lt_stats_t:
+ * @parses: the number of the tags parsed.
+ * @parse_failures: the number of the tags failed to parse, by the type of
+ *                  the error. see lt_stats_get_parse_failures().
+ * @db_lookups: the number of the lookups in each database.
+ * @db_misses: the number of the lookups which found nothing in each database.
+ * @xpath_evals: the number of the XPath expressions evaluated.
+ * @canonicalize_iterations: the number of the lookups of the redundant tags
+ *                           while canonicalizing.
+ * @transform_retries: the number of the lookups of the likely subtags
+ *                     retried with the less subtags while transforming.
+ * @module_calls: the number of the calls to the extension modules.
+ * @objects_allocated: the number of the objects allocated.
+ * @bytes_allocated: the size of the objects allocated in bytes.
+ *
+ * The counters of the operations in the library, which are aggregated
+ * over all the threads. see lt_stats_get().
+ */
+struct _lt_stats_t {
+	unsigned long long parses;
+	unsigned long long parse_failures[LT_STATS_N_ERRORS];
+	unsigned long long db_lookups[LT_STATS_DB_END];
+	unsigned long long db_misses[LT_STATS_DB_END];
+	unsigned long long xpath_evals;
+	unsigned long long canonicalize_iterations;
+	unsigned long long transform_retries;
+	unsigned long long module_calls;
+	unsigned long long objects_allocated;
+	unsigned long long bytes_allocated;
+};
+
+/**
+ * lt_stats_mem_t:
+ * @n_allocated: the number of the objects allocated so far.
+ * @n_live: the number of the objects alive.
+ * @n_live_max: the high-water mark of @n_live.
+ * @live_bytes: the size of the objects alive in bytes.
+ * @live_bytes_max: the high-water mark of @live_bytes.
+ *
+ * The memory used by a type of the objects. see lt_stats_get_memory().
+ */
+struct _lt_stats_mem_t {
+	unsigned long long n_allocated;
+	unsigned long long n_live;
+	unsigned long long n_live_max;
+	unsigned long long live_bytes;
+	unsigned long long live_bytes_max;
+};
+
+lt_bool_t          lt_stats_get                  (lt_stats_t          *stats);
+void               lt_stats_reset                (void);
+unsigned long long lt_stats_get_parse_failures   (const lt_stats_t    *stats,
+                                                  lt_error_type_t      type);
+void               lt_stats_set_memory_accounting(lt_bool_t            flag);
+lt_bool_t          lt_stats_get_memory           (lt_stats_mem_type_t  type,
+                                                  lt_stats_mem_t      *stats);
+const char        *lt_stats_mem_type_get_name    (lt_stats_mem_type_t  type);
+
+LT_END_DECLS
+
+#endif /* __LT_STATS_H__ */
@@ -0,0 +1,27 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/* 
+ * lt-string-private.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ * 
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ * 
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __LT_STRING_PRIVATE_H__
+#define __LT_STRING_PRIVATE_H__
+
+#include "lt-macros.h"
+#include "lt-mem.h"
+#include "lt-string.h"
+
+LT_BEGIN_DECLS
+
+lt_string_t *lt_string_new_with_arena(lt_mem_arena_t *arena,
+				      const char     *string);
+
+LT_END_DECLS
+
+#endif /* __LT_STRING_PRIVATE_H__ */
@@ -20,8 +20,11 @@
 #include "lt-messages.h"
 #include "lt-utils.h"
 #include "lt-string.h"
+#include "lt-string-private.h"
 
-#define LT_STRING_SIZE	128
+#define LT_STRING_SIZE		128
+/* the strings shorter than this are kept in the object itself */
+#define LT_STRING_INLINE_SIZE	32
 
 /**
  * SECTION: lt-string
@@ -32,12 +35,17 @@
  * string.
  */
 struct _lt_string_t {
-	lt_mem_t  parent;
-	char     *string;
-	size_t    len;
-	size_t    allocated_len;
+	lt_mem_t        parent;
+	char           *string;
+	size_t          len;
+	size_t          allocated_len;
+	lt_mem_arena_t *arena;
+	char            buffer[LT_STRING_INLINE_SIZE];
 };
 
+#define LT_STRING_IS_ALLOCATED(_s_)				\
+	((_s_)->string != (_s_)->buffer && (_s_)->arena == NULL)
+
 lt_bool_t _lt_string_expand(lt_string_t *string,
 			    size_t       size);
 
@@ -46,21 +54,80 @@ lt_bool_t
 _lt_string_expand(lt_string_t *string,
 		  size_t       size)
 {
-	string->allocated_len += LT_ALIGNED_TO_POINTER (size + LT_STRING_SIZE);
-	lt_mem_remove_ref(&string->parent, string->string);
-	string->string = realloc(string->string, string->allocated_len);
-	if (!string->string) {
-		string->len = 0;
-		string->allocated_len = 0;
-
-		return FALSE;
+	size_t len = string->allocated_len + LT_ALIGNED_TO_POINTER (size + LT_STRING_SIZE);
+	char *p;
+
+	if (LT_STRING_IS_ALLOCATED (string)) {
+		lt_mem_remove_ref(&string->parent, string->string);
+		p = realloc(string->string, len);
+		if (!p) {
+			lt_mem_add_ref(&string->parent, string->string, free);
+
+			return FALSE;
+		}
+	} else {
+		/* move it out of the inline buffer. the old buffer in
+		 * the arena is freed together with the arena.
+		 */
+		if (string->arena)
+			p = lt_mem_arena_alloc(string->arena, len);
+		else
+			p = malloc(len);
+		if (!p)
+			return FALSE;
+		memcpy(p, string->string, string->len + 1);
 	}
-	lt_mem_add_ref(&string->parent, string->string, free);
+	string->string = p;
+	string->allocated_len = len;
+	if (!string->arena)
+		lt_mem_add_ref(&string->parent, string->string, free);
 
 	return TRUE;
 }
 
+static lt_string_t *
+_lt_string_init(lt_string_t *string,
+		const char  *s)
+{
+	size_t len = s ? strlen(s) : 0;
+
+	string->string = string->buffer;
+	string->len = 0;
+	string->allocated_len = LT_STRING_INLINE_SIZE;
+	if (len >= string->allocated_len &&
+	    !_lt_string_expand(string, len)) {
+		lt_mem_unref(&string->parent);
+
+		return NULL;
+	}
+	if (s)
+		memcpy(string->string, s, len + 1);
+	string->len = len;
+
+	return string;
+}
+
 /*< protected >*/
+/* the buffer is allocated from @arena when it doesn't fit in the inline
+ * buffer. the instance has to be finalized before the owner of @arena.
+ */
+lt_string_t *
+lt_string_new_with_arena(lt_mem_arena_t *arena,
+			 const char     *string)
+{
+	lt_string_t *retval;
+
+	lt_return_val_if_fail (arena != NULL, NULL);
+
+	retval = lt_mem_arena_alloc_object(arena, sizeof (lt_string_t));
+	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_STRING);
+		retval->arena = arena;
+		retval = _lt_string_init(retval, string);
+	}
+
+	return retval;
+}
 
 /*< public >*/
 
@@ -78,18 +145,8 @@ lt_string_new(const char *string)
 	lt_string_t *retval = lt_mem_alloc_object(sizeof (lt_string_t));
 
 	if (retval) {
-		retval->len = string ? strlen(string) : 0;
-		retval->allocated_len = LT_ALIGNED_TO_POINTER (retval->len + LT_STRING_SIZE);
-		retval->string = malloc(retval->allocated_len);
-		if (!retval->string) {
-			lt_mem_unref(&retval->parent);
-			return NULL;
-		}
-		if (string)
-			strcpy(retval->string, string);
-		else
-			retval->string[retval->len] = 0;
-		lt_mem_add_ref(&retval->parent, retval->string, free);
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_STRING);
+		retval = _lt_string_init(retval, string);
 	}
 
 	return retval;
@@ -145,8 +202,13 @@ lt_string_free(lt_string_t *string,
 	char *retval = NULL;
 
 	if (!free_segment) {
-		lt_mem_remove_ref(&string->parent, string->string);
-		retval = string->string;
+		if (LT_STRING_IS_ALLOCATED (string)) {
+			lt_mem_remove_ref(&string->parent, string->string);
+			retval = string->string;
+		} else {
+			/* the buffer can't be taken out of the object or the arena */
+			retval = strdup(string->string);
+		}
 	}
 	lt_string_unref(string);
 
@@ -264,17 +326,36 @@ lt_string_t *
 lt_string_append(lt_string_t *string,
 		 const char  *str)
 {
-	size_t len;
+	lt_return_val_if_fail (string != NULL, NULL);
+	lt_return_val_if_fail (str != NULL, string);
 
+	return lt_string_append_len(string, str, strlen(str));
+}
+
+/**
+ * lt_string_append_len:
+ * @string: a #lt_string_t
+ * @str: the string to append onto the end of @string
+ * @len: the number of bytes in @str to append
+ *
+ * Adds @len bytes of @str onto the end of a #lt_string_t, expanding
+ * it if necessary. @str doesn't need to be nul-terminated.
+ *
+ * Returns: (transfer none): the same @string object
+ */
+lt_string_t *
+lt_string_append_len(lt_string_t *string,
+		     const char  *str,
+		     size_t       len)
+{
 	lt_return_val_if_fail (string != NULL, NULL);
 	lt_return_val_if_fail (str != NULL, string);
 
-	len = strlen(str);
 	if ((string->len + len + 1) >= string->allocated_len) {
 		if (!_lt_string_expand(string, len))
 			return string;
 	}
-	strncpy(&string->string[string->len], str, len);
+	memcpy(&string->string[string->len], str, len);
 	string->len += len;
 	string->string[string->len] = 0;
 
@@ -43,6 +43,9 @@ lt_string_t *lt_string_append_c       (lt_string_t       *string,
                                        char               c);
 lt_string_t *lt_string_append         (lt_string_t       *string,
                                        const char        *str);
+lt_string_t *lt_string_append_len     (lt_string_t       *string,
+                                       const char        *str,
+                                       size_t             len);
 lt_string_t *lt_string_append_filename(lt_string_t       *string,
                                        const char        *path,
 				       ...) LT_GNUC_NULL_TERMINATED;
@@ -0,0 +1,712 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-tag-dict.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "lt-stdint.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lt-atomic.h"
+#include "lt-error.h"
+#include "lt-lock.h"
+#include "lt-mem.h"
+#include "lt-messages.h"
+#include "lt-utils.h"
+#include "lt-tag.h"
+#include "lt-tag-dict.h"
+
+
+/**
+ * SECTION: lt-tag-dict
+ * @Short_Description: A dictionary to map the language tags to the integers
+ * @Title: Container - Tag Dictionary
+ *
+ * This container class assigns a dense integer ID to each distinct
+ * canonicalized language tag, so that the column of the language tags can
+ * be stored as the integers. the tags which are canonicalized to the same
+ * string, such as "en-us", "EN-US" and "en-Latn-US", get the same ID.
+ * the IDs are assigned from 0 in the order of the first occurrence.
+ */
+
+/* The file consists of the header and the canonicalized tags in the order
+ * of IDs. each of them is terminated by nul. the integers are stored
+ * in the native byte order.
+ */
+#define LT_TAG_DICT_MAGIC		"LTDICT"
+#define LT_TAG_DICT_VERSION		1
+#define LT_TAG_DICT_N_SHARDS		64
+#define LT_TAG_DICT_SHARD_SIZE		16
+/* the segment n of the reverse table has 1024 << n entries. it's never
+ * reallocated so that the strings can be looked up without any locks.
+ */
+#define LT_TAG_DICT_SEGMENT_SHIFT	10
+#define LT_TAG_DICT_N_SEGMENTS		23
+#define LT_TAG_DICT_MAX_ID		0xfffffffeU
+#define LT_TAG_DICT_ARENA_SIZE		1024
+#define LT_TAG_DICT_BATCH_SIZE		65536
+
+/* @id is ID + 1. 0 means the empty slot. */
+typedef struct _lt_tag_dict_slot_t {
+	uint32_t hash;
+	uint32_t id;
+} lt_tag_dict_slot_t;
+
+/* the strings are distributed to the shards by the hash value so that
+ * the threads don't wait for each other on looking up the different tags.
+ */
+typedef struct _lt_tag_dict_shard_t {
+	LT_LOCK_DEFINE_DYNAMIC (lock);
+	lt_tag_dict_slot_t *slots;
+	size_t              size;
+	size_t              n_entries;
+	/* keep the shards on the different cache lines */
+	char                padding[64];
+} lt_tag_dict_shard_t;
+
+typedef struct _lt_tag_dict_header_t {
+	char     magic[8];
+	uint32_t version;
+	uint32_t n_entries;
+	uint64_t size;
+} lt_tag_dict_header_t;
+
+/* @lock protects @arena, @segments and @n_ids. */
+struct _lt_tag_dict_t {
+	lt_mem_t              parent;
+	LT_LOCK_DEFINE_DYNAMIC (lock);
+	lt_mem_arena_t       *arena;
+	const char          **segments[LT_TAG_DICT_N_SEGMENTS];
+	size_t                n_ids;
+	lt_tag_dict_shard_t   shards[LT_TAG_DICT_N_SHARDS];
+};
+
+/*< private >*/
+static void
+_lt_tag_dict_finalize(lt_tag_dict_t *dict)
+{
+	int i;
+
+	for (i = 0; i < LT_TAG_DICT_N_SHARDS; i++) {
+		free(dict->shards[i].slots);
+		LT_LOCK_FINI (dict->shards[i].lock);
+	}
+	for (i = 0; i < LT_TAG_DICT_N_SEGMENTS; i++)
+		free(dict->segments[i]);
+	LT_LOCK_FINI (dict->lock);
+}
+
+/* FNV-1a */
+static uint32_t
+_lt_tag_dict_hash(const char *string,
+		  size_t      length)
+{
+	uint32_t retval = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		retval ^= (unsigned char)string[i];
+		retval *= 16777619U;
+	}
+
+	return retval;
+}
+
+static size_t
+_lt_tag_dict_get_segment(size_t  id,
+			 size_t *offset)
+{
+	size_t n = (id >> LT_TAG_DICT_SEGMENT_SHIFT) + 1, retval = 0;
+
+	while (n > 1) {
+		n >>= 1;
+		retval++;
+	}
+	*offset = id - ((((size_t)1) << retval) - 1) * (1 << LT_TAG_DICT_SEGMENT_SHIFT);
+
+	return retval;
+}
+
+static const char *
+_lt_tag_dict_lookup_id(lt_tag_dict_t *dict,
+		       size_t         id)
+{
+	const char **segment;
+	size_t n, offset;
+
+	if (id > LT_TAG_DICT_MAX_ID)
+		return NULL;
+	n = _lt_tag_dict_get_segment(id, &offset);
+	segment = lt_atomic_pointer_get((volatile lt_pointer_t *)&dict->segments[n]);
+	if (!segment)
+		return NULL;
+
+	return lt_atomic_pointer_get((volatile lt_pointer_t *)&segment[offset]);
+}
+
+/* this has to be called with the lock of the shard held */
+static lt_bool_t
+_lt_tag_dict_add_string(lt_tag_dict_t *dict,
+			const char    *string,
+			size_t         length,
+			unsigned int  *id)
+{
+	const char **segment;
+	size_t n, offset;
+	char *s = NULL;
+
+	LT_LOCK_DYNAMIC (dict->lock);
+	if (dict->n_ids > LT_TAG_DICT_MAX_ID)
+		goto bail;
+	n = _lt_tag_dict_get_segment(dict->n_ids, &offset);
+	segment = dict->segments[n];
+	if (!segment) {
+		segment = calloc(((size_t)1) << (n + LT_TAG_DICT_SEGMENT_SHIFT),
+				 sizeof (char *));
+		if (!segment)
+			goto bail;
+		lt_atomic_pointer_set((volatile lt_pointer_t *)&dict->segments[n],
+				      segment);
+	}
+	s = lt_mem_arena_alloc(dict->arena, length + 1);
+	if (s) {
+		memcpy(s, string, length);
+		s[length] = 0;
+		lt_atomic_pointer_set((volatile lt_pointer_t *)&segment[offset], s);
+		*id = dict->n_ids++;
+	}
+  bail:
+	LT_UNLOCK_DYNAMIC (dict->lock);
+
+	return s != NULL;
+}
+
+static lt_bool_t
+_lt_tag_dict_shard_grow(lt_tag_dict_shard_t *shard)
+{
+	size_t i, j, size = shard->size ? shard->size * 2 : LT_TAG_DICT_SHARD_SIZE;
+	lt_tag_dict_slot_t *slots = calloc(size, sizeof (lt_tag_dict_slot_t));
+
+	if (!slots)
+		return FALSE;
+	for (i = 0; i < shard->size; i++) {
+		if (shard->slots[i].id == 0)
+			continue;
+		j = (shard->slots[i].hash / LT_TAG_DICT_N_SHARDS) & (size - 1);
+		while (slots[j].id != 0)
+			j = (j + 1) & (size - 1);
+		slots[j] = shard->slots[i];
+	}
+	free(shard->slots);
+	shard->slots = slots;
+	shard->size = size;
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_dict_insert(lt_tag_dict_t *dict,
+		    const char    *string,
+		    size_t         length,
+		    unsigned int  *id)
+{
+	uint32_t hash = _lt_tag_dict_hash(string, length);
+	lt_tag_dict_shard_t *shard = &dict->shards[hash % LT_TAG_DICT_N_SHARDS];
+	lt_bool_t retval = FALSE;
+	size_t i = 0, mask;
+
+	LT_LOCK_DYNAMIC (shard->lock);
+	if (shard->size > 0) {
+		mask = shard->size - 1;
+		for (i = (hash / LT_TAG_DICT_N_SHARDS) & mask;
+		     shard->slots[i].id != 0;
+		     i = (i + 1) & mask) {
+			const char *s;
+
+			if (shard->slots[i].hash != hash)
+				continue;
+			s = _lt_tag_dict_lookup_id(dict, shard->slots[i].id - 1);
+			if (strncmp(s, string, length) == 0 && s[length] == 0) {
+				*id = shard->slots[i].id - 1;
+				retval = TRUE;
+				goto bail;
+			}
+		}
+	}
+	if ((shard->n_entries + 1) * 2 > shard->size) {
+		if (!_lt_tag_dict_shard_grow(shard))
+			goto bail;
+		mask = shard->size - 1;
+		for (i = (hash / LT_TAG_DICT_N_SHARDS) & mask;
+		     shard->slots[i].id != 0;
+		     i = (i + 1) & mask);
+	}
+	if (_lt_tag_dict_add_string(dict, string, length, id)) {
+		shard->slots[i].hash = hash;
+		shard->slots[i].id = *id + 1;
+		shard->n_entries++;
+		retval = TRUE;
+	}
+  bail:
+	LT_UNLOCK_DYNAMIC (shard->lock);
+
+	return retval;
+}
+
+static lt_bool_t
+_lt_tag_dict_intern_canonical(lt_tag_dict_t  *dict,
+			      const char     *string,
+			      unsigned int   *id,
+			      lt_error_t    **error)
+{
+	if (!_lt_tag_dict_insert(dict, string, strlen(string), id)) {
+		lt_error_set(error, LT_ERR_OOM,
+			     "Unable to add the tag to the dictionary: %s",
+			     string);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*< public >*/
+/**
+ * lt_tag_dict_new:
+ *
+ * Create a new instance of #lt_tag_dict_t.
+ *
+ * Returns: (transfer full): a new instance of #lt_tag_dict_t.
+ */
+lt_tag_dict_t *
+lt_tag_dict_new(void)
+{
+	lt_tag_dict_t *retval = lt_mem_alloc_object_with_arena(sizeof (lt_tag_dict_t),
+							       NULL, 0);
+	int i;
+
+	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_TAG_DICT);
+		retval->arena = lt_mem_get_arena(&retval->parent);
+		LT_LOCK_INIT (retval->lock, tag_dict);
+		for (i = 0; i < LT_TAG_DICT_N_SHARDS; i++)
+			LT_LOCK_INIT (retval->shards[i].lock, tag_dict_shard);
+		lt_mem_add_ref(&retval->parent, retval,
+			       (lt_destroy_func_t)_lt_tag_dict_finalize);
+	}
+
+	return retval;
+}
+
+/**
+ * lt_tag_dict_ref:
+ * @dict: a #lt_tag_dict_t.
+ *
+ * Increases the reference count of @dict.
+ *
+ * Returns: (transfer none): the same @dict object.
+ */
+lt_tag_dict_t *
+lt_tag_dict_ref(lt_tag_dict_t *dict)
+{
+	lt_return_val_if_fail (dict != NULL, NULL);
+
+	return lt_mem_ref(&dict->parent);
+}
+
+/**
+ * lt_tag_dict_unref:
+ * @dict: a #lt_tag_dict_t.
+ *
+ * Decreases the reference count of @dict. when its reference count
+ * drops to 0, the object is finalized (i.e. its memory is freed).
+ */
+void
+lt_tag_dict_unref(lt_tag_dict_t *dict)
+{
+	if (dict)
+		lt_mem_unref(&dict->parent);
+}
+
+/**
+ * lt_tag_dict_intern:
+ * @dict: a #lt_tag_dict_t.
+ * @tag_string: a language tag to be added.
+ * @length: the length of @tag_string in bytes.
+ * @id: (out): a location to store the ID.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Parse and canonicalize @tag_string as lt_tag_parse() and
+ * lt_tag_canonicalize() do, and obtain the ID of the canonicalized tag.
+ * a new ID is assigned if it isn't in @dict yet.
+ * This can be called from the multiple threads at the same time.
+ *
+ * Returns: %TRUE if it's successfully processed, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_dict_intern(lt_tag_dict_t  *dict,
+		   const char     *tag_string,
+		   size_t          length,
+		   unsigned int   *id,
+		   lt_error_t    **error)
+{
+	lt_pointer_t buffer[LT_TAG_DICT_ARENA_SIZE / sizeof (lt_pointer_t)];
+	lt_tag_t *tag;
+	lt_error_t *err = NULL;
+	lt_bool_t retval = FALSE;
+
+	lt_return_val_if_fail (dict != NULL, FALSE);
+	lt_return_val_if_fail (tag_string != NULL, FALSE);
+	lt_return_val_if_fail (id != NULL, FALSE);
+
+	tag = lt_tag_new_with_arena(buffer, sizeof (buffer));
+	if (!tag) {
+		lt_error_set(&err, LT_ERR_OOM, "Unable to create an instance of lt_tag_t.");
+		goto bail;
+	}
+	if (lt_tag_parse_len(tag, tag_string, length, &err))
+		retval = lt_tag_dict_intern_tag(dict, tag, id, &err);
+	lt_tag_unref(tag);
+  bail:
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+	}
+	if (err)
+		lt_error_unref(err);
+
+	return retval;
+}
+
+/**
+ * lt_tag_dict_intern_tag:
+ * @dict: a #lt_tag_dict_t.
+ * @tag: a #lt_tag_t to be added.
+ * @id: (out): a location to store the ID.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Same as lt_tag_dict_intern() but for the tag already parsed.
+ *
+ * Returns: %TRUE if it's successfully processed, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_dict_intern_tag(lt_tag_dict_t  *dict,
+		       lt_tag_t       *tag,
+		       unsigned int   *id,
+		       lt_error_t    **error)
+{
+	lt_error_t *err = NULL;
+	char *s;
+	lt_bool_t retval = FALSE;
+
+	lt_return_val_if_fail (dict != NULL, FALSE);
+	lt_return_val_if_fail (tag != NULL, FALSE);
+	lt_return_val_if_fail (id != NULL, FALSE);
+
+	s = lt_tag_canonicalize(tag, &err);
+	if (s) {
+		retval = _lt_tag_dict_intern_canonical(dict, s, id, &err);
+		free(s);
+	}
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+	}
+	if (err)
+		lt_error_unref(err);
+
+	return retval;
+}
+
+/**
+ * lt_tag_dict_intern_batch:
+ * @dict: a #lt_tag_dict_t.
+ * @spans: an array of #lt_tag_span_t to be added.
+ * @n_spans: the number of the elements in @spans.
+ * @ids: an array to store the IDs.
+ * @status: (allow-none): an array of #lt_error_type_t to store the result
+ *          of each tag, or %NULL.
+ * @n_threads: the number of the threads to be used, or 0 to use as many
+ *             as the online processors.
+ *
+ * Same as lt_tag_dict_intern() for each tag in @spans. the tags are
+ * canonicalized with lt_tag_canonicalize_batch_parallel().
+ * %LT_TAG_DICT_INVALID_ID is stored into @ids for the tags which failed
+ * to be processed. the errors aren't printed.
+ *
+ * Returns: the number of the tags successfully processed.
+ */
+size_t
+lt_tag_dict_intern_batch(lt_tag_dict_t       *dict,
+			 const lt_tag_span_t *spans,
+			 size_t               n_spans,
+			 unsigned int        *ids,
+			 lt_error_type_t     *status,
+			 unsigned int         n_threads)
+{
+	char **results;
+	size_t i, j, n, retval = 0;
+
+	lt_return_val_if_fail (dict != NULL, 0);
+	lt_return_val_if_fail (spans != NULL, 0);
+	lt_return_val_if_fail (ids != NULL, 0);
+
+	results = malloc(sizeof (char *) * LT_MIN (n_spans, LT_TAG_DICT_BATCH_SIZE));
+	if (!results && n_spans > 0) {
+		for (i = 0; i < n_spans; i++) {
+			ids[i] = LT_TAG_DICT_INVALID_ID;
+			if (status)
+				status[i] = LT_ERR_OOM;
+		}
+		return 0;
+	}
+	for (i = 0; i < n_spans; i += n) {
+		n = LT_MIN (n_spans - i, LT_TAG_DICT_BATCH_SIZE);
+		lt_tag_canonicalize_batch_parallel(&spans[i], n, results,
+						   status ? &status[i] : NULL,
+						   n_threads);
+		for (j = 0; j < n; j++) {
+			ids[i + j] = LT_TAG_DICT_INVALID_ID;
+			if (!results[j])
+				continue;
+			if (_lt_tag_dict_insert(dict, results[j], strlen(results[j]), &ids[i + j]))
+				retval++;
+			else if (status)
+				status[i + j] = LT_ERR_OOM;
+			free(results[j]);
+		}
+	}
+	free(results);
+
+	return retval;
+}
+
+/**
+ * lt_tag_dict_get_string:
+ * @dict: a #lt_tag_dict_t.
+ * @id: an ID.
+ *
+ * Obtain the canonicalized tag for @id.
+ * This can be called while the other threads are adding the tags.
+ *
+ * Returns: the canonicalized tag, or %NULL if @id isn't assigned. the
+ *          string is owned by @dict and valid until @dict is finalized.
+ */
+const char *
+lt_tag_dict_get_string(lt_tag_dict_t *dict,
+		       unsigned int   id)
+{
+	lt_return_val_if_fail (dict != NULL, NULL);
+
+	return _lt_tag_dict_lookup_id(dict, id);
+}
+
+/**
+ * lt_tag_dict_size:
+ * @dict: a #lt_tag_dict_t.
+ *
+ * Obtain the number of the IDs assigned in @dict. the IDs are from 0 to
+ * the returned value - 1.
+ *
+ * Returns: the number of the tags in @dict.
+ */
+size_t
+lt_tag_dict_size(lt_tag_dict_t *dict)
+{
+	size_t retval;
+
+	lt_return_val_if_fail (dict != NULL, 0);
+
+	LT_LOCK_DYNAMIC (dict->lock);
+	retval = dict->n_ids;
+	LT_UNLOCK_DYNAMIC (dict->lock);
+
+	return retval;
+}
+
+/**
+ * lt_tag_dict_save:
+ * @dict: a #lt_tag_dict_t.
+ * @filename: the filename to write @dict.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Write the tags in @dict into @filename. it can be read by
+ * lt_tag_dict_load() on the machine of the same byte order.
+ * the tags being added by the other threads at the same time may not
+ * be written.
+ *
+ * Returns: %TRUE if it's successfully written, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_dict_save(lt_tag_dict_t  *dict,
+		 const char     *filename,
+		 lt_error_t    **error)
+{
+	lt_tag_dict_header_t header;
+	lt_error_t *err = NULL;
+	FILE *fp;
+	size_t i, n;
+	const char *s;
+	lt_bool_t retval = FALSE;
+
+	lt_return_val_if_fail (dict != NULL, FALSE);
+	lt_return_val_if_fail (filename != NULL, FALSE);
+
+	fp = fopen(filename, "wb");
+	if (!fp) {
+		lt_error_set(&err, LT_ERR_UNKNOWN,
+			     "Unable to open %s: %s",
+			     filename, strerror(errno));
+		goto bail;
+	}
+	LT_LOCK_DYNAMIC (dict->lock);
+	n = dict->n_ids;
+	LT_UNLOCK_DYNAMIC (dict->lock);
+
+	memset(&header, 0, sizeof (lt_tag_dict_header_t));
+	memcpy(header.magic, LT_TAG_DICT_MAGIC, strlen(LT_TAG_DICT_MAGIC));
+	header.version = LT_TAG_DICT_VERSION;
+	header.n_entries = n;
+	header.size = sizeof (lt_tag_dict_header_t);
+	/* the strings up to @n are never changed */
+	for (i = 0; i < n; i++)
+		header.size += strlen(_lt_tag_dict_lookup_id(dict, i)) + 1;
+	fwrite(&header, sizeof (lt_tag_dict_header_t), 1, fp);
+	for (i = 0; i < n; i++) {
+		s = _lt_tag_dict_lookup_id(dict, i);
+		fwrite(s, strlen(s) + 1, 1, fp);
+	}
+	retval = !ferror(fp);
+	if (fclose(fp) != 0)
+		retval = FALSE;
+	if (!retval)
+		lt_error_set(&err, LT_ERR_UNKNOWN,
+			     "Unable to write %s: %s",
+			     filename, strerror(errno));
+  bail:
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+		lt_error_unref(err);
+	}
+
+	return retval;
+}
+
+/**
+ * lt_tag_dict_load:
+ * @filename: the filename written by lt_tag_dict_save().
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Create a new instance of #lt_tag_dict_t from @filename. the IDs are
+ * same as ones in the dictionary written into @filename.
+ *
+ * Returns: (transfer full): a new instance of #lt_tag_dict_t, or %NULL
+ *          if it fails.
+ */
+lt_tag_dict_t *
+lt_tag_dict_load(const char  *filename,
+		 lt_error_t **error)
+{
+	lt_tag_dict_header_t *header;
+	lt_tag_dict_t *retval = NULL;
+	lt_error_t *err = NULL;
+	FILE *fp;
+	char *data = NULL, *p, *end;
+	long size;
+	size_t n = 0;
+	unsigned int id;
+
+	lt_return_val_if_fail (filename != NULL, NULL);
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		lt_error_set(&err, LT_ERR_UNKNOWN,
+			     "Unable to open %s: %s",
+			     filename, strerror(errno));
+		goto bail;
+	}
+	if (fseek(fp, 0, SEEK_END) != 0 ||
+	    (size = ftell(fp)) < 0 ||
+	    fseek(fp, 0, SEEK_SET) != 0) {
+		lt_error_set(&err, LT_ERR_UNKNOWN,
+			     "Unable to read %s: %s",
+			     filename, strerror(errno));
+		goto bail;
+	}
+	if (size < sizeof (lt_tag_dict_header_t))
+		goto invalid;
+	data = malloc(size);
+	if (!data) {
+		lt_error_set(&err, LT_ERR_OOM,
+			     "Unable to allocate the memory to read %s",
+			     filename);
+		goto bail;
+	}
+	if (fread(data, size, 1, fp) != 1) {
+		lt_error_set(&err, LT_ERR_UNKNOWN,
+			     "Unable to read %s: %s",
+			     filename, strerror(errno));
+		goto bail;
+	}
+	header = (lt_tag_dict_header_t *)data;
+	if (memcmp(header->magic, LT_TAG_DICT_MAGIC, strlen(LT_TAG_DICT_MAGIC) + 1) != 0 ||
+	    header->version != LT_TAG_DICT_VERSION ||
+	    header->size != (uint64_t)size ||
+	    (size > sizeof (lt_tag_dict_header_t) && data[size - 1] != 0))
+		goto invalid;
+
+	retval = lt_tag_dict_new();
+	if (!retval) {
+		lt_error_set(&err, LT_ERR_OOM,
+			     "Unable to create an instance of lt_tag_dict_t.");
+		goto bail;
+	}
+	end = data + size;
+	for (p = data + sizeof (lt_tag_dict_header_t); p < end; p += strlen(p) + 1) {
+		if (!_lt_tag_dict_intern_canonical(retval, p, &id, &err))
+			goto bail;
+		/* the duplicate entries would break the IDs */
+		if (id != n++)
+			goto invalid;
+	}
+	if (n != header->n_entries)
+		goto invalid;
+	goto bail;
+  invalid:
+	lt_error_set(&err, LT_ERR_INVALID,
+		     "Invalid dictionary file: %s", filename);
+  bail:
+	free(data);
+	if (fp)
+		fclose(fp);
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+		lt_error_unref(err);
+		lt_tag_dict_unref(retval);
+		retval = NULL;
+	}
+
+	return retval;
+}
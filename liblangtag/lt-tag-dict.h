@@ -0,0 +1,70 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * lt-tag-dict.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#if !defined (__LANGTAG_H__INSIDE) && !defined (__LANGTAG_COMPILATION)
+#error "Only <liblangtag/langtag.h> can be included directly."
+#endif
+
+#ifndef __LT_TAG_DICT_H__
+#define __LT_TAG_DICT_H__
+
+#include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-error.h>
+#include <liblangtag/lt-tag.h>
+
+LT_BEGIN_DECLS
+
+/**
+ * lt_tag_dict_t:
+ *
+ * All the fields in the <structname>lt_tag_dict_t</structname>
+ * structure are private to the #lt_tag_dict_t implementation.
+ */
+typedef struct _lt_tag_dict_t	lt_tag_dict_t;
+
+/**
+ * LT_TAG_DICT_INVALID_ID:
+ *
+ * The ID which is never assigned to any tags.
+ */
+#define LT_TAG_DICT_INVALID_ID	0xffffffffU
+
+lt_tag_dict_t *lt_tag_dict_new         (void);
+lt_tag_dict_t *lt_tag_dict_ref         (lt_tag_dict_t        *dict);
+void           lt_tag_dict_unref       (lt_tag_dict_t        *dict);
+lt_bool_t      lt_tag_dict_intern      (lt_tag_dict_t        *dict,
+                                        const char           *tag_string,
+                                        size_t                length,
+                                        unsigned int         *id,
+                                        lt_error_t          **error);
+lt_bool_t      lt_tag_dict_intern_tag  (lt_tag_dict_t        *dict,
+                                        lt_tag_t             *tag,
+                                        unsigned int         *id,
+                                        lt_error_t          **error);
+size_t         lt_tag_dict_intern_batch(lt_tag_dict_t        *dict,
+                                        const lt_tag_span_t  *spans,
+                                        size_t                n_spans,
+                                        unsigned int         *ids,
+                                        lt_error_type_t      *status,
+                                        unsigned int          n_threads);
+const char    *lt_tag_dict_get_string  (lt_tag_dict_t        *dict,
+                                        unsigned int          id);
+size_t         lt_tag_dict_size        (lt_tag_dict_t        *dict);
+lt_bool_t      lt_tag_dict_save        (lt_tag_dict_t        *dict,
+                                        const char           *filename,
+                                        lt_error_t          **error);
+lt_tag_dict_t *lt_tag_dict_load        (const char           *filename,
+                                        lt_error_t          **error);
+
+LT_END_DECLS
+
+#endif /* __LT_TAG_DICT_H__ */
@@ -19,16 +19,25 @@
 #include <ctype.h>
 #include <locale.h>
 #include <string.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include <libxml/xpath.h>
+#include "lt-atomic.h"
 #include "lt-config.h"
 #include "lt-database.h"
+#include "lt-database-private.h"
 #include "lt-error.h"
 #include "lt-ext-module-private.h"
 #include "lt-extension-private.h"
 #include "lt-localealias.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-string.h"
+#include "lt-string-private.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
 #include "lt-tag.h"
@@ -42,13 +51,143 @@
  *
  * This container class provides an interface to deal with the language tag.
  */
+#define LT_TAG_SCANNER_TOKEN_SIZE	64
+/* the number of the variants kept in lt_tag_t itself */
+#define LT_TAG_N_INLINE_VARIANTS	2
+/* the layout of lt_tag_key_t.
+ * hi: language (15 bits), extlang (15 bits), script (20 bits), region (11 bits)
+ * lo: variant (42 bits), digest of the whole tag (21 bits), partial flag (1 bit)
+ */
+#define LT_TAG_KEY_LANG_SHIFT		49
+#define LT_TAG_KEY_EXTLANG_SHIFT	34
+#define LT_TAG_KEY_SCRIPT_SHIFT		14
+#define LT_TAG_KEY_REGION_SHIFT		3
+#define LT_TAG_KEY_VARIANT_SHIFT	22
+#define LT_TAG_KEY_DIGEST_SHIFT		1
+#define LT_TAG_KEY_DIGEST_MASK		0x1fffffULL
+#define LT_TAG_KEY_PARTIAL		1ULL
+/* the region code in numeric is placed before the alphabets */
+#define LT_TAG_KEY_REGION_ALPHA		1024
+
+/* lt_tag_is_valid() leaves the rare cases to the parser beyond these */
+#define LT_TAG_VALIDATOR_KEY_SIZE	64
+#define LT_TAG_VALIDATOR_BUFFER_SIZE	256
+#define LT_TAG_VALIDATOR_MAX_VARIANTS	8
+#define LT_TAG_VALIDATOR_ARENA_SIZE	1024
+/* the number of the tags that a worker takes from the queue at once */
+#define LT_TAG_BATCH_CHUNK_SIZE		128
+
 typedef struct _lt_tag_scanner_t {
-	lt_mem_t  parent;
-	char     *string;
-	size_t    length;
-	size_t    position;
+	const char *string;
+	size_t      length;
+	size_t      position;
+	char       *token;
+	char        buffer[LT_TAG_SCANNER_TOKEN_SIZE];
 } lt_tag_scanner_t;
 
+/* the databases obtained once and kept during parsing a tag or a batch */
+typedef struct _lt_tag_dbs_t {
+	lt_lang_db_t          *langdb;
+	lt_extlang_db_t       *extlangdb;
+	lt_script_db_t        *scriptdb;
+	lt_region_db_t        *regiondb;
+	lt_variant_db_t       *variantdb;
+	lt_grandfathered_db_t *grandfathereddb;
+	lt_redundant_db_t     *redundantdb;
+} lt_tag_dbs_t;
+
+typedef struct _lt_tag_scratch_t {
+	lt_tag_dbs_t  dbs;
+	lt_tag_t     *tag;
+	lt_string_t  *string;
+} lt_tag_scratch_t;
+
+#if HAVE_PTHREAD
+typedef struct _lt_tag_batch_t lt_tag_batch_t;
+/* @head and @tail are the range of the chunks that the worker hasn't
+ * taken yet. they are updated with @lock held since the other workers
+ * may steal them.
+ */
+typedef struct _lt_tag_worker_t {
+	pthread_mutex_t   lock;
+	size_t            head;
+	size_t            tail;
+	size_t            id;
+	size_t            n_succeeded;
+	pthread_t         thread;
+	lt_bool_t         running;
+	lt_tag_batch_t   *batch;
+	lt_tag_scratch_t  scratch;
+	/* keep the workers on the different cache lines */
+	char              padding[64];
+} lt_tag_worker_t;
+struct _lt_tag_batch_t {
+	const lt_tag_span_t  *spans;
+	size_t                n_spans;
+	char                **results;
+	lt_error_type_t      *status;
+	lt_tag_dbs_t          dbs;
+	lt_tag_worker_t      *workers;
+	size_t                n_workers;
+};
+#endif
+
+typedef struct _lt_tag_validator_t {
+	lt_tag_state_t     state;
+	lt_tag_dbs_t       dbs;
+	lt_db_probe_t      language;
+	lt_db_probe_t      extlang;
+	lt_db_probe_t      script;
+	lt_db_probe_t      region;
+	lt_db_probe_t      variants[LT_TAG_VALIDATOR_MAX_VARIANTS];
+	size_t             n_variants;
+	lt_bool_t          fallback;
+} lt_tag_validator_t;
+
+typedef struct _lt_tag_parser_t {
+	lt_tag_t      *tag;
+	lt_tag_dbs_t  *dbs;
+	lt_error_t   **error;
+} lt_tag_parser_t;
+
+/* returns FALSE if @token isn't this kind of the subtag so that the others
+ * are tried then. otherwise @validity is set if it isn't acceptable.
+ */
+typedef lt_bool_t (* lt_tag_subtag_func_t)          (lt_pointer_t       data,
+						     const char        *token,
+						     size_t             length,
+						     lt_tag_validity_t *validity);
+typedef lt_bool_t (* lt_tag_extension_close_func_t) (lt_pointer_t       data,
+						     lt_bool_t          keep);
+typedef void      (* lt_tag_privateuse_func_t)      (lt_pointer_t       data,
+						     const char        *token,
+						     size_t             length);
+
+/* how the subtags are dealt with in lt_tag_parse_token(). the parser
+ * stores them into #lt_tag_t whereas lt_tag_is_valid() only probes the
+ * databases. @privateuse may be %NULL. so may @extension_token and
+ * @extension_close if @extension never lets the state go further.
+ */
+typedef struct _lt_tag_parser_funcs_t {
+	const lt_tag_subtag_func_t          language;
+	const lt_tag_subtag_func_t          extlang;
+	const lt_tag_subtag_func_t          script;
+	const lt_tag_subtag_func_t          region;
+	const lt_tag_subtag_func_t          variant;
+	const lt_tag_subtag_func_t          extension;
+	const lt_tag_subtag_func_t          extension_token;
+	const lt_tag_extension_close_func_t extension_close;
+	const lt_tag_privateuse_func_t      privateuse;
+} lt_tag_parser_funcs_t;
+
+typedef struct _lt_tag_variants_t {
+	lt_variant_t **values;
+	size_t         n;
+	size_t         size;
+	lt_list_t     *list;
+	lt_variant_t  *inline_values[LT_TAG_N_INLINE_VARIANTS];
+} lt_tag_variants_t;
+
 struct _lt_tag_t {
 	lt_mem_t            parent;
 	int32_t             wildcard_map;
@@ -58,10 +197,13 @@ struct _lt_tag_t {
 	lt_extlang_t       *extlang;
 	lt_script_t        *script;
 	lt_region_t        *region;
-	lt_list_t          *variants;
+	lt_tag_variants_t   variants;
 	lt_extension_t     *extension;
 	lt_string_t        *privateuse;
 	lt_grandfathered_t *grandfathered;
+	lt_mem_arena_t     *arena;
+	lt_string_t        *spare_tag_string;
+	lt_string_t        *scratch_string;
 };
 
 /*< private >*/
@@ -92,34 +234,33 @@ _lt_tag_string_compare(const lt_string_t *v1,
 	return retval;
 }
 
-static lt_tag_scanner_t *
-lt_tag_scanner_new(const char *tag)
+static void
+lt_tag_scanner_init(lt_tag_scanner_t *scanner,
+		    const char       *tag,
+		    size_t            length)
 {
-	lt_tag_scanner_t *retval = lt_mem_alloc_object(sizeof (lt_tag_scanner_t));
-
-	if (retval) {
-		retval->string = strdup(tag);
-		lt_mem_add_ref(&retval->parent, retval->string, free);
-		retval->length = strlen(tag);
-	}
-
-	return retval;
+	scanner->string = tag;
+	scanner->length = length;
+	scanner->position = 0;
+	scanner->token = scanner->buffer;
 }
 
 static void
-lt_tag_scanner_unref(lt_tag_scanner_t *scanner)
+lt_tag_scanner_finish(lt_tag_scanner_t *scanner)
 {
-	if (scanner)
-		lt_mem_unref(&scanner->parent);
+	if (scanner->token != scanner->buffer)
+		free(scanner->token);
+	scanner->token = scanner->buffer;
 }
 
+/* the token is valid until the next call or lt_tag_scanner_finish() */
 static lt_bool_t
 lt_tag_scanner_get_token(lt_tag_scanner_t  *scanner,
-			 char             **retval,
+			 const char       **retval,
 			 size_t            *length,
 			 lt_error_t       **error)
 {
-	lt_string_t *string = NULL;
+	size_t begin = 0, len;
 	char c;
 	lt_error_t *err = NULL;
 
@@ -131,11 +272,11 @@ lt_tag_scanner_get_token(lt_tag_scanner_t  *scanner,
 		goto bail;
 	}
 
-	string = lt_string_new(NULL);
+	begin = scanner->position;
 	while (scanner->position < scanner->length) {
 		c = scanner->string[scanner->position++];
 		if (c == 0) {
-			if (lt_string_length(string) == 0) {
+			if (scanner->position - 1 == begin) {
 				lt_error_set(&err, LT_ERR_EOT,
 					     "No more tokens in buffer");
 			}
@@ -143,7 +284,7 @@ lt_tag_scanner_get_token(lt_tag_scanner_t  *scanner,
 			break;
 		}
 		if (c == '*') {
-			if (lt_string_length(string) > 0) {
+			if (scanner->position - 1 > begin) {
 				lt_error_set(&err, LT_ERR_FAIL_ON_SCANNER,
 					     "Invalid wildcard: positon = %lu",
 					     (unsigned long)scanner->position - 1);
@@ -154,12 +295,12 @@ lt_tag_scanner_get_token(lt_tag_scanner_t  *scanner,
 				     "Invalid character for tag: '%c'", c);
 			break;
 		}
-		lt_string_append_c(string, c);
 
 		if (c == '-' ||
 		    c == '*')
 			break;
-		if (scanner->string[scanner->position] == '-' ||
+		if (scanner->position >= scanner->length ||
+		    scanner->string[scanner->position] == '-' ||
 		    scanner->string[scanner->position] == 0)
 			break;
 	}
@@ -170,15 +311,28 @@ lt_tag_scanner_get_token(lt_tag_scanner_t  *scanner,
 		else
 			lt_error_print(err, LT_ERR_ANY);
 		lt_error_unref(err);
-		lt_string_unref(string);
 		*retval = NULL;
 		*length = 0;
 
 		return FALSE;
 	}
 
-	*length = lt_string_length(string);
-	*retval = lt_string_free(string, FALSE);
+	/* the subtags are short enough in most cases */
+	len = scanner->position - begin;
+	lt_tag_scanner_finish(scanner);
+	if (len >= LT_TAG_SCANNER_TOKEN_SIZE) {
+		scanner->token = malloc(len + 1);
+		if (!scanner->token) {
+			scanner->token = scanner->buffer;
+			lt_error_set(&err, LT_ERR_OOM,
+				     "Unable to allocate memory for a token");
+			goto bail;
+		}
+	}
+	memcpy(scanner->token, &scanner->string[begin], len);
+	scanner->token[len] = 0;
+	*length = len;
+	*retval = scanner->token;
 
 	return TRUE;
 }
@@ -189,15 +343,183 @@ lt_tag_scanner_is_eof(lt_tag_scanner_t *scanner)
 	lt_return_val_if_fail (scanner != NULL, TRUE);
 	lt_return_val_if_fail (scanner->position <= scanner->length, TRUE);
 
-	return scanner->string[scanner->position] == 0 ||
-		scanner->position >= scanner->length;
+	return scanner->position >= scanner->length ||
+		scanner->string[scanner->position] == 0;
+}
+
+#define LT_TAG_DB(_dbs_,_t_)						\
+	((_dbs_)->_t_ ## db ? (_dbs_)->_t_ ## db : ((_dbs_)->_t_ ## db = lt_db_get_ ## _t_ ()))
+
+static void
+_lt_tag_dbs_clear(lt_tag_dbs_t *dbs)
+{
+	if (dbs->langdb)
+		lt_lang_db_unref(dbs->langdb);
+	if (dbs->extlangdb)
+		lt_extlang_db_unref(dbs->extlangdb);
+	if (dbs->scriptdb)
+		lt_script_db_unref(dbs->scriptdb);
+	if (dbs->regiondb)
+		lt_region_db_unref(dbs->regiondb);
+	if (dbs->variantdb)
+		lt_variant_db_unref(dbs->variantdb);
+	if (dbs->grandfathereddb)
+		lt_grandfathered_db_unref(dbs->grandfathereddb);
+	if (dbs->redundantdb)
+		lt_redundant_db_unref(dbs->redundantdb);
+	memset(dbs, 0, sizeof (lt_tag_dbs_t));
+}
+
+static void
+_lt_tag_variants_clear(lt_pointer_t data)
+{
+	lt_tag_variants_t *variants = data;
+	size_t i;
+
+	for (i = 0; i < variants->n; i++)
+		lt_variant_unref(variants->values[i]);
+	if (variants->values != variants->inline_values)
+		free(variants->values);
+	lt_list_free(variants->list);
+	variants->values = NULL;
+	variants->n = 0;
+	variants->size = 0;
+	variants->list = NULL;
+}
+
+static lt_bool_t
+_lt_tag_variants_append(lt_tag_variants_t *variants,
+			lt_variant_t      *variant)
+{
+	if (variants->n == variants->size) {
+		lt_variant_t **p;
+		size_t size;
+
+		if (variants->size == 0) {
+			size = LT_TAG_N_INLINE_VARIANTS;
+			p = variants->inline_values;
+		} else {
+			size = variants->size * 2;
+			if (variants->values == variants->inline_values) {
+				p = malloc(sizeof (lt_variant_t *) * size);
+				if (p)
+					memcpy(p, variants->values, sizeof (lt_variant_t *) * variants->n);
+			} else {
+				p = realloc(variants->values, sizeof (lt_variant_t *) * size);
+			}
+			if (!p)
+				return FALSE;
+		}
+		variants->values = p;
+		variants->size = size;
+	}
+	variants->values[variants->n++] = variant;
+	/* the list has to be rebuilt */
+	lt_list_free(variants->list);
+	variants->list = NULL;
+
+	return TRUE;
+}
+
+/* packs @s in @width letters by 5 bits each. the shorter string is padded
+ * so that the order of the keys is same as the order of the strings.
+ */
+static lt_bool_t
+_lt_tag_key_pack_alpha(const char         *s,
+		       size_t              min_len,
+		       size_t              width,
+		       unsigned long long *retval)
+{
+	size_t i, len = strlen(s);
+
+	if (len < min_len || len > width)
+		return FALSE;
+	*retval = 0;
+	for (i = 0; i < width; i++) {
+		*retval <<= 5;
+		if (i < len) {
+			if (!isalpha((int)s[i]))
+				return FALSE;
+			*retval |= tolower((int)s[i]) - 'a' + 1;
+		}
+	}
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_key_pack_region(const char         *s,
+			unsigned long long *retval)
+{
+	if (isdigit((int)s[0])) {
+		if (strlen(s) != 3 ||
+		    !isdigit((int)s[1]) ||
+		    !isdigit((int)s[2]))
+			return FALSE;
+		*retval = (s[0] - '0') * 100 + (s[1] - '0') * 10 + (s[2] - '0') + 1;
+
+		return TRUE;
+	}
+	if (!_lt_tag_key_pack_alpha(s, 2, 2, retval))
+		return FALSE;
+	*retval += LT_TAG_KEY_REGION_ALPHA;
+
+	return TRUE;
+}
+
+/* 8 characters in base 37. the digits are placed before the alphabets */
+static lt_bool_t
+_lt_tag_key_pack_variant(const char         *s,
+			 unsigned long long *retval)
+{
+	size_t i, len = strlen(s);
+
+	if (len < 4 || len > 8)
+		return FALSE;
+	*retval = 0;
+	for (i = 0; i < 8; i++) {
+		*retval *= 37;
+		if (i < len) {
+			if (isdigit((int)s[i]))
+				*retval += s[i] - '0' + 1;
+			else if (isalpha((int)s[i]))
+				*retval += tolower((int)s[i]) - 'a' + 11;
+			else
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+_lt_tag_key_unpack_alpha(unsigned long long  v,
+			 size_t              width,
+			 char               *buffer)
+{
+	size_t i, len = 0;
+	char c;
+
+	for (i = width; i > 0; i--) {
+		c = (v >> ((i - 1) * 5)) & 0x1f;
+		if (c)
+			buffer[len++] = c - 1 + 'a';
+	}
+	buffer[len] = 0;
 }
 
-static int
-_lt_tag_variant_compare(const lt_pointer_t a,
-			const lt_pointer_t b)
+static lt_bool_t
+_lt_tag_variants_contains(const lt_tag_variants_t *variants,
+			  const lt_variant_t      *variant)
 {
-	return LT_POINTER_TO_INT (a) - LT_POINTER_TO_INT (b);
+	size_t i;
+
+	for (i = 0; i < variants->n; i++) {
+		if (variants->values[i] == variant)
+			return TRUE;
+	}
+
+	return FALSE;
 }
 
 #define DEFUNC_TAG_FREE(__func__)					\
@@ -214,13 +536,35 @@ DEFUNC_TAG_FREE (language)
 DEFUNC_TAG_FREE (extlang)
 DEFUNC_TAG_FREE (script)
 DEFUNC_TAG_FREE (region)
-DEFUNC_TAG_FREE (variants)
 DEFUNC_TAG_FREE (extension)
 DEFUNC_TAG_FREE (grandfathered)
-DEFUNC_TAG_FREE (tag_string)
 
 #undef DEFUNC_TAG_FREE
 
+LT_INLINE_FUNC void
+lt_tag_free_variants(lt_tag_t *tag)
+{
+	if (tag->variants.n > 0)
+		lt_mem_delete_ref(&tag->parent, &tag->variants);
+}
+
+LT_INLINE_FUNC void
+lt_tag_free_tag_string(lt_tag_t *tag)
+{
+	if (tag->tag_string) {
+		if (tag->arena && !tag->spare_tag_string) {
+			/* keep it to be reused. the memory in the arena
+			 * isn't freed until the tag is finalized.
+			 */
+			lt_string_clear(tag->tag_string);
+			tag->spare_tag_string = tag->tag_string;
+		} else {
+			lt_mem_delete_ref(&tag->parent, tag->tag_string);
+		}
+		tag->tag_string = NULL;
+	}
+}
+
 #define DEFUNC_TAG_SET(__func__, __unref_func__)			\
 	LT_INLINE_FUNC void						\
 	lt_tag_set_ ##__func__ (lt_tag_t *tag, lt_pointer_t p)		\
@@ -244,12 +588,14 @@ LT_INLINE_FUNC void
 lt_tag_set_variant(lt_tag_t     *tag,
 		   lt_pointer_t  p)
 {
-	lt_bool_t no_variants = (tag->variants == NULL);
-
 	if (p) {
-		tag->variants = lt_list_append(tag->variants, p, (lt_destroy_func_t)lt_variant_unref);
-		if (no_variants)
-			lt_mem_add_ref(&tag->parent, tag->variants, lt_list_free);
+		if (tag->variants.n == 0)
+			lt_mem_add_ref(&tag->parent, &tag->variants,
+				       _lt_tag_variants_clear);
+		if (!_lt_tag_variants_append(&tag->variants, p)) {
+			lt_critical("Out of memory");
+			lt_variant_unref(p);
+		}
 	} else {
 		lt_warn_if_reached();
 	}
@@ -258,23 +604,39 @@ lt_tag_set_variant(lt_tag_t     *tag,
 #undef DEFUNC_TAG_SET
 
 LT_INLINE_FUNC void
-lt_tag_add_tag_string(lt_tag_t   *tag,
-		      const char *s)
+lt_tag_add_tag_string_len(lt_tag_t   *tag,
+			  const char *s,
+			  size_t      len)
 {
 	if (!tag->tag_string) {
-		tag->tag_string = lt_string_new(NULL);
-		lt_mem_add_ref(&tag->parent, tag->tag_string,
-			       (lt_destroy_func_t)lt_string_unref);
+		if (tag->spare_tag_string) {
+			tag->tag_string = tag->spare_tag_string;
+			tag->spare_tag_string = NULL;
+		} else {
+			if (tag->arena)
+				tag->tag_string = lt_string_new_with_arena(tag->arena, NULL);
+			else
+				tag->tag_string = lt_string_new(NULL);
+			lt_mem_add_ref(&tag->parent, tag->tag_string,
+				       (lt_destroy_func_t)lt_string_unref);
+		}
 	}
 	if (s) {
 		if (lt_string_length(tag->tag_string) > 0)
 			lt_string_append_c(tag->tag_string, '-');
-		lt_string_append(tag->tag_string, s);
+		lt_string_append_len(tag->tag_string, s, len);
 	} else {
 		lt_warn_if_reached();
 	}
 }
 
+LT_INLINE_FUNC void
+lt_tag_add_tag_string(lt_tag_t   *tag,
+		      const char *s)
+{
+	lt_tag_add_tag_string_len(tag, s, s ? strlen(s) : 0);
+}
+
 static const char *
 lt_tag_get_locale_from_locale_alias(const char *alias)
 {
@@ -292,44 +654,30 @@ lt_tag_get_locale_from_locale_alias(const char *alias)
 
 static void
 lt_tag_fill_wildcard(lt_tag_t       *tag,
+		     lt_tag_dbs_t   *dbs,
 		     lt_tag_state_t  begin,
 		     lt_tag_state_t  end)
 {
 	lt_tag_state_t i;
-	lt_lang_db_t *langdb;
-	lt_extlang_db_t *extlangdb;
-	lt_script_db_t *scriptdb;
-	lt_region_db_t *regiondb;
-	lt_variant_db_t *variantdb;
 	lt_extension_t *e;
 
 	for (i = begin; i < end; i++) {
 		tag->wildcard_map |= (1 << (i - 1));
 		switch (i) {
 		    case STATE_LANG:
-			    langdb = lt_db_get_lang();
-			    lt_tag_set_language(tag, lt_lang_db_lookup(langdb, "*"));
-			    lt_lang_db_unref(langdb);
+			    lt_tag_set_language(tag, lt_lang_db_lookup(LT_TAG_DB (dbs, lang), "*"));
 			    break;
 		    case STATE_EXTLANG:
-			    extlangdb = lt_db_get_extlang();
-			    lt_tag_set_extlang(tag, lt_extlang_db_lookup(extlangdb, "*"));
-			    lt_extlang_db_unref(extlangdb);
+			    lt_tag_set_extlang(tag, lt_extlang_db_lookup(LT_TAG_DB (dbs, extlang), "*"));
 			    break;
 		    case STATE_SCRIPT:
-			    scriptdb = lt_db_get_script();
-			    lt_tag_set_script(tag, lt_script_db_lookup(scriptdb, "*"));
-			    lt_script_db_unref(scriptdb);
+			    lt_tag_set_script(tag, lt_script_db_lookup(LT_TAG_DB (dbs, script), "*"));
 			    break;
 		    case STATE_REGION:
-			    regiondb = lt_db_get_region();
-			    lt_tag_set_region(tag, lt_region_db_lookup(regiondb, "*"));
-			    lt_region_db_unref(regiondb);
+			    lt_tag_set_region(tag, lt_region_db_lookup(LT_TAG_DB (dbs, region), "*"));
 			    break;
 		    case STATE_VARIANT:
-			    variantdb = lt_db_get_variant();
-			    lt_tag_set_variant(tag, lt_variant_db_lookup(variantdb, "*"));
-			    lt_variant_db_unref(variantdb);
+			    lt_tag_set_variant(tag, lt_variant_db_lookup(LT_TAG_DB (dbs, variant), "*"));
 			    break;
 		    case STATE_EXTENSION:
 			    e = lt_extension_create();
@@ -353,6 +701,52 @@ lt_tag_parser_init(lt_tag_t *tag)
 	tag->state = STATE_NONE;
 }
 
+/* the state after a hyphen, or STATE_NONE if it isn't allowed there */
+static lt_tag_state_t
+lt_tag_state_after_hyphen(lt_tag_state_t state)
+{
+	switch (state) {
+	    case STATE_PRE_EXTLANG:
+		    return STATE_EXTLANG;
+	    case STATE_PRE_SCRIPT:
+		    return STATE_SCRIPT;
+	    case STATE_PRE_REGION:
+		    return STATE_REGION;
+	    case STATE_PRE_VARIANT:
+		    return STATE_VARIANT;
+	    case STATE_PRE_EXTENSION:
+		    return STATE_EXTENSION;
+	    case STATE_IN_EXTENSION:
+		    return STATE_EXTENSIONTOKEN;
+	    case STATE_IN_EXTENSIONTOKEN:
+		    return STATE_EXTENSIONTOKEN2;
+	    case STATE_PRE_PRIVATEUSE:
+		    return STATE_PRIVATEUSE;
+	    case STATE_IN_PRIVATEUSE:
+		    return STATE_PRIVATEUSETOKEN;
+	    case STATE_IN_PRIVATEUSETOKEN:
+		    return STATE_PRIVATEUSETOKEN2;
+	    default:
+		    break;
+	}
+
+	return STATE_NONE;
+}
+
+static lt_bool_t
+lt_tag_state_is_complete(lt_tag_state_t state)
+{
+	return state == STATE_PRE_EXTLANG ||
+		state == STATE_PRE_SCRIPT ||
+		state == STATE_PRE_REGION ||
+		state == STATE_PRE_VARIANT ||
+		state == STATE_PRE_EXTENSION ||
+		state == STATE_PRE_PRIVATEUSE ||
+		state == STATE_IN_EXTENSIONTOKEN ||
+		state == STATE_IN_PRIVATEUSETOKEN ||
+		state == STATE_NONE;
+}
+
 static lt_bool_t
 lt_tag_parse_prestate(lt_tag_t    *tag,
 		      const char  *token,
@@ -360,45 +754,17 @@ lt_tag_parse_prestate(lt_tag_t    *tag,
 		      lt_error_t **error)
 {
 	lt_bool_t retval = TRUE;
+	lt_tag_state_t state;
 
 	if (lt_strcmp0(token, "-") == 0) {
-		switch (tag->state) {
-		    case STATE_PRE_EXTLANG:
-			    tag->state = STATE_EXTLANG;
-			    break;
-		    case STATE_PRE_SCRIPT:
-			    tag->state = STATE_SCRIPT;
-			    break;
-		    case STATE_PRE_REGION:
-			    tag->state = STATE_REGION;
-			    break;
-		    case STATE_PRE_VARIANT:
-			    tag->state = STATE_VARIANT;
-			    break;
-		    case STATE_PRE_EXTENSION:
-			    tag->state = STATE_EXTENSION;
-			    break;
-		    case STATE_IN_EXTENSION:
-			    tag->state = STATE_EXTENSIONTOKEN;
-			    break;
-		    case STATE_IN_EXTENSIONTOKEN:
-			    tag->state = STATE_EXTENSIONTOKEN2;
-			    break;
-		    case STATE_PRE_PRIVATEUSE:
-			    tag->state = STATE_PRIVATEUSE;
-			    break;
-		    case STATE_IN_PRIVATEUSE:
-			    tag->state = STATE_PRIVATEUSETOKEN;
-			    break;
-		    case STATE_IN_PRIVATEUSETOKEN:
-			    tag->state = STATE_PRIVATEUSETOKEN2;
-			    break;
-		    default:
-			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-					 "Invalid syntax found during parsing a token: %s",
-					 token);
-			    retval = FALSE;
-			    break;
+		state = lt_tag_state_after_hyphen(tag->state);
+		if (state == STATE_NONE) {
+			lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+				     "Invalid syntax found during parsing a token: %s",
+				     token);
+			retval = FALSE;
+		} else {
+			tag->state = state;
 		}
 	} else {
 		retval = FALSE;
@@ -407,90 +773,320 @@ lt_tag_parse_prestate(lt_tag_t    *tag,
 	return retval;
 }
 
+static lt_bool_t _lt_tag_canonicalize(lt_tag_t      *tag,
+				      lt_tag_dbs_t  *dbs,
+				      lt_string_t   *string,
+				      lt_error_t   **error);
+
+/* the temporary string for the tag being parsed. it's kept in the arena
+ * to be reused if @tag has one. otherwise it's a new one every time.
+ */
+static lt_string_t *
+_lt_tag_get_scratch_string(lt_tag_t *tag)
+{
+	if (!tag->arena)
+		return lt_string_new(NULL);
+	if (!tag->scratch_string) {
+		tag->scratch_string = lt_string_new_with_arena(tag->arena, NULL);
+		lt_mem_add_ref(&tag->parent, tag->scratch_string,
+			       (lt_destroy_func_t)lt_string_unref);
+	} else {
+		lt_string_clear(tag->scratch_string);
+	}
+
+	return lt_string_ref(tag->scratch_string);
+}
+
+/* the subtags after lt_tag_parse_token() has accepted or rejected them */
 static lt_bool_t
-lt_tag_parse_state(lt_tag_t    *tag,
-		   const char  *token,
-		   size_t       length,
-		   lt_error_t **error)
+_lt_tag_parser_language(lt_pointer_t       data,
+			const char        *token,
+			size_t             length,
+			lt_tag_validity_t *validity)
 {
-	lt_bool_t retval = TRUE;
+	lt_tag_parser_t *parser = data;
+	lt_tag_t *tag = parser->tag;
 	const char *p;
 
-	switch (tag->state) {
+	/* shortest ISO 639 code */
+	tag->language = lt_lang_db_lookup(LT_TAG_DB (parser->dbs, lang), token);
+	if (!tag->language) {
+		lt_error_set(parser->error, LT_ERR_FAIL_ON_SCANNER,
+			     "Unknown ISO 639 code: %s",
+			     token);
+		return FALSE;
+	}
+	/* validate if it's really shortest one */
+	p = lt_lang_get_tag(tag->language);
+	if (!p || lt_strcasecmp(token, p) != 0) {
+		lt_error_set(parser->error, LT_ERR_FAIL_ON_SCANNER,
+			     "No such language subtag: %s",
+			     token);
+		lt_lang_unref(tag->language);
+		tag->language = NULL;
+		return FALSE;
+	}
+	lt_mem_add_ref(&tag->parent, tag->language,
+		       (lt_destroy_func_t)lt_lang_unref);
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_parser_extlang(lt_pointer_t       data,
+		       const char        *token,
+		       size_t             length,
+		       lt_tag_validity_t *validity)
+{
+	lt_tag_parser_t *parser = data;
+	lt_tag_t *tag = parser->tag;
+	const char *prefix, *subtag, *lang;
+
+	tag->extlang = lt_extlang_db_lookup(LT_TAG_DB (parser->dbs, extlang), token);
+	if (!tag->extlang)
+		return FALSE;
+	prefix = lt_extlang_get_prefix(tag->extlang);
+	subtag = lt_extlang_get_tag(tag->extlang);
+	lang = lt_lang_get_better_tag(tag->language);
+	if (prefix &&
+	    lt_strcasecmp(prefix, lang) != 0) {
+		lt_error_set(parser->error, LT_ERR_FAIL_ON_SCANNER,
+			     "extlang '%s' is supposed to be used with %s, but %s",
+			     subtag, prefix, lang);
+		lt_extlang_unref(tag->extlang);
+		tag->extlang = NULL;
+		*validity = LT_TAG_INVALID_PREFIX;
+	} else {
+		lt_mem_add_ref(&tag->parent, tag->extlang,
+			       (lt_destroy_func_t)lt_extlang_unref);
+	}
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_parser_script(lt_pointer_t       data,
+		      const char        *token,
+		      size_t             length,
+		      lt_tag_validity_t *validity)
+{
+	lt_tag_parser_t *parser = data;
+
+	lt_tag_set_script(parser->tag, lt_script_db_lookup(LT_TAG_DB (parser->dbs, script), token));
+
+	return parser->tag->script != NULL;
+}
+
+static lt_bool_t
+_lt_tag_parser_region(lt_pointer_t       data,
+		      const char        *token,
+		      size_t             length,
+		      lt_tag_validity_t *validity)
+{
+	lt_tag_parser_t *parser = data;
+
+	lt_tag_set_region(parser->tag, lt_region_db_lookup(LT_TAG_DB (parser->dbs, region), token));
+
+	return parser->tag->region != NULL;
+}
+
+static lt_bool_t
+_lt_tag_parser_variant(lt_pointer_t       data,
+		       const char        *token,
+		       size_t             length,
+		       lt_tag_validity_t *validity)
+{
+	lt_tag_parser_t *parser = data;
+	lt_tag_t *tag = parser->tag;
+	lt_error_t **error = parser->error;
+	lt_variant_t *variant;
+	const lt_list_t *prefixes, *l;
+	lt_string_t *langtag = NULL;
+	lt_bool_t matched = FALSE;
+
+	variant = lt_variant_db_lookup(LT_TAG_DB (parser->dbs, variant), token);
+	if (!variant)
+		return FALSE;
+	prefixes = lt_variant_get_prefix(variant);
+	if (prefixes) {
+		langtag = _lt_tag_get_scratch_string(tag);
+		if (!_lt_tag_canonicalize(tag, parser->dbs, langtag, error)) {
+			/* ignore it and fallback to the original tag string.
+			 * it may be still empty if the language is a wildcard.
+			 */
+			lt_error_clear(*error);
+			*error = NULL;
+			lt_string_clear(langtag);
+			if (tag->tag_string)
+				lt_string_append(langtag, lt_string_value(tag->tag_string));
+		}
+	}
+	for (l = prefixes; l != NULL; l = lt_list_next(l)) {
+		const char *s = lt_list_value(l);
+
+		if (lt_strncasecmp(s, lt_string_value(langtag), strlen(s)) == 0) {
+			matched = TRUE;
+			break;
+		}
+	}
+	if (prefixes && !matched) {
+		lt_string_t *str_prefixes = lt_string_new(NULL);
+
+		for (l = prefixes; l != NULL; l = lt_list_next(l)) {
+			if (lt_string_length(str_prefixes) > 0)
+				lt_string_append(str_prefixes, ",");
+			lt_string_append(str_prefixes, lt_list_value(l));
+		}
+		lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+			     "variant '%s' is supposed to be used with %s, but %s",
+			     token, lt_string_value(str_prefixes),
+			     lt_string_value(langtag));
+		lt_string_unref(str_prefixes);
+		lt_variant_unref(variant);
+		*validity = LT_TAG_INVALID_PREFIX;
+	} else if (tag->variants.n == 0) {
+		lt_tag_set_variant(tag, variant);
+	} else {
+		const char *tstr;
+
+		lt_tag_free_tag_string(tag);
+		tstr = lt_tag_get_string(tag);
+		if (prefixes && !lt_list_find_custom((lt_list_t *)prefixes, (const lt_pointer_t)tstr, (lt_compare_func_t)lt_strcmp0)) {
+			lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+				     "Variant isn't allowed for %s: %s",
+				     tstr,
+				     lt_variant_get_tag(variant));
+			lt_variant_unref(variant);
+			*validity = LT_TAG_INVALID_PREFIX;
+		} else if (!prefixes && _lt_tag_variants_contains(&tag->variants, variant)) {
+			lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+				     "Duplicate variants: %s",
+				     lt_variant_get_tag(variant));
+			lt_variant_unref(variant);
+			*validity = LT_TAG_DUPLICATE_SUBTAG;
+		} else {
+			lt_tag_set_variant(tag, variant);
+		}
+	}
+	if (langtag)
+		lt_string_unref(langtag);
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_parser_extension(lt_pointer_t       data,
+			 const char        *token,
+			 size_t             length,
+			 lt_tag_validity_t *validity)
+{
+	lt_tag_parser_t *parser = data;
+	lt_tag_t *tag = parser->tag;
+
+	if (!tag->extension)
+		lt_tag_set_extension(tag, lt_extension_create());
+	if (lt_extension_has_singleton(tag->extension, token[0])) {
+		lt_error_set(parser->error, LT_ERR_FAIL_ON_SCANNER,
+			     "Duplicate singleton for extension: %s", token);
+		*validity = LT_TAG_INVALID_EXTENSION;
+	} else if (!lt_extension_add_singleton(tag->extension,
+					       token[0],
+					       tag, parser->error)) {
+		*validity = LT_TAG_INVALID_EXTENSION;
+	}
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_parser_extension_token(lt_pointer_t       data,
+			       const char        *token,
+			       size_t             length,
+			       lt_tag_validity_t *validity)
+{
+	lt_tag_parser_t *parser = data;
+
+	if (!lt_extension_add_tag(parser->tag->extension,
+				  token, parser->error))
+		*validity = LT_TAG_INVALID_EXTENSION;
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_parser_extension_close(lt_pointer_t data,
+			       lt_bool_t    keep)
+{
+	lt_tag_parser_t *parser = data;
+
+	/* No need to destroy the previous tokens if it's complete */
+	if (keep && lt_extension_validate_state(parser->tag->extension))
+		return TRUE;
+	lt_extension_cancel_tag(parser->tag->extension);
+
+	return FALSE;
+}
+
+static void
+_lt_tag_parser_privateuse(lt_pointer_t  data,
+			  const char   *token,
+			  size_t        length)
+{
+	lt_tag_parser_t *parser = data;
+
+	if (lt_string_length(parser->tag->privateuse) > 0)
+		lt_string_append_c(parser->tag->privateuse, '-');
+	lt_string_append_len(parser->tag->privateuse, token, length);
+}
+
+static const lt_tag_parser_funcs_t __lt_tag_parser_funcs = {
+	_lt_tag_parser_language,
+	_lt_tag_parser_extlang,
+	_lt_tag_parser_script,
+	_lt_tag_parser_region,
+	_lt_tag_parser_variant,
+	_lt_tag_parser_extension,
+	_lt_tag_parser_extension_token,
+	_lt_tag_parser_extension_close,
+	_lt_tag_parser_privateuse
+};
+
+/* the transition of the state by a subtag, that is shared by the parser
+ * and lt_tag_is_valid(). this decides what kind of the subtag @token can
+ * be at @state and @funcs looks it up. @state is updated only when it's
+ * accepted.
+ */
+static lt_tag_validity_t
+lt_tag_parse_token(lt_tag_state_t              *state,
+		   const lt_tag_parser_funcs_t *funcs,
+		   lt_pointer_t                 data,
+		   const char                  *token,
+		   size_t                       length)
+{
+	lt_tag_validity_t validity = LT_TAG_VALID;
+	lt_bool_t probed = FALSE;
+
+	switch (*state) {
 	    case STATE_LANG:
-		    if (length == 1) {
-			    if (lt_strcasecmp(token, "x") == 0) {
-				    lt_string_append(tag->privateuse, token);
-				    tag->state = STATE_IN_PRIVATEUSE;
-				    break;
-			    } else {
-			      invalid_tag:
-				    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-						 "Invalid language subtag: %s", token);
-				    break;
-			    }
+		    if (length == 1 && (token[0] == 'x' || token[0] == 'X')) {
+			    if (funcs->privateuse)
+				    funcs->privateuse(data, token, length);
+			    *state = STATE_IN_PRIVATEUSE;
+			    break;
 		    } else if (length >= 2 && length <= 3) {
-			    lt_lang_db_t *langdb = lt_db_get_lang();
-
-			    /* shortest ISO 639 code */
-			    tag->language = lt_lang_db_lookup(langdb, token);
-			    lt_lang_db_unref(langdb);
-			    if (!tag->language) {
-				    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-						 "Unknown ISO 639 code: %s",
-						 token);
-				    break;
-			    }
-			    /* validate if it's really shortest one */
-			    p = lt_lang_get_tag(tag->language);
-			    if (!p || lt_strcasecmp(token, p) != 0) {
-				    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-						 "No such language subtag: %s",
-						 token);
-				    lt_lang_unref(tag->language);
-				    tag->language = NULL;
-				    break;
-			    }
-			    lt_mem_add_ref(&tag->parent, tag->language,
-					   (lt_destroy_func_t)lt_lang_unref);
-			    tag->state = STATE_PRE_EXTLANG;
-		    } else if (length == 4) {
-			    /* reserved for future use */
-			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-					 "Reserved for future use: %s",
-					 token);
-		    } else if (length >= 5 && length <= 8) {
-			    /* registered language subtag */
-			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-					 "XXX: registered language tag: %s",
-					 token);
-		    } else {
-			    goto invalid_tag;
+			    if (!funcs->language(data, token, length, &validity))
+				    return LT_TAG_UNKNOWN_SUBTAG;
+			    if (validity == LT_TAG_VALID)
+				    *state = STATE_PRE_EXTLANG;
+			    break;
 		    }
-		    break;
+		    return LT_TAG_INVALID_SUBTAG;
 	    case STATE_EXTLANG:
 		    if (length == 3) {
-			    lt_extlang_db_t *extlangdb = lt_db_get_extlang();
-
-			    tag->extlang = lt_extlang_db_lookup(extlangdb, token);
-			    lt_extlang_db_unref(extlangdb);
-			    if (tag->extlang) {
-				    const char *prefix = lt_extlang_get_prefix(tag->extlang);
-				    const char *subtag = lt_extlang_get_tag(tag->extlang);
-				    const char *lang = lt_lang_get_better_tag(tag->language);
-
-				    if (prefix &&
-					lt_strcasecmp(prefix, lang) != 0) {
-					    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-							 "extlang '%s' is supposed to be used with %s, but %s",
-							 subtag, prefix, lang);
-					    lt_extlang_unref(tag->extlang);
-					    tag->extlang = NULL;
-				    } else {
-					    lt_mem_add_ref(&tag->parent, tag->extlang,
-							   (lt_destroy_func_t)lt_extlang_unref);
-					    tag->state = STATE_PRE_SCRIPT;
-				    }
+			    probed = TRUE;
+			    if (funcs->extlang(data, token, length, &validity)) {
+				    if (validity == LT_TAG_VALID)
+					    *state = STATE_PRE_SCRIPT;
 				    break;
 			    }
 			    /* try to check something else */
@@ -499,12 +1095,10 @@ lt_tag_parse_state(lt_tag_t    *tag,
 		    }
 	    case STATE_SCRIPT:
 		    if (length == 4) {
-			    lt_script_db_t *scriptdb = lt_db_get_script();
-
-			    lt_tag_set_script(tag, lt_script_db_lookup(scriptdb, token));
-			    lt_script_db_unref(scriptdb);
-			    if (tag->script) {
-				    tag->state = STATE_PRE_REGION;
+			    probed = TRUE;
+			    if (funcs->script(data, token, length, &validity)) {
+				    if (validity == LT_TAG_VALID)
+					    *state = STATE_PRE_REGION;
 				    break;
 			    }
 			    /* try to check something else */
@@ -517,12 +1111,10 @@ lt_tag_parse_state(lt_tag_t    *tag,
 			 isdigit((int)token[0]) &&
 			 isdigit((int)token[1]) &&
 			 isdigit((int)token[2]))) {
-			    lt_region_db_t *regiondb = lt_db_get_region();
-
-			    lt_tag_set_region(tag, lt_region_db_lookup(regiondb, token));
-			    lt_region_db_unref(regiondb);
-			    if (tag->region) {
-				    tag->state = STATE_PRE_VARIANT;
+			    probed = TRUE;
+			    if (funcs->region(data, token, length, &validity)) {
+				    if (validity == LT_TAG_VALID)
+					    *state = STATE_PRE_VARIANT;
 				    break;
 			    }
 			    /* try to check something else */
@@ -530,74 +1122,13 @@ lt_tag_parse_state(lt_tag_t    *tag,
 			    /* it may be a variant */
 		    }
 	    case STATE_VARIANT:
-		    if ((length >=5 && length <= 8) ||
+		    if ((length >= 5 && length <= 8) ||
 			(length == 4 && isdigit((int)token[0]))) {
-			    lt_variant_db_t *variantdb = lt_db_get_variant();
-			    lt_variant_t *variant;
-
-			    variant = lt_variant_db_lookup(variantdb, token);
-			    lt_variant_db_unref(variantdb);
-			    if (variant) {
-				    const lt_list_t *prefixes = lt_variant_get_prefix(variant), *l;
-				    char *langtag = lt_tag_canonicalize(tag, error);
-				    lt_string_t *str_prefixes = lt_string_new(NULL);
-				    lt_bool_t matched = FALSE;
-
-				    if (error && lt_error_is_set(*error, LT_ERR_ANY)) {
-					    /* ignore it and fallback to the original tag string */
-					    lt_error_clear(*error);
-					    *error = NULL;
-					    langtag = strdup(lt_string_value(tag->tag_string));
-				    }
-				    for (l = prefixes; l != NULL; l = lt_list_next(l)) {
-					    const char *s = lt_list_value(l);
-
-					    if (lt_string_length(str_prefixes) > 0)
-						    lt_string_append(str_prefixes, ",");
-					    lt_string_append(str_prefixes, s);
-
-					    if (lt_strncasecmp(s, langtag, strlen(s)) == 0) {
-						    matched = TRUE;
-						    break;
-					    }
-				    }
-				    if (prefixes && !matched) {
-					    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-							 "variant '%s' is supposed to be used with %s, but %s",
-							 token, lt_string_value(str_prefixes), langtag);
-					    lt_variant_unref(variant);
-				    } else {
-					    if (!tag->variants) {
-						    lt_tag_set_variant(tag, variant);
-					    } else {
-						    lt_list_t *prefixes = (lt_list_t *)lt_variant_get_prefix(variant);
-						    const char *tstr;
-
-						    lt_tag_free_tag_string(tag);
-						    tstr = lt_tag_get_string(tag);
-						    if (prefixes && !lt_list_find_custom(prefixes, (const lt_pointer_t)tstr, (lt_compare_func_t)lt_strcmp0)) {
-							    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-									 "Variant isn't allowed for %s: %s",
-									 tstr,
-									 lt_variant_get_tag(variant));
-							    lt_variant_unref(variant);
-						    } else if (!prefixes && lt_list_find_custom(tag->variants, variant, _lt_tag_variant_compare)) {
-							    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-									 "Duplicate variants: %s",
-									 lt_variant_get_tag(variant));
-							    lt_variant_unref(variant);
-						    } else {
-							    tag->variants = lt_list_append(tag->variants,
-											   variant,
-											   (lt_destroy_func_t)lt_variant_unref);
-						    }
-					    }
-					    /* multiple variants are allowed. */
-					    tag->state = STATE_PRE_VARIANT;
-				    }
-				    if (langtag)
-					    free(langtag);
-				    lt_string_unref(str_prefixes);
+			    probed = TRUE;
+			    if (funcs->variant(data, token, length, &validity)) {
+				    /* multiple variants are allowed. */
+				    if (validity == LT_TAG_VALID)
+					    *state = STATE_PRE_VARIANT;
 				    break;
 			    }
 			    /* try to check something else */
@@ -610,86 +1141,137 @@ lt_tag_parse_state(lt_tag_t    *tag,
 			token[0] != 'x' &&
 			token[0] != 'X' &&
 			token[0] != '*' &&
-			token[0] != '-') {
-			    if (!tag->extension)
-				    lt_tag_set_extension(tag, lt_extension_create());
-			    if (lt_extension_has_singleton(tag->extension, token[0])) {
-				    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-						 "Duplicate singleton for extension: %s", token);
-			    } else {
-				    if (lt_extension_add_singleton(tag->extension,
-								    token[0],
-								    tag, error)) {
-					    tag->state = STATE_IN_EXTENSION;
-				    }
-			    }
+			token[0] != '-' &&
+			funcs->extension(data, token, length, &validity)) {
+			    if (validity == LT_TAG_VALID)
+				    *state = STATE_IN_EXTENSION;
 			    break;
 		    } else {
 			    /* it may be a private use */
 		    }
 	    case STATE_PRIVATEUSE:
 		    if (length == 1 && (token[0] == 'x' || token[0] == 'X')) {
-			    lt_string_append(tag->privateuse, token);
-			    tag->state = STATE_IN_PRIVATEUSE;
-		    } else {
-			    /* No state to try */
-			    retval = FALSE;
+			    if (funcs->privateuse)
+				    funcs->privateuse(data, token, length);
+			    *state = STATE_IN_PRIVATEUSE;
+			    break;
 		    }
-		    break;
+		    /* No state to try */
+		    return probed ? LT_TAG_UNKNOWN_SUBTAG : LT_TAG_INVALID_SUBTAG;
 	    case STATE_EXTENSIONTOKEN:
 	    case STATE_EXTENSIONTOKEN2:
-		    if (length >= 2 && length <= 8) {
-			    if (lt_extension_add_tag(tag->extension,
-						      token, error))
-				    tag->state = STATE_IN_EXTENSIONTOKEN;
-		    } else {
-			    if (tag->state == STATE_EXTENSIONTOKEN2 &&
-				lt_extension_validate_state(tag->extension)) {
-				    /* No need to destroy the previous tokens.
-				     * fallback to check the extension again.
-				     */
-				    goto extension;
-			    }
-			    lt_extension_cancel_tag(tag->extension);
-			    /* No state to try */
-			    retval = FALSE;
+		    if (!funcs->extension_token)
+			    return LT_TAG_INVALID_EXTENSION;
+		    if (length >= 2 && length <= 8 &&
+			funcs->extension_token(data, token, length, &validity)) {
+			    if (validity == LT_TAG_VALID)
+				    *state = STATE_IN_EXTENSIONTOKEN;
+			    break;
 		    }
-		    break;
+		    /* fallback to check the extension again */
+		    if (funcs->extension_close(data, *state == STATE_EXTENSIONTOKEN2))
+			    goto extension;
+		    return LT_TAG_INVALID_EXTENSION;
 	    case STATE_PRIVATEUSETOKEN:
 	    case STATE_PRIVATEUSETOKEN2:
 		    if (length <= 8) {
-			    lt_string_append_printf(tag->privateuse, "-%s", token);
-			    tag->state = STATE_IN_PRIVATEUSETOKEN;
-		    } else {
-			    /* 'x'/'X' is reserved singleton for the private use subtag.
-			     * so nothing to fallback to anything else.
-			     */
+			    if (funcs->privateuse)
+				    funcs->privateuse(data, token, length);
+			    *state = STATE_IN_PRIVATEUSETOKEN;
+			    break;
+		    }
+		    return LT_TAG_INVALID_SUBTAG;
+	    default:
+		    return LT_TAG_INVALID_SYNTAX;
+	}
+
+	return validity;
+}
+
+static lt_bool_t
+lt_tag_parse_state(lt_tag_t     *tag,
+		   lt_tag_dbs_t *dbs,
+		   const char   *token,
+		   size_t        length,
+		   lt_error_t  **error)
+{
+	lt_tag_parser_t parser;
+	lt_tag_state_t state = tag->state;
+	lt_tag_validity_t validity;
+
+	parser.tag = tag;
+	parser.dbs = dbs;
+	parser.error = error;
+	validity = lt_tag_parse_token(&tag->state, &__lt_tag_parser_funcs,
+				      &parser, token, length);
+	if (validity == LT_TAG_VALID)
+		return TRUE;
+	if (lt_error_is_set(*error, LT_ERR_ANY))
+		return FALSE;
+	/* the funcs didn't tell why. the others are reported as
+	 * the incomplete tag by the caller.
+	 */
+	switch (state) {
+	    case STATE_LANG:
+		    if (length == 4) {
+			    /* reserved for future use */
+			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+					 "Reserved for future use: %s",
+					 token);
+		    } else if (length >= 5 && length <= 8) {
+			    /* registered language subtag */
 			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-					 "Invalid tag for the private use: token = '%s'",
+					 "XXX: registered language tag: %s",
 					 token);
+		    } else {
+			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+					 "Invalid language subtag: %s", token);
 		    }
 		    break;
-	    default:
+	    case STATE_PRIVATEUSETOKEN:
+	    case STATE_PRIVATEUSETOKEN2:
+		    /* 'x'/'X' is reserved singleton for the private use subtag.
+		     * so nothing to fallback to anything else.
+		     */
 		    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
-				 "Unable to parse tag: %s, token = '%s' state = %d",
-				 lt_string_value(tag->tag_string), token, tag->state);
+				 "Invalid tag for the private use: token = '%s'",
+				 token);
+		    break;
+	    default:
+		    if (validity == LT_TAG_INVALID_SYNTAX)
+			    lt_error_set(error, LT_ERR_FAIL_ON_SCANNER,
+					 "Unable to parse tag: %s, token = '%s' state = %d",
+					 lt_string_value(tag->tag_string), token, tag->state);
 		    break;
 	}
-	if (lt_error_is_set(*error, LT_ERR_ANY))
-		retval = FALSE;
 
-	return retval;
+	return FALSE;
+}
+
+/* the error type in @error for the status of the batch processing */
+static lt_error_type_t
+_lt_tag_get_error_type(lt_error_t *error)
+{
+	lt_error_type_t type;
+
+	for (type = LT_ERR_OOM; type < LT_ERR_ANY; type++) {
+		if (lt_error_is_set(error, type))
+			return type;
+	}
+
+	return LT_ERR_UNKNOWN;
 }
 
 static lt_bool_t
-_lt_tag_parse(lt_tag_t    *tag,
-	      const char  *langtag,
-	      lt_bool_t    allow_wildcard,
-	      lt_error_t **error)
+_lt_tag_parse(lt_tag_t      *tag,
+	      lt_tag_dbs_t  *dbs,
+	      const char    *langtag,
+	      size_t         length,
+	      lt_bool_t      allow_wildcard,
+	      lt_error_t   **error)
 {
-	lt_tag_scanner_t *scanner = NULL;
-	lt_grandfathered_db_t *grandfathereddb;
-	char *token = NULL;
+	lt_tag_scanner_t scanner;
+	const char *token = NULL, *p;
 	size_t len = 0;
 	lt_error_t *err = NULL;
 	lt_bool_t retval = TRUE;
@@ -699,10 +1281,14 @@ _lt_tag_parse(lt_tag_t    *tag,
 	lt_return_val_if_fail (tag != NULL, FALSE);
 	lt_return_val_if_fail (langtag != NULL, FALSE);
 
+	/* the scanner stops at the nul byte as well */
+	p = memchr(langtag, 0, length);
+	if (p)
+		length = p - langtag;
+	LT_PROBE2 (parse_start, langtag, length);
+	lt_tag_scanner_init(&scanner, langtag, length);
 	if (tag->state == STATE_NONE) {
-		grandfathereddb = lt_db_get_grandfathered();
-		lt_tag_set_grandfathered(tag, lt_grandfathered_db_lookup(grandfathereddb, langtag));
-		lt_grandfathered_db_unref(grandfathereddb);
+		lt_tag_set_grandfathered(tag, lt_grandfathered_db_lookup_len(LT_TAG_DB (dbs, grandfathered), langtag, length));
 		if (tag->grandfathered) {
 			/* no need to lookup anymore. */
 			goto bail;
@@ -718,13 +1304,8 @@ _lt_tag_parse(lt_tag_t    *tag,
 			tag->state++;
 	}
 
-	scanner = lt_tag_scanner_new(langtag);
-	while (!lt_tag_scanner_is_eof(scanner)) {
-		if (token) {
-			free(token);
-			token = NULL;
-		}
-		if (!lt_tag_scanner_get_token(scanner, &token, &len, &err)) {
+	while (!lt_tag_scanner_is_eof(&scanner)) {
+		if (!lt_tag_scanner_get_token(&scanner, &token, &len, &err)) {
 			if (err)
 				break;
 			lt_error_set(&err, LT_ERR_FAIL_ON_SCANNER,
@@ -747,35 +1328,625 @@ _lt_tag_parse(lt_tag_t    *tag,
 				else
 					tag->state -= 1;
 			} else {
-				if (!lt_tag_parse_state(tag, token, len, &err))
+				if (!lt_tag_parse_state(tag, dbs, token, len, &err))
 					break;
 				if (wildcard != STATE_NONE) {
-					lt_tag_fill_wildcard(tag, wildcard, tag->state - 1);
+					lt_tag_fill_wildcard(tag, dbs, wildcard, tag->state - 1);
 					wildcard = STATE_NONE;
 				}
 			}
 		}
 	}
-	if (wildcard != STATE_NONE) {
-		lt_tag_fill_wildcard(tag, wildcard, STATE_END);
-	}
-	if (!err &&
-	    tag->state != STATE_PRE_EXTLANG &&
-	    tag->state != STATE_PRE_SCRIPT &&
-	    tag->state != STATE_PRE_REGION &&
-	    tag->state != STATE_PRE_VARIANT &&
-	    tag->state != STATE_PRE_EXTENSION &&
-	    tag->state != STATE_PRE_PRIVATEUSE &&
-	    tag->state != STATE_IN_EXTENSIONTOKEN &&
-	    tag->state != STATE_IN_PRIVATEUSETOKEN &&
-	    tag->state != STATE_NONE) {
-		lt_error_set(&err, LT_ERR_FAIL_ON_SCANNER,
-			     "Invalid tag: %s, last token = '%s', state = %d, parsed count = %d",
-			     langtag, token, tag->state, count);
+	if (wildcard != STATE_NONE) {
+		lt_tag_fill_wildcard(tag, dbs, wildcard, STATE_END);
+	}
+	if (!err && !lt_tag_state_is_complete(tag->state)) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_SCANNER,
+			     "Invalid tag: %.*s, last token = '%s', state = %d, parsed count = %d",
+			     (int)length, langtag, token, tag->state, count);
+	}
+  bail:
+	lt_tag_add_tag_string_len(tag, langtag, length);
+	LT_STATS_INC (parses);
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		LT_STATS_PARSE_FAILURE (_lt_tag_get_error_type(err));
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+		lt_error_unref(err);
+		retval = FALSE;
+	}
+	lt_tag_scanner_finish(&scanner);
+	LT_PROBE4 (parse_done, langtag, length, (int)tag->state, (int)retval);
+
+	return retval;
+}
+
+#define LT_TAG_PROBE_BETTER_TAG(_p_)					\
+	((_p_)->preferred_tag ? (_p_)->preferred_tag : (_p_)->tag)
+
+static void
+_lt_tag_validator_finish(lt_tag_validator_t *v)
+{
+	_lt_tag_dbs_clear(&v->dbs);
+}
+
+/* the databases are keyed in lower case */
+static const char *
+_lt_tag_validator_key(char       *buffer,
+		      size_t      size,
+		      const char *s,
+		      size_t      length)
+{
+	size_t i;
+
+	if (length >= size)
+		return NULL;
+	for (i = 0; i < length; i++)
+		buffer[i] = tolower((int)s[i]);
+	buffer[length] = 0;
+
+	return buffer;
+}
+
+static lt_bool_t
+_lt_tag_validator_append(char       *buffer,
+			 size_t      size,
+			 size_t     *length,
+			 char        separator,
+			 const char *s,
+			 lt_bool_t   lower)
+{
+	size_t len = strlen(s), i;
+
+	if (*length + len + 2 > size)
+		return FALSE;
+	if (separator)
+		buffer[(*length)++] = separator;
+	for (i = 0; i < len; i++)
+		buffer[(*length)++] = lower ? tolower((int)s[i]) : s[i];
+	buffer[*length] = 0;
+
+	return TRUE;
+}
+
+/* likewise lt_tag_get_string(), but only with the first @n subtags */
+static lt_bool_t
+_lt_tag_validator_get_string(lt_tag_validator_t *v,
+			     size_t              n,
+			     char               *buffer,
+			     size_t              size,
+			     lt_bool_t           lower)
+{
+	const lt_db_probe_t *subtags[4];
+	size_t n_subtags = 0, len = 0, i;
+
+	buffer[0] = 0;
+	subtags[n_subtags++] = &v->language;
+	if (v->extlang.tag)
+		subtags[n_subtags++] = &v->extlang;
+	if (v->script.tag)
+		subtags[n_subtags++] = &v->script;
+	if (v->region.tag)
+		subtags[n_subtags++] = &v->region;
+	n = LT_MIN (n, n_subtags + v->n_variants);
+	for (i = 0; i < n; i++) {
+		const lt_db_probe_t *p = i < n_subtags ? subtags[i] : &v->variants[i - n_subtags];
+
+		if (!_lt_tag_validator_append(buffer, size, &len, len > 0 ? '-' : 0,
+					      p->tag, lower))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* likewise lt_tag_canonicalize(). returns FALSE if the parser has to
+ * deal with it because of the replacement by the redundant entries.
+ */
+static lt_bool_t
+_lt_tag_validator_canonicalize(lt_tag_validator_t *v,
+			       char               *buffer,
+			       size_t              size)
+{
+	lt_db_probe_t probe;
+	char key[LT_TAG_VALIDATOR_KEY_SIZE];
+	const char *better = LT_TAG_PROBE_BETTER_TAG (&v->language), *p;
+	size_t n_subtags, len = 0, i;
+
+	n_subtags = 1 + (v->extlang.tag ? 1 : 0) + (v->script.tag ? 1 : 0) +
+		(v->region.tag ? 1 : 0) + v->n_variants;
+	for (; n_subtags > 0; n_subtags--) {
+		if (!_lt_tag_validator_get_string(v, n_subtags, buffer, size, TRUE))
+			return FALSE;
+		if (lt_redundant_db_probe(LT_TAG_DB (&v->dbs, redundant),
+					  buffer, &probe)) {
+			if (probe.preferred_tag)
+				return FALSE;
+			break;
+		}
+	}
+
+	buffer[0] = 0;
+	p = _lt_tag_validator_key(key, sizeof (key), better, strlen(better));
+	if (p &&
+	    lt_extlang_db_probe(LT_TAG_DB (&v->dbs, extlang), p, &probe) &&
+	    probe.prefix) {
+		if (!_lt_tag_validator_append(buffer, size, &len, 0, probe.prefix, FALSE))
+			return FALSE;
+		buffer[len++] = '-';
+	}
+	if (!_lt_tag_validator_append(buffer, size, &len, 0, better, FALSE))
+		return FALSE;
+	if (v->extlang.tag) {
+		if (v->extlang.preferred_tag) {
+			len = 0;
+			p = v->extlang.preferred_tag;
+		} else {
+			buffer[len++] = '-';
+			p = v->extlang.tag;
+		}
+		if (!_lt_tag_validator_append(buffer, size, &len, 0, p, FALSE))
+			return FALSE;
+	}
+	if (v->script.tag &&
+	    (!v->language.suppress_script ||
+	     lt_strcasecmp(v->language.suppress_script, v->script.tag))) {
+		if (!_lt_tag_validator_append(buffer, size, &len, '-', v->script.tag, FALSE))
+			return FALSE;
+	}
+	if (v->region.tag) {
+		if (!_lt_tag_validator_append(buffer, size, &len, '-',
+					      LT_TAG_PROBE_BETTER_TAG (&v->region),
+					      FALSE))
+			return FALSE;
+	}
+	n_subtags = len;
+	for (i = 0; i < v->n_variants; i++) {
+		p = LT_TAG_PROBE_BETTER_TAG (&v->variants[i]);
+		if (lt_strcasecmp(v->variants[i].tag, p) != 0)
+			len = n_subtags;
+		if (!_lt_tag_validator_append(buffer, size, &len, '-', p, FALSE))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_validator_match_prefix(const lt_db_probe_t *variant,
+			       const char          *s,
+			       lt_bool_t            exact)
+{
+	const lt_list_t *l;
+	const char *p, *e;
+	size_t len;
+
+	for (l = variant->prefixes; l != NULL; l = lt_list_next(l)) {
+		p = lt_list_value(l);
+		if (exact ? strcmp(p, s) == 0 : lt_strncasecmp(p, s, strlen(p)) == 0)
+			return TRUE;
+	}
+	for (p = variant->prefix_list; p && *p; p = *e ? e + 1 : e) {
+		e = strchr(p, ' ');
+		if (!e)
+			e = p + strlen(p);
+		len = e - p;
+		if (exact ?
+		    strlen(s) == len && strncmp(p, s, len) == 0 :
+		    lt_strncasecmp(p, s, len) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static lt_tag_validity_t
+_lt_tag_validator_add_variant(lt_tag_validator_t  *v,
+			      const lt_db_probe_t *variant)
+{
+	char buffer[LT_TAG_VALIDATOR_BUFFER_SIZE];
+	lt_bool_t has_prefixes = variant->prefixes || variant->prefix_list;
+	size_t i;
+
+	if (v->n_variants == LT_TAG_VALIDATOR_MAX_VARIANTS ||
+	    !_lt_tag_validator_canonicalize(v, buffer, sizeof (buffer))) {
+		v->fallback = TRUE;
+
+		return LT_TAG_VALID;
+	}
+	if (has_prefixes && !_lt_tag_validator_match_prefix(variant, buffer, FALSE))
+		return LT_TAG_INVALID_PREFIX;
+	if (v->n_variants > 0) {
+		if (!_lt_tag_validator_get_string(v, (size_t)-1, buffer, sizeof (buffer), FALSE)) {
+			v->fallback = TRUE;
+
+			return LT_TAG_VALID;
+		}
+		if (has_prefixes && !_lt_tag_validator_match_prefix(variant, buffer, TRUE))
+			return LT_TAG_INVALID_PREFIX;
+		for (i = 0; !has_prefixes && i < v->n_variants; i++) {
+			if (v->variants[i].tag == variant->tag)
+				return LT_TAG_DUPLICATE_SUBTAG;
+		}
+	}
+	v->variants[v->n_variants++] = *variant;
+
+	return LT_TAG_VALID;
+}
+
+/* likewise the parser's ones. @token is the key in lower case here */
+static lt_bool_t
+_lt_tag_validator_language(lt_pointer_t       data,
+			   const char        *token,
+			   size_t             length,
+			   lt_tag_validity_t *validity)
+{
+	lt_tag_validator_t *v = data;
+
+	return lt_lang_db_probe(LT_TAG_DB (&v->dbs, lang), token, &v->language) &&
+		v->language.tag &&
+		lt_strcasecmp(token, v->language.tag) == 0;
+}
+
+static lt_bool_t
+_lt_tag_validator_extlang(lt_pointer_t       data,
+			  const char        *token,
+			  size_t             length,
+			  lt_tag_validity_t *validity)
+{
+	lt_tag_validator_t *v = data;
+	lt_db_probe_t probe;
+
+	if (!lt_extlang_db_probe(LT_TAG_DB (&v->dbs, extlang), token, &probe))
+		return FALSE;
+	if (probe.prefix &&
+	    lt_strcasecmp(probe.prefix,
+			  LT_TAG_PROBE_BETTER_TAG (&v->language)) != 0)
+		*validity = LT_TAG_INVALID_PREFIX;
+	else
+		v->extlang = probe;
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_validator_script(lt_pointer_t       data,
+			 const char        *token,
+			 size_t             length,
+			 lt_tag_validity_t *validity)
+{
+	lt_tag_validator_t *v = data;
+
+	return lt_script_db_probe(LT_TAG_DB (&v->dbs, script), token, &v->script);
+}
+
+static lt_bool_t
+_lt_tag_validator_region(lt_pointer_t       data,
+			 const char        *token,
+			 size_t             length,
+			 lt_tag_validity_t *validity)
+{
+	lt_tag_validator_t *v = data;
+
+	return lt_region_db_probe(LT_TAG_DB (&v->dbs, region), token, &v->region);
+}
+
+static lt_bool_t
+_lt_tag_validator_variant(lt_pointer_t       data,
+			  const char        *token,
+			  size_t             length,
+			  lt_tag_validity_t *validity)
+{
+	lt_tag_validator_t *v = data;
+	lt_db_probe_t probe;
+
+	if (!lt_variant_db_probe(LT_TAG_DB (&v->dbs, variant), token, &probe))
+		return FALSE;
+	*validity = _lt_tag_validator_add_variant(v, &probe);
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_tag_validator_extension(lt_pointer_t       data,
+			    const char        *token,
+			    size_t             length,
+			    lt_tag_validity_t *validity)
+{
+	lt_tag_validator_t *v = data;
+
+	/* the extension modules have to deal with the rest */
+	v->fallback = TRUE;
+
+	return TRUE;
+}
+
+static const lt_tag_parser_funcs_t __lt_tag_validator_funcs = {
+	_lt_tag_validator_language,
+	_lt_tag_validator_extlang,
+	_lt_tag_validator_script,
+	_lt_tag_validator_region,
+	_lt_tag_validator_variant,
+	_lt_tag_validator_extension,
+	NULL,
+	NULL,
+	NULL
+};
+
+static lt_bool_t
+_lt_tag_is_valid_with_parser(lt_tag_dbs_t *dbs,
+			     const char   *tag_string,
+			     size_t        length,
+			     int           flags)
+{
+	lt_pointer_t buffer[LT_TAG_VALIDATOR_ARENA_SIZE / sizeof (lt_pointer_t)];
+	lt_tag_t *tag;
+	lt_error_t *err = NULL;
+	lt_bool_t retval = FALSE;
+
+	tag = lt_tag_new_with_arena(buffer, sizeof (buffer));
+	if (tag) {
+		lt_tag_parser_init(tag);
+		retval = _lt_tag_parse(tag, dbs, tag_string, length,
+				       (flags & LT_TAG_VALIDATE_WILDCARD) != 0,
+				       &err);
+		if (err)
+			lt_error_unref(err);
+		lt_tag_unref(tag);
+	}
+
+	return retval;
+}
+
+/* the subtags missing in @v2 are considered as empty, not as the wildcard,
+ * once the range goes beyond them in @state.
+ */
+static lt_bool_t
+_lt_tag_match(const lt_tag_t *v1,
+	      const lt_tag_t *v2,
+	      lt_tag_state_t  state)
+{
+	lt_return_val_if_fail (v1 != NULL, FALSE);
+	lt_return_val_if_fail (v2 != NULL, FALSE);
+
+	if (state > STATE_EXTLANG && !v2->extlang && v1->extlang &&
+	    !lt_extlang_compare(v1->extlang, NULL))
+		return FALSE;
+	if (state > STATE_SCRIPT && !v2->script && v1->script &&
+	    !lt_script_compare(v1->script, NULL))
+		return FALSE;
+	if (state > STATE_REGION && !v2->region && v1->region &&
+	    !lt_region_compare(v1->region, NULL))
+		return FALSE;
+	if (state > STATE_VARIANT && v2->variants.n == 0 && v1->variants.n > 0 &&
+	    !lt_variant_compare(v1->variants.values[0], NULL))
+		return FALSE;
+	if (state > STATE_EXTENSION && !v2->extension && v1->extension &&
+	    !lt_extension_compare(v1->extension, NULL))
+		return FALSE;
+
+	return lt_tag_compare(v1, v2);
+}
+
+static void
+_lt_tag_subtract(lt_tag_t       *tag,
+		 const lt_tag_t *rtag)
+{
+	if (rtag->language) {
+		lt_tag_free_language(tag);
+	}
+	if (rtag->extlang) {
+		lt_tag_free_extlang(tag);
+	}
+	if (rtag->script) {
+		lt_tag_free_script(tag);
+	}
+	if (rtag->region) {
+		lt_tag_free_region(tag);
+	}
+	if (rtag->variants.n > 0) {
+		lt_tag_free_variants(tag);
+	}
+	if (rtag->extension) {
+		/* XXX: how to deal with the multiple extensions? */
+		lt_tag_free_extension(tag);
+	}
+	if (rtag->privateuse) {
+		if (tag->privateuse)
+			lt_string_clear(tag->privateuse);
+	}
+}
+
+static void
+_lt_tag_replace(lt_tag_t       *tag,
+		const lt_tag_t *rtag)
+{
+	if (rtag->language) {
+		lt_return_if_fail (!tag->language);
+		lt_tag_set_language(tag, lt_lang_ref(rtag->language));
+	}
+	if (rtag->extlang) {
+		lt_return_if_fail (!tag->extlang);
+		lt_tag_set_extlang(tag, lt_extlang_ref(rtag->extlang));
+	}
+	if (rtag->script) {
+		lt_return_if_fail (!tag->script);
+		lt_tag_set_script(tag, lt_script_ref(rtag->script));
+	}
+	if (rtag->region) {
+		lt_return_if_fail (!tag->region);
+		lt_tag_set_region(tag, lt_region_ref(rtag->region));
+	}
+	if (rtag->variants.n > 0) {
+		size_t i;
+
+		lt_return_if_fail (tag->variants.n == 0);
+
+		for (i = 0; i < rtag->variants.n; i++)
+			lt_tag_set_variant(tag, lt_variant_ref(rtag->variants.values[i]));
+	}
+	if (rtag->extension) {
+		lt_return_if_fail (!tag->extension);
+		lt_tag_set_extension(tag, lt_extension_ref(rtag->extension));
+	}
+	if (rtag->privateuse) {
+		lt_string_clear(tag->privateuse);
+		lt_string_append(tag->privateuse, lt_string_value(rtag->privateuse));
+	}
+}
+
+LT_INLINE_FUNC void
+lt_tag_append_subtag(lt_string_t *string,
+		     const char  *subtag)
+{
+	lt_string_append_c(string, '-');
+	lt_string_append(string, subtag);
+}
+
+/* append the canonicalized tag of @tag to @string */
+static lt_bool_t
+_lt_tag_canonicalize(lt_tag_t      *tag,
+		     lt_tag_dbs_t  *dbs,
+		     lt_string_t   *string,
+		     lt_error_t   **error)
+{
+	lt_error_t *err = NULL;
+	size_t i, len = lt_string_length(string), n;
+	lt_redundant_t *r = NULL;
+	lt_bool_t retval = TRUE;
+
+	LT_PROBE1 (canonicalize_start, tag);
+	if (tag->grandfathered) {
+		lt_string_append(string, lt_grandfathered_get_better_tag(tag->grandfathered));
+		goto bail1;
+	}
+
+	/* Look up the longest redundant tag which @tag starts with.
+	 * the candidates are the leading subtags of @tag, which are
+	 * placed after @len in @string temporarily. the redundant tags
+	 * never contain the extensions nor the private use subtags.
+	 */
+	if (tag->language) {
+		lt_string_append(string, lt_lang_get_tag(tag->language));
+		if (tag->extlang)
+			lt_tag_append_subtag(string, lt_extlang_get_tag(tag->extlang));
+		if (tag->script)
+			lt_tag_append_subtag(string, lt_script_get_tag(tag->script));
+		if (tag->region)
+			lt_tag_append_subtag(string, lt_region_get_tag(tag->region));
+		for (i = 0; i < tag->variants.n; i++)
+			lt_tag_append_subtag(string, lt_variant_get_tag(tag->variants.values[i]));
+	}
+	for (n = lt_string_length(string); n > len; n--) {
+		const char *tag_string = lt_string_value(string);
+
+		if (n < lt_string_length(string) && tag_string[n] != '-')
+			continue;
+		LT_STATS_INC (canonicalize_iterations);
+		r = lt_redundant_db_lookup_len(LT_TAG_DB (dbs, redundant),
+					       &tag_string[len], n - len);
+		if (r) {
+			const char *preferred = lt_redundant_get_preferred_tag(r);
+
+			if (preferred) {
+				const char *rs = lt_redundant_get_tag(r);
+				lt_tag_t *rtag = lt_tag_new();
+				lt_tag_t *ntag = lt_tag_new();
+
+				if (!_lt_tag_parse(rtag, dbs, rs, strlen(rs), FALSE, &err)) {
+					lt_tag_unref(rtag);
+					lt_tag_unref(ntag);
+					goto bail1;
+				}
+				if (!_lt_tag_parse(ntag, dbs, preferred, strlen(preferred), FALSE, &err)) {
+					lt_tag_unref(rtag);
+					lt_tag_unref(ntag);
+					goto bail1;
+				}
+				_lt_tag_subtract(tag, rtag);
+				_lt_tag_replace(tag, ntag);
+				lt_tag_unref(rtag);
+				lt_tag_unref(ntag);
+			}
+			break;
+		}
+	}
+	lt_string_truncate(string, len);
+
+	if (tag->language) {
+		size_t vlen;
+		lt_extlang_t *e;
+
+		/* If the language tag starts with a primary language subtag
+		 * that is also an extlang subtag, then the language tag is
+		 * prepended with the extlang's 'Prefix'.
+		 */
+		e = lt_extlang_db_lookup(LT_TAG_DB (dbs, extlang), lt_lang_get_better_tag(tag->language));
+		if (e) {
+			const char *prefix = lt_extlang_get_prefix(e);
+
+			if (prefix) {
+				lt_string_append(string, prefix);
+				lt_string_append_c(string, '-');
+			}
+			lt_extlang_unref(e);
+		}
+
+		lt_string_append(string, lt_lang_get_better_tag(tag->language));
+		if (tag->extlang) {
+			const char *preferred = lt_extlang_get_preferred_tag(tag->extlang);
+
+			if (preferred) {
+				lt_string_truncate(string, len);
+				lt_string_append(string, preferred);
+			} else {
+				lt_tag_append_subtag(string, lt_extlang_get_tag(tag->extlang));
+			}
+		}
+		if (tag->script) {
+			const char *script = lt_script_get_tag(tag->script);
+			const char *suppress = lt_lang_get_suppress_script(tag->language);
+
+			if (!suppress ||
+			    lt_strcasecmp(suppress, script))
+				lt_tag_append_subtag(string, script);
+		}
+		if (tag->region) {
+			lt_tag_append_subtag(string, lt_region_get_better_tag(tag->region));
+		}
+		vlen = lt_string_length(string);
+		for (i = 0; i < tag->variants.n; i++) {
+			lt_variant_t *variant = tag->variants.values[i];
+			const char *better = lt_variant_get_better_tag(variant);
+			const char *s = lt_variant_get_tag(variant);
+
+			if (better && lt_strcasecmp(s, better) != 0) {
+				/* ignore all of variants prior to this one */
+				lt_string_truncate(string, vlen);
+			}
+			lt_tag_append_subtag(string, better ? better : s);
+		}
+		if (tag->extension) {
+			char *s = lt_extension_get_canonicalized_tag(tag->extension);
+
+			lt_tag_append_subtag(string, s);
+			free(s);
+		}
+	}
+	if (tag->privateuse && lt_string_length(tag->privateuse) > 0) {
+		if (lt_string_length(string) > len)
+			lt_string_append_c(string, '-');
+		lt_string_append(string, lt_string_value(tag->privateuse));
 	}
-  bail:
-	lt_tag_add_tag_string(tag, langtag);
-	lt_tag_scanner_unref(scanner);
+	if (lt_string_length(string) == len) {
+		lt_error_set(&err, LT_ERR_NO_TAG,
+			     "No tag to convert.");
+	}
+  bail1:
+	if (r)
+		lt_redundant_unref(r);
 	if (lt_error_is_set(err, LT_ERR_ANY)) {
 		if (error)
 			*error = lt_error_ref(err);
@@ -784,122 +1955,188 @@ _lt_tag_parse(lt_tag_t    *tag,
 		lt_error_unref(err);
 		retval = FALSE;
 	}
-	if (token)
-		free(token);
+	LT_PROBE2 (canonicalize_done, tag, (int)retval);
 
 	return retval;
 }
 
-static lt_bool_t
-_lt_tag_match(const lt_tag_t *v1,
-	      lt_tag_t       *v2,
-	      lt_tag_state_t  state)
+static char *
+_lt_tag_canonicalize_dup(lt_tag_t     *tag,
+			 lt_tag_dbs_t *dbs,
+			 lt_error_t  **error)
 {
-	lt_return_val_if_fail (v1 != NULL, FALSE);
-	lt_return_val_if_fail (v2 != NULL, FALSE);
+	lt_string_t *string = lt_string_new(NULL);
 
-	if (state > STATE_EXTLANG && !v2->extlang && v1->extlang) {
-		lt_extlang_db_t *db = lt_db_get_extlang();
+	if (!_lt_tag_canonicalize(tag, dbs, string, error)) {
+		lt_string_unref(string);
 
-		lt_tag_set_extlang(v2, lt_extlang_db_lookup(db, ""));
-		lt_extlang_db_unref(db);
+		return NULL;
 	}
-	if (state > STATE_SCRIPT && !v2->script && v1->script) {
-		lt_script_db_t *db = lt_db_get_script();
 
-		lt_tag_set_script(v2, lt_script_db_lookup(db, ""));
-		lt_script_db_unref(db);
-	}
-	if (state > STATE_REGION && !v2->region && v1->region) {
-		lt_region_db_t *db = lt_db_get_region();
+	return lt_string_free(string, FALSE);
+}
 
-		lt_tag_set_region(v2, lt_region_db_lookup(db, ""));
-		lt_region_db_unref(db);
-	}
-	if (state > STATE_VARIANT && !v2->variants && v1->variants) {
-		lt_variant_db_t *db = lt_db_get_variant();
+static void
+_lt_tag_dbs_copy(lt_tag_dbs_t       *dbs,
+		 const lt_tag_dbs_t *src)
+{
+	memset(dbs, 0, sizeof (lt_tag_dbs_t));
+	if (src->langdb)
+		dbs->langdb = lt_lang_db_ref(src->langdb);
+	if (src->extlangdb)
+		dbs->extlangdb = lt_extlang_db_ref(src->extlangdb);
+	if (src->scriptdb)
+		dbs->scriptdb = lt_script_db_ref(src->scriptdb);
+	if (src->regiondb)
+		dbs->regiondb = lt_region_db_ref(src->regiondb);
+	if (src->variantdb)
+		dbs->variantdb = lt_variant_db_ref(src->variantdb);
+	if (src->grandfathereddb)
+		dbs->grandfathereddb = lt_grandfathered_db_ref(src->grandfathereddb);
+	if (src->redundantdb)
+		dbs->redundantdb = lt_redundant_db_ref(src->redundantdb);
+}
 
-		lt_tag_set_variant(v2, lt_variant_db_lookup(db, ""));
-		lt_variant_db_unref(db);
-	}
-	if (state > STATE_EXTENSION && !v2->extension && v1->extension) {
-		lt_extension_t *e = lt_extension_create();
+/* the state kept for a batch or a worker thread. the tag allocates
+ * the subtag strings from its own arena, which is reused for every tag.
+ */
+static void
+_lt_tag_scratch_init(lt_tag_scratch_t   *scratch,
+		     const lt_tag_dbs_t *dbs)
+{
+	if (dbs)
+		_lt_tag_dbs_copy(&scratch->dbs, dbs);
+	else
+		memset(&scratch->dbs, 0, sizeof (lt_tag_dbs_t));
+	scratch->tag = lt_tag_new_with_arena(NULL, 0);
+	scratch->string = lt_string_new(NULL);
+}
+
+static void
+_lt_tag_scratch_clear(lt_tag_scratch_t *scratch)
+{
+	if (scratch->string)
+		lt_string_unref(scratch->string);
+	if (scratch->tag)
+		lt_tag_unref(scratch->tag);
+	scratch->string = NULL;
+	scratch->tag = NULL;
+	_lt_tag_dbs_clear(&scratch->dbs);
+}
+
+static lt_error_type_t
+_lt_tag_scratch_canonicalize(lt_tag_scratch_t    *scratch,
+			     const lt_tag_span_t *span,
+			     char               **result)
+{
+	lt_error_type_t retval = LT_ERR_SUCCESS;
+	lt_error_t *err = NULL;
 
-		lt_extension_add_singleton(e, ' ', NULL, NULL);
-		lt_tag_set_extension(v2, e);
+	*result = NULL;
+	if (!scratch->tag || !scratch->string)
+		return LT_ERR_OOM;
+	if (!span->string)
+		return LT_ERR_INVALID;
+
+	lt_tag_parser_init(scratch->tag);
+	lt_string_clear(scratch->string);
+	if (!_lt_tag_parse(scratch->tag, &scratch->dbs, span->string,
+			   span->length, FALSE, &err) ||
+	    !_lt_tag_canonicalize(scratch->tag, &scratch->dbs,
+				  scratch->string, &err)) {
+		retval = err ? _lt_tag_get_error_type(err) : LT_ERR_FAIL_ON_SCANNER;
+	} else {
+		*result = strdup(lt_string_value(scratch->string));
+		if (!*result)
+			retval = LT_ERR_OOM;
 	}
+	if (err)
+		lt_error_unref(err);
 
-	return lt_tag_compare(v1, v2);
+	return retval;
 }
 
-static void
-_lt_tag_subtract(lt_tag_t       *tag,
-		 const lt_tag_t *rtag)
+#if HAVE_PTHREAD
+static lt_bool_t
+_lt_tag_worker_pop(lt_tag_worker_t *worker,
+		   size_t          *chunk)
 {
-	if (rtag->language) {
-		lt_tag_free_language(tag);
-	}
-	if (rtag->extlang) {
-		lt_tag_free_extlang(tag);
-	}
-	if (rtag->script) {
-		lt_tag_free_script(tag);
-	}
-	if (rtag->region) {
-		lt_tag_free_region(tag);
-	}
-	if (rtag->variants) {
-		lt_tag_free_variants(tag);
-	}
-	if (rtag->extension) {
-		/* XXX: how to deal with the multiple extensions? */
-		lt_tag_free_extension(tag);
-	}
-	if (rtag->privateuse) {
-		if (tag->privateuse)
-			lt_string_clear(tag->privateuse);
+	lt_bool_t retval = FALSE;
+
+	pthread_mutex_lock(&worker->lock);
+	if (worker->head < worker->tail) {
+		*chunk = worker->head++;
+		retval = TRUE;
 	}
+	pthread_mutex_unlock(&worker->lock);
+
+	return retval;
 }
 
-static void
-_lt_tag_replace(lt_tag_t       *tag,
-		const lt_tag_t *rtag)
+/* take the latter half of the chunks left in the other worker so that
+ * a worker which got the expensive tags doesn't stall the others.
+ * this is called only when the own range is empty.
+ */
+static lt_bool_t
+_lt_tag_worker_steal(lt_tag_worker_t *worker)
 {
-	if (rtag->language) {
-		lt_return_if_fail (!tag->language);
-		lt_tag_set_language(tag, lt_lang_ref(rtag->language));
-	}
-	if (rtag->extlang) {
-		lt_return_if_fail (!tag->extlang);
-		lt_tag_set_extlang(tag, lt_extlang_ref(rtag->extlang));
-	}
-	if (rtag->script) {
-		lt_return_if_fail (!tag->script);
-		lt_tag_set_script(tag, lt_script_ref(rtag->script));
-	}
-	if (rtag->region) {
-		lt_return_if_fail (!tag->region);
-		lt_tag_set_region(tag, lt_region_ref(rtag->region));
+	lt_tag_batch_t *batch = worker->batch;
+	size_t i, n, head = 0, tail = 0;
+
+	for (i = 1; i < batch->n_workers; i++) {
+		lt_tag_worker_t *victim = &batch->workers[(worker->id + i) % batch->n_workers];
+
+		pthread_mutex_lock(&victim->lock);
+		n = victim->tail - victim->head;
+		if (n > 0) {
+			tail = victim->tail;
+			head = tail - (n + 1) / 2;
+			victim->tail = head;
+		}
+		pthread_mutex_unlock(&victim->lock);
+		if (n > 0) {
+			pthread_mutex_lock(&worker->lock);
+			worker->head = head;
+			worker->tail = tail;
+			pthread_mutex_unlock(&worker->lock);
+
+			return TRUE;
+		}
 	}
-	if (rtag->variants) {
-		lt_list_t *l = rtag->variants;
 
-		lt_return_if_fail (!tag->variants);
+	return FALSE;
+}
 
-		while (l != NULL) {
-			lt_tag_set_variant(tag, lt_variant_ref(lt_list_value(l)));
-			l = lt_list_next(l);
+static lt_pointer_t
+_lt_tag_worker_run(lt_pointer_t data)
+{
+	lt_tag_worker_t *worker = data;
+	lt_tag_batch_t *batch = worker->batch;
+	size_t chunk, i, end;
+
+	_lt_tag_scratch_init(&worker->scratch, &batch->dbs);
+	while (_lt_tag_worker_pop(worker, &chunk) ||
+	       (_lt_tag_worker_steal(worker) &&
+		_lt_tag_worker_pop(worker, &chunk))) {
+		i = chunk * LT_TAG_BATCH_CHUNK_SIZE;
+		end = LT_MIN (i + LT_TAG_BATCH_CHUNK_SIZE, batch->n_spans);
+		for (; i < end; i++) {
+			lt_error_type_t type;
+
+			type = _lt_tag_scratch_canonicalize(&worker->scratch,
+							    &batch->spans[i],
+							    &batch->results[i]);
+			if (type == LT_ERR_SUCCESS)
+				worker->n_succeeded++;
+			if (batch->status)
+				batch->status[i] = type;
 		}
 	}
-	if (rtag->extension) {
-		lt_return_if_fail (!tag->extension);
-		lt_tag_set_extension(tag, lt_extension_ref(rtag->extension));
-	}
-	if (rtag->privateuse) {
-		lt_string_clear(tag->privateuse);
-		lt_string_append(tag->privateuse, lt_string_value(rtag->privateuse));
-	}
+	_lt_tag_scratch_clear(&worker->scratch);
+
+	return NULL;
 }
+#endif /* HAVE_PTHREAD */
 
 /* borrowed the modifier related code from localehelper:
  * http://people.redhat.com/caolanm/BCP47/localehelper-1.0.0.tar.gz
@@ -1110,7 +2347,7 @@ _lt_tag_convert_privaseuse_from_locale_modifier(const char *modifier)
 				return maps[i][1];
 		}
 
-		lt_warning("Unknown modifiers: %s", modifier);
+		lt_warning_ratelimited("Unknown modifiers: %s", modifier);
 
 		return modifier;
 	}
@@ -1227,13 +2464,17 @@ _lt_tag_convert_from_locale_string(const char  *locale,
 lt_tag_state_t
 lt_tag_parse_wildcard(lt_tag_t    *tag,
 		      const char  *tag_string,
+		      size_t       length,
 		      lt_error_t **error)
 {
+	lt_tag_dbs_t dbs;
 	lt_error_t *err = NULL;
 	lt_bool_t ret;
 
+	memset(&dbs, 0, sizeof (lt_tag_dbs_t));
 	lt_tag_parser_init(tag);
-	ret = _lt_tag_parse(tag, tag_string, TRUE, &err);
+	ret = _lt_tag_parse(tag, &dbs, tag_string, length, TRUE, &err);
+	_lt_tag_dbs_clear(&dbs);
 
 	if (!ret && !err) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_SCANNER,
@@ -1264,6 +2505,7 @@ lt_tag_new(void)
 	lt_tag_t *retval = lt_mem_alloc_object(sizeof (lt_tag_t));
 
 	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_TAG);
 		retval->state = STATE_NONE;
 		retval->privateuse = lt_string_new(NULL);
 		lt_mem_add_ref(&retval->parent, retval->privateuse,
@@ -1273,6 +2515,47 @@ lt_tag_new(void)
 	return retval;
 }
 
+/**
+ * lt_tag_new_with_arena:
+ * @buffer: (allow-none): a memory to place the arena or %NULL.
+ * @size: the size of @buffer in bytes.
+ *
+ * Create a new instance of #lt_tag_t, which allocates the memory for
+ * itself and the strings it owns from an arena. the arena is freed at once
+ * when the instance is finalized. when the instance is reused for many
+ * tags, parsing the tags without the extensions doesn't allocate any memory
+ * once the arena has grown enough. the extensions and the errors are still
+ * allocated on the heap, since they are owned by the extension modules and
+ * the caller.
+ *
+ * If @buffer is given, the arena is placed in it. @buffer has to be aligned
+ * to the pointer size and available until the instance is finalized.
+ * otherwise the arena of @size bytes is allocated, or the default size if
+ * @size is 0. the arena grows automatically when it's not enough.
+ *
+ * Note that the objects retrieved from the instance, such as
+ * lt_tag_get_privateuse(), must not be used after the instance is finalized.
+ *
+ * Returns: (transfer full): a new instance of #lt_tag_t.
+ */
+lt_tag_t *
+lt_tag_new_with_arena(lt_pointer_t buffer,
+		      size_t       size)
+{
+	lt_tag_t *retval = lt_mem_alloc_object_with_arena(sizeof (lt_tag_t), buffer, size);
+
+	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_TAG);
+		retval->state = STATE_NONE;
+		retval->arena = lt_mem_get_arena(&retval->parent);
+		retval->privateuse = lt_string_new_with_arena(retval->arena, NULL);
+		lt_mem_add_ref(&retval->parent, retval->privateuse,
+			       (lt_destroy_func_t)lt_string_unref);
+	}
+
+	return retval;
+}
+
 /**
  * lt_tag_ref:
  * @tag: a #lt_tag_t.
@@ -1342,9 +2625,99 @@ lt_tag_parse(lt_tag_t    *tag,
 	     const char  *tag_string,
 	     lt_error_t **error)
 {
+	lt_return_val_if_fail (tag_string != NULL, FALSE);
+
+	return lt_tag_parse_len(tag, tag_string, strlen(tag_string), error);
+}
+
+/**
+ * lt_tag_parse_len:
+ * @tag: a #lt_tag_t.
+ * @tag_string: language tag to be parsed.
+ * @length: the length of @tag_string in bytes.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Parse @tag_string as lt_tag_parse() does, but only the first @length bytes
+ * of it. @tag_string doesn't need to be nul-terminated and isn't copied.
+ *
+ * Returns: %TRUE if it's successfully completed, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_parse_len(lt_tag_t    *tag,
+		 const char  *tag_string,
+		 size_t       length,
+		 lt_error_t **error)
+{
+	lt_tag_dbs_t dbs;
+	lt_bool_t retval;
+
+	memset(&dbs, 0, sizeof (lt_tag_dbs_t));
 	lt_tag_parser_init(tag);
+	retval = _lt_tag_parse(tag, &dbs, tag_string, length, FALSE, error);
+	_lt_tag_dbs_clear(&dbs);
+
+	return retval;
+}
+
+/**
+ * lt_tag_parse_batch:
+ * @tags: an array of #lt_tag_t for the results.
+ * @spans: an array of #lt_tag_span_t to be parsed.
+ * @n_spans: the number of the elements in @spans.
+ * @status: (allow-none): an array of #lt_error_type_t to store the result
+ *          of each tag, or %NULL.
+ *
+ * Parse @n_spans language tags in @spans into @tags as lt_tag_parse() does.
+ * if the element in @tags is %NULL, the new #lt_tag_t is created and stored
+ * there. otherwise it's re-used. the databases are obtained once for
+ * the whole batch.
+ *
+ * %LT_ERR_SUCCESS is stored into @status for the tag successfully parsed,
+ * otherwise the type of the error. the errors aren't printed.
+ *
+ * Returns: the number of the tags successfully parsed.
+ */
+size_t
+lt_tag_parse_batch(lt_tag_t            **tags,
+		   const lt_tag_span_t  *spans,
+		   size_t                n_spans,
+		   lt_error_type_t      *status)
+{
+	lt_tag_dbs_t dbs;
+	lt_error_t *err = NULL;
+	size_t i, retval = 0;
+
+	lt_return_val_if_fail (tags != NULL, 0);
+	lt_return_val_if_fail (spans != NULL, 0);
+
+	memset(&dbs, 0, sizeof (lt_tag_dbs_t));
+	for (i = 0; i < n_spans; i++) {
+		lt_error_type_t type = LT_ERR_SUCCESS;
+
+		if (!tags[i])
+			tags[i] = lt_tag_new();
+		if (!tags[i]) {
+			type = LT_ERR_OOM;
+		} else if (!spans[i].string) {
+			type = LT_ERR_INVALID;
+		} else {
+			lt_tag_parser_init(tags[i]);
+			if (!_lt_tag_parse(tags[i], &dbs, spans[i].string,
+					   spans[i].length, FALSE, &err))
+				type = err ? _lt_tag_get_error_type(err) : LT_ERR_FAIL_ON_SCANNER;
+			if (err) {
+				lt_error_unref(err);
+				err = NULL;
+			}
+		}
+		if (type == LT_ERR_SUCCESS)
+			retval++;
+		if (status)
+			status[i] = type;
+	}
+	_lt_tag_dbs_clear(&dbs);
 
-	return _lt_tag_parse(tag, tag_string, FALSE, error);
+	return retval;
 }
 
 /**
@@ -1363,13 +2736,127 @@ lt_tag_parse_with_extra_token(lt_tag_t    *tag,
 			      const char  *tag_string,
 			      lt_error_t **error)
 {
+	lt_tag_dbs_t dbs;
+	lt_bool_t retval;
+
 	lt_return_val_if_fail (tag != NULL, FALSE);
 	lt_return_val_if_fail (tag->state != STATE_NONE, FALSE);
 
+	lt_return_val_if_fail (tag_string != NULL, FALSE);
+
 	/* Update the tag string */
 	lt_tag_get_string(tag);
 
-	return _lt_tag_parse(tag, tag_string, FALSE, error);
+	memset(&dbs, 0, sizeof (lt_tag_dbs_t));
+	retval = _lt_tag_parse(tag, &dbs, tag_string, strlen(tag_string), FALSE, error);
+	_lt_tag_dbs_clear(&dbs);
+
+	return retval;
+}
+
+/**
+ * lt_tag_is_valid:
+ * @tag_string: a language tag to be validated.
+ * @length: the length of @tag_string in bytes.
+ * @flags: the bitwise OR of #lt_tag_validate_flags_t.
+ * @error_offset: (out) (allow-none): the location to store the offset in
+ *                @tag_string where the validation failed, or %NULL.
+ *
+ * Validate @tag_string as lt_tag_parse() does, without creating #lt_tag_t.
+ * the subtags are checked against the databases in place, so this doesn't
+ * allocate any memory for the tags in the most cases. the extensions are
+ * still validated by the parser since it depends on the extension modules.
+ * @tag_string doesn't need to be nul-terminated.
+ *
+ * Returns: %LT_TAG_VALID if @tag_string is valid, otherwise the reason why
+ *          it isn't.
+ */
+lt_tag_validity_t
+lt_tag_is_valid(const char *tag_string,
+		size_t      length,
+		int         flags,
+		size_t     *error_offset)
+{
+	lt_tag_validator_t v;
+	lt_tag_validity_t retval = LT_TAG_VALID;
+	lt_db_probe_t probe;
+	char buffer[LT_TAG_VALIDATOR_KEY_SIZE];
+	const char *key;
+	size_t n, pos = 0, begin = 0;
+
+	lt_return_val_if_fail (tag_string != NULL, LT_TAG_INVALID_SYNTAX);
+
+	/* the scanner stops at the nul byte as well */
+	for (n = 0; n < length && tag_string[n] != 0; n++);
+
+	memset(&v, 0, sizeof (lt_tag_validator_t));
+	key = _lt_tag_validator_key(buffer, sizeof (buffer), tag_string, n);
+	if (key) {
+		lt_bool_t found;
+
+		found = lt_grandfathered_db_probe(LT_TAG_DB (&v.dbs, grandfathered), key, &probe);
+		if (found)
+			goto bail;
+	}
+	v.state = STATE_LANG;
+	while (pos < n) {
+		begin = pos;
+		if (tag_string[pos] == '-' || tag_string[pos] == '*') {
+			pos++;
+		} else {
+			while (pos < n && isalnum((int)tag_string[pos]))
+				pos++;
+			if (pos < n && tag_string[pos] != '-') {
+				/* invalid character or the wildcard in the middle */
+				begin = pos;
+				retval = LT_TAG_INVALID_SYNTAX;
+				goto bail;
+			}
+		}
+		if (tag_string[begin] == '-') {
+			v.state = lt_tag_state_after_hyphen(v.state);
+			if (v.state == STATE_NONE) {
+				retval = LT_TAG_INVALID_SYNTAX;
+				goto bail;
+			}
+		} else if ((flags & LT_TAG_VALIDATE_WILDCARD) &&
+			   tag_string[begin] == '*') {
+			v.fallback = TRUE;
+		} else {
+			key = _lt_tag_validator_key(buffer, sizeof (buffer),
+						    &tag_string[begin], pos - begin);
+			if (!key) {
+				retval = LT_TAG_INVALID_SUBTAG;
+				goto bail;
+			}
+			retval = lt_tag_parse_token(&v.state, &__lt_tag_validator_funcs,
+						    &v, key, pos - begin);
+			if (retval != LT_TAG_VALID)
+				goto bail;
+		}
+		if (v.fallback) {
+			/* the rest is validated by the parser. it has no idea
+			 * where it failed though.
+			 */
+			if (!_lt_tag_is_valid_with_parser(&v.dbs, tag_string, n, flags)) {
+				if (pos - begin == 1 && tag_string[begin] != '*')
+					retval = LT_TAG_INVALID_EXTENSION;
+				else
+					retval = LT_TAG_INVALID_SUBTAG;
+			}
+			goto bail;
+		}
+	}
+	if (!lt_tag_state_is_complete(v.state)) {
+		begin = n;
+		retval = LT_TAG_INVALID_SYNTAX;
+	}
+  bail:
+	_lt_tag_validator_finish(&v);
+	if (retval != LT_TAG_VALID && error_offset)
+		*error_offset = begin;
+
+	return retval;
 }
 
 /**
@@ -1402,14 +2889,11 @@ lt_tag_copy(const lt_tag_t *tag)
 	if (tag->region) {
 		lt_tag_set_region(retval, lt_region_ref(tag->region));
 	}
-	if (tag->variants) {
-		lt_list_t *l;
+	if (tag->variants.n > 0) {
+		size_t i;
 
-		for (l = tag->variants; l != NULL; l = lt_list_next(l)) {
-			retval->variants = lt_list_append(retval->variants,
-							  lt_variant_ref(lt_list_value(l)),
-							  (lt_destroy_func_t)lt_variant_unref);
-		}
+		for (i = 0; i < tag->variants.n; i++)
+			lt_tag_set_variant(retval, lt_variant_ref(tag->variants.values[i]));
 	}
 	if (tag->extension) {
 		lt_tag_set_extension(retval, lt_extension_copy(tag->extension));
@@ -1472,16 +2956,14 @@ lt_tag_truncate(lt_tag_t    *tag,
 			}
 			break;
 		}
-		if (tag->variants) {
-			lt_list_t *l = lt_list_last(tag->variants);
-
-			if (tag->variants == l) {
-				lt_mem_remove_ref(&tag->parent, tag->variants);
-				tag->variants = lt_list_delete_link(tag->variants, l);
-				if (tag->variants)
-					lt_mem_add_ref(&tag->parent, tag->variants, lt_list_free);
+		if (tag->variants.n > 0) {
+			if (tag->variants.n == 1) {
+				lt_tag_free_variants(tag);
 			} else {
-				l = lt_list_delete_link(l, l);
+				tag->variants.n--;
+				lt_variant_unref(tag->variants.values[tag->variants.n]);
+				lt_list_free(tag->variants.list);
+				tag->variants.list = NULL;
 			}
 			break;
 		}
@@ -1531,7 +3013,7 @@ lt_tag_truncate(lt_tag_t    *tag,
 const char *
 lt_tag_get_string(lt_tag_t *tag)
 {
-	lt_list_t *l;
+	size_t i;
 
 	if (tag->tag_string)
 		return lt_string_value(tag->tag_string);
@@ -1546,11 +3028,8 @@ lt_tag_get_string(lt_tag_t *tag)
 			lt_tag_add_tag_string(tag, lt_script_get_tag(tag->script));
 		if (tag->region)
 			lt_tag_add_tag_string(tag, lt_region_get_tag(tag->region));
-		l = tag->variants;
-		while (l != NULL) {
-			lt_tag_add_tag_string(tag, lt_variant_get_tag(lt_list_value(l)));
-			l = lt_list_next(l);
-		}
+		for (i = 0; i < tag->variants.n; i++)
+			lt_tag_add_tag_string(tag, lt_variant_get_tag(tag->variants.values[i]));
 		if (tag->extension)
 			lt_tag_add_tag_string(tag, lt_extension_get_tag(tag->extension));
 		if (tag->privateuse && lt_string_length(tag->privateuse) > 0)
@@ -1577,151 +3056,177 @@ char *
 lt_tag_canonicalize(lt_tag_t    *tag,
 		    lt_error_t **error)
 {
-	char *retval = NULL;
-	lt_string_t *string = NULL;
-	lt_error_t *err = NULL;
-	lt_list_t *l;
-	lt_redundant_db_t *rdb = NULL;
-	lt_redundant_t *r = NULL;
-	lt_tag_t *ctag = NULL;
+	lt_tag_dbs_t dbs;
+	char *retval;
 
 	lt_return_val_if_fail (tag != NULL, NULL);
 
-	string = lt_string_new(NULL);
-	if (tag->grandfathered) {
-		lt_string_append(string, lt_grandfathered_get_better_tag(tag->grandfathered));
-		goto bail1;
-	}
-
-	ctag = lt_tag_copy(tag);
-	rdb = lt_db_get_redundant();
-	while (1) {
-		const char *tag_string = lt_tag_get_string(ctag);
-
-		if (tag_string == NULL || tag_string[0] == 0)
-			break;
-		if (r)
-			lt_redundant_unref(r);
-		r = lt_redundant_db_lookup(rdb, tag_string);
-		if (r) {
-			const char *preferred = lt_redundant_get_preferred_tag(r);
-
-			if (preferred) {
-				lt_tag_t *rtag = lt_tag_new();
-				lt_tag_t *ntag = lt_tag_new();
+	memset(&dbs, 0, sizeof (lt_tag_dbs_t));
+	retval = _lt_tag_canonicalize_dup(tag, &dbs, error);
+	_lt_tag_dbs_clear(&dbs);
 
-				if (!lt_tag_parse(rtag, lt_redundant_get_tag(r), &err)) {
-					lt_tag_unref(rtag);
-					lt_tag_unref(ntag);
-					goto bail1;
-				}
-				if (!lt_tag_parse(ntag, preferred, &err)) {
-					lt_tag_unref(rtag);
-					lt_tag_unref(ntag);
-					goto bail1;
-				}
-				_lt_tag_subtract(tag, rtag);
-				_lt_tag_replace(tag, ntag);
-				lt_tag_unref(rtag);
-				lt_tag_unref(ntag);
-			}
-			break;
-		} else {
-			if (!lt_tag_truncate(ctag, &err))
-				goto bail1;
-		}
-	}
+	return retval;
+}
 
-	if (tag->language) {
-		size_t len;
-		lt_extlang_db_t *edb = lt_db_get_extlang();
-		lt_extlang_t *e;
+/**
+ * lt_tag_canonicalize_batch:
+ * @spans: an array of #lt_tag_span_t to be canonicalized.
+ * @n_spans: the number of the elements in @spans.
+ * @results: an array to store the canonicalized tags.
+ * @status: (allow-none): an array of #lt_error_type_t to store the result
+ *          of each tag, or %NULL.
+ *
+ * Parse and canonicalize @n_spans language tags in @spans as lt_tag_parse()
+ * and lt_tag_canonicalize() do. the canonicalized tag is stored into
+ * @results, or %NULL if it fails. the databases are obtained once and
+ * the temporary #lt_tag_t and the buffer are shared for the whole batch.
+ *
+ * %LT_ERR_SUCCESS is stored into @status for the tag successfully
+ * canonicalized, otherwise the type of the error. the errors aren't printed.
+ *
+ * Returns: the number of the tags successfully canonicalized. the strings
+ *          in @results has to be freed.
+ */
+size_t
+lt_tag_canonicalize_batch(const lt_tag_span_t  *spans,
+			  size_t                n_spans,
+			  char                **results,
+			  lt_error_type_t      *status)
+{
+	lt_tag_scratch_t scratch;
+	size_t i, retval = 0;
 
-		/* If the language tag starts with a primary language subtag
-		 * that is also an extlang subtag, then the language tag is
-		 * prepended with the extlang's 'Prefix'.
-		 */
-		e = lt_extlang_db_lookup(edb, lt_lang_get_better_tag(tag->language));
-		if (e) {
-			const char *prefix = lt_extlang_get_prefix(e);
+	lt_return_val_if_fail (spans != NULL, 0);
+	lt_return_val_if_fail (results != NULL, 0);
 
-			if (prefix)
-				lt_string_append_printf(string, "%s-", prefix);
-			lt_extlang_unref(e);
-		}
-		lt_extlang_db_unref(edb);
+	_lt_tag_scratch_init(&scratch, NULL);
+	for (i = 0; i < n_spans; i++) {
+		lt_error_type_t type;
 
-		lt_string_append(string, lt_lang_get_better_tag(tag->language));
-		if (tag->extlang) {
-			const char *preferred = lt_extlang_get_preferred_tag(tag->extlang);
+		type = _lt_tag_scratch_canonicalize(&scratch, &spans[i], &results[i]);
+		if (type == LT_ERR_SUCCESS)
+			retval++;
+		if (status)
+			status[i] = type;
+	}
+	_lt_tag_scratch_clear(&scratch);
 
-			if (preferred) {
-				lt_string_clear(string);
-				lt_string_append(string, preferred);
-			} else {
-				lt_string_append_printf(string, "-%s",
-							lt_extlang_get_tag(tag->extlang));
-			}
-		}
-		if (tag->script) {
-			const char *script = lt_script_get_tag(tag->script);
-			const char *suppress = lt_lang_get_suppress_script(tag->language);
+	return retval;
+}
 
-			if (!suppress ||
-			    lt_strcasecmp(suppress, script))
-				lt_string_append_printf(string, "-%s", script);
-		}
-		if (tag->region) {
-			lt_string_append_printf(string, "-%s", lt_region_get_better_tag(tag->region));
-		}
-		len = lt_string_length(string);
-		for (l = tag->variants; l != NULL; l = lt_list_next(l)) {
-			lt_variant_t *variant = lt_list_value(l);
-			const char *better = lt_variant_get_better_tag(variant);
-			const char *s = lt_variant_get_tag(variant);
+/**
+ * lt_tag_canonicalize_batch_parallel:
+ * @spans: an array of #lt_tag_span_t to be canonicalized.
+ * @n_spans: the number of the elements in @spans.
+ * @results: an array to store the canonicalized tags.
+ * @status: (allow-none): an array of #lt_error_type_t to store the result
+ *          of each tag, or %NULL.
+ * @n_threads: the number of the threads to be used, or 0 to use as many
+ *             as the online processors.
+ *
+ * Same as lt_tag_canonicalize_batch() but splits @spans into chunks and
+ * processes them on @n_threads threads including the caller's one.
+ * each thread starts from its own range of @spans and takes over the half
+ * of the chunks left in the others once it's done, so the tags that take
+ * a long time such as ones with the extensions don't keep the others
+ * waiting. the results are stored in the same order as @spans.
+ *
+ * The databases are obtained once and shared among the threads. each
+ * thread has its own temporary #lt_tag_t and buffer. the threads still
+ * share some mutable state though:
+ *
+ * - the reference counts of the database entries, which are updated
+ *   atomically on every lookup unless the database is frozen with
+ *   lt_db_freeze(). a warning is emitted if it isn't.
+ * - the memory pool, which is locked when the per-thread cache of
+ *   the pooled objects gets empty or full.
+ * - the extension modules, which may use the shared XML document and
+ *   its lock.
+ *
+ * So the tags with the extensions don't scale as well as the others.
+ *
+ * Returns: the number of the tags successfully canonicalized. the strings
+ *          in @results has to be freed.
+ */
+size_t
+lt_tag_canonicalize_batch_parallel(const lt_tag_span_t  *spans,
+				   size_t                n_spans,
+				   char                **results,
+				   lt_error_type_t      *status,
+				   unsigned int          n_threads)
+{
+#if HAVE_PTHREAD
+	lt_tag_batch_t batch;
+	size_t i, n_chunks, retval = 0;
 
-			if (better && lt_strcasecmp(s, better) != 0) {
-				/* ignore all of variants prior to this one */
-				lt_string_truncate(string, len);
-			}
-			lt_string_append_printf(string, "-%s", better ? better : s);
-		}
-		if (tag->extension) {
-			char *s = lt_extension_get_canonicalized_tag(tag->extension);
+	lt_return_val_if_fail (spans != NULL, 0);
+	lt_return_val_if_fail (results != NULL, 0);
 
-			lt_string_append_printf(string, "-%s", s);
-			free(s);
-		}
+	if (n_threads == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		n_threads = n > 0 ? n : 1;
 	}
-	if (tag->privateuse && lt_string_length(tag->privateuse) > 0) {
-		lt_string_append_printf(string, "%s%s",
-					lt_string_length(string) > 0 ? "-" : "",
-					lt_string_value(tag->privateuse));
+	n_chunks = (n_spans + LT_TAG_BATCH_CHUNK_SIZE - 1) / LT_TAG_BATCH_CHUNK_SIZE;
+	if (n_threads < 2 || n_chunks < 2)
+		return lt_tag_canonicalize_batch(spans, n_spans, results, status);
+	if (!lt_db_is_frozen())
+		lt_warning_ratelimited("The database isn't frozen. the threads will contend on the reference counts of the entries. call lt_db_freeze() first.");
+
+	memset(&batch, 0, sizeof (lt_tag_batch_t));
+	batch.spans = spans;
+	batch.n_spans = n_spans;
+	batch.results = results;
+	batch.status = status;
+	batch.n_workers = LT_MIN (n_threads, n_chunks);
+	batch.workers = calloc(batch.n_workers, sizeof (lt_tag_worker_t));
+	if (!batch.workers)
+		return lt_tag_canonicalize_batch(spans, n_spans, results, status);
+	/* load all of the databases here so that the workers don't race
+	 * on it and only take the references.
+	 */
+	LT_TAG_DB (&batch.dbs, lang);
+	LT_TAG_DB (&batch.dbs, extlang);
+	LT_TAG_DB (&batch.dbs, script);
+	LT_TAG_DB (&batch.dbs, region);
+	LT_TAG_DB (&batch.dbs, variant);
+	LT_TAG_DB (&batch.dbs, grandfathered);
+	LT_TAG_DB (&batch.dbs, redundant);
+
+	for (i = 0; i < batch.n_workers; i++) {
+		lt_tag_worker_t *worker = &batch.workers[i];
+
+		pthread_mutex_init(&worker->lock, NULL);
+		worker->id = i;
+		worker->batch = &batch;
+		worker->head = n_chunks * i / batch.n_workers;
+		worker->tail = n_chunks * (i + 1) / batch.n_workers;
 	}
-	if (lt_string_length(string) == 0) {
-		lt_error_set(&err, LT_ERR_NO_TAG,
-			     "No tag to convert.");
+	/* the chunks of the worker that failed to start are stolen by others */
+	for (i = 1; i < batch.n_workers; i++) {
+		lt_tag_worker_t *worker = &batch.workers[i];
+
+		worker->running = pthread_create(&worker->thread, NULL,
+						 _lt_tag_worker_run,
+						 worker) == 0;
 	}
-  bail1:
-	if (ctag)
-		lt_tag_unref(ctag);
-	if (rdb)
-		lt_redundant_db_unref(rdb);
-	if (r)
-		lt_redundant_unref(r);
-	retval = lt_string_free(string, FALSE);
-	if (lt_error_is_set(err, LT_ERR_ANY)) {
-		if (error)
-			*error = lt_error_ref(err);
-		else
-			lt_error_print(err, LT_ERR_ANY);
-		lt_error_unref(err);
-		if (retval)
-			free(retval);
-		retval = NULL;
+	_lt_tag_worker_run(&batch.workers[0]);
+	for (i = 0; i < batch.n_workers; i++) {
+		if (batch.workers[i].running)
+			pthread_join(batch.workers[i].thread, NULL);
 	}
+	/* the others may still look at the lock until all of them finish */
+	for (i = 0; i < batch.n_workers; i++) {
+		pthread_mutex_destroy(&batch.workers[i].lock);
+		retval += batch.workers[i].n_succeeded;
+	}
+	free(batch.workers);
+	_lt_tag_dbs_clear(&batch.dbs);
 
 	return retval;
+#else
+	return lt_tag_canonicalize_batch(spans, n_spans, results, status);
+#endif
 }
 
 /**
@@ -1831,7 +3336,7 @@ lt_tag_convert_to_locale(lt_tag_t    *tag,
 void
 lt_tag_dump(const lt_tag_t *tag)
 {
-	lt_list_t *l;
+	size_t i;
 
 	lt_return_if_fail (tag != NULL);
 
@@ -1846,11 +3351,8 @@ lt_tag_dump(const lt_tag_t *tag)
 		lt_script_dump(tag->script);
 	if (tag->region)
 		lt_region_dump(tag->region);
-	for (l = tag->variants; l != NULL; l = lt_list_next(l)) {
-		lt_variant_t *variant = lt_list_value(l);
-
-		lt_variant_dump(variant);
-	}
+	for (i = 0; i < tag->variants.n; i++)
+		lt_variant_dump(tag->variants.values[i]);
 	if (tag->extension)
 		lt_extension_dump(tag->extension);
 	if (lt_string_length(tag->privateuse) > 0)
@@ -1871,7 +3373,7 @@ lt_tag_compare(const lt_tag_t *v1,
 	       const lt_tag_t *v2)
 {
 	lt_bool_t retval = TRUE;
-	const lt_list_t *l1, *l2;
+	size_t i;
 
 	lt_return_val_if_fail (v1 != NULL, FALSE);
 	lt_return_val_if_fail (v2 != NULL, FALSE);
@@ -1885,16 +3387,10 @@ lt_tag_compare(const lt_tag_t *v1,
 		retval &= lt_script_compare(v1->script, v2->script);
 	if (v2->region)
 		retval &= lt_region_compare(v1->region, v2->region);
-	l1 = v1->variants;
-	l2 = v2->variants;
-	while (l2 != NULL) {
-		lt_variant_t *vv1, *vv2;
+	for (i = 0; i < v2->variants.n; i++) {
+		lt_variant_t *vv1 = i < v1->variants.n ? v1->variants.values[i] : NULL;
 
-		vv1 = l1 ? lt_list_value(l1) : NULL;
-		vv2 = l2 ? lt_list_value(l2) : NULL;
-		retval &= lt_variant_compare(vv1, vv2);
-		l1 = lt_list_next(l1);
-		l2 = lt_list_next(l2);
+		retval &= lt_variant_compare(vv1, v2->variants.values[i]);
 	}
 	if (v2->extension)
 		retval &= lt_extension_compare(v1->extension, v2->extension);
@@ -1919,6 +3415,29 @@ lt_bool_t
 lt_tag_match(const lt_tag_t  *v1,
 	     const char      *v2,
 	     lt_error_t     **error)
+{
+	lt_return_val_if_fail (v2 != NULL, FALSE);
+
+	return lt_tag_match_len(v1, v2, strlen(v2), error);
+}
+
+/**
+ * lt_tag_match_len:
+ * @v1: a #lt_tag_t.
+ * @v2: a language range string.
+ * @length: the length of @v2 in bytes.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Try matching of @v1 and the first @length bytes of @v2 as lt_tag_match()
+ * does. @v2 doesn't need to be nul-terminated.
+ *
+ * Returns: %TRUE if it matches, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_match_len(const lt_tag_t  *v1,
+		 const char      *v2,
+		 size_t           length,
+		 lt_error_t     **error)
 {
 	lt_bool_t retval = FALSE;
 	lt_tag_t *t2 = NULL;
@@ -1929,7 +3448,7 @@ lt_tag_match(const lt_tag_t  *v1,
 	lt_return_val_if_fail (v2 != NULL, FALSE);
 
 	t2 = lt_tag_new();
-	state = lt_tag_parse_wildcard(t2, v2, &err);
+	state = lt_tag_parse_wildcard(t2, v2, length, &err);
 	if (lt_error_is_set(err, LT_ERR_ANY)) {
 		if (error)
 			*error = lt_error_ref(err);
@@ -1946,6 +3465,63 @@ lt_tag_match(const lt_tag_t  *v1,
 	return retval;
 }
 
+/**
+ * lt_tag_parse_range:
+ * @tag: a #lt_tag_t.
+ * @range: a language range string.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Parse @range into @tag to be used with lt_tag_match_range(). any of
+ * subtags in @range is allowed to use the wildcard according to the syntax
+ * in RFC 4647. this is useful to match many tags against the same range
+ * without parsing it every time.
+ *
+ * Returns: %TRUE if it's successfully completed, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_parse_range(lt_tag_t    *tag,
+		   const char  *range,
+		   lt_error_t **error)
+{
+	lt_error_t *err = NULL;
+	lt_bool_t retval = TRUE;
+
+	lt_return_val_if_fail (tag != NULL, FALSE);
+	lt_return_val_if_fail (range != NULL, FALSE);
+
+	lt_tag_parse_wildcard(tag, range, strlen(range), &err);
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+		lt_error_unref(err);
+		retval = FALSE;
+	}
+
+	return retval;
+}
+
+/**
+ * lt_tag_match_range:
+ * @v1: a #lt_tag_t.
+ * @range: a #lt_tag_t parsed with lt_tag_parse_range().
+ *
+ * Try matching of @v1 and @range as lt_tag_match() does. @range isn't
+ * modified, so it can be shared among the threads.
+ *
+ * Returns: %TRUE if it matches, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_match_range(const lt_tag_t *v1,
+		   const lt_tag_t *range)
+{
+	lt_return_val_if_fail (v1 != NULL, FALSE);
+	lt_return_val_if_fail (range != NULL, FALSE);
+
+	return _lt_tag_match(v1, range, range->state);
+}
+
 /**
  * lt_tag_lookup:
  * @tag: a #lt_tag_t.
@@ -1962,18 +3538,42 @@ char *
 lt_tag_lookup(const lt_tag_t  *tag,
 	      const char      *pattern,
 	      lt_error_t     **error)
+{
+	lt_return_val_if_fail (pattern != NULL, NULL);
+
+	return lt_tag_lookup_len(tag, pattern, strlen(pattern), error);
+}
+
+/**
+ * lt_tag_lookup_len:
+ * @tag: a #lt_tag_t.
+ * @pattern: a language range string.
+ * @length: the length of @pattern in bytes.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Lookup the language tag that @tag meets with the first @length bytes of
+ * @pattern as lt_tag_lookup() does. @pattern doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: a language tag string if any matches, otherwise %NULL.
+ */
+char *
+lt_tag_lookup_len(const lt_tag_t  *tag,
+		  const char      *pattern,
+		  size_t           length,
+		  lt_error_t     **error)
 {
 	lt_tag_t *t2 = NULL;
 	lt_tag_state_t state = STATE_NONE;
 	lt_error_t *err = NULL;
-	lt_list_t *l;
+	size_t j;
 	char *retval = NULL;
 
 	lt_return_val_if_fail (tag != NULL, NULL);
 	lt_return_val_if_fail (pattern != NULL, NULL);
 
 	t2 = lt_tag_new();
-	state = lt_tag_parse_wildcard(t2, pattern, &err);
+	state = lt_tag_parse_wildcard(t2, pattern, length, &err);
 	if (err)
 		goto bail;
 	if (_lt_tag_match(tag, t2, state)) {
@@ -2005,11 +3605,8 @@ lt_tag_lookup(const lt_tag_t  *tag,
 					    break;
 				    case STATE_VARIANT:
 					    lt_tag_free_variants(t2);
-					    l = tag->variants;
-					    while (l != NULL) {
-						    lt_tag_set_variant(t2, lt_variant_ref(lt_list_value(l)));
-						    l = lt_list_next(l);
-					    }
+					    for (j = 0; j < tag->variants.n; j++)
+						    lt_tag_set_variant(t2, lt_variant_ref(tag->variants.values[j]));
 					    break;
 				    case STATE_EXTENSION:
 				    case STATE_EXTENSIONTOKEN:
@@ -2071,14 +3668,17 @@ lt_tag_transform(lt_tag_t    *tag,
 
 	lt_return_val_if_fail (tag != NULL, NULL);
 
+	LT_PROBE1 (transform_start, tag);
 	s = lt_tag_canonicalize(tag, &err);
 	if (s) {
 		const lt_script_t *script;
 		const lt_region_t *region;
 
 		canoned_tag = lt_tag_new();
-		if (!lt_tag_parse(canoned_tag, s, &err))
+		if (!lt_tag_parse(canoned_tag, s, &err)) {
+			free(s);
 			goto bail1;
+		}
 		/* See http://www.unicode.org/reports/tr35/#Likely_Subtags
 		 * for further canonicalization for likely Subtags.
 		 */
@@ -2126,6 +3726,8 @@ lt_tag_transform(lt_tag_t    *tag,
 			int i;
 			size_t len;
 
+			if (retry < 4)
+				LT_STATS_INC (transform_retries);
 			wt = lt_tag_copy(canoned_tag);
 			switch (retry) {
 			    case 1:
@@ -2145,6 +3747,7 @@ lt_tag_transform(lt_tag_t    *tag,
 			lt_debug(LT_MSGCAT_TAG, "transform lookup: %s", tag_string);
 			xpath_string = lt_strdup_printf("/supplementalData/likelySubtags/likelySubtag[translate(@from,'_', '-') = '%s']", tag_string);
 			xobj = xmlXPathEvalExpression((const xmlChar *)xpath_string, xctxt);
+			LT_STATS_INC (xpath_evals);
 			if (!xobj) {
 				lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 					     "No valid elements for %s",
@@ -2153,8 +3756,8 @@ lt_tag_transform(lt_tag_t    *tag,
 			}
 			n = xmlXPathNodeSetGetLength(xobj->nodesetval);
 			if (n > 1)
-				lt_warning("Multiple subtag data to be transformed for %s: %d",
-					   tag_string, n);
+				lt_warning_ratelimited("Multiple subtag data to be transformed for %s: %d",
+						       tag_string, n);
 
 			ent = xmlXPathNodeSetItem(xobj->nodesetval, 0);
 			if (!ent) {
@@ -2225,6 +3828,280 @@ lt_tag_transform(lt_tag_t    *tag,
 	if (canoned_tag)
 		lt_tag_unref(canoned_tag);
 
+	if (lt_error_is_set(err, LT_ERR_ANY)) {
+		if (error)
+			*error = lt_error_ref(err);
+		else
+			lt_error_print(err, LT_ERR_ANY);
+	}
+	/* the errors cleared on retrying leave the empty object */
+	if (err)
+		lt_error_unref(err);
+	LT_PROBE2 (transform_done, tag, retval);
+
+	return retval;
+}
+
+/**
+ * lt_tag_get_key:
+ * @tag: a #lt_tag_t.
+ * @key: (out): a #lt_tag_key_t to store the key.
+ *
+ * Encode @tag into the fixed-width key. the key contains the language,
+ * the extlang, the script, the region and one variant in case-insensitive.
+ * the keys of the tags which are the same are equal and the keys are ordered
+ * by the language, the extlang, the script, the region and the variant.
+ *
+ * If @tag has any other subtags, such as the extensions and the private use,
+ * the key is marked as partial and contains the digest of the whole tag
+ * instead. the partial keys can be still used for the hash, but they have to
+ * be compared with lt_tag_cmp() to see if they are really equal.
+ *
+ * Note that the key is encoded as it is. use lt_tag_canonicalize() and
+ * parse the result before encoding if the canonical form is expected.
+ *
+ * Returns: %TRUE if @key represents the whole @tag, otherwise %FALSE.
+ */
+lt_bool_t
+lt_tag_get_key(lt_tag_t     *tag,
+	       lt_tag_key_t *key)
+{
+	unsigned long long v;
+	lt_bool_t retval = FALSE;
+
+	lt_return_val_if_fail (tag != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+
+	key->hi = 0;
+	key->lo = 0;
+	if (tag->grandfathered ||
+	    !tag->language ||
+	    tag->wildcard_map != 0)
+		goto bail;
+	if (!_lt_tag_key_pack_alpha(lt_lang_get_tag(tag->language), 2, 3, &v))
+		goto bail;
+	key->hi |= v << LT_TAG_KEY_LANG_SHIFT;
+	if (tag->extlang) {
+		if (!_lt_tag_key_pack_alpha(lt_extlang_get_tag(tag->extlang), 3, 3, &v))
+			goto bail;
+		key->hi |= v << LT_TAG_KEY_EXTLANG_SHIFT;
+	}
+	if (tag->script) {
+		if (!_lt_tag_key_pack_alpha(lt_script_get_tag(tag->script), 4, 4, &v))
+			goto bail;
+		key->hi |= v << LT_TAG_KEY_SCRIPT_SHIFT;
+	}
+	if (tag->region) {
+		if (!_lt_tag_key_pack_region(lt_region_get_tag(tag->region), &v))
+			goto bail;
+		key->hi |= v << LT_TAG_KEY_REGION_SHIFT;
+	}
+	if (tag->variants.n > 0) {
+		if (!_lt_tag_key_pack_variant(lt_variant_get_tag(tag->variants.values[0]), &v))
+			goto bail;
+		key->lo |= v << LT_TAG_KEY_VARIANT_SHIFT;
+	}
+	retval = (tag->variants.n <= 1 &&
+		  !tag->extension &&
+		  (!tag->privateuse || lt_string_length(tag->privateuse) == 0));
+  bail:
+	if (!retval) {
+		const char *s = lt_tag_get_string(tag);
+		unsigned long long h = 14695981039346656037ULL;
+
+		/* keep the subtags encoded so far for the order */
+		if (s) {
+			for (; *s; s++) {
+				h ^= (unsigned char)tolower((int)*s);
+				h *= 1099511628211ULL;
+			}
+		}
+		key->lo |= ((h ^ (h >> 32)) & LT_TAG_KEY_DIGEST_MASK) << LT_TAG_KEY_DIGEST_SHIFT;
+		key->lo |= LT_TAG_KEY_PARTIAL;
+	}
+
+	return retval;
+}
+
+/**
+ * lt_tag_hash:
+ * @tag: a #lt_tag_t.
+ *
+ * Calculate the hash value of @tag. the tags which are equal according to
+ * lt_tag_cmp() have the same hash value.
+ *
+ * Returns: the hash value.
+ */
+size_t
+lt_tag_hash(lt_tag_t *tag)
+{
+	lt_tag_key_t key;
+
+	lt_return_val_if_fail (tag != NULL, 0);
+
+	lt_tag_get_key(tag, &key);
+
+	return lt_tag_key_hash(&key);
+}
+
+/**
+ * lt_tag_cmp:
+ * @v1: a #lt_tag_t.
+ * @v2: a #lt_tag_t.
+ *
+ * Compare @v1 and @v2 in the total order. this is mostly the integer
+ * comparison of their keys. see lt_tag_get_key().
+ *
+ * Returns: a negative value if @v1 is prior to @v2, 0 if they are equal,
+ *          otherwise a positive value.
+ */
+int
+lt_tag_cmp(lt_tag_t *v1,
+	   lt_tag_t *v2)
+{
+	lt_tag_key_t k1, k2;
+	int retval;
+
+	lt_return_val_if_fail (v1 != NULL, 0);
+	lt_return_val_if_fail (v2 != NULL, 0);
+
+	lt_tag_get_key(v1, &k1);
+	lt_tag_get_key(v2, &k2);
+	retval = lt_tag_key_cmp(&k1, &k2);
+	if (retval == 0 && (k1.lo & LT_TAG_KEY_PARTIAL)) {
+		/* the digest may conflict */
+		retval = lt_strcasecmp(lt_tag_get_string(v1),
+				       lt_tag_get_string(v2));
+	}
+
+	return retval;
+}
+
+/**
+ * lt_tag_key_hash:
+ * @key: a #lt_tag_key_t.
+ *
+ * Calculate the hash value of @key.
+ *
+ * Returns: the hash value.
+ */
+size_t
+lt_tag_key_hash(const lt_tag_key_t *key)
+{
+	unsigned long long h;
+
+	lt_return_val_if_fail (key != NULL, 0);
+
+	h = key->hi;
+	h ^= key->lo + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return (size_t)h;
+}
+
+/**
+ * lt_tag_key_cmp:
+ * @k1: a #lt_tag_key_t.
+ * @k2: a #lt_tag_key_t.
+ *
+ * Compare @k1 and @k2 in the total order.
+ *
+ * Returns: a negative value if @k1 is prior to @k2, 0 if they are equal,
+ *          otherwise a positive value.
+ */
+int
+lt_tag_key_cmp(const lt_tag_key_t *k1,
+	       const lt_tag_key_t *k2)
+{
+	lt_return_val_if_fail (k1 != NULL, 0);
+	lt_return_val_if_fail (k2 != NULL, 0);
+
+	if (k1->hi != k2->hi)
+		return k1->hi < k2->hi ? -1 : 1;
+	if (k1->lo != k2->lo)
+		return k1->lo < k2->lo ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * lt_tag_key_decode:
+ * @key: a #lt_tag_key_t.
+ * @error: (allow-none): a #lt_error_t or %NULL.
+ *
+ * Create a #lt_tag_t from @key. this doesn't work for the partial keys.
+ *
+ * Returns: (transfer full): a new instance of #lt_tag_t or %NULL if fails.
+ */
+lt_tag_t *
+lt_tag_key_decode(const lt_tag_key_t  *key,
+		  lt_error_t         **error)
+{
+	/* "xxx-xxx-xxxx-xx-xxxxxxxx" */
+	char buffer[32], *p = buffer;
+	unsigned long long v;
+	lt_tag_t *retval = NULL;
+	lt_error_t *err = NULL;
+	int i;
+
+	lt_return_val_if_fail (key != NULL, NULL);
+
+	if (key->lo & LT_TAG_KEY_PARTIAL) {
+		lt_error_set(&err, LT_ERR_INVALID,
+			     "Unable to decode the partial key");
+		goto bail;
+	}
+	_lt_tag_key_unpack_alpha(key->hi >> LT_TAG_KEY_LANG_SHIFT, 3, p);
+	p += strlen(p);
+	v = (key->hi >> LT_TAG_KEY_EXTLANG_SHIFT) & 0x7fff;
+	if (v) {
+		*p++ = '-';
+		_lt_tag_key_unpack_alpha(v, 3, p);
+		p += strlen(p);
+	}
+	v = (key->hi >> LT_TAG_KEY_SCRIPT_SHIFT) & 0xfffff;
+	if (v) {
+		*p++ = '-';
+		_lt_tag_key_unpack_alpha(v, 4, p);
+		*p = toupper((int)*p);
+		p += strlen(p);
+	}
+	v = (key->hi >> LT_TAG_KEY_REGION_SHIFT) & 0x7ff;
+	if (v >= LT_TAG_KEY_REGION_ALPHA) {
+		*p++ = '-';
+		_lt_tag_key_unpack_alpha(v - LT_TAG_KEY_REGION_ALPHA, 2, p);
+		for (; *p; p++)
+			*p = toupper((int)*p);
+	} else if (v) {
+		v--;
+		*p++ = '-';
+		*p++ = '0' + v / 100;
+		*p++ = '0' + v / 10 % 10;
+		*p++ = '0' + v % 10;
+	}
+	v = key->lo >> LT_TAG_KEY_VARIANT_SHIFT;
+	if (v) {
+		int c;
+
+		*p++ = '-';
+		for (i = 7; i >= 0; i--) {
+			c = v % 37;
+			v /= 37;
+			p[i] = c == 0 ? 0 : c <= 10 ? c - 1 + '0' : c - 11 + 'a';
+		}
+		p += 8;
+	}
+	*p = 0;
+	retval = lt_tag_new();
+	if (!lt_tag_parse(retval, buffer, &err)) {
+		lt_tag_unref(retval);
+		retval = NULL;
+	}
+  bail:
 	if (lt_error_is_set(err, LT_ERR_ANY)) {
 		if (error)
 			*error = lt_error_ref(err);
@@ -2289,7 +4166,35 @@ DEFUNC_GET_SUBTAG (region, lt_region_t)
  *
  * Returns: (transfer none): a #lt_list_t containing #lt_variant_t.
  */
-DEFUNC_GET_SUBTAG (variants, lt_list_t)
+const lt_list_t *
+lt_tag_get_variants(const lt_tag_t *tag)
+{
+	lt_tag_variants_t *variants;
+	lt_list_t *retval, *list = NULL;
+	size_t i;
+
+	lt_return_val_if_fail (tag != NULL, NULL);
+
+	/* the list is built on demand and kept until the variants are updated.
+	 * @tag may be read from the multiple threads. so the list is published
+	 * atomically and the one built by the loser is thrown away.
+	 */
+	variants = (lt_tag_variants_t *)&tag->variants;
+	retval = lt_atomic_pointer_get((volatile lt_pointer_t *)&variants->list);
+	if (!retval && variants->n > 0) {
+		for (i = variants->n; i > 0; i--)
+			list = lt_list_prepend(list, variants->values[i - 1], NULL);
+		if (lt_atomic_pointer_compare_and_exchange((volatile lt_pointer_t *)&variants->list,
+							   NULL, list)) {
+			retval = list;
+		} else {
+			lt_list_free(list);
+			retval = lt_atomic_pointer_get((volatile lt_pointer_t *)&variants->list);
+		}
+	}
+
+	return retval;
+}
 /**
  * lt_tag_get_extension:
  * @tag: a #lt_tag_t.
@@ -36,17 +36,98 @@ LT_BEGIN_DECLS
  * structure are private to the #lt_tag_t implementation.
  */
 typedef struct _lt_tag_t	lt_tag_t;
+typedef struct _lt_tag_key_t	lt_tag_key_t;
+typedef struct _lt_tag_span_t	lt_tag_span_t;
 
+/**
+ * lt_tag_key_t:
+ * @hi: the upper 64 bits of the key.
+ * @lo: the lower 64 bits of the key.
+ *
+ * The fixed-width key which represents #lt_tag_t. see lt_tag_get_key().
+ */
+struct _lt_tag_key_t {
+	unsigned long long hi;
+	unsigned long long lo;
+};
+
+/**
+ * lt_tag_span_t:
+ * @string: a language tag. this doesn't need to be nul-terminated.
+ * @length: the length of @string in bytes.
+ *
+ * A language tag in the caller's buffer to be processed by
+ * lt_tag_parse_batch() and lt_tag_canonicalize_batch().
+ */
+struct _lt_tag_span_t {
+	const char *string;
+	size_t      length;
+};
+
+/**
+ * lt_tag_validity_t:
+ * @LT_TAG_VALID: the language tag is valid.
+ * @LT_TAG_INVALID_SYNTAX: the language tag isn't well-formed. i.e. invalid
+ *                         characters, the misplaced hyphens or the language
+ *                         tag ends unexpectedly.
+ * @LT_TAG_INVALID_SUBTAG: the subtag isn't allowed at the position.
+ * @LT_TAG_UNKNOWN_SUBTAG: the subtag isn't registered in the database.
+ * @LT_TAG_INVALID_PREFIX: the extlang or the variant subtag isn't allowed
+ *                         with the preceding subtags.
+ * @LT_TAG_DUPLICATE_SUBTAG: the variant subtag appears more than once.
+ * @LT_TAG_INVALID_EXTENSION: the extension or the following subtags are
+ *                            invalid.
+ *
+ * The result of lt_tag_is_valid().
+ */
+enum _lt_tag_validity_t {
+	LT_TAG_VALID = 0,
+	LT_TAG_INVALID_SYNTAX,
+	LT_TAG_INVALID_SUBTAG,
+	LT_TAG_UNKNOWN_SUBTAG,
+	LT_TAG_INVALID_PREFIX,
+	LT_TAG_DUPLICATE_SUBTAG,
+	LT_TAG_INVALID_EXTENSION
+};
+/**
+ * lt_tag_validate_flags_t:
+ * @LT_TAG_VALIDATE_DEFAULT: validate as lt_tag_parse() does.
+ * @LT_TAG_VALIDATE_WILDCARD: allow the wildcard subtags as the language
+ *                            range does.
+ *
+ * The flags to change the behavior of lt_tag_is_valid().
+ */
+enum _lt_tag_validate_flags_t {
+	LT_TAG_VALIDATE_DEFAULT  = 0,
+	LT_TAG_VALIDATE_WILDCARD = 1 << 0
+};
+
+typedef enum _lt_tag_validity_t		lt_tag_validity_t;
+typedef enum _lt_tag_validate_flags_t	lt_tag_validate_flags_t;
 
 lt_tag_t                 *lt_tag_new                       (void);
+lt_tag_t                 *lt_tag_new_with_arena            (lt_pointer_t     buffer,
+                                                            size_t           size);
 lt_tag_t                 *lt_tag_ref                       (lt_tag_t        *tag);
 void                      lt_tag_unref                     (lt_tag_t        *tag);
 lt_bool_t                 lt_tag_parse                     (lt_tag_t        *tag,
                                                             const char      *tag_string,
                                                             lt_error_t     **error);
+lt_bool_t                 lt_tag_parse_len                 (lt_tag_t        *tag,
+                                                            const char      *tag_string,
+                                                            size_t           length,
+                                                            lt_error_t     **error);
+size_t                    lt_tag_parse_batch               (lt_tag_t           **tags,
+                                                            const lt_tag_span_t *spans,
+                                                            size_t               n_spans,
+                                                            lt_error_type_t     *status);
 lt_bool_t                 lt_tag_parse_with_extra_token    (lt_tag_t        *tag,
                                                             const char      *tag_string,
                                                             lt_error_t     **error);
+lt_tag_validity_t         lt_tag_is_valid                  (const char      *tag_string,
+                                                            size_t           length,
+                                                            int              flags,
+                                                            size_t          *error_offset);
 void                      lt_tag_clear                     (lt_tag_t        *tag);
 lt_tag_t                 *lt_tag_copy                      (const lt_tag_t  *tag);
 lt_bool_t                 lt_tag_truncate                  (lt_tag_t        *tag,
@@ -54,6 +135,15 @@ lt_bool_t                 lt_tag_truncate                  (lt_tag_t        *tag
 const char               *lt_tag_get_string                (lt_tag_t        *tag);
 char                     *lt_tag_canonicalize              (lt_tag_t        *tag,
                                                             lt_error_t     **error);
+size_t                    lt_tag_canonicalize_batch        (const lt_tag_span_t *spans,
+                                                            size_t               n_spans,
+                                                            char               **results,
+                                                            lt_error_type_t     *status);
+size_t                    lt_tag_canonicalize_batch_parallel(const lt_tag_span_t *spans,
+                                                             size_t               n_spans,
+                                                             char               **results,
+                                                             lt_error_type_t     *status,
+                                                             unsigned int         n_threads);
 char                     *lt_tag_convert_to_locale         (lt_tag_t        *tag,
                                                             lt_error_t     **error);
 lt_tag_t                 *lt_tag_convert_from_locale       (lt_error_t     **error);
@@ -65,9 +155,22 @@ lt_bool_t                 lt_tag_compare                   (const lt_tag_t  *v1,
 lt_bool_t                 lt_tag_match                     (const lt_tag_t  *v1,
                                                             const char      *v2,
                                                             lt_error_t     **error);
+lt_bool_t                 lt_tag_match_len                 (const lt_tag_t  *v1,
+                                                            const char      *v2,
+                                                            size_t           length,
+                                                            lt_error_t     **error);
+lt_bool_t                 lt_tag_parse_range               (lt_tag_t        *tag,
+                                                            const char      *range,
+                                                            lt_error_t     **error);
+lt_bool_t                 lt_tag_match_range               (const lt_tag_t  *v1,
+                                                            const lt_tag_t  *range);
 char                     *lt_tag_lookup                    (const lt_tag_t  *tag,
                                                             const char      *pattern,
                                                             lt_error_t     **error);
+char                     *lt_tag_lookup_len                (const lt_tag_t  *tag,
+                                                            const char      *pattern,
+                                                            size_t           length,
+                                                            lt_error_t     **error);
 lt_tag_t                 *lt_tag_transform                 (lt_tag_t        *tag,
                                                             lt_error_t     **error);
 const lt_lang_t          *lt_tag_get_language              (const lt_tag_t  *tag);
@@ -78,6 +181,16 @@ const lt_list_t          *lt_tag_get_variants              (const lt_tag_t  *tag
 const lt_extension_t     *lt_tag_get_extension             (const lt_tag_t  *tag);
 const lt_string_t        *lt_tag_get_privateuse            (const lt_tag_t  *tag);
 const lt_grandfathered_t *lt_tag_get_grandfathered         (const lt_tag_t  *tag);
+lt_bool_t                 lt_tag_get_key                   (lt_tag_t        *tag,
+                                                            lt_tag_key_t    *key);
+size_t                    lt_tag_hash                      (lt_tag_t        *tag);
+int                       lt_tag_cmp                       (lt_tag_t        *v1,
+                                                            lt_tag_t        *v2);
+size_t                    lt_tag_key_hash                  (const lt_tag_key_t *key);
+int                       lt_tag_key_cmp                   (const lt_tag_key_t *k1,
+                                                            const lt_tag_key_t *k2);
+lt_tag_t                 *lt_tag_key_decode                (const lt_tag_key_t  *key,
+                                                            lt_error_t         **error);
 
 LT_END_DECLS
 
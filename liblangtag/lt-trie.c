@@ -22,17 +22,43 @@
 #include "lt-trie.h"
 
 
+/* the depth of the stack in the iterator. it grows on the heap only for
+ * the keys longer than this.
+ */
+#define LT_TRIE_ITER_DEPTH	32
+
 typedef struct _lt_trie_node_t	lt_trie_node_t;
 struct _lt_trie_node_t {
 	lt_mem_t           parent;
 	lt_trie_node_t    *node[255];
 	lt_pointer_t       data;
 	char               index_;
+	/* the range of the children ever added. the iterator scans this only */
+	unsigned char      first;
+	unsigned char      last;
 };
 struct _lt_trie_t {
 	lt_iter_tmpl_t  parent;
 	lt_trie_node_t *root;
 };
+typedef struct _lt_trie_iter_frame_t {
+	lt_trie_node_t *node;
+	int             pos;
+} lt_trie_iter_frame_t;
+struct _lt_trie_iter_t {
+	lt_iter_t             parent;
+	lt_trie_iter_frame_t *stack;
+	char                 *key;
+	size_t                depth;
+	size_t                size;
+	/* the depth of the subtree being iterated and its root which isn't
+	 * visited yet. see lt_trie_prefix_iter().
+	 */
+	size_t                base;
+	lt_trie_node_t       *start;
+	lt_trie_iter_frame_t  stack_[LT_TRIE_ITER_DEPTH];
+	char                  key_[LT_TRIE_ITER_DEPTH];
+};
 
 /*< private >*/
 static lt_trie_node_t *
@@ -41,7 +67,10 @@ lt_trie_node_new(char index_)
 	lt_trie_node_t *retval = lt_mem_alloc_object(sizeof (lt_trie_node_t));
 
 	if (retval) {
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_TRIE_NODE);
 		retval->index_ = index_ + 1;
+		retval->first = 254;
+		retval->last = 0;
 	}
 
 	return retval;
@@ -76,7 +105,7 @@ lt_trie_node_add(lt_trie_node_t    *node,
 	lt_return_val_if_fail (node != NULL, FALSE);
 	lt_return_val_if_fail (key != NULL, FALSE);
 
-	index_ = *key - 1;
+	index_ = (unsigned char)*key - 1;
 	if (*key == 0) {
 		if (node->data && !replace) {
 			return FALSE;
@@ -99,6 +128,10 @@ lt_trie_node_add(lt_trie_node_t    *node,
 			       (lt_destroy_func_t)lt_trie_node_unref);
 		lt_mem_add_weak_pointer(&node->node[index_]->parent,
 					(lt_pointer_t *)&node->node[index_]);
+		if (index_ < node->first)
+			node->first = index_;
+		if (index_ > node->last)
+			node->last = index_;
 	}
 
 	return lt_trie_node_add(node->node[index_], key + 1, data, func, replace);
@@ -115,7 +148,7 @@ lt_trie_node_remove(lt_trie_node_t *node,
 	lt_return_val_if_fail (node != NULL, FALSE);
 	lt_return_val_if_fail (key != NULL, FALSE);
 
-	index_ = *key - 1;
+	index_ = (unsigned char)*key - 1;
 	if (*key == 0) {
 		if (!node->data)
 			return FALSE;
@@ -143,7 +176,7 @@ lt_trie_node_lookup(lt_trie_node_t *node,
 	lt_return_val_if_fail (node != NULL, NULL);
 	lt_return_val_if_fail (key != NULL, NULL);
 
-	index_ = *key - 1;
+	index_ = (unsigned char)*key - 1;
 	if (*key == 0)
 		return node->data;
 	if (!node->node[index_])
@@ -152,27 +185,82 @@ lt_trie_node_lookup(lt_trie_node_t *node,
 	return lt_trie_node_lookup(node->node[index_], key + 1);
 }
 
+static lt_bool_t
+_lt_trie_iter_reserve(lt_trie_iter_t *iter,
+		      size_t          depth)
+{
+	/* keep one more room for the terminator in the key */
+	if (depth + 1 >= iter->size) {
+		size_t size = iter->size * 2;
+		lt_trie_iter_frame_t *stack;
+		char *key;
+
+		while (depth + 1 >= size)
+			size *= 2;
+
+		if (iter->stack == iter->stack_) {
+			stack = malloc(sizeof (lt_trie_iter_frame_t) * size);
+			key = malloc(size);
+			if (stack)
+				memcpy(stack, iter->stack, sizeof (lt_trie_iter_frame_t) * iter->size);
+			if (key)
+				memcpy(key, iter->key, iter->size);
+		} else {
+			stack = realloc(iter->stack, sizeof (lt_trie_iter_frame_t) * size);
+			if (stack)
+				iter->stack = stack;
+			key = realloc(iter->key, size);
+			if (key)
+				iter->key = key;
+		}
+		if (!stack || !key) {
+			lt_warning("Unable to allocate a memory for the iterator.");
+			if (iter->stack == iter->stack_) {
+				free(stack);
+				free(key);
+			}
+			return FALSE;
+		}
+		iter->stack = stack;
+		iter->key = key;
+		iter->size = size;
+	}
+
+	return TRUE;
+}
+
+static lt_bool_t
+_lt_trie_iter_push(lt_trie_iter_t *iter,
+		   lt_trie_node_t *node)
+{
+	if (!_lt_trie_iter_reserve(iter, iter->depth))
+		return FALSE;
+	if (iter->depth > 0)
+		iter->key[iter->depth - 1] = node->index_;
+	iter->stack[iter->depth].node = node;
+	iter->stack[iter->depth].pos = node->first;
+	iter->depth++;
+
+	return TRUE;
+}
+
 static lt_iter_t *
 _lt_trie_iter_init(lt_iter_tmpl_t *tmpl)
 {
 	lt_trie_iter_t *trie_iter;
 	lt_trie_t *trie = (lt_trie_t *)tmpl;
-	int i;
 
 	trie_iter = malloc(sizeof (lt_trie_iter_t));
 	if (trie_iter) {
-		trie_iter->pos_str = lt_string_new(NULL);
-		trie_iter->stack = NULL;
-		if (trie->root) {
-			lt_trie_node_t *node = trie->root;
-
-			for (i = 0; i < 255; i++) {
-				if (node->node[i])
-					trie_iter->stack = lt_list_append(trie_iter->stack, node->node[i], NULL);
-			}
-			/* add a terminator */
-			trie_iter->stack = lt_list_append(trie_iter->stack, NULL, NULL);
-		}
+		trie_iter->stack = trie_iter->stack_;
+		trie_iter->key = trie_iter->key_;
+		trie_iter->depth = 0;
+		trie_iter->size = LT_TRIE_ITER_DEPTH;
+		trie_iter->base = 0;
+		trie_iter->start = NULL;
+		/* the data at the root isn't iterated as it's for the empty key */
+		if (trie->root)
+			_lt_trie_iter_push(trie_iter, trie->root);
 	}
 
 	return &trie_iter->parent;
@@ -183,45 +271,51 @@ _lt_trie_iter_fini(lt_iter_t *iter)
 {
 	lt_trie_iter_t *trie_iter = (lt_trie_iter_t *)iter;
 
-	if (trie_iter->stack)
-		lt_list_free(trie_iter->stack);
-	lt_string_unref(trie_iter->pos_str);
+	if (trie_iter->stack != trie_iter->stack_) {
+		free(trie_iter->stack);
+		free(trie_iter->key);
+	}
 }
 
+/* the key is in the buffer of the iterator. it's valid until the next call */
 static lt_bool_t
 _lt_trie_iter_next(lt_iter_t    *iter,
 		   lt_pointer_t *key,
 		   lt_pointer_t *value)
 {
 	lt_trie_iter_t *trie_iter = (lt_trie_iter_t *)iter;
-	int i;
-	lt_trie_node_t *node = NULL;
-	lt_list_t *base;
+	lt_trie_iter_frame_t *frame;
+	lt_trie_node_t *node;
+
+	if (trie_iter->start) {
+		node = trie_iter->start;
+		trie_iter->start = NULL;
+		if (_lt_trie_iter_push(trie_iter, node) && node->data) {
+			trie_iter->key[trie_iter->depth - 1] = 0;
+			if (key)
+				*key = trie_iter->key;
+			if (value)
+				*value = node->data;
 
-	while (1) {
-		if (lt_list_length(trie_iter->stack) == 0)
-			break;
-		trie_iter->stack = lt_list_pop(trie_iter->stack, (lt_pointer_t *)&node);
-		if (node) {
-			lt_string_append_c(trie_iter->pos_str, node->index_);
-		} else {
-			lt_string_truncate(trie_iter->pos_str, -1);
-			continue;
+			return TRUE;
 		}
-		base = trie_iter->stack;
-		for (i = 0; i < 255; i++) {
-			if (node->node[i]) {
-				base = lt_list_prepend(base, node->node[i], NULL);
-				base = lt_list_next(base);
-			}
+	}
+	while (trie_iter->depth > trie_iter->base) {
+		frame = &trie_iter->stack[trie_iter->depth - 1];
+		while (frame->pos <= frame->node->last &&
+		       !frame->node->node[frame->pos])
+			frame->pos++;
+		if (frame->pos > frame->node->last) {
+			trie_iter->depth--;
+			continue;
 		}
-		/* add a terminator */
-		base = lt_list_prepend(base, NULL, NULL);
-		trie_iter->stack = lt_list_first(base);
+		node = frame->node->node[frame->pos++];
+		if (!_lt_trie_iter_push(trie_iter, node))
+			break;
 		if (node->data) {
-			if (key) {
-				*key = strdup(lt_string_value(trie_iter->pos_str));
-			}
+			trie_iter->key[trie_iter->depth - 1] = 0;
+			if (key)
+				*key = trie_iter->key;
 			if (value)
 				*value = node->data;
 
@@ -241,6 +335,7 @@ lt_trie_new(void)
 	lt_trie_t *retval = lt_mem_alloc_object(sizeof (lt_trie_t));
 
 	if (retval) {
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_TRIE);
 		lt_iter_tmpl_init(&retval->parent);
 		retval->parent.init = _lt_trie_iter_init;
 		retval->parent.fini = _lt_trie_iter_fini;
@@ -333,25 +428,64 @@ lt_trie_lookup(lt_trie_t  *trie,
 	return lt_trie_node_lookup(trie->root, key);
 }
 
+/* iterates the keys starting with @prefix in the lexicographic order.
+ * only the subtree for @prefix is visited.
+ */
+lt_iter_t *
+lt_trie_prefix_iter(lt_trie_t  *trie,
+		    const char *prefix)
+{
+	lt_trie_iter_t *retval;
+	lt_trie_node_t *node;
+	size_t len;
+	const char *p;
+
+	lt_return_val_if_fail (trie != NULL, NULL);
+	lt_return_val_if_fail (prefix != NULL, NULL);
+
+	retval = (lt_trie_iter_t *)lt_iter_init(&trie->parent);
+	if (!retval || !*prefix)
+		return &retval->parent;
+
+	node = trie->root;
+	for (p = prefix; node && *p; p++)
+		node = node->node[(unsigned char)*p - 1];
+	/* nothing to iterate unless the subtree is found */
+	retval->depth = 0;
+	if (node) {
+		len = p - prefix;
+		if (!_lt_trie_iter_reserve(retval, len)) {
+			lt_iter_finish(&retval->parent);
+			return NULL;
+		}
+		memcpy(retval->key, prefix, len - 1);
+		retval->depth = len;
+		retval->base = len;
+		retval->start = node;
+	}
+
+	return &retval->parent;
+}
+
 lt_list_t *
 lt_trie_keys(lt_trie_t *trie)
 {
-	lt_trie_iter_t *iter;
+	lt_iter_t *iter;
 	lt_list_t *retval = NULL;
 	lt_pointer_t key;
 
 	lt_return_val_if_fail (trie != NULL, NULL);
 
-	if (trie->root)
+	if (!trie->root)
 		return NULL;
 
-	iter = (lt_trie_iter_t *)lt_iter_init(&trie->parent);
+	iter = lt_iter_init(&trie->parent);
 
-	while (lt_iter_next((lt_iter_t *)&iter, &key, NULL)) {
-		retval = lt_list_append(retval, key, free);
+	while (lt_iter_next(iter, &key, NULL)) {
+		retval = lt_list_append(retval, strdup(key), free);
 	}
 
-	lt_iter_finish((lt_iter_t *)&iter);
+	lt_iter_finish(iter);
 
 	return retval;
 }
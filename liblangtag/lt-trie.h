@@ -21,11 +21,7 @@
 LT_BEGIN_DECLS
 
 typedef struct _lt_trie_t	lt_trie_t;
-typedef struct _lt_trie_iter_t {
-	lt_iter_t    parent;
-	lt_list_t   *stack;
-	lt_string_t *pos_str;
-} lt_trie_iter_t;
+typedef struct _lt_trie_iter_t	lt_trie_iter_t;
 
 lt_trie_t      *lt_trie_new        (void);
 lt_trie_t      *lt_trie_ref        (lt_trie_t         *trie);
@@ -42,6 +38,8 @@ lt_bool_t       lt_trie_remove     (lt_trie_t         *trie,
                                     const char        *key);
 lt_pointer_t    lt_trie_lookup     (lt_trie_t         *trie,
                                     const char        *key);
+lt_iter_t      *lt_trie_prefix_iter(lt_trie_t         *trie,
+                                    const char        *prefix);
 lt_list_t      *lt_trie_keys       (lt_trie_t         *trie);
 
 LT_END_DECLS
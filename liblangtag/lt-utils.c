@@ -215,3 +215,30 @@ lt_strndup(const char *s,
 	return memcpy(retval, s, i);
 #endif
 }
+
+/* Copy @n bytes of @s in lower case into @buffer, or into the newly allocated
+ * memory if it doesn't fit in @size. the caller has to free the result if it
+ * isn't @buffer.
+ */
+char *
+lt_strlower_key(char       *buffer,
+		size_t      size,
+		const char *s,
+		size_t      n)
+{
+	char *retval = buffer;
+	size_t i;
+
+	lt_return_val_if_fail (s != NULL, NULL);
+
+	if (n >= size || !buffer) {
+		retval = malloc(n + 1);
+		if (!retval)
+			return NULL;
+	}
+	for (i = 0; i < n; i++)
+		retval[i] = tolower((unsigned char)s[i]);
+	retval[n] = 0;
+
+	return retval;
+}
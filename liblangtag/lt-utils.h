@@ -38,6 +38,10 @@ char *lt_strdup_vprintf(const char *format,
                         va_list     args);
 char *lt_strndup       (const char *s,
 			size_t      n);
+char *lt_strlower_key  (char       *buffer,
+			size_t      size,
+			const char *s,
+			size_t      n);
 
 LT_END_DECLS
 
@@ -17,6 +17,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <libxml/xpath.h>
+#include "lt-database-private.h"
+#include "lt-db-image.h"
 #include "lt-error.h"
 #include "lt-iter-private.h"
 #include "lt-variant.h"
@@ -24,6 +26,8 @@
 #include "lt-list.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-trie.h"
 #include "lt-utils.h"
 #include "lt-xml.h"
@@ -42,6 +46,7 @@ struct _lt_variant_db_t {
 	lt_iter_tmpl_t  parent;
 	lt_xml_t       *xml;
 	lt_trie_t      *variant_entries;
+	lt_db_image_table_t *image;
 };
 typedef struct _lt_variant_db_iter_t {
 	lt_iter_t  parent;
@@ -63,6 +68,11 @@ lt_variant_db_parse(lt_variant_db_t  *variantdb,
 	lt_return_val_if_fail (variantdb != NULL, FALSE);
 
 	doc = lt_xml_get_subtag_registry(variantdb->xml);
+	if (!doc) {
+		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
+			     "Unable to obtain the subtag registry.");
+		goto bail;
+	}
 	xctxt = xmlXPathNewContext(doc);
 	if (!xctxt) {
 		lt_error_set(&err, LT_ERR_OOM,
@@ -70,6 +80,7 @@ lt_variant_db_parse(lt_variant_db_t  *variantdb,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/registry/variant", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s",
@@ -95,8 +106,8 @@ lt_variant_db_parse(lt_variant_db_t  *variantdb,
 		while (cnode != NULL) {
 			if (xmlStrcmp(cnode->name, (const xmlChar *)"subtag") == 0) {
 				if (subtag) {
-					lt_warning("Duplicate subtag element in variant: previous value was '%s'",
-						   subtag);
+					lt_warning_ratelimited("Duplicate subtag element in variant: previous value was '%s'",
+							       subtag);
 				} else {
 					subtag = xmlNodeGetContent(cnode);
 				}
@@ -115,24 +126,24 @@ lt_variant_db_parse(lt_variant_db_t  *variantdb,
 							     (lt_destroy_func_t)xmlFree);
 			} else if (xmlStrcmp(cnode->name, (const xmlChar *)"preferred-value") == 0) {
 				if (preferred) {
-					lt_warning("Duplicate preferred-value element in variant: previous value was '%s'",
-						   preferred);
+					lt_warning_ratelimited("Duplicate preferred-value element in variant: previous value was '%s'",
+							       preferred);
 				} else {
 					preferred = xmlNodeGetContent(cnode);
 				}
 			} else {
-				lt_warning("Unknown node under /registry/variant: %s", cnode->name);
+				lt_warning_ratelimited("Unknown node under /registry/variant: %s", cnode->name);
 			}
 			cnode = cnode->next;
 		}
 		if (!subtag) {
-			lt_warning("No subtag node: description = '%s', prefix = '%s', preferred-value = '%s'",
-				   desc, prefix_list ? (char *)lt_list_value(prefix_list) : "N/A", preferred);
+			lt_warning_ratelimited("No subtag node: description = '%s', prefix = '%s', preferred-value = '%s'",
+					       desc, prefix_list ? (char *)lt_list_value(prefix_list) : "N/A", preferred);
 			goto bail1;
 		}
 		if (!desc) {
-			lt_warning("No description node: subtag = '%s', prefix = '%s', preferred-value = '%s'",
-				   subtag, prefix_list ? (char *)lt_list_value(prefix_list) : "N/A", preferred);
+			lt_warning_ratelimited("No description node: subtag = '%s', prefix = '%s', preferred-value = '%s'",
+					       subtag, prefix_list ? (char *)lt_list_value(prefix_list) : "N/A", preferred);
 			goto bail1;
 		}
 		le = lt_variant_create();
@@ -191,7 +202,10 @@ _lt_variant_db_iter_init(lt_iter_tmpl_t *tmpl)
 
 	retval = malloc(sizeof (lt_variant_db_iter_t));
 	if (retval) {
-		retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->variant_entries);
+		if (db->image)
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->image);
+		else
+			retval->iter = lt_iter_init((lt_iter_tmpl_t *)db->variant_entries);
 		if (!retval->iter) {
 			free(retval);
 			retval = NULL;
@@ -219,6 +233,40 @@ _lt_variant_db_iter_next(lt_iter_t    *iter,
 	return lt_iter_next(db_iter->iter, key, val);
 }
 
+/*< protected >*/
+/* @key has to be in lower case as the database keeps it so. */
+lt_bool_t
+lt_variant_db_probe(lt_variant_db_t *variantdb,
+		    const char      *key,
+		    lt_db_probe_t   *probe)
+{
+	lt_variant_t *variant;
+	lt_bool_t retval;
+
+	lt_return_val_if_fail (variantdb != NULL, FALSE);
+	lt_return_val_if_fail (key != NULL, FALSE);
+	lt_return_val_if_fail (probe != NULL, FALSE);
+
+	memset(probe, 0, sizeof (lt_db_probe_t));
+	if (variantdb->image) {
+		retval = lt_db_image_table_probe(variantdb->image, key, probe);
+		LT_STATS_DB_LOOKUP (VARIANT, retval);
+		LT_PROBE_DB_LOOKUP (VARIANT, key, retval);
+
+		return retval;
+	}
+	variant = lt_trie_lookup(variantdb->variant_entries, key);
+	LT_STATS_DB_LOOKUP (VARIANT, variant != NULL);
+	LT_PROBE_DB_LOOKUP (VARIANT, key, variant != NULL);
+	if (!variant)
+		return FALSE;
+	probe->tag = lt_variant_get_tag(variant);
+	probe->preferred_tag = lt_variant_get_preferred_tag(variant);
+	probe->prefixes = lt_variant_get_prefix(variant);
+
+	return TRUE;
+}
+
 /*< public >*/
 /**
  * lt_variant_db_new:
@@ -233,11 +281,28 @@ lt_variant_db_new(void)
 	lt_variant_db_t *retval = lt_mem_alloc_object(sizeof (lt_variant_db_t));
 
 	if (retval) {
+		lt_db_image_t *image;
 		lt_error_t *err = NULL;
 		lt_variant_t *le;
 
+		lt_mem_set_type(&retval->parent.parent, LT_STATS_MEM_DATABASE);
 		LT_ITER_TMPL_INIT (&retval->parent, _lt_variant_db);
 
+		image = lt_db_image_get_default();
+		if (image) {
+			/* served from the shared image. no need to parse XML */
+			retval->image = lt_db_image_table_new(image, LT_DB_IMAGE_VARIANT);
+			lt_db_image_unref(image);
+			if (!retval->image) {
+				lt_variant_db_unref(retval);
+				retval = NULL;
+				goto bail;
+			}
+			lt_mem_add_ref((lt_mem_t *)retval, retval->image,
+				       (lt_destroy_func_t)lt_db_image_table_unref);
+			goto bail;
+		}
+
 		retval->variant_entries = lt_trie_new();
 		lt_mem_add_ref((lt_mem_t *)retval, retval->variant_entries,
 			       (lt_destroy_func_t)lt_trie_unref);
@@ -322,19 +387,120 @@ lt_variant_db_unref(lt_variant_db_t *variantdb)
 lt_variant_t *
 lt_variant_db_lookup(lt_variant_db_t *variantdb,
 		     const char      *subtag)
+{
+	lt_return_val_if_fail (subtag != NULL, NULL);
+
+	return lt_variant_db_lookup_len(variantdb, subtag, strlen(subtag));
+}
+
+/**
+ * lt_variant_db_lookup_len:
+ * @variantdb: a #lt_variant_db_t.
+ * @subtag: a subtag name to lookup.
+ * @length: the length of @subtag in bytes.
+ *
+ * Lookup @lt_variant_t if @subtag is valid and registered into the database.
+ * This is the same as lt_variant_db_lookup() but @subtag doesn't need to be
+ * nul-terminated.
+ *
+ * Returns: (transfer full): a #lt_variant_t that meets with @subtag.
+ *                           otherwise %NULL.
+ */
+lt_variant_t *
+lt_variant_db_lookup_len(lt_variant_db_t *variantdb,
+			 const char      *subtag,
+			 size_t           length)
 {
 	lt_variant_t *retval;
-	char *s;
+	char buffer[LT_DB_KEY_SIZE], *s;
 
 	lt_return_val_if_fail (variantdb != NULL, NULL);
 	lt_return_val_if_fail (subtag != NULL, NULL);
 
-	s = strdup(subtag);
-	retval = lt_trie_lookup(variantdb->variant_entries,
-				lt_strlower(s));
-	free(s);
-	if (retval)
-		return lt_variant_ref(retval);
+	s = lt_strlower_key(buffer, sizeof (buffer), subtag, length);
+	if (!s)
+		return NULL;
+	if (variantdb->image) {
+		/* the entry is materialized from the image with a reference */
+		retval = lt_db_image_table_lookup(variantdb->image, s);
+	} else {
+		retval = lt_trie_lookup(variantdb->variant_entries, s);
+		if (retval)
+			lt_variant_ref(retval);
+	}
+	LT_STATS_DB_LOOKUP (VARIANT, retval != NULL);
+	LT_PROBE_DB_LOOKUP (VARIANT, s, retval != NULL);
+	if (s != buffer)
+		free(s);
+
+	return retval;
+}
+
+/**
+ * lt_variant_db_export:
+ * @variantdb: a #lt_variant_db_t.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Export all the entries in @variantdb at once. @entries is filled with
+ * the pairs of the key and #lt_variant_t in one contiguous block, which is
+ * terminated by the entry with %NULL key.
+ *
+ * Returns: the number of the entries. @entries has to be freed with
+ *          lt_iter_entries_free().
+ */
+size_t
+lt_variant_db_export(lt_variant_db_t  *variantdb,
+		     lt_iter_entry_t **entries)
+{
+	lt_return_val_if_fail (variantdb != NULL, 0);
+
+	return lt_iter_export(&variantdb->parent, entries);
+}
+
+/**
+ * lt_variant_db_complete:
+ * @variantdb: a #lt_variant_db_t.
+ * @prefix: the prefix of the subtag.
+ * @max: the maximum number of the entries.
+ * @entries: (out) (transfer full): the location to store the entries.
+ *
+ * Look up the entries whose subtag starts with @prefix case-insensitively,
+ * in the lexicographic order. only the entries matching @prefix are visited.
+ * @entries is filled as lt_variant_db_export() does.
+ *
+ * Returns: the number of the entries, up to @max. @entries has to be freed
+ *          with lt_iter_entries_free().
+ */
+size_t
+lt_variant_db_complete(lt_variant_db_t  *variantdb,
+		       const char       *prefix,
+		       size_t            max,
+		       lt_iter_entry_t **entries)
+{
+	lt_iter_t *iter;
+	char buffer[LT_DB_KEY_SIZE], *s;
+	size_t retval = 0;
+
+	lt_return_val_if_fail (variantdb != NULL, 0);
+	lt_return_val_if_fail (prefix != NULL, 0);
+	lt_return_val_if_fail (entries != NULL, 0);
+
+	*entries = NULL;
+	if (max == 0)
+		return 0;
+	s = lt_strlower_key(buffer, sizeof (buffer), prefix, strlen(prefix));
+	if (!s)
+		return 0;
+	if (variantdb->image)
+		iter = lt_db_image_table_prefix_iter(variantdb->image, s);
+	else
+		iter = lt_trie_prefix_iter(variantdb->variant_entries, s);
+	if (iter) {
+		retval = lt_iter_collect(iter, max, entries);
+		lt_iter_finish(iter);
+	}
+	if (s != buffer)
+		free(s);
 
-	return NULL;
+	return retval;
 }
@@ -18,6 +18,7 @@
 #define __LT_VARIANT_DB_H__
 
 #include <liblangtag/lt-macros.h>
+#include <liblangtag/lt-iter.h>
 #include <liblangtag/lt-variant.h>
 
 LT_BEGIN_DECLS
@@ -31,11 +32,20 @@ LT_BEGIN_DECLS
 typedef struct _lt_variant_db_t	lt_variant_db_t;
 
 
-lt_variant_db_t *lt_variant_db_new   (void);
-lt_variant_db_t *lt_variant_db_ref   (lt_variant_db_t *variantdb);
-void             lt_variant_db_unref (lt_variant_db_t *variantdb);
-lt_variant_t    *lt_variant_db_lookup(lt_variant_db_t *variantdb,
-                                      const char      *subtag);
+lt_variant_db_t *lt_variant_db_new       (void);
+lt_variant_db_t *lt_variant_db_ref       (lt_variant_db_t *variantdb);
+void             lt_variant_db_unref     (lt_variant_db_t *variantdb);
+lt_variant_t    *lt_variant_db_lookup    (lt_variant_db_t *variantdb,
+                                          const char      *subtag);
+lt_variant_t    *lt_variant_db_lookup_len(lt_variant_db_t *variantdb,
+                                          const char      *subtag,
+                                          size_t           length);
+size_t           lt_variant_db_export    (lt_variant_db_t *variantdb,
+                                          lt_iter_entry_t **entries);
+size_t           lt_variant_db_complete  (lt_variant_db_t *variantdb,
+                                          const char      *prefix,
+                                          size_t           max,
+                                          lt_iter_entry_t **entries);
 
 LT_END_DECLS
 
@@ -49,6 +49,9 @@ lt_variant_create(void)
 
 	retval = lt_mem_alloc_object(sizeof (lt_variant_t));
 
+	if (retval)
+		lt_mem_set_type(&retval->parent, LT_STATS_MEM_VARIANT);
+
 	return retval;
 }
 
@@ -21,6 +21,8 @@
 #include "lt-lock.h"
 #include "lt-mem.h"
 #include "lt-messages.h"
+#include "lt-probes.h"
+#include "lt-stats-private.h"
 #include "lt-database.h"
 #include "lt-string.h"
 #include "lt-xml.h"
@@ -41,6 +43,7 @@ struct _lt_xml_t {
 
 static lt_xml_t *__xml = NULL;
 LT_LOCK_DEFINE_STATIC (xml);
+LT_LOCK_DEFINE_STATIC (xml_registry);
 
 /*< private >*/
 static lt_bool_t
@@ -78,7 +81,9 @@ lt_xml_read_subtag_registry(lt_xml_t  *xml,
 			     "Unable to create an instance of xmlParserCtxt.");
 		goto bail;
 	}
+	LT_PROBE1 (xml_load_start, lt_string_value(regfile));
 	doc = xmlCtxtReadFile(xmlparser, lt_string_value(regfile), "UTF-8", 0);
+	LT_PROBE2 (xml_load_done, lt_string_value(regfile), (int)(doc != NULL));
 	if (!doc) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "Unable to read the xml file: %s",
@@ -149,7 +154,9 @@ lt_xml_read_cldr_bcp47(lt_xml_t     *xml,
 			     "Unable to create an instance of xmlParserCtxt.");
 		goto bail;
 	}
+	LT_PROBE1 (xml_load_start, lt_string_value(regfile));
 	*doc = xmlCtxtReadFile(xmlparser, lt_string_value(regfile), "UTF-8", 0);
+	LT_PROBE2 (xml_load_done, lt_string_value(regfile), (int)(*doc != NULL));
 	if (!*doc) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "Unable to read the xml file: %s",
@@ -220,7 +227,9 @@ lt_xml_read_cldr_supplemental(lt_xml_t     *xml,
 			     "Unable to create an instance of xmlParserCtxt.");
 		goto bail;
 	}
+	LT_PROBE1 (xml_load_start, lt_string_value(regfile));
 	*doc = xmlCtxtReadFile(xmlparser, lt_string_value(regfile), "UTF-8", 0);
+	LT_PROBE2 (xml_load_done, lt_string_value(regfile), (int)(*doc != NULL));
 	if (!*doc) {
 		lt_error_set(&err, LT_ERR_FAIL_ON_XML,
 			     "Unable to read the xml file: %s",
@@ -267,6 +276,7 @@ _lt_xml_merge_keys(lt_xml_t    *xml,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/ldmlBCP47/keyword", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(error, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s: keyword",
@@ -291,6 +301,7 @@ _lt_xml_merge_keys(lt_xml_t    *xml,
 		goto bail;
 	}
 	xobj = xmlXPathEvalExpression((const xmlChar *)"/ldmlBCP47/keyword/key", xctxt);
+	LT_STATS_INC (xpath_evals);
 	if (!xobj) {
 		lt_error_set(error, LT_ERR_FAIL_ON_XML,
 			     "No valid elements for %s: key",
@@ -316,81 +327,76 @@ _lt_xml_merge_keys(lt_xml_t    *xml,
 	return retval;
 }
 
-/*< public >*/
-lt_xml_t *
-lt_xml_new(void)
+static lt_xml_t *
+_lt_xml_load(void)
 {
+	lt_xml_t *xml;
 	lt_error_t *err = NULL;
 
-	LT_LOCK (xml);
-
-	if (__xml) {
-		LT_UNLOCK (xml);
-
-		return lt_xml_ref(__xml);
-	}
-
-	__xml = lt_mem_alloc_object(sizeof (lt_xml_t));
-	if (__xml) {
+	xml = lt_mem_alloc_object(sizeof (lt_xml_t));
+	if (xml) {
 		xmlDocPtr doc = NULL;
 
-		lt_mem_add_weak_pointer(&__xml->parent, (lt_pointer_t *)&__xml);
-		if (!lt_xml_read_subtag_registry(__xml, &err))
-			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "calendar.xml",
-					    &__xml->cldr_bcp47_calendar,
+		lt_mem_set_type(&xml->parent, LT_STATS_MEM_XML);
+
+		/* the subtag registry is read at the first use.
+		 * the database may not need it at all when it's
+		 * served from the shared image.
+		 */
+		if (!lt_xml_read_cldr_bcp47(xml, "calendar.xml",
+					    &xml->cldr_bcp47_calendar,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "collation.xml",
-					    &__xml->cldr_bcp47_collation,
+		if (!lt_xml_read_cldr_bcp47(xml, "collation.xml",
+					    &xml->cldr_bcp47_collation,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "currency.xml",
-					    &__xml->cldr_bcp47_currency,
+		if (!lt_xml_read_cldr_bcp47(xml, "currency.xml",
+					    &xml->cldr_bcp47_currency,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "number.xml",
-					    &__xml->cldr_bcp47_number,
+		if (!lt_xml_read_cldr_bcp47(xml, "number.xml",
+					    &xml->cldr_bcp47_number,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "timezone.xml",
-					    &__xml->cldr_bcp47_timezone,
+		if (!lt_xml_read_cldr_bcp47(xml, "timezone.xml",
+					    &xml->cldr_bcp47_timezone,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "transform.xml",
-					    &__xml->cldr_bcp47_transform,
+		if (!lt_xml_read_cldr_bcp47(xml, "transform.xml",
+					    &xml->cldr_bcp47_transform,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "transform_ime.xml",
+		if (!lt_xml_read_cldr_bcp47(xml, "transform_ime.xml",
 					    &doc,
 					    &err))
 			goto bail;
-		if (!_lt_xml_merge_keys(__xml, __xml->cldr_bcp47_transform, doc, &err))
+		if (!_lt_xml_merge_keys(xml, xml->cldr_bcp47_transform, doc, &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "transform_keyboard.xml",
+		if (!lt_xml_read_cldr_bcp47(xml, "transform_keyboard.xml",
 					    &doc,
 					    &err))
 			goto bail;
-		if (!_lt_xml_merge_keys(__xml, __xml->cldr_bcp47_transform, doc, &err))
+		if (!_lt_xml_merge_keys(xml, xml->cldr_bcp47_transform, doc, &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "transform_mt.xml",
+		if (!lt_xml_read_cldr_bcp47(xml, "transform_mt.xml",
 					    &doc,
 					    &err))
 			goto bail;
-		if (!_lt_xml_merge_keys(__xml, __xml->cldr_bcp47_transform, doc, &err))
+		if (!_lt_xml_merge_keys(xml, xml->cldr_bcp47_transform, doc, &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "transform_private_use.xml",
+		if (!lt_xml_read_cldr_bcp47(xml, "transform_private_use.xml",
 					    &doc,
 					    &err))
 			goto bail;
-		if (!_lt_xml_merge_keys(__xml, __xml->cldr_bcp47_transform, doc, &err))
+		if (!_lt_xml_merge_keys(xml, xml->cldr_bcp47_transform, doc, &err))
 			goto bail;
-		if (!lt_xml_read_cldr_bcp47(__xml, "variant.xml",
-					    &__xml->cldr_bcp47_variant,
+		if (!lt_xml_read_cldr_bcp47(xml, "variant.xml",
+					    &xml->cldr_bcp47_variant,
 					    &err))
 			goto bail;
-		if (!lt_xml_read_cldr_supplemental(__xml, "likelySubtags.xml",
-						   &__xml->cldr_supplemental_likelysubtags,
+		if (!lt_xml_read_cldr_supplemental(xml, "likelySubtags.xml",
+						   &xml->cldr_supplemental_likelysubtags,
 						   &err))
 			goto bail;
 	}
@@ -399,14 +405,58 @@ lt_xml_new(void)
 	if (lt_error_is_set(err, LT_ERR_ANY)) {
 		lt_error_print(err, LT_ERR_ANY);
 		lt_error_unref(err);
-		lt_xml_unref(__xml);
+		lt_xml_unref(xml);
+		xml = NULL;
+	}
+
+	return xml;
+}
+
+/*< public >*/
+lt_xml_t *
+lt_xml_new(void)
+{
+	LT_LOCK (xml);
+
+	if (__xml) {
+		LT_UNLOCK (xml);
+
+		return lt_xml_ref(__xml);
 	}
 
+	__xml = _lt_xml_load();
+	if (__xml)
+		lt_mem_add_weak_pointer(&__xml->parent, (lt_pointer_t *)&__xml);
+
 	LT_UNLOCK (xml);
 
 	return __xml;
 }
 
+lt_xml_t *
+lt_xml_reload(void)
+{
+	lt_xml_t *retval;
+
+	/* don't block lt_xml_new() during reading the files */
+	retval = _lt_xml_load();
+	if (!retval)
+		return NULL;
+
+	LT_LOCK (xml);
+
+	if (__xml)
+		lt_mem_remove_weak_pointer(&__xml->parent, (lt_pointer_t *)&__xml);
+	__xml = retval;
+	lt_mem_add_weak_pointer(&__xml->parent, (lt_pointer_t *)&__xml);
+
+	LT_UNLOCK (xml);
+
+	return retval;
+}
+
+
+
 lt_xml_t *
 lt_xml_ref(lt_xml_t *xml)
 {
@@ -425,9 +475,17 @@ lt_xml_unref(lt_xml_t *xml)
 const xmlDocPtr
 lt_xml_get_subtag_registry(lt_xml_t *xml)
 {
+	xmlDocPtr retval;
+
 	lt_return_val_if_fail (xml != NULL, NULL);
 
-	return xml->subtag_registry;
+	LT_LOCK (xml_registry);
+	if (!xml->subtag_registry)
+		lt_xml_read_subtag_registry(xml, NULL);
+	retval = xml->subtag_registry;
+	LT_UNLOCK (xml_registry);
+
+	return retval;
 }
 
 const xmlDocPtr
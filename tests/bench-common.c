@@ -0,0 +1,146 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * bench-common.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <time.h>
+#include "bench-common.h"
+#ifdef BENCH_COUNT_ALLOCS
+#include <malloc.h>
+#endif
+
+int bench_counting = 0;
+long bench_n_allocs = 0;
+long bench_n_bytes = 0;
+long bench_heap = 0;
+long bench_heap_peak = 0;
+
+#ifdef BENCH_COUNT_ALLOCS
+extern void *__libc_malloc  (size_t  size);
+extern void *__libc_calloc  (size_t  nmemb,
+			     size_t  size);
+extern void *__libc_realloc (void   *ptr,
+			     size_t  size);
+extern void *__libc_memalign(size_t  alignment,
+			     size_t  size);
+extern void  __libc_free    (void   *ptr);
+
+/*< private >*/
+static void
+bench_account(void   *ptr,
+	      size_t  size,
+	      long    old_size)
+{
+	long usable = ptr ? malloc_usable_size(ptr) : 0;
+
+	bench_n_allocs++;
+	bench_n_bytes += size;
+	bench_heap += usable - old_size;
+	if (bench_heap > bench_heap_peak)
+		bench_heap_peak = bench_heap;
+}
+
+/*< public >*/
+void *
+malloc(size_t size)
+{
+	void *retval = __libc_malloc(size);
+
+	if (bench_counting)
+		bench_account(retval, size, 0);
+
+	return retval;
+}
+
+void *
+calloc(size_t nmemb,
+       size_t size)
+{
+	void *retval = __libc_calloc(nmemb, size);
+
+	if (bench_counting)
+		bench_account(retval, nmemb * size, 0);
+
+	return retval;
+}
+
+void *
+realloc(void   *ptr,
+	size_t  size)
+{
+	long old_size = ptr && bench_counting ? malloc_usable_size(ptr) : 0;
+	void *retval = __libc_realloc(ptr, size);
+
+	if (bench_counting) {
+		if (retval)
+			bench_account(retval, size, old_size);
+		else if (size == 0)
+			bench_heap -= old_size;
+	}
+
+	return retval;
+}
+
+void *
+memalign(size_t alignment,
+	 size_t size)
+{
+	void *retval = __libc_memalign(alignment, size);
+
+	if (bench_counting)
+		bench_account(retval, size, 0);
+
+	return retval;
+}
+
+void *
+aligned_alloc(size_t alignment,
+	      size_t size)
+{
+	return memalign(alignment, size);
+}
+
+int
+posix_memalign(void   **memptr,
+	       size_t   alignment,
+	       size_t   size)
+{
+	void *p = memalign(alignment, size);
+
+	if (!p)
+		return ENOMEM;
+	*memptr = p;
+
+	return 0;
+}
+
+void
+free(void *ptr)
+{
+	if (ptr && bench_counting)
+		bench_heap -= malloc_usable_size(ptr);
+	__libc_free(ptr);
+}
+#endif
+
+double
+bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
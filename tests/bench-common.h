@@ -0,0 +1,42 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * bench-common.h
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifndef __BENCH_COMMON_H__
+#define __BENCH_COMMON_H__
+
+#include <stdlib.h>
+#include <liblangtag/langtag.h>
+
+/* count the allocations by replacing malloc and friends. the sanitizers
+ * replace them by themselves.
+ */
+#if defined (__GLIBC__) && !defined (__SANITIZE_ADDRESS__) && !defined (__SANITIZE_THREAD__)
+#define BENCH_COUNT_ALLOCS	1
+#endif
+
+LT_BEGIN_DECLS
+
+/* the allocations are counted only while @bench_counting is set, so that
+ * the threads don't write the counters. @bench_heap is the live heap and
+ * is accurate only if it's set before anything is allocated.
+ */
+extern int  bench_counting;
+extern long bench_n_allocs;
+extern long bench_n_bytes;
+extern long bench_heap;
+extern long bench_heap_peak;
+
+double bench_now(void);
+
+LT_END_DECLS
+
+#endif /* __BENCH_COMMON_H__ */
@@ -0,0 +1,337 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * bench-db.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "langtag.h"
+#include "lt-xml.h"
+#include "bench-common.h"
+
+#define BENCH_RUNS	5
+
+typedef enum _bench_stage_t {
+	BENCH_COLD_XML_CLDR,
+	BENCH_COLD_XML_REGISTRY,
+	BENCH_COLD_LANG_DB,
+	BENCH_COLD_EXTLANG_DB,
+	BENCH_COLD_SCRIPT_DB,
+	BENCH_COLD_REGION_DB,
+	BENCH_COLD_VARIANT_DB,
+	BENCH_COLD_GRANDFATHERED_DB,
+	BENCH_COLD_REDUNDANT_DB,
+	BENCH_COLD_EXT_MODULES,
+	BENCH_COLD_TOTAL,
+	BENCH_COLD_INITIALIZE,
+	BENCH_WARM_INITIALIZE,
+	BENCH_WARM_FINALIZE,
+	BENCH_STAGE_END
+} bench_stage_t;
+
+typedef enum _bench_field_t {
+	BENCH_FIELD_MSEC,
+	BENCH_FIELD_ALLOCS,
+	BENCH_FIELD_HEAP,
+	BENCH_FIELD_HEAP_PEAK,
+	BENCH_FIELD_MINFLT,
+	BENCH_FIELD_MAJFLT,
+	BENCH_FIELD_RSS,
+	BENCH_FIELD_END
+} bench_field_t;
+
+typedef struct _bench_stat_t {
+	double values[BENCH_FIELD_END];
+} bench_stat_t;
+
+/* the snapshot at the beginning of the stage */
+typedef struct _bench_mark_t {
+	double start;
+	long   allocs;
+	long   heap;
+	long   minflt;
+	long   majflt;
+	long   rss;
+} bench_mark_t;
+
+static const char *stages[] = {
+	"cold/xml_cldr",
+	"cold/xml_registry",
+	"cold/lang_db",
+	"cold/extlang_db",
+	"cold/script_db",
+	"cold/region_db",
+	"cold/variant_db",
+	"cold/grandfathered_db",
+	"cold/redundant_db",
+	"cold/ext_modules",
+	"cold/total",
+	"cold/lt_db_initialize",
+	"warm/lt_db_initialize",
+	"warm/lt_db_finalize"
+};
+
+/*< private >*/
+/* in KiB */
+static long
+bench_get_rss(void)
+{
+	FILE *fp = fopen("/proc/self/statm", "r");
+	long size, resident = -1;
+
+	if (fp) {
+		if (fscanf(fp, "%ld %ld", &size, &resident) != 2)
+			resident = -1;
+		fclose(fp);
+	}
+	if (resident >= 0)
+		return resident * (sysconf(_SC_PAGESIZE) / 1024);
+
+	return -1;
+}
+
+static void
+bench_begin(bench_mark_t *mark)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	mark->minflt = ru.ru_minflt;
+	mark->majflt = ru.ru_majflt;
+	mark->rss = bench_get_rss();
+#ifdef BENCH_COUNT_ALLOCS
+	mark->allocs = bench_n_allocs;
+	mark->heap = bench_heap;
+	bench_heap_peak = bench_heap;
+#endif
+	mark->start = bench_now();
+}
+
+static void
+bench_end(bench_mark_t *mark,
+	  bench_stat_t *stat)
+{
+	double end = bench_now();
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	stat->values[BENCH_FIELD_MSEC] = (end - mark->start) * 1000;
+	stat->values[BENCH_FIELD_MINFLT] = ru.ru_minflt - mark->minflt;
+	stat->values[BENCH_FIELD_MAJFLT] = ru.ru_majflt - mark->majflt;
+	stat->values[BENCH_FIELD_RSS] = mark->rss < 0 ? 0 : bench_get_rss() - mark->rss;
+#ifdef BENCH_COUNT_ALLOCS
+	stat->values[BENCH_FIELD_ALLOCS] = bench_n_allocs - mark->allocs;
+	stat->values[BENCH_FIELD_HEAP] = bench_heap - mark->heap;
+	stat->values[BENCH_FIELD_HEAP_PEAK] = bench_heap_peak - mark->heap;
+#endif
+}
+
+#define STAGE(_s_,_e_)					\
+	bench_begin(&mark);				\
+	_e_;						\
+	bench_end(&mark, &stats[_s_]);
+
+/* run in a new process so that nothing has been loaded yet */
+static void
+bench_cold(bench_stat_t *stats)
+{
+	bench_mark_t mark, total;
+	lt_xml_t *xml = NULL;
+	double heap = 0, peak = 0;
+	int i;
+
+	bench_begin(&total);
+	STAGE (BENCH_COLD_XML_CLDR, xml = lt_xml_new());
+	STAGE (BENCH_COLD_XML_REGISTRY, lt_xml_get_subtag_registry(xml));
+	/* same order as lt_db_initialize() */
+	STAGE (BENCH_COLD_LANG_DB, lt_lang_db_unref(lt_db_get_lang()));
+	STAGE (BENCH_COLD_EXTLANG_DB, lt_extlang_db_unref(lt_db_get_extlang()));
+	STAGE (BENCH_COLD_SCRIPT_DB, lt_script_db_unref(lt_db_get_script()));
+	STAGE (BENCH_COLD_REGION_DB, lt_region_db_unref(lt_db_get_region()));
+	STAGE (BENCH_COLD_VARIANT_DB, lt_variant_db_unref(lt_db_get_variant()));
+	STAGE (BENCH_COLD_GRANDFATHERED_DB, lt_grandfathered_db_unref(lt_db_get_grandfathered()));
+	STAGE (BENCH_COLD_REDUNDANT_DB, lt_redundant_db_unref(lt_db_get_redundant()));
+	STAGE (BENCH_COLD_EXT_MODULES, lt_ext_modules_load());
+	lt_xml_unref(xml);
+	bench_end(&total, &stats[BENCH_COLD_TOTAL]);
+	/* the peak is reset at each stages */
+	for (i = 0; i < BENCH_COLD_TOTAL; i++) {
+		peak = LT_MAX (peak, heap + stats[i].values[BENCH_FIELD_HEAP_PEAK]);
+		heap += stats[i].values[BENCH_FIELD_HEAP];
+	}
+	stats[BENCH_COLD_TOTAL].values[BENCH_FIELD_HEAP_PEAK] = LT_MAX (peak, stats[BENCH_COLD_TOTAL].values[BENCH_FIELD_HEAP]);
+	lt_db_finalize();
+}
+
+/* run in another new process to see the whole lt_db_initialize() and
+ * then the one after the files are cached.
+ */
+static void
+bench_warm(bench_stat_t *stats)
+{
+	bench_mark_t mark;
+
+	STAGE (BENCH_COLD_INITIALIZE, lt_db_initialize());
+	lt_db_finalize();
+	STAGE (BENCH_WARM_INITIALIZE, lt_db_initialize());
+	STAGE (BENCH_WARM_FINALIZE, lt_db_finalize());
+}
+
+#undef STAGE
+
+static int
+bench_fork(void (* func) (bench_stat_t *),
+	   bench_stat_t  *stats)
+{
+	int fds[2], status;
+	pid_t pid;
+	ssize_t n = 0, r;
+
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return 0;
+	}
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 0;
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		memset(stats, 0, sizeof (bench_stat_t) * BENCH_STAGE_END);
+		func(stats);
+		if (write(fds[1], stats, sizeof (bench_stat_t) * BENCH_STAGE_END) < 0)
+			_exit(1);
+		_exit(0);
+	}
+	close(fds[1]);
+	while (n < sizeof (bench_stat_t) * BENCH_STAGE_END) {
+		r = read(fds[0], (char *)stats + n, sizeof (bench_stat_t) * BENCH_STAGE_END - n);
+		if (r <= 0)
+			break;
+		n += r;
+	}
+	close(fds[0]);
+	waitpid(pid, &status, 0);
+
+	return n == sizeof (bench_stat_t) * BENCH_STAGE_END &&
+		WIFEXITED (status) && WEXITSTATUS (status) == 0;
+}
+
+static int
+bench_compare(const void *v1,
+	      const void *v2)
+{
+	double d1 = *(const double *)v1, d2 = *(const double *)v2;
+
+	return d1 < d2 ? -1 : d1 > d2 ? 1 : 0;
+}
+
+static void
+bench_usage(const char *prog)
+{
+	printf("Usage: %s [-d <directory>] [-n <runs>]\n"
+	       "\n"
+	       "Measure the time and the memory to load the database in the new\n"
+	       "processes and write the median of the runs as the tab-separated values:\n"
+	       "  stage, ms, allocations, heap bytes, peak heap bytes, minor faults,\n"
+	       "  major faults, RSS KiB\n"
+	       "the heap is the difference from the beginning of the stage. the files\n"
+	       "may be in the page cache already even for the cold stages.\n"
+	       "\n"
+	       "Options:\n"
+	       "  -d <directory>  the directory of the language subtag registry\n"
+	       "  -n <runs>       the number of the runs [default: %d]\n",
+	       prog, BENCH_RUNS);
+}
+
+/*< public >*/
+int
+main(int    argc,
+     char **argv)
+{
+	bench_stat_t *stats;
+	double *values;
+	int i, j, k, n_runs = BENCH_RUNS;
+
+	/* keep track of the live heap from the beginning */
+	bench_counting = 1;
+	setenv("LANGTAG_EXT_MODULE_PATH", TEST_MODDIR, TRUE);
+	lt_db_set_datadir(TEST_DATADIR);
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			lt_db_set_datadir(argv[++i]);
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			n_runs = atoi(argv[++i]);
+			if (n_runs < 1)
+				n_runs = 1;
+		} else {
+			bench_usage(argv[0]);
+			return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+		}
+	}
+	stats = calloc(n_runs * 2, sizeof (bench_stat_t) * BENCH_STAGE_END);
+	values = calloc(n_runs, sizeof (double));
+	if (!stats || !values) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < n_runs; i++) {
+		bench_stat_t *cold = &stats[i * 2 * BENCH_STAGE_END];
+		bench_stat_t *warm = &stats[(i * 2 + 1) * BENCH_STAGE_END];
+
+		if (!bench_fork(bench_cold, cold) ||
+		    !bench_fork(bench_warm, warm)) {
+			fprintf(stderr, "Unable to run the benchmark\n");
+			return 1;
+		}
+		memcpy(&cold[BENCH_COLD_INITIALIZE], &warm[BENCH_COLD_INITIALIZE],
+		       sizeof (bench_stat_t) * (BENCH_STAGE_END - BENCH_COLD_INITIALIZE));
+	}
+
+	printf("# %s %s datadir=%s runs=%d\n",
+	       PACKAGE_NAME, PACKAGE_VERSION, lt_db_get_datadir(), n_runs);
+	printf("# stage\tms\tallocs\theap\theap_peak\tminflt\tmajflt\trss_kb\n");
+	for (j = 0; j < BENCH_STAGE_END; j++) {
+		printf("%s", stages[j]);
+		for (k = 0; k < BENCH_FIELD_END; k++) {
+			for (i = 0; i < n_runs; i++)
+				values[i] = stats[i * 2 * BENCH_STAGE_END + j].values[k];
+			qsort(values, n_runs, sizeof (double), bench_compare);
+#ifndef BENCH_COUNT_ALLOCS
+			if (k == BENCH_FIELD_ALLOCS ||
+			    k == BENCH_FIELD_HEAP ||
+			    k == BENCH_FIELD_HEAP_PEAK) {
+				printf("\t-");
+				continue;
+			}
+#endif
+			if (k == BENCH_FIELD_MSEC)
+				printf("\t%.3f", values[n_runs / 2]);
+			else
+				printf("\t%.0f", values[n_runs / 2]);
+		}
+		printf("\n");
+	}
+	free(values);
+	free(stats);
+
+	return 0;
+}
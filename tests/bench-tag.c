@@ -0,0 +1,519 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * bench-tag.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "langtag.h"
+#include "lt-utils.h"
+#include "bench-common.h"
+
+#define BENCH_MIN_TIME	0.5
+#define BENCH_RANGE	"en-*"
+#define BENCH_PATTERN	"*-JP"
+
+typedef enum _bench_set_t {
+	BENCH_SET_STRINGS,
+	BENCH_SET_TAGS,
+	BENCH_SET_LOCALES,
+	BENCH_SET_LANGS,
+	BENCH_SET_SCRIPTS,
+	BENCH_SET_REGIONS,
+	BENCH_SET_VARIANTS,
+	BENCH_SET_END
+} bench_set_t;
+
+typedef struct _bench_t {
+	lt_tag_span_t         *sets[BENCH_SET_END];
+	size_t                 n_sets[BENCH_SET_END];
+	lt_tag_t             **tags;
+	lt_tag_t              *tag;
+	lt_tag_t              *arena_tag;
+	lt_lang_db_t          *langdb;
+	lt_script_db_t        *scriptdb;
+	lt_region_db_t        *regiondb;
+	lt_variant_db_t       *variantdb;
+	lt_grandfathered_db_t *grandfathereddb;
+} bench_t;
+
+typedef void (* bench_func_t) (bench_t *bench,
+			       size_t   i);
+
+typedef struct _bench_case_t {
+	const char   *name;
+	bench_set_t   set;
+	bench_func_t  func;
+} bench_case_t;
+
+static const char *locales[] = {
+	"C", "POSIX", "en_US", "en_US.UTF-8", "en_GB.ISO-8859-1", "de_DE@euro",
+	"ja_JP.eucJP", "ja_JP.UTF-8", "zh_CN.GB18030", "zh_TW.Big5",
+	"sr_RS@latin", "ca_ES@valencia", "uz_UZ@cyrillic", "pt_BR", "es_419",
+	NULL
+};
+
+
+/*< private >*/
+static void
+bench_parse(bench_t *bench,
+	    size_t   i)
+{
+	lt_error_t *err = NULL;
+
+	lt_tag_parse_len(bench->tag,
+			 bench->sets[BENCH_SET_STRINGS][i].string,
+			 bench->sets[BENCH_SET_STRINGS][i].length,
+			 &err);
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_parse_arena(bench_t *bench,
+		  size_t   i)
+{
+	lt_error_t *err = NULL;
+
+	lt_tag_parse_len(bench->arena_tag,
+			 bench->sets[BENCH_SET_STRINGS][i].string,
+			 bench->sets[BENCH_SET_STRINGS][i].length,
+			 &err);
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_is_valid(bench_t *bench,
+	       size_t   i)
+{
+	lt_tag_is_valid(bench->sets[BENCH_SET_STRINGS][i].string,
+			bench->sets[BENCH_SET_STRINGS][i].length,
+			0, NULL);
+}
+
+static void
+bench_canonicalize(bench_t *bench,
+		   size_t   i)
+{
+	lt_error_t *err = NULL;
+
+	free(lt_tag_canonicalize(bench->tags[i], &err));
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_transform(bench_t *bench,
+		size_t   i)
+{
+	lt_error_t *err = NULL;
+	lt_tag_t *t = lt_tag_transform(bench->tags[i], &err);
+
+	if (t)
+		lt_tag_unref(t);
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_match(bench_t *bench,
+	    size_t   i)
+{
+	lt_error_t *err = NULL;
+
+	lt_tag_match(bench->tags[i], BENCH_RANGE, &err);
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_lookup(bench_t *bench,
+	     size_t   i)
+{
+	lt_error_t *err = NULL;
+
+	free(lt_tag_lookup(bench->tags[i], BENCH_PATTERN, &err));
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_to_locale(bench_t *bench,
+		size_t   i)
+{
+	lt_error_t *err = NULL;
+
+	free(lt_tag_convert_to_locale(bench->tags[i], &err));
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_from_locale(bench_t *bench,
+		  size_t   i)
+{
+	lt_error_t *err = NULL;
+	lt_tag_t *t = lt_tag_convert_from_locale_string(bench->sets[BENCH_SET_LOCALES][i].string,
+							&err);
+
+	if (t)
+		lt_tag_unref(t);
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_lang_db_lookup(bench_t *bench,
+		     size_t   i)
+{
+	lt_lang_unref(lt_lang_db_lookup_len(bench->langdb,
+					    bench->sets[BENCH_SET_LANGS][i].string,
+					    bench->sets[BENCH_SET_LANGS][i].length));
+}
+
+static void
+bench_script_db_lookup(bench_t *bench,
+		       size_t   i)
+{
+	lt_script_unref(lt_script_db_lookup_len(bench->scriptdb,
+						bench->sets[BENCH_SET_SCRIPTS][i].string,
+						bench->sets[BENCH_SET_SCRIPTS][i].length));
+}
+
+static void
+bench_region_db_lookup(bench_t *bench,
+		       size_t   i)
+{
+	lt_region_unref(lt_region_db_lookup_len(bench->regiondb,
+						bench->sets[BENCH_SET_REGIONS][i].string,
+						bench->sets[BENCH_SET_REGIONS][i].length));
+}
+
+static void
+bench_variant_db_lookup(bench_t *bench,
+			size_t   i)
+{
+	lt_variant_unref(lt_variant_db_lookup_len(bench->variantdb,
+						  bench->sets[BENCH_SET_VARIANTS][i].string,
+						  bench->sets[BENCH_SET_VARIANTS][i].length));
+}
+
+static void
+bench_grandfathered_db_lookup(bench_t *bench,
+			      size_t   i)
+{
+	lt_grandfathered_unref(lt_grandfathered_db_lookup_len(bench->grandfathereddb,
+							      bench->sets[BENCH_SET_STRINGS][i].string,
+							      bench->sets[BENCH_SET_STRINGS][i].length));
+}
+
+static const bench_case_t cases[] = {
+	{ "is_valid", BENCH_SET_STRINGS, bench_is_valid },
+	{ "parse", BENCH_SET_STRINGS, bench_parse },
+	{ "parse_arena", BENCH_SET_STRINGS, bench_parse_arena },
+	{ "canonicalize", BENCH_SET_TAGS, bench_canonicalize },
+	{ "transform", BENCH_SET_TAGS, bench_transform },
+	{ "match", BENCH_SET_TAGS, bench_match },
+	{ "lookup", BENCH_SET_TAGS, bench_lookup },
+	{ "to_locale", BENCH_SET_TAGS, bench_to_locale },
+	{ "from_locale", BENCH_SET_LOCALES, bench_from_locale },
+	{ "lang_db_lookup", BENCH_SET_LANGS, bench_lang_db_lookup },
+	{ "script_db_lookup", BENCH_SET_SCRIPTS, bench_script_db_lookup },
+	{ "region_db_lookup", BENCH_SET_REGIONS, bench_region_db_lookup },
+	{ "variant_db_lookup", BENCH_SET_VARIANTS, bench_variant_db_lookup },
+	{ "grandfathered_db_lookup", BENCH_SET_STRINGS, bench_grandfathered_db_lookup },
+	{ NULL, 0, NULL }
+};
+
+static void
+bench_add(bench_t     *bench,
+	  bench_set_t  set,
+	  const char  *string,
+	  size_t       length)
+{
+	bench->sets[set][bench->n_sets[set]].string = string;
+	bench->sets[set][bench->n_sets[set]].length = length;
+	bench->n_sets[set]++;
+}
+
+static int
+bench_is_alpha(const char *s,
+	       size_t      length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		if (!isalpha((unsigned char)s[i]))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* split the tag into the subtags and classify them by the shape so that
+ * the database lookups see both the hits and the misses in the corpus.
+ */
+static void
+bench_add_subtags(bench_t    *bench,
+		  const char *string,
+		  size_t      length)
+{
+	const char *p = string, *end = string + length, *e;
+	size_t len;
+	int first = 1;
+
+	for (; p < end; p = e + 1, first = 0) {
+		e = memchr(p, '-', end - p);
+		if (!e)
+			e = end;
+		len = e - p;
+		/* stop at the extensions and the privateuse */
+		if (len == 1)
+			break;
+		if (first && len >= 2 && len <= 3 && bench_is_alpha(p, len))
+			bench_add(bench, BENCH_SET_LANGS, p, len);
+		else if (len == 4 && bench_is_alpha(p, len))
+			bench_add(bench, BENCH_SET_SCRIPTS, p, len);
+		else if ((len == 2 && bench_is_alpha(p, len)) ||
+			 (len == 3 && isdigit((unsigned char)p[0])))
+			bench_add(bench, BENCH_SET_REGIONS, p, len);
+		else if (len >= 4)
+			bench_add(bench, BENCH_SET_VARIANTS, p, len);
+		if (e == end)
+			break;
+	}
+}
+
+static char *
+bench_load(bench_t    *bench,
+	   const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	char *data = NULL, *p, *e;
+	size_t size = 0, n = 0, len;
+	lt_error_t *err = NULL;
+	int i;
+
+	if (!fp) {
+		perror(filename);
+		return NULL;
+	}
+	while (!feof(fp)) {
+		if (n + 1 >= size) {
+			size = size ? size * 2 : 4096;
+			data = realloc(data, size);
+			if (!data)
+				goto oom;
+		}
+		n += fread(data + n, 1, size - n - 1, fp);
+		if (ferror(fp)) {
+			perror(filename);
+			fclose(fp);
+			free(data);
+			return NULL;
+		}
+	}
+	fclose(fp);
+	fp = NULL;
+	data[n] = 0;
+
+	/* every subtag is shorter than the tag itself */
+	for (i = 0; i < BENCH_SET_END; i++) {
+		bench->sets[i] = malloc(sizeof (lt_tag_span_t) * (n + sizeof (locales) / sizeof (locales[0])));
+		if (!bench->sets[i])
+			goto oom;
+	}
+	bench->tags = malloc(sizeof (lt_tag_t *) * (n + 1));
+	if (!bench->tags)
+		goto oom;
+	for (p = data; p < data + n; p = e + 1) {
+		e = memchr(p, '\n', data + n - p);
+		if (!e)
+			e = data + n;
+		len = e - p;
+		while (len > 0 && isspace((unsigned char)p[len - 1]))
+			len--;
+		if (len > 0 && p[0] != '#') {
+			lt_tag_t *t = lt_tag_new();
+
+			p[len] = 0;
+			bench_add(bench, BENCH_SET_STRINGS, p, len);
+			bench_add_subtags(bench, p, len);
+			/* the grandfathered and privateuse-only tags can't be
+			 * converted nor compared.
+			 */
+			if (lt_tag_parse_len(t, p, len, &err) &&
+			    !lt_tag_get_grandfathered(t) &&
+			    lt_tag_get_language(t))
+				bench->tags[bench->n_sets[BENCH_SET_TAGS]++] = lt_tag_ref(t);
+			lt_tag_unref(t);
+			if (err) {
+				lt_error_unref(err);
+				err = NULL;
+			}
+		}
+	}
+	for (i = 0; locales[i] != NULL; i++)
+		bench_add(bench, BENCH_SET_LOCALES, locales[i], strlen(locales[i]));
+
+	return data;
+  oom:
+	fprintf(stderr, "Out of memory\n");
+	if (fp)
+		fclose(fp);
+	free(data);
+
+	return NULL;
+}
+
+static void
+bench_run(bench_t            *bench,
+	  const bench_case_t *c,
+	  double              min_time)
+{
+	size_t i, n = bench->n_sets[c->set], iterations = 0;
+	size_t n_allocs = 0, n_bytes = 0;
+	double start, elapsed;
+
+	if (n == 0)
+		return;
+	/* warm up the caches and load the modules lazily loaded */
+	for (i = 0; i < n; i++)
+		c->func(bench, i);
+#ifdef BENCH_COUNT_ALLOCS
+	bench_n_allocs = bench_n_bytes = 0;
+	bench_counting = 1;
+#endif
+	start = bench_now();
+	do {
+		for (i = 0; i < n; i++)
+			c->func(bench, i);
+		iterations += n;
+		elapsed = bench_now() - start;
+	} while (elapsed < min_time);
+#ifdef BENCH_COUNT_ALLOCS
+	bench_counting = 0;
+	n_allocs = bench_n_allocs;
+	n_bytes = bench_n_bytes;
+#endif
+	printf("%s\t%lu\t%.1f", c->name, (unsigned long)iterations,
+	       elapsed * 1e9 / iterations);
+#ifdef BENCH_COUNT_ALLOCS
+	printf("\t%.2f\t%.1f\n",
+	       (double)n_allocs / iterations,
+	       (double)n_bytes / iterations);
+#else
+	(void)n_allocs;
+	(void)n_bytes;
+	printf("\t-\t-\n");
+#endif
+	fflush(stdout);
+}
+
+static void
+bench_usage(const char *prog)
+{
+	int i;
+
+	printf("Usage: %s [-t <seconds>] <corpus> [<benchmark>...]\n"
+	       "\n"
+	       "Run the benchmarks over the tags in <corpus> and write the results\n"
+	       "as the tab-separated values:\n"
+	       "  name, iterations, ns/op, allocations/op, bytes/op\n"
+	       "\n"
+	       "Options:\n"
+	       "  -t <seconds>    the minimum time to run each benchmark [default: %.1f]\n"
+	       "\n"
+	       "Benchmarks:\n",
+	       prog, BENCH_MIN_TIME);
+	for (i = 0; cases[i].name != NULL; i++)
+		printf("  %s\n", cases[i].name);
+}
+
+/*< public >*/
+int
+main(int    argc,
+     char **argv)
+{
+	bench_t bench;
+	double min_time = BENCH_MIN_TIME;
+	const char *filename;
+	char *data;
+	int i, j, k;
+
+	memset(&bench, 0, sizeof (bench_t));
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			min_time = atof(argv[++i]);
+		} else {
+			bench_usage(argv[0]);
+			return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+		}
+	}
+	if (i >= argc) {
+		bench_usage(argv[0]);
+		return 1;
+	}
+	filename = argv[i++];
+
+	setenv("LANGTAG_EXT_MODULE_PATH", TEST_MODDIR, TRUE);
+	lt_db_set_datadir(TEST_DATADIR);
+	lt_db_initialize();
+	bench.tag = lt_tag_new();
+	bench.arena_tag = lt_tag_new_with_arena(NULL, 0);
+	bench.langdb = lt_db_get_lang();
+	bench.scriptdb = lt_db_get_script();
+	bench.regiondb = lt_db_get_region();
+	bench.variantdb = lt_db_get_variant();
+	bench.grandfathereddb = lt_db_get_grandfathered();
+	data = bench_load(&bench, filename);
+	if (!data)
+		return 1;
+
+	printf("# %s %s corpus=%s tags=%lu min_time=%.2f\n",
+	       PACKAGE_NAME, PACKAGE_VERSION, filename,
+	       (unsigned long)bench.n_sets[BENCH_SET_STRINGS], min_time);
+	printf("# name\titerations\tns/op\tallocs/op\tbytes/op\n");
+	for (j = 0; cases[j].name != NULL; j++) {
+		if (i < argc) {
+			for (k = i; k < argc; k++) {
+				if (strcmp(argv[k], cases[j].name) == 0)
+					break;
+			}
+			if (k == argc)
+				continue;
+		}
+		bench_run(&bench, &cases[j], min_time);
+	}
+
+	for (j = 0; j < bench.n_sets[BENCH_SET_TAGS]; j++)
+		lt_tag_unref(bench.tags[j]);
+	free(bench.tags);
+	for (j = 0; j < BENCH_SET_END; j++)
+		free(bench.sets[j]);
+	free(data);
+	lt_grandfathered_db_unref(bench.grandfathereddb);
+	lt_variant_db_unref(bench.variantdb);
+	lt_region_db_unref(bench.regiondb);
+	lt_script_db_unref(bench.scriptdb);
+	lt_lang_db_unref(bench.langdb);
+	lt_tag_unref(bench.arena_tag);
+	lt_tag_unref(bench.tag);
+	lt_db_finalize();
+
+	return 0;
+}
@@ -0,0 +1,429 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * bench-threads.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "langtag.h"
+#include "lt-atomic.h"
+#include "lt-lock.h"
+#include "bench-common.h"
+
+#define BENCH_DURATION	0.2
+#define BENCH_THREADS	"1,2,4,8,16,32,64"
+#define BENCH_MAX_THREADS	1024
+
+typedef enum _bench_op_t {
+	BENCH_OP_PARSE,
+	BENCH_OP_CANONICALIZE,
+	BENCH_OP_U_EXTENSION,
+	BENCH_OP_END
+} bench_op_t;
+
+typedef struct _bench_t {
+	char              **strings;
+	size_t              n_strings;
+	char              **extensions;
+	size_t              n_extensions;
+	bench_op_t          op;
+	int                 verbose;
+	volatile int        stop;
+	int                 n_ready;
+	int                 go;
+#if HAVE_PTHREAD
+	pthread_mutex_t     lock;
+	pthread_cond_t      cond;
+#endif
+} bench_t;
+
+typedef struct _bench_thread_t {
+	bench_t            *bench;
+	unsigned int        id;
+	unsigned long long  n_ops;
+	double              elapsed;
+#if HAVE_PTHREAD
+	pthread_t           thread;
+#endif
+} bench_thread_t;
+
+static const char *ops[] = {
+	"parse",
+	"canonicalize",
+	"u_extension"
+};
+
+/*< private >*/
+#if HAVE_PTHREAD
+static void
+bench_parse(lt_tag_t   *tag,
+	    const char *string)
+{
+	lt_error_t *err = NULL;
+
+	lt_tag_parse(tag, string, &err);
+	if (err)
+		lt_error_unref(err);
+}
+
+static void
+bench_canonicalize(lt_tag_t *tag)
+{
+	lt_error_t *err = NULL;
+
+	free(lt_tag_canonicalize(tag, &err));
+	if (err)
+		lt_error_unref(err);
+}
+
+static void *
+bench_worker(void *data)
+{
+	bench_thread_t *thread = data;
+	bench_t *bench = thread->bench;
+	lt_tag_t *tag = lt_tag_new(), **tags = NULL;
+	char **strings = bench->op == BENCH_OP_U_EXTENSION ? bench->extensions : bench->strings;
+	size_t i, n = bench->op == BENCH_OP_U_EXTENSION ? bench->n_extensions : bench->n_strings;
+	size_t n_tags = 0;
+	double start;
+
+	/* every thread has its own tags. only the databases are shared. */
+	if (bench->op == BENCH_OP_CANONICALIZE) {
+		tags = malloc(sizeof (lt_tag_t *) * n);
+		for (i = 0; tags && i < n; i++) {
+			lt_tag_t *t = lt_tag_new();
+			lt_error_t *err = NULL;
+
+			if (lt_tag_parse(t, strings[i], &err))
+				tags[n_tags++] = t;
+			else
+				lt_tag_unref(t);
+			if (err)
+				lt_error_unref(err);
+		}
+	}
+
+	pthread_mutex_lock(&bench->lock);
+	bench->n_ready++;
+	pthread_cond_broadcast(&bench->cond);
+	while (!bench->go)
+		pthread_cond_wait(&bench->cond, &bench->lock);
+	pthread_mutex_unlock(&bench->lock);
+
+	start = bench_now();
+	/* start at the different tags so that the threads don't run in
+	 * lockstep.
+	 */
+	i = thread->id;
+	while (!lt_atomic_int_get(&bench->stop)) {
+		switch (bench->op) {
+		    case BENCH_OP_PARSE:
+		    case BENCH_OP_U_EXTENSION:
+			    bench_parse(tag, strings[i % n]);
+			    break;
+		    case BENCH_OP_CANONICALIZE:
+			    if (n_tags > 0)
+				    bench_canonicalize(tags[i % n_tags]);
+			    break;
+		    default:
+			    break;
+		}
+		thread->n_ops++;
+		i++;
+	}
+	thread->elapsed = bench_now() - start;
+
+	for (i = 0; i < n_tags; i++)
+		lt_tag_unref(tags[i]);
+	free(tags);
+	lt_tag_unref(tag);
+
+	return NULL;
+}
+
+static void
+bench_print_lock(const lt_lock_stats_t *stats,
+		 lt_pointer_t           user_data)
+{
+	const char *prefix = user_data;
+
+	if (stats->n_locks == 0)
+		return;
+	printf("lock\t%s\t%s\t%s\t%llu\t%llu\t%llu\t%llu\n",
+	       prefix, stats->name, stats->file,
+	       stats->n_locks, stats->n_contended,
+	       stats->wait_ns, stats->hold_ns);
+}
+
+static void
+bench_probe_lock(const lt_lock_stats_t *stats,
+		 lt_pointer_t           user_data)
+{
+}
+
+static double
+bench_run(bench_t      *bench,
+	  unsigned int  n_threads,
+	  double        duration,
+	  double        base,
+	  int           lock_stats)
+{
+	bench_thread_t *threads = calloc(n_threads, sizeof (bench_thread_t));
+	struct timespec ts;
+	unsigned long long n_ops = 0;
+	double start, elapsed, min = 0, max = 0, retval;
+	unsigned int i, n = 0;
+	char prefix[64];
+
+	if (!threads) {
+		fprintf(stderr, "Out of memory\n");
+		return 0;
+	}
+	bench->stop = 0;
+	bench->n_ready = 0;
+	bench->go = 0;
+	for (i = 0; i < n_threads; i++) {
+		threads[i].bench = bench;
+		threads[i].id = i;
+		if (pthread_create(&threads[i].thread, NULL, bench_worker, &threads[i]) != 0) {
+			fprintf(stderr, "Unable to create a thread\n");
+			break;
+		}
+		n++;
+	}
+	pthread_mutex_lock(&bench->lock);
+	while (bench->n_ready < n)
+		pthread_cond_wait(&bench->cond, &bench->lock);
+	lt_lock_stats_reset();
+	bench->go = 1;
+	start = bench_now();
+	pthread_cond_broadcast(&bench->cond);
+	pthread_mutex_unlock(&bench->lock);
+
+	ts.tv_sec = (time_t)duration;
+	ts.tv_nsec = (long)((duration - ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+	lt_atomic_int_inc(&bench->stop);
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i].thread, NULL);
+	elapsed = bench_now() - start;
+
+	snprintf(prefix, sizeof (prefix), "%s\t%u", ops[bench->op], n);
+	for (i = 0; i < n; i++) {
+		double v = threads[i].n_ops / threads[i].elapsed;
+
+		n_ops += threads[i].n_ops;
+		if (i == 0 || v < min)
+			min = v;
+		if (i == 0 || v > max)
+			max = v;
+		if (bench->verbose)
+			printf("thread\t%s\t%u\t%.0f\n", prefix, i, v);
+	}
+	retval = n_ops / elapsed;
+	printf("total\t%s\t%.0f\t%.2f\t%.0f\t%.0f\n",
+	       prefix, retval, base > 0 ? retval / base : 1.0, min, max);
+	if (lock_stats)
+		lt_lock_stats_foreach(bench_print_lock, prefix);
+	fflush(stdout);
+	free(threads);
+
+	return retval;
+}
+#endif
+
+static char *
+bench_load(bench_t    *bench,
+	   const char *filename)
+{
+	FILE *fp = fopen(filename, "rb");
+	char *data = NULL, *p, *e, *end;
+	size_t size = 0, n = 0, len;
+
+	if (!fp) {
+		perror(filename);
+		return NULL;
+	}
+	while (!feof(fp) && !ferror(fp)) {
+		if (n + 1 >= size) {
+			size = size ? size * 2 : 4096;
+			p = realloc(data, size);
+			if (!p)
+				goto bail;
+			data = p;
+		}
+		n += fread(data + n, 1, size - n - 1, fp);
+	}
+	if (ferror(fp) || !data)
+		goto bail;
+	fclose(fp);
+	data[n] = 0;
+	bench->strings = malloc(sizeof (char *) * (n + 1));
+	bench->extensions = malloc(sizeof (char *) * (n + 1));
+	if (!bench->strings || !bench->extensions) {
+		free(data);
+		return NULL;
+	}
+	end = data + n;
+	for (p = data; p < end; p = e + 1) {
+		e = memchr(p, '\n', end - p);
+		if (!e)
+			e = end;
+		len = e - p;
+		while (len > 0 && isspace((unsigned char)p[len - 1]))
+			len--;
+		if (len == 0 || p[0] == '#')
+			continue;
+		p[len] = 0;
+		bench->strings[bench->n_strings++] = p;
+		if (strstr(p, "-u-"))
+			bench->extensions[bench->n_extensions++] = p;
+	}
+
+	return data;
+  bail:
+	perror(filename);
+	fclose(fp);
+	free(data);
+
+	return NULL;
+}
+
+static void
+bench_usage(const char *prog)
+{
+	printf("Usage: %s [options] <corpus> [<operation>...]\n"
+	       "\n"
+	       "Run the operations over the tags in <corpus> on the threads sharing\n"
+	       "the databases and write the throughput as the tab-separated values:\n"
+	       "  total, operation, threads, ops/s, speedup, per-thread min ops/s,\n"
+	       "  per-thread max ops/s\n"
+	       "  thread, operation, threads, id, ops/s (with -v)\n"
+	       "  lock, operation, threads, name, file, locks, contended, wait ns,\n"
+	       "  hold ns (with -l)\n"
+	       "\n"
+	       "Operations:\n"
+	       "  parse, canonicalize, u_extension (parsing the tags with -u- only)\n"
+	       "\n"
+	       "Options:\n"
+	       "  -j <list>       the comma-separated numbers of the threads [default: %s]\n"
+	       "  -t <seconds>    the duration of each run [default: %.1f]\n"
+	       "  -l              record the time to wait for and to hold the locks.\n"
+	       "                  this requires --enable-lock-stats\n"
+	       "  -v              write the throughput of each thread as well\n",
+	       prog, BENCH_THREADS, BENCH_DURATION);
+}
+
+/*< public >*/
+int
+main(int    argc,
+     char **argv)
+{
+	bench_t bench;
+	const char *threads = BENCH_THREADS, *filename, *p;
+	double duration = BENCH_DURATION, base;
+	char *data, *e;
+	int i, j, k, lock_stats = 0;
+	unsigned long n_threads;
+
+	memset(&bench, 0, sizeof (bench_t));
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = argv[++i];
+		} else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			duration = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-l") == 0) {
+			lock_stats = 1;
+		} else if (strcmp(argv[i], "-v") == 0) {
+			bench.verbose = 1;
+		} else {
+			bench_usage(argv[0]);
+			return strcmp(argv[i], "-h") == 0 ? 0 : 1;
+		}
+	}
+	if (i >= argc) {
+		bench_usage(argv[0]);
+		return 1;
+	}
+	filename = argv[i++];
+#if HAVE_PTHREAD
+	setenv("LANGTAG_EXT_MODULE_PATH", TEST_MODDIR, TRUE);
+	lt_db_set_datadir(TEST_DATADIR);
+	lt_db_initialize();
+	data = bench_load(&bench, filename);
+	if (!data)
+		return 1;
+	if (lock_stats && !lt_lock_stats_foreach(bench_probe_lock, NULL)) {
+		fprintf(stderr, "Lock statistics aren't available. configure with --enable-lock-stats\n");
+		lock_stats = 0;
+	}
+	pthread_mutex_init(&bench.lock, NULL);
+	pthread_cond_init(&bench.cond, NULL);
+
+	printf("# %s %s corpus=%s tags=%lu extensions=%lu duration=%.2f\n",
+	       PACKAGE_NAME, PACKAGE_VERSION, filename,
+	       (unsigned long)bench.n_strings,
+	       (unsigned long)bench.n_extensions, duration);
+	printf("# total\top\tthreads\tops/s\tspeedup\tthread_min\tthread_max\n");
+	if (bench.verbose)
+		printf("# thread\top\tthreads\tid\tops/s\n");
+	if (lock_stats)
+		printf("# lock\top\tthreads\tname\tfile\tlocks\tcontended\twait_ns\thold_ns\n");
+	for (j = 0; j < BENCH_OP_END; j++) {
+		if (i < argc) {
+			for (k = i; k < argc; k++) {
+				if (strcmp(argv[k], ops[j]) == 0)
+					break;
+			}
+			if (k == argc)
+				continue;
+		}
+		bench.op = j;
+		base = 0;
+		for (p = threads; *p; p = *e ? e + 1 : e) {
+			n_threads = strtoul(p, &e, 10);
+			if (e == p || (*e && *e != ',')) {
+				fprintf(stderr, "Invalid list of the threads: %s\n", threads);
+				return 1;
+			}
+			if (n_threads == 0 || n_threads > BENCH_MAX_THREADS)
+				continue;
+			/* the speedup is relative to the first run */
+			if (base == 0)
+				base = bench_run(&bench, n_threads, duration, 0, lock_stats);
+			else
+				bench_run(&bench, n_threads, duration, base, lock_stats);
+		}
+	}
+
+	pthread_cond_destroy(&bench.cond);
+	pthread_mutex_destroy(&bench.lock);
+	free(bench.extensions);
+	free(bench.strings);
+	free(data);
+	lt_db_finalize();
+
+	return 0;
+#else
+	fprintf(stderr, "This benchmark requires pthread\n");
+
+	return 1;
+#endif
+}
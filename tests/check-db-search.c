@@ -0,0 +1,118 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * check-db-search.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <liblangtag/langtag.h>
+#include "main.h"
+
+/************************************************************/
+/* common functions                                         */
+/************************************************************/
+void
+setup(void)
+{
+	lt_db_set_datadir(TEST_DATADIR);
+	lt_db_initialize();
+}
+
+void
+teardown(void)
+{
+	lt_db_finalize();
+}
+
+/************************************************************/
+/* Test cases                                               */
+/************************************************************/
+TDEF (lt_db_search_description) {
+	lt_db_search_result_t *results;
+	size_t n;
+
+	n = lt_db_search_description("JAPANESE", LT_DB_SEARCH_ALL, 10, &results);
+	fail_unless(n > 0, "No entries found");
+	fail_unless(results[0].kind == LT_DB_SEARCH_LANG, "Unexpected kind: %d", results[0].kind);
+	fail_unless(strcmp(results[0].subtag, "ja") == 0, "Unexpected entry: %s", results[0].subtag);
+	fail_unless(strcmp(lt_lang_get_name(results[0].entry), "Japanese") == 0, "Unexpected name");
+	fail_unless(results[n].entry == NULL, "Not terminated");
+	lt_db_search_results_free(results);
+
+	/* the last word can be the prefix */
+	n = lt_db_search_description("han simp", LT_DB_SEARCH_ALL, 10, &results);
+	fail_unless(n == 1, "Unexpected number of the entries: %d", (int)n);
+	fail_unless(results[0].kind == LT_DB_SEARCH_SCRIPT, "Unexpected kind: %d", results[0].kind);
+	fail_unless(strcmp(results[0].subtag, "Hans") == 0, "Unexpected entry: %s", results[0].subtag);
+	lt_db_search_results_free(results);
+
+	n = lt_db_search_description("simp han", LT_DB_SEARCH_ALL, 10, &results);
+	fail_unless(n == 0, "The words other than the last have to be whole: %d", (int)n);
+
+	n = lt_db_search_description("xyzzy", LT_DB_SEARCH_ALL, 10, &results);
+	fail_unless(n == 0 && results == NULL, "No entries expected");
+} TEND
+
+TDEF (lt_db_search_description_rank) {
+	lt_db_search_result_t *results;
+	size_t n, i;
+
+	n = lt_db_search_description("hebrew", LT_DB_SEARCH_ALL, 10, &results);
+	fail_unless(n == 3, "Unexpected number of the entries: %d", (int)n);
+	for (i = 1; i < n; i++)
+		fail_unless(results[i - 1].score >= results[i].score, "Not ranked");
+	fail_unless(results[2].kind == LT_DB_SEARCH_SCRIPT, "Unexpected kind: %d", results[2].kind);
+	lt_db_search_results_free(results);
+
+	n = lt_db_search_description("hebrew", LT_DB_SEARCH_SCRIPT, 10, &results);
+	fail_unless(n == 1, "Unexpected number of the entries: %d", (int)n);
+	fail_unless(strcmp(results[0].subtag, "Hebr") == 0, "Unexpected entry: %s", results[0].subtag);
+	lt_db_search_results_free(results);
+
+	n = lt_db_search_description("private", LT_DB_SEARCH_LANG, 5, &results);
+	fail_unless(n == 5, "Not bounded: %d", (int)n);
+	lt_db_search_results_free(results);
+} TEND
+
+TDEF (lt_db_reload) {
+	lt_db_search_result_t *results;
+	size_t n;
+
+	n = lt_db_search_description("japanese", LT_DB_SEARCH_LANG, 10, &results);
+	fail_unless(n == 1, "Unexpected number of the entries: %d", (int)n);
+	/* the entries are still valid after the database is replaced */
+	fail_unless(lt_db_reload(), "Unable to reload");
+	fail_unless(strcmp(lt_lang_get_name(results[0].entry), "Japanese") == 0, "Unexpected name");
+	lt_db_search_results_free(results);
+	n = lt_db_search_description("japanese", LT_DB_SEARCH_LANG, 10, &results);
+	fail_unless(n == 1, "Unexpected number of the entries after reloading: %d", (int)n);
+	lt_db_search_results_free(results);
+} TEND
+
+/************************************************************/
+Suite *
+tester_suite(void)
+{
+	Suite *s = suite_create("lt_db_search");
+	TCase *tc = tcase_create("Basic functionality");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+
+	T (lt_db_search_description);
+	T (lt_db_search_description_rank);
+	T (lt_db_reload);
+
+	suite_add_tcase(s, tc);
+
+	return s;
+}
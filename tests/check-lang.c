@@ -14,6 +14,7 @@
 #include "config.h"
 #endif
 
+#include <string.h>
 #include <liblangtag/langtag.h>
 #include "main.h"
 
@@ -58,6 +59,70 @@ TDEF (lt_lang_compare) {
 	lt_lang_unref(e1);
 } TEND
 
+TDEF (lt_lang_db_lookup_len) {
+	char key[128];
+	lt_lang_t *e1, *e2;
+
+	e1 = lt_lang_db_lookup(db, "ja");
+	fail_unless(e1 != NULL, "No expected lang found: 'ja'");
+	e2 = lt_lang_db_lookup_len(db, "JA-JP", 2);
+	fail_unless(e2 != NULL, "No expected lang found: 'JA'");
+	fail_unless(lt_lang_compare(e1, e2), "lang should be looked up with the given length only.");
+	lt_lang_unref(e2);
+	e2 = lt_lang_db_lookup_len(db, "ja", 1);
+	fail_unless(e2 == NULL, "No expected lang for 'j'");
+	/* longer than the key buffer */
+	memset(key, 'a', sizeof (key));
+	e2 = lt_lang_db_lookup_len(db, key, sizeof (key));
+	fail_unless(e2 == NULL, "No expected lang for the long key");
+	lt_lang_unref(e1);
+} TEND
+
+TDEF (lt_lang_db_export) {
+	lt_iter_entry_t *entries;
+	lt_lang_t *lang;
+	size_t n, i;
+
+	n = lt_lang_db_export(db, &entries);
+	fail_unless(n > 0, "No entries exported");
+	fail_unless(entries[n].key == NULL, "Not terminated");
+	for (i = 0; i < n; i++) {
+		lang = lt_lang_db_lookup(db, entries[i].key);
+		fail_unless(lang != NULL, "No entry for the exported key: %s", entries[i].key);
+		fail_unless(lt_lang_compare(lang, entries[i].value), "Unexpected entry for %s", entries[i].key);
+		lt_lang_unref(lang);
+		if (i > 0)
+			fail_unless(strcmp(entries[i - 1].key, entries[i].key) < 0, "Not sorted");
+	}
+	lt_iter_entries_free(entries);
+} TEND
+
+TDEF (lt_lang_db_complete) {
+	lt_iter_entry_t *entries;
+	size_t n, i;
+
+	n = lt_lang_db_complete(db, "J", 1000, &entries);
+	fail_unless(n > 0, "No entries completed");
+	fail_unless(strcmp(entries[0].key, "ja") == 0, "Unexpected first entry: %s", entries[0].key);
+	for (i = 0; i < n; i++) {
+		fail_unless(entries[i].key[0] == 'j', "Unexpected entry: %s", entries[i].key);
+		if (i > 0)
+			fail_unless(strcmp(entries[i - 1].key, entries[i].key) < 0, "Not sorted");
+	}
+	lt_iter_entries_free(entries);
+	n = lt_lang_db_complete(db, "", 2, &entries);
+	fail_unless(n == 2, "Not bounded: %d", (int)n);
+	fail_unless(entries[2].key == NULL, "Not terminated");
+	lt_iter_entries_free(entries);
+	n = lt_lang_db_complete(db, "jqqq", 10, &entries);
+	fail_unless(n == 0 && entries == NULL, "No entries expected");
+	/* the non-ASCII input from the keystrokes */
+	n = lt_lang_db_complete(db, "\xc3\xa9", 5, &entries);
+	fail_unless(n == 0 && entries == NULL, "No entries expected");
+	n = lt_lang_db_complete(db, "j\xff", 5, &entries);
+	fail_unless(n == 0 && entries == NULL, "No entries expected");
+} TEND
+
 /************************************************************/
 Suite *
 tester_suite(void)
@@ -68,6 +133,9 @@ tester_suite(void)
 	tcase_add_checked_fixture(tc, setup, teardown);
 
 	T (lt_lang_compare);
+	T (lt_lang_db_lookup_len);
+	T (lt_lang_db_export);
+	T (lt_lang_db_complete);
 
 	suite_add_tcase(s, tc);
 
@@ -15,13 +15,40 @@
 #endif
 
 #include <stdlib.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include <liblangtag/langtag.h>
 #include "liblangtag/lt-mem.h"
 #include "main.h"
 
+#define N_THREADS	4
+#define N_NODES		200
+
+static int values[N_NODES];
+
 /************************************************************/
 /* common functions                                         */
 /************************************************************/
+#if HAVE_PTHREAD
+static void *
+build_list(void *data)
+{
+	lt_list_t *l = NULL;
+	int i, j;
+
+	for (j = 0; j < 10; j++) {
+		lt_list_free(l);
+		l = NULL;
+		for (i = 0; i < N_NODES; i++)
+			l = lt_list_prepend(l, &values[N_NODES - i - 1], NULL);
+	}
+
+	/* the list is freed in another thread */
+	return l;
+}
+#endif
+
 void
 setup(void)
 {
@@ -77,6 +104,57 @@ TDEF (lt_list_append) {
 	lt_list_free(t);
 } TEND
 
+TDEF (lt_list_new_recycled) {
+	lt_list_t *l = NULL, *t;
+	lt_pointer_t p;
+	int i;
+
+	for (i = 0; i < 100; i++)
+		l = lt_list_prepend(l, strdup("foo"), free);
+	p = l;
+	lt_mem_add_weak_pointer((lt_mem_t *)l, &p);
+	lt_list_free(l);
+	fail_unless(p == NULL, "Not registered as a weak pointer properly");
+	/* the nodes may be recycled. they have to be initialized anyway */
+	for (i = 0; i < 100; i++) {
+		p = &i;
+		t = lt_list_new();
+		fail_unless(t != NULL, "Allocation failed");
+		fail_unless(lt_list_value(t) == NULL, "Not initialized");
+		fail_unless(lt_list_previous(t) == NULL, "Not initialized");
+		fail_unless(lt_list_next(t) == NULL, "Not initialized");
+		lt_list_unref(t);
+		fail_unless(p == &i, "The weak pointer is still registered");
+	}
+} TEND
+
+TDEF (lt_list_threads) {
+#if HAVE_PTHREAD
+	pthread_t threads[N_THREADS];
+	lt_list_t *l[N_THREADS], *t;
+	int i, j;
+
+	for (i = 0; i < N_THREADS; i++) {
+		fail_unless(pthread_create(&threads[i], NULL, build_list, NULL) == 0, "Unable to create a thread");
+	}
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], (void **)&l[i]);
+	/* the nodes kept in the threads exited have to be usable */
+	for (i = 0; i < N_THREADS; i++) {
+		for (t = l[i], j = 0; t != NULL; t = lt_list_next(t), j++)
+			fail_unless(lt_list_value(t) == &values[j], "Unexpected value");
+		fail_unless(j == N_NODES, "Unexpected length: %d", j);
+		lt_list_free(l[i]);
+	}
+	for (i = 0; i < N_THREADS * N_NODES; i++) {
+		t = lt_list_new();
+		fail_unless(t != NULL, "Allocation failed");
+		fail_unless(lt_list_value(t) == NULL, "Not initialized");
+		lt_list_unref(t);
+	}
+#endif
+} TEND
+
 /************************************************************/
 Suite *
 tester_suite(void)
@@ -89,6 +167,8 @@ tester_suite(void)
 	T (lt_list_new);
 	T (lt_list_unref);
 	T (lt_list_append);
+	T (lt_list_new_recycled);
+	T (lt_list_threads);
 
 	suite_add_tcase(s, tc);
 
@@ -0,0 +1,163 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * check-log.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <liblangtag/langtag.h>
+#include "lt-log-private.h"
+#include "lt-messages.h"
+#include "main.h"
+
+#define N_THREADS	4
+#define N_MESSAGES	1000
+
+typedef struct _log_result_t {
+	size_t         n_messages;
+	lt_log_level_t level;
+	char           message[LT_LOG_MESSAGE_SIZE];
+} log_result_t;
+
+/************************************************************/
+/* common functions                                         */
+/************************************************************/
+void
+setup(void)
+{
+	lt_log_set_deferred(TRUE);
+}
+
+void
+teardown(void)
+{
+	lt_log_set_deferred(FALSE);
+}
+
+static void
+log_func(lt_log_level_t  level,
+	 const char     *message,
+	 lt_pointer_t    user_data)
+{
+	log_result_t *result = user_data;
+
+	result->n_messages++;
+	result->level = level;
+	strncpy(result->message, message, LT_LOG_MESSAGE_SIZE - 1);
+}
+
+#if HAVE_PTHREAD
+static void *
+push_messages(void *data)
+{
+	int i;
+
+	for (i = 0; i < N_MESSAGES; i++)
+		lt_warning("message %d", i);
+
+	return NULL;
+}
+#endif
+
+/************************************************************/
+/* Test cases                                               */
+/************************************************************/
+TDEF (lt_log_drain) {
+	log_result_t result;
+
+	memset(&result, 0, sizeof (log_result_t));
+	lt_warning("foo %d", 1);
+	lt_info("bar");
+	lt_warning("baz %s", "qux");
+	fail_unless(lt_log_drain(log_func, &result) == 3, "Unexpected number of the messages delivered");
+	fail_unless(result.n_messages == 3, "Unexpected number of the messages received: %d", (int)result.n_messages);
+	fail_unless(result.level == LT_LOG_WARNING, "Unexpected level: %d", result.level);
+	fail_unless(strcmp(result.message, "baz qux") == 0, "Unexpected message: %s", result.message);
+	fail_unless(lt_log_drain(log_func, &result) == 0, "The queue has to be empty");
+
+	fail_unless(lt_log_set_deferred(FALSE), "It has to be deferred");
+	fail_unless(!lt_log_set_deferred(TRUE), "It has to be disabled");
+} TEND
+
+TDEF (lt_log_get_dropped) {
+	unsigned long long dropped = lt_log_get_dropped();
+	log_result_t result;
+	int i;
+
+	memset(&result, 0, sizeof (log_result_t));
+	for (i = 0; i < LT_LOG_QUEUE_SIZE + 10; i++)
+		lt_warning("message %d", i);
+	fail_unless(lt_log_get_dropped() - dropped == 10, "Unexpected number of the messages dropped: %llu", lt_log_get_dropped() - dropped);
+	fail_unless(lt_log_drain(log_func, &result) == LT_LOG_QUEUE_SIZE, "Unexpected number of the messages delivered: %d", (int)result.n_messages);
+	fail_unless(strcmp(result.message, "message 255") == 0, "Unexpected message: %s", result.message);
+} TEND
+
+TDEF (lt_warning_ratelimited) {
+	log_result_t result;
+	int i;
+
+	memset(&result, 0, sizeof (log_result_t));
+	for (i = 0; i < 100; i++)
+		lt_warning_ratelimited("message %d", i);
+	/* the suppressed ones are reported without waiting for the next window */
+	lt_log_drain(log_func, &result);
+	fail_unless(result.n_messages == LT_MESSAGE_SITE_BURST + 1, "Unexpected number of the messages: %d", (int)result.n_messages);
+	fail_unless(strcmp(result.message, "95 similar messages were suppressed") == 0, "Unexpected message: %s", result.message);
+	fail_unless(lt_log_drain(log_func, &result) == 0, "The suppressed messages has to be reported once");
+} TEND
+
+TDEF (lt_log_threads) {
+#if HAVE_PTHREAD
+	pthread_t threads[N_THREADS];
+	unsigned long long dropped = lt_log_get_dropped();
+	log_result_t result;
+	int i, done = 0;
+
+	memset(&result, 0, sizeof (log_result_t));
+	for (i = 0; i < N_THREADS; i++) {
+		fail_unless(pthread_create(&threads[i], NULL, push_messages, NULL) == 0, "Unable to create a thread");
+	}
+	/* drain while the threads are pushing */
+	while (done < 100) {
+		if (lt_log_drain(log_func, &result) == 0)
+			done++;
+	}
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+	lt_log_drain(log_func, &result);
+	fail_unless(result.n_messages + (lt_log_get_dropped() - dropped) == N_THREADS * N_MESSAGES, "Messages lost: %d delivered, %llu dropped", (int)result.n_messages, lt_log_get_dropped() - dropped);
+#endif
+} TEND
+
+/************************************************************/
+Suite *
+tester_suite(void)
+{
+	Suite *s = suite_create("lt_log_t");
+	TCase *tc = tcase_create("Basic functionality");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+
+	T (lt_log_drain);
+	T (lt_log_get_dropped);
+	T (lt_warning_ratelimited);
+	T (lt_log_threads);
+
+	suite_add_tcase(s, tc);
+
+	return s;
+}
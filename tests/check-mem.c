@@ -0,0 +1,193 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * check-mem.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <liblangtag/langtag.h>
+#include "liblangtag/lt-mem.h"
+#include "main.h"
+
+#define N_ITEMS	256
+
+static int destroyed[N_ITEMS];
+static int n_destroyed;
+static int items[N_ITEMS];
+
+/************************************************************/
+/* common functions                                         */
+/************************************************************/
+void
+setup(void)
+{
+	int i;
+
+	for (i = 0; i < N_ITEMS; i++)
+		items[i] = i;
+	n_destroyed = 0;
+}
+
+void
+teardown(void)
+{
+}
+
+static void
+destroy(lt_pointer_t data)
+{
+	destroyed[n_destroyed++] = *(int *)data;
+}
+
+static lt_mem_t *
+create_object(int n)
+{
+	lt_mem_t *m = lt_mem_alloc_object(sizeof (lt_mem_t));
+	int i;
+
+	for (i = 0; i < n; i++)
+		lt_mem_add_ref(m, &items[i], destroy);
+
+	return m;
+}
+
+/************************************************************/
+/* Test cases                                               */
+/************************************************************/
+TDEF (lt_mem_add_ref) {
+	int n[] = { 1, 3, 4, 100, N_ITEMS, 0 };
+	int i, j;
+
+	/* both the object itself and the table has to keep the order */
+	for (i = 0; n[i] != 0; i++) {
+		n_destroyed = 0;
+		lt_mem_unref(create_object(n[i]));
+		fail_unless(n_destroyed == n[i], "Unexpected number of the references destroyed");
+		for (j = 0; j < n[i]; j++)
+			fail_unless(destroyed[j] == j, "Not destroyed in the order of the registration");
+	}
+} TEND
+
+TDEF (lt_mem_remove_ref) {
+	lt_mem_t *m = create_object(N_ITEMS);
+	int i;
+
+	for (i = 0; i < N_ITEMS; i += 2)
+		lt_mem_remove_ref(m, &items[i]);
+	fail_unless(n_destroyed == 0, "Removed references must not be destroyed");
+	lt_mem_unref(m);
+	fail_unless(n_destroyed == N_ITEMS / 2, "Unexpected number of the references destroyed");
+	for (i = 0; i < n_destroyed; i++)
+		fail_unless(destroyed[i] == i * 2 + 1, "Not destroyed in the order of the registration");
+} TEND
+
+TDEF (lt_mem_delete_ref) {
+	lt_mem_t *m = create_object(2);
+
+	lt_mem_delete_ref(m, &items[1]);
+	fail_unless(n_destroyed == 1 && destroyed[0] == 1, "Not destroyed immediately");
+	lt_mem_delete_ref(m, &items[1]);
+	fail_unless(n_destroyed == 1, "Destroyed twice");
+	lt_mem_unref(m);
+	fail_unless(n_destroyed == 2 && destroyed[1] == 0, "Unexpected reference destroyed");
+} TEND
+
+TDEF (lt_mem_replace_ref) {
+	lt_mem_t *m = create_object(5);
+	int i;
+
+	/* likewise lt_string_t re-registers the buffer on realloc */
+	for (i = 0; i < 10000; i++) {
+		lt_mem_remove_ref(m, &items[(i % 5) + 5]);
+		lt_mem_add_ref(m, &items[((i + 1) % 5) + 5], destroy);
+	}
+	lt_mem_unref(m);
+	fail_unless(n_destroyed == 6, "Unexpected number of the references destroyed");
+	for (i = 0; i < 5; i++)
+		fail_unless(destroyed[i] == i, "Not destroyed in the order of the registration");
+} TEND
+
+TDEF (lt_mem_add_weak_pointer) {
+	lt_mem_t *m, *p1, *p2;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		n_destroyed = 0;
+		m = create_object(i == 0 ? 1 : N_ITEMS);
+		p1 = p2 = m;
+		lt_mem_add_weak_pointer(m, (lt_pointer_t *)&p1);
+		lt_mem_add_weak_pointer(m, (lt_pointer_t *)&p1);
+		lt_mem_add_weak_pointer(m, (lt_pointer_t *)&p2);
+		lt_mem_remove_weak_pointer(m, (lt_pointer_t *)&p2);
+		lt_mem_unref(m);
+		fail_unless(p1 == NULL, "Not registered as a weak pointer properly");
+		fail_unless(p2 == m, "Not removed from the weak pointers");
+	}
+} TEND
+
+TDEF (lt_mem_alloc_object_with_arena) {
+	lt_pointer_t buffer[32];
+	lt_mem_t *m, *o;
+	lt_mem_arena_t *arena;
+	char *p;
+	int i, j;
+
+	for (i = 0; i < 2; i++) {
+		n_destroyed = 0;
+		m = lt_mem_alloc_object_with_arena(sizeof (lt_mem_t),
+						   i == 0 ? NULL : buffer,
+						   i == 0 ? 0 : sizeof (buffer));
+		fail_unless(m != NULL, "OOM");
+		arena = lt_mem_get_arena(m);
+		fail_unless(arena != NULL, "No arena");
+		if (i == 1)
+			fail_unless((lt_pointer_t)arena == (lt_pointer_t)buffer, "Not placed in the buffer");
+		o = lt_mem_arena_alloc_object(arena, sizeof (lt_mem_t));
+		fail_unless(o != NULL, "OOM");
+		fail_unless(lt_mem_get_arena(o) == NULL, "Not an owner of the arena");
+		lt_mem_add_ref(o, &items[1], destroy);
+		lt_mem_add_ref(m, &items[0], destroy);
+		lt_mem_add_ref(m, o, (lt_destroy_func_t)lt_mem_unref);
+		/* exceed the initial size to get the additional chunks */
+		for (j = 0; j < 64; j++) {
+			p = lt_mem_arena_alloc(arena, j + 1);
+			fail_unless(p != NULL, "OOM");
+			fail_unless(p[j] == 0, "Not cleared");
+			p[j] = 1;
+		}
+		lt_mem_unref(m);
+		fail_unless(n_destroyed == 2, "Unexpected number of the references destroyed");
+		fail_unless(destroyed[0] == 0 && destroyed[1] == 1, "Not destroyed in the order of the registration");
+	}
+} TEND
+
+/************************************************************/
+Suite *
+tester_suite(void)
+{
+	Suite *s = suite_create("lt_mem_t");
+	TCase *tc = tcase_create("Basic functionality");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+
+	T (lt_mem_add_ref);
+	T (lt_mem_remove_ref);
+	T (lt_mem_delete_ref);
+	T (lt_mem_replace_ref);
+	T (lt_mem_add_weak_pointer);
+	T (lt_mem_alloc_object_with_arena);
+
+	suite_add_tcase(s, tc);
+
+	return s;
+}
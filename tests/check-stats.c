@@ -0,0 +1,167 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * check-stats.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <liblangtag/langtag.h>
+#include "main.h"
+
+#define N_THREADS	4
+#define N_PARSES	100
+
+/************************************************************/
+/* common functions                                         */
+/************************************************************/
+void
+setup(void)
+{
+	setenv("LANGTAG_EXT_MODULE_PATH", TEST_MODDIR, TRUE);
+	lt_db_set_datadir(TEST_DATADIR);
+	lt_db_initialize();
+}
+
+void
+teardown(void)
+{
+	lt_db_finalize();
+}
+
+#if HAVE_PTHREAD
+static void *
+parse_tags(void *data)
+{
+	lt_tag_t *tag = lt_tag_new();
+	int i;
+
+	for (i = 0; i < N_PARSES; i++)
+		lt_tag_parse(tag, "ja-JP", NULL);
+	lt_tag_unref(tag);
+
+	return NULL;
+}
+#endif
+
+/************************************************************/
+/* Test cases                                               */
+/************************************************************/
+TDEF (lt_stats_get) {
+	lt_stats_t stats;
+	lt_tag_t *tag;
+	lt_error_t *err = NULL;
+	char *s;
+
+	if (!lt_stats_get(&stats)) {
+		fail_unless(stats.parses == 0, "Counters should be zero when disabled");
+		return;
+	}
+	lt_stats_reset();
+	fail_unless(lt_stats_get(&stats), "Unable to obtain the statistics");
+	fail_unless(stats.parses == 0, "Counters have to be zero after reset: %llu", stats.parses);
+
+	tag = lt_tag_new();
+	fail_unless(lt_tag_parse(tag, "en-US", NULL), "Unable to parse en-US");
+	s = lt_tag_canonicalize(tag, NULL);
+	fail_unless(s != NULL, "Unable to canonicalize en-US");
+	free(s);
+	fail_unless(!lt_tag_parse(tag, "en--US", &err), "en--US has to be invalid");
+	lt_error_unref(err);
+	lt_tag_unref(tag);
+
+	lt_stats_get(&stats);
+	fail_unless(stats.parses == 2, "Unexpected number of the parses: %llu", stats.parses);
+	fail_unless(lt_stats_get_parse_failures(&stats, LT_ERR_ANY) == 1, "Unexpected number of the failures: %llu", lt_stats_get_parse_failures(&stats, LT_ERR_ANY));
+	fail_unless(lt_stats_get_parse_failures(&stats, LT_ERR_SUCCESS) == 0, "Success counted as a failure");
+	fail_unless(stats.db_lookups[LT_STATS_DB_GRANDFATHERED] == 2, "Unexpected number of the lookups: %llu", stats.db_lookups[LT_STATS_DB_GRANDFATHERED]);
+	fail_unless(stats.db_misses[LT_STATS_DB_GRANDFATHERED] == 2, "Unexpected number of the misses: %llu", stats.db_misses[LT_STATS_DB_GRANDFATHERED]);
+	fail_unless(stats.db_lookups[LT_STATS_DB_LANG] > 0, "No lookups in the language database");
+	fail_unless(stats.canonicalize_iterations > 0, "No lookups while canonicalizing");
+	fail_unless(stats.objects_allocated > 0, "No objects allocated");
+	fail_unless(stats.bytes_allocated > 0, "No bytes allocated");
+
+	lt_stats_reset();
+	lt_stats_get(&stats);
+	fail_unless(stats.parses == 0, "Counters have to be zero after reset: %llu", stats.parses);
+	fail_unless(stats.objects_allocated == 0, "Counters have to be zero after reset: %llu", stats.objects_allocated);
+} TEND
+
+TDEF (lt_stats_threads) {
+#if HAVE_PTHREAD
+	pthread_t threads[N_THREADS];
+	lt_stats_t stats;
+	int i;
+
+	if (!lt_stats_get(&stats))
+		return;
+	lt_stats_reset();
+	for (i = 0; i < N_THREADS; i++) {
+		fail_unless(pthread_create(&threads[i], NULL, parse_tags, NULL) == 0, "Unable to create a thread");
+	}
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+	/* the counters of the threads exited have to be kept */
+	lt_stats_get(&stats);
+	fail_unless(stats.parses == N_THREADS * N_PARSES, "Unexpected number of the parses: %llu", stats.parses);
+	fail_unless(lt_stats_get_parse_failures(&stats, LT_ERR_ANY) == 0, "Unexpected number of the failures: %llu", lt_stats_get_parse_failures(&stats, LT_ERR_ANY));
+#endif
+} TEND
+
+TDEF (lt_stats_get_memory) {
+	lt_stats_mem_t before, after;
+	lt_tag_t *tag;
+	int i;
+
+	fail_unless(lt_stats_mem_type_get_name(LT_STATS_MEM_TAG) != NULL, "No name for the type");
+	lt_stats_set_memory_accounting(TRUE);
+	if (!lt_stats_get_memory(LT_STATS_MEM_TAG, &before)) {
+		fail_unless(before.n_allocated == 0, "Counters should be zero when disabled");
+		return;
+	}
+	for (i = 0; i < 10; i++) {
+		tag = lt_tag_new();
+		fail_unless(lt_tag_parse(tag, "ja-JP", NULL), "Unable to parse ja-JP");
+		lt_stats_get_memory(LT_STATS_MEM_TAG, &after);
+		fail_unless(after.n_live == before.n_live + 1, "Unexpected number of the live objects: %llu", after.n_live);
+		fail_unless(after.live_bytes > before.live_bytes, "No bytes accounted for the tag");
+		lt_tag_unref(tag);
+	}
+	lt_stats_get_memory(LT_STATS_MEM_TAG, &after);
+	fail_unless(after.n_allocated == before.n_allocated + 10, "Unexpected number of the objects allocated: %llu", after.n_allocated);
+	fail_unless(after.n_live == before.n_live, "The tags are still alive: %llu", after.n_live);
+	fail_unless(after.live_bytes == before.live_bytes, "The bytes are still accounted: %llu", after.live_bytes);
+	fail_unless(after.n_live_max >= before.n_live + 1, "Unexpected high-water mark: %llu", after.n_live_max);
+	lt_stats_set_memory_accounting(FALSE);
+} TEND
+
+/************************************************************/
+Suite *
+tester_suite(void)
+{
+	Suite *s = suite_create("lt_stats_t");
+	TCase *tc = tcase_create("Basic functionality");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+
+	T (lt_stats_get);
+	T (lt_stats_threads);
+	T (lt_stats_get_memory);
+
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,200 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * check-string.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <liblangtag/langtag.h>
+#include "liblangtag/lt-mem.h"
+#include "lt-string-private.h"
+#include "main.h"
+
+/* long enough to spill out of the inline buffer in lt-string.c */
+#define N_CHARS		300
+
+static char expected[N_CHARS + 1];
+
+/************************************************************/
+/* common functions                                         */
+/************************************************************/
+void
+setup(void)
+{
+	int i;
+
+	for (i = 0; i < N_CHARS; i++)
+		expected[i] = 'a' + (i % 26);
+	expected[N_CHARS] = 0;
+}
+
+void
+teardown(void)
+{
+}
+
+static void
+check_grow_and_shrink(lt_string_t *s)
+{
+	int i;
+
+	/* cross the inline boundary one byte at a time */
+	for (i = 0; i < N_CHARS; i++) {
+		lt_string_append_c(s, expected[i]);
+		fail_unless(lt_string_length(s) == i + 1, "Unexpected length: %d", (int)lt_string_length(s));
+		fail_unless(strncmp(lt_string_value(s), expected, i + 1) == 0, "Unexpected value at %d: %s", i, lt_string_value(s));
+		fail_unless(lt_string_value(s)[i + 1] == 0, "Not nul-terminated at %d", i);
+	}
+	/* back below the inline size after it spilled */
+	lt_string_truncate(s, 10);
+	fail_unless(lt_string_length(s) == 10, "Unexpected length after truncate: %d", (int)lt_string_length(s));
+	fail_unless(strncmp(lt_string_value(s), expected, 10) == 0 && lt_string_value(s)[10] == 0, "Unexpected value after truncate: %s", lt_string_value(s));
+	lt_string_clear(s);
+	fail_unless(lt_string_length(s) == 0, "Not cleared");
+	fail_unless(strcmp(lt_string_value(s), "") == 0, "Not cleared: %s", lt_string_value(s));
+
+	/* and spill again in chunks */
+	for (i = 0; i < N_CHARS; i += 50)
+		lt_string_append_len(s, &expected[i], 50);
+	fail_unless(lt_string_length(s) == N_CHARS, "Unexpected length after re-append: %d", (int)lt_string_length(s));
+	fail_unless(strcmp(lt_string_value(s), expected) == 0, "Unexpected value after re-append: %s", lt_string_value(s));
+	lt_string_truncate(s, -(N_CHARS - 31));
+	fail_unless(lt_string_length(s) == 31, "Unexpected length after negative truncate: %d", (int)lt_string_length(s));
+	lt_string_append(s, "0123456789");
+	fail_unless(lt_string_length(s) == 41, "Unexpected length: %d", (int)lt_string_length(s));
+	fail_unless(strncmp(lt_string_value(s), expected, 31) == 0 && strcmp(&lt_string_value(s)[31], "0123456789") == 0, "Unexpected value: %s", lt_string_value(s));
+}
+
+/************************************************************/
+/* Test cases                                               */
+/************************************************************/
+TDEF (lt_string_new) {
+	lt_string_t *s;
+	int i;
+
+	s = lt_string_new(NULL);
+	fail_unless(s != NULL, "Unable to create an instance");
+	fail_unless(lt_string_length(s) == 0, "Unexpected length");
+	fail_unless(strcmp(lt_string_value(s), "") == 0, "Unexpected value");
+	lt_string_unref(s);
+
+	/* the initial strings around the inline size */
+	for (i = 28; i < 36; i++) {
+		char buf[N_CHARS + 1];
+
+		strncpy(buf, expected, i);
+		buf[i] = 0;
+		s = lt_string_new(buf);
+		fail_unless(s != NULL, "Unable to create an instance with %d bytes", i);
+		fail_unless(lt_string_length(s) == i, "Unexpected length: %d", (int)lt_string_length(s));
+		fail_unless(strcmp(lt_string_value(s), buf) == 0, "Unexpected value: %s", lt_string_value(s));
+		lt_string_append_c(s, '!');
+		fail_unless(lt_string_length(s) == i + 1, "Unexpected length: %d", (int)lt_string_length(s));
+		fail_unless(strncmp(lt_string_value(s), buf, i) == 0 && strcmp(&lt_string_value(s)[i], "!") == 0, "Unexpected value: %s", lt_string_value(s));
+		lt_string_unref(s);
+	}
+} TEND
+
+TDEF (lt_string_append) {
+	lt_string_t *s = lt_string_new(NULL);
+
+	check_grow_and_shrink(s);
+	lt_string_unref(s);
+
+	s = lt_string_new(expected);
+	lt_string_clear(s);
+	check_grow_and_shrink(s);
+	lt_string_unref(s);
+} TEND
+
+TDEF (lt_string_free) {
+	lt_string_t *s;
+	char *p;
+
+	/* inline */
+	s = lt_string_new("foo");
+	p = lt_string_free(s, FALSE);
+	fail_unless(p != NULL && strcmp(p, "foo") == 0, "Unexpected value: %s", p);
+	free(p);
+
+	/* on the heap */
+	s = lt_string_new(NULL);
+	lt_string_append(s, expected);
+	p = lt_string_free(s, FALSE);
+	fail_unless(p != NULL && strcmp(p, expected) == 0, "Unexpected value: %s", p);
+	free(p);
+
+	/* spilled and truncated back below the inline size */
+	s = lt_string_new(expected);
+	lt_string_truncate(s, 3);
+	p = lt_string_free(s, FALSE);
+	fail_unless(p != NULL && strncmp(p, expected, 3) == 0 && p[3] == 0, "Unexpected value: %s", p);
+	free(p);
+
+	s = lt_string_new(expected);
+	fail_unless(lt_string_free(s, TRUE) == NULL, "Unexpected return value");
+} TEND
+
+TDEF (lt_string_new_with_arena) {
+	char buffer[256];
+	lt_mem_t *owner;
+	lt_mem_arena_t *arena;
+	lt_string_t *s, *s2;
+	char *p;
+
+	owner = lt_mem_alloc_object_with_arena(sizeof (lt_mem_t), buffer, sizeof (buffer));
+	fail_unless(owner != NULL, "Unable to create an owner of the arena");
+	arena = lt_mem_get_arena(owner);
+	fail_unless(arena != NULL, "No arena");
+
+	s = lt_string_new_with_arena(arena, "foo");
+	fail_unless(s != NULL, "Unable to create an instance");
+	fail_unless(strcmp(lt_string_value(s), "foo") == 0, "Unexpected value: %s", lt_string_value(s));
+	lt_string_clear(s);
+	/* spills out of the inline buffer and of the buffer on the stack */
+	check_grow_and_shrink(s);
+
+	s2 = lt_string_new_with_arena(arena, expected);
+	fail_unless(s2 != NULL, "Unable to create an instance");
+	fail_unless(strcmp(lt_string_value(s2), expected) == 0, "Unexpected value: %s", lt_string_value(s2));
+	/* the buffer in the arena has to be copied */
+	p = lt_string_free(s2, FALSE);
+	fail_unless(p != NULL && strcmp(p, expected) == 0, "Unexpected value: %s", p);
+	free(p);
+
+	p = lt_string_free(s, FALSE);
+	fail_unless(p != NULL && strlen(p) == 41, "Unexpected value: %s", p);
+	free(p);
+
+	lt_mem_unref(owner);
+} TEND
+
+/************************************************************/
+Suite *
+tester_suite(void)
+{
+	Suite *s = suite_create("lt_string_t");
+	TCase *tc = tcase_create("Basic functionality");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+
+	T (lt_string_new);
+	T (lt_string_append);
+	T (lt_string_free);
+	T (lt_string_new_with_arena);
+
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,266 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * check-tag-dict.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <liblangtag/langtag.h>
+#include "lt-utils.h"
+#include "main.h"
+
+#define N_THREADS	4
+#define N_TAGS		2000
+
+typedef struct _thread_data_t {
+	lt_tag_dict_t *dict;
+	char         **tags;
+	unsigned int  *ids;
+} thread_data_t;
+
+/************************************************************/
+/* common functions                                         */
+/************************************************************/
+void
+setup(void)
+{
+	setenv("LANGTAG_EXT_MODULE_PATH", TEST_MODDIR, TRUE);
+	lt_db_set_datadir(TEST_DATADIR);
+	lt_db_initialize();
+}
+
+void
+teardown(void)
+{
+	lt_db_finalize();
+}
+
+static void *
+intern_tags(void *data)
+{
+	thread_data_t *d = data;
+	size_t i;
+
+	for (i = 0; i < N_TAGS; i++) {
+		if (!lt_tag_dict_intern(d->dict, d->tags[i], strlen(d->tags[i]), &d->ids[i], NULL))
+			d->ids[i] = LT_TAG_DICT_INVALID_ID;
+	}
+
+	return NULL;
+}
+
+/************************************************************/
+/* Test cases                                               */
+/************************************************************/
+TDEF (lt_tag_dict_intern) {
+	lt_tag_dict_t *dict;
+	lt_tag_t *tag;
+	lt_error_t *err = NULL;
+	unsigned int id1, id2, id3;
+
+	dict = lt_tag_dict_new();
+	fail_unless(dict != NULL, "OOM");
+	fail_unless(lt_tag_dict_size(dict) == 0, "Unexpected size of the empty dictionary");
+	fail_unless(lt_tag_dict_intern(dict, "en-us", 5, &id1, NULL), "Unable to add en-us");
+	fail_unless(id1 == 0, "Unexpected ID for the first tag: %u", id1);
+	fail_unless(lt_tag_dict_intern(dict, "EN-US", 5, &id2, NULL), "Unable to add EN-US");
+	fail_unless(id1 == id2, "The tags canonicalized to the same string should have the same ID");
+	fail_unless(lt_tag_dict_intern(dict, "en-Latn-US-and-more", 10, &id2, NULL), "Unable to add en-Latn-US");
+	fail_unless(id1 == id2, "The tags canonicalized to the same string should have the same ID");
+	fail_unless(lt_tag_dict_intern(dict, "ja-JP", 5, &id3, NULL), "Unable to add ja-JP");
+	fail_unless(id3 == 1, "Unexpected ID for the second tag: %u", id3);
+	fail_unless(!lt_tag_dict_intern(dict, "blahblahblah", 12, &id3, &err), "Invalid tag shouldn't be added");
+	fail_unless(lt_error_is_set(err, LT_ERR_ANY), "No errors reported for the invalid tag");
+	lt_error_unref(err);
+	fail_unless(lt_tag_dict_size(dict) == 2, "Unexpected size of the dictionary");
+
+	tag = lt_tag_new();
+	fail_unless(lt_tag_parse(tag, "JA-jp", NULL), "Unable to parse JA-jp");
+	fail_unless(lt_tag_dict_intern_tag(dict, tag, &id3, NULL), "Unable to add the tag");
+	fail_unless(id3 == 1, "Unexpected ID for the tag already added: %u", id3);
+	lt_tag_unref(tag);
+
+	fail_unless(lt_strcmp0(lt_tag_dict_get_string(dict, id1), "en-US") == 0, "Unexpected string for ID %u: %s", id1, lt_tag_dict_get_string(dict, id1));
+	fail_unless(lt_strcmp0(lt_tag_dict_get_string(dict, 1), "ja-JP") == 0, "Unexpected string for ID 1");
+	fail_unless(lt_tag_dict_get_string(dict, 2) == NULL, "The string for the ID not assigned yet should be NULL");
+	fail_unless(lt_tag_dict_get_string(dict, 100000) == NULL, "The string for the ID not assigned yet should be NULL");
+	fail_unless(lt_tag_dict_get_string(dict, LT_TAG_DICT_INVALID_ID) == NULL, "The string for the invalid ID should be NULL");
+	lt_tag_dict_unref(dict);
+} TEND
+
+TDEF (lt_tag_dict_intern_batch) {
+	const char *tags[] = {
+		"en-US", "EN-us", "zh-yue", "i-klingon", "ja-JP", "blahblahblah", "sgn-BR", NULL
+	};
+	lt_tag_dict_t *dict;
+	lt_tag_span_t spans[100];
+	lt_error_type_t status[100];
+	unsigned int ids[100], id;
+	size_t i, n, ret;
+
+	dict = lt_tag_dict_new();
+	fail_unless(dict != NULL, "OOM");
+	for (n = 0; tags[n] != NULL; n++);
+	for (i = 0; i < 100; i++) {
+		spans[i].string = tags[i % n];
+		spans[i].length = strlen(tags[i % n]);
+	}
+	ret = lt_tag_dict_intern_batch(dict, spans, 100, ids, status, 2);
+	fail_unless(ret == 100 - (100 + n - 6) / n, "Unexpected number of the tags added: %lu", ret);
+	for (i = 0; i < 100; i++) {
+		if (i % n == 5) {
+			fail_unless(status[i] != LT_ERR_SUCCESS, "Invalid tag shouldn't be added");
+			fail_unless(ids[i] == LT_TAG_DICT_INVALID_ID, "Unexpected ID for the invalid tag");
+		} else {
+			fail_unless(status[i] == LT_ERR_SUCCESS, "Unable to add %s", spans[i].string);
+			fail_unless(lt_tag_dict_intern(dict, spans[i].string, spans[i].length, &id, NULL), "Unable to add %s", spans[i].string);
+			fail_unless(id == ids[i], "Unexpected ID for %s", spans[i].string);
+		}
+	}
+	fail_unless(ids[0] == ids[1], "The tags canonicalized to the same string should have the same ID");
+	fail_unless(lt_tag_dict_size(dict) == 5, "Unexpected size of the dictionary: %lu", lt_tag_dict_size(dict));
+	lt_tag_dict_unref(dict);
+} TEND
+
+TDEF (lt_tag_dict_concurrent) {
+	const char *regions[] = { "US", "JP", "DE", "CN", "BR", NULL };
+	const char *langs[] = { "en", "ja", "de", "zh", "es", NULL };
+	lt_tag_dict_t *dict;
+	thread_data_t data[N_THREADS];
+	char **tags;
+	size_t i, j, k, n_regions, n_langs;
+#if HAVE_PTHREAD
+	pthread_t threads[N_THREADS];
+#endif
+
+	for (n_regions = 0; regions[n_regions] != NULL; n_regions++);
+	for (n_langs = 0; langs[n_langs] != NULL; n_langs++);
+	tags = malloc(sizeof (char *) * N_TAGS);
+	fail_unless(tags != NULL, "OOM");
+	for (i = 0; i < N_TAGS; i++) {
+		tags[i] = malloc(32);
+		fail_unless(tags[i] != NULL, "OOM");
+		snprintf(tags[i], 32, "%s-%s%s",
+			 langs[i % n_langs],
+			 regions[(i / n_langs) % n_regions],
+			 (i / (n_langs * n_regions)) % 2 ? "-x-private" : "");
+	}
+	dict = lt_tag_dict_new();
+	fail_unless(dict != NULL, "OOM");
+	for (i = 0; i < N_THREADS; i++) {
+		data[i].dict = dict;
+		data[i].tags = tags;
+		data[i].ids = malloc(sizeof (unsigned int) * N_TAGS);
+		fail_unless(data[i].ids != NULL, "OOM");
+	}
+#if HAVE_PTHREAD
+	for (i = 0; i < N_THREADS; i++)
+		fail_unless(pthread_create(&threads[i], NULL, intern_tags, &data[i]) == 0, "Unable to create a thread");
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+#else
+	for (i = 0; i < N_THREADS; i++)
+		intern_tags(&data[i]);
+#endif
+	k = n_langs * n_regions * 2;
+	fail_unless(lt_tag_dict_size(dict) == k, "Unexpected size of the dictionary: %lu", lt_tag_dict_size(dict));
+	for (i = 0; i < N_TAGS; i++) {
+		fail_unless(data[0].ids[i] < k, "Unexpected ID for %s", tags[i]);
+		for (j = 1; j < N_THREADS; j++)
+			fail_unless(data[0].ids[i] == data[j].ids[i], "Different IDs assigned for %s", tags[i]);
+		fail_unless(lt_strcmp0(lt_tag_dict_get_string(dict, data[0].ids[i]), tags[i]) == 0, "Unexpected string for %s", tags[i]);
+	}
+	lt_tag_dict_unref(dict);
+	for (i = 0; i < N_THREADS; i++)
+		free(data[i].ids);
+	for (i = 0; i < N_TAGS; i++)
+		free(tags[i]);
+	free(tags);
+} TEND
+
+TDEF (lt_tag_dict_save) {
+	lt_tag_dict_t *dict, *dict2;
+	lt_error_t *err = NULL;
+	char filename[] = "/tmp/check-tag-dict.XXXXXX";
+	char buf[32];
+	unsigned int id;
+	size_t i;
+	int fd;
+	FILE *fp;
+
+	fd = mkstemp(filename);
+	fail_unless(fd >= 0, "Unable to create a temporary file");
+	close(fd);
+	dict = lt_tag_dict_new();
+	fail_unless(dict != NULL, "OOM");
+	fail_unless(lt_tag_dict_save(dict, filename, NULL), "Unable to write the empty dictionary");
+	dict2 = lt_tag_dict_load(filename, NULL);
+	fail_unless(dict2 != NULL, "Unable to read the empty dictionary");
+	fail_unless(lt_tag_dict_size(dict2) == 0, "Unexpected size of the empty dictionary");
+	lt_tag_dict_unref(dict2);
+
+	/* make sure the IDs over the first segment are preserved */
+	for (i = 0; i < 1500; i++) {
+		snprintf(buf, 32, "en-x-%lu", (unsigned long)i);
+		fail_unless(lt_tag_dict_intern(dict, buf, strlen(buf), &id, NULL), "Unable to add %s", buf);
+		fail_unless(id == i, "Unexpected ID for %s: %u", buf, id);
+	}
+	fail_unless(lt_tag_dict_save(dict, filename, NULL), "Unable to write the dictionary");
+	dict2 = lt_tag_dict_load(filename, NULL);
+	fail_unless(dict2 != NULL, "Unable to read the dictionary");
+	fail_unless(lt_tag_dict_size(dict2) == lt_tag_dict_size(dict), "Unexpected size of the dictionary");
+	for (i = 0; i < 1500; i++) {
+		fail_unless(lt_strcmp0(lt_tag_dict_get_string(dict, i), lt_tag_dict_get_string(dict2, i)) == 0, "Unexpected string for ID %lu", i);
+	}
+	fail_unless(lt_tag_dict_intern(dict2, "en-x-1000", 9, &id, NULL), "Unable to add en-x-1000");
+	fail_unless(id == 1000, "Unexpected ID after reading the dictionary: %u", id);
+	fail_unless(lt_tag_dict_intern(dict2, "ja", 2, &id, NULL), "Unable to add ja");
+	fail_unless(id == 1500, "Unexpected ID for the new tag: %u", id);
+	lt_tag_dict_unref(dict2);
+	lt_tag_dict_unref(dict);
+
+	/* broken file */
+	fp = fopen(filename, "wb");
+	fail_unless(fp != NULL, "Unable to open the temporary file");
+	fputs("LTDICT but not a dictionary", fp);
+	fclose(fp);
+	fail_unless(lt_tag_dict_load(filename, &err) == NULL, "Broken file shouldn't be read");
+	fail_unless(lt_error_is_set(err, LT_ERR_INVALID), "No errors reported for the broken file");
+	lt_error_unref(err);
+	unlink(filename);
+} TEND
+
+/************************************************************/
+Suite *
+tester_suite(void)
+{
+	Suite *s = suite_create("lt_tag_dict_t");
+	TCase *tc = tcase_create("Basic functionality");
+
+	tcase_add_checked_fixture(tc, setup, teardown);
+
+	T (lt_tag_dict_intern);
+	T (lt_tag_dict_intern_batch);
+	T (lt_tag_dict_concurrent);
+	T (lt_tag_dict_save);
+
+	suite_add_tcase(s, tc);
+
+	return s;
+}
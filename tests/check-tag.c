@@ -14,7 +14,9 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <liblangtag/langtag.h>
 #include "lt-utils.h"
 #include "main.h"
@@ -92,6 +94,46 @@ TDEF (lt_tag_parse) {
 	lt_tag_unref(t1);
 } TEND
 
+TDEF (lt_tag_new_with_arena) {
+	const char *tags[] = {
+		"en-GB-oed", "mn-Cyrl-MN", "sl-rozaj-biske-1994", "de-a-value",
+		"ja-u-tz", "en-u-vt-0061-0065", "sr-Latn-RS-x-private-use",
+		"blahblahblah", "en-a-bbb-a-ccc",
+		"x-aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+		NULL
+	};
+	lt_pointer_t buffer[64];
+	lt_tag_t *t1, *t2, *t3;
+	char *s1, *s2;
+	int i;
+
+	t1 = lt_tag_new();
+	t2 = lt_tag_new_with_arena(NULL, 0);
+	t3 = lt_tag_new_with_arena(buffer, sizeof (buffer));
+	fail_unless(t1 != NULL && t2 != NULL && t3 != NULL, "OOM");
+	/* the instances are reused to make sure the arena is reused as well */
+	for (i = 0; tags[i] != NULL; i++) {
+		lt_bool_t r1 = lt_tag_parse(t1, tags[i], NULL);
+
+		fail_unless(r1 == lt_tag_parse(t2, tags[i], NULL), "Unexpected result for %s", tags[i]);
+		fail_unless(r1 == lt_tag_parse(t3, tags[i], NULL), "Unexpected result for %s", tags[i]);
+		if (!r1)
+			continue;
+		fail_unless(lt_strcmp0(lt_tag_get_string(t1), lt_tag_get_string(t2)) == 0, "Unexpected string for %s", tags[i]);
+		fail_unless(lt_strcmp0(lt_tag_get_string(t1), lt_tag_get_string(t3)) == 0, "Unexpected string for %s", tags[i]);
+		fail_unless(lt_strcmp0(lt_string_value(lt_tag_get_privateuse(t1)),
+				       lt_string_value(lt_tag_get_privateuse(t2))) == 0, "Unexpected private use for %s", tags[i]);
+		s1 = lt_tag_canonicalize(t1, NULL);
+		s2 = lt_tag_canonicalize(t2, NULL);
+		fail_unless(lt_strcmp0(s1, s2) == 0, "Unexpected canonicalized tag for %s", tags[i]);
+		free(s1);
+		free(s2);
+	}
+	lt_tag_unref(t1);
+	lt_tag_unref(t2);
+	lt_tag_unref(t3);
+} TEND
+
 TDEF (lt_tag_parse_with_extra_token) {
 	lt_tag_t *t1;
 
@@ -193,7 +235,7 @@ TDEF (lt_tag_canonicalize) {
 } TEND
 
 TDEF (lt_tag_match) {
-	lt_tag_t *t1;
+	lt_tag_t *t1, *t2;
 
 	t1 = lt_tag_new();
 	fail_unless(t1 != NULL, "OOM");
@@ -230,6 +272,24 @@ TDEF (lt_tag_match) {
 	fail_unless(lt_tag_parse(t1, "de-Deva", NULL), "should be valid langtag.");
 	fail_unless(!lt_tag_match(t1, "de-*-DE", NULL), "shouldn't match because of the missing region.");
 
+	t2 = lt_tag_new();
+	fail_unless(t2 != NULL, "OOM");
+	fail_unless(!lt_tag_parse_range(t2, "de*", NULL), "'de*' is invalid wildcard.");
+	fail_unless(lt_tag_parse_range(t2, "de-*-DE", NULL), "should be valid range.");
+	fail_unless(lt_tag_parse(t1, "de-Latn-DE", NULL), "should be valid langtag.");
+	fail_unless(lt_tag_match_range(t1, t2), "should match.");
+	fail_unless(lt_tag_parse(t1, "de-DE-x-goethe", NULL), "should be valid langtag.");
+	fail_unless(lt_tag_match_range(t1, t2), "should match.");
+	fail_unless(lt_tag_parse(t1, "de", NULL), "should be valid langtag.");
+	fail_unless(!lt_tag_match_range(t1, t2), "shouldn't match because of the missing region.");
+	fail_unless(lt_tag_parse_range(t2, "de-DE", NULL), "should be valid range.");
+	fail_unless(lt_tag_parse(t1, "de-Latn-DE", NULL), "should be valid langtag.");
+	fail_unless(!lt_tag_match_range(t1, t2), "shouldn't match because the script tag is different.");
+	fail_unless(lt_tag_parse(t1, "de-DE-1996", NULL), "should be valid langtag.");
+	fail_unless(lt_tag_match_range(t1, t2), "should match.");
+	fail_unless(lt_tag_match_range(t1, t2), "the range shouldn't be modified.");
+
+	lt_tag_unref(t2);
 	lt_tag_unref(t1);
 } TEND
 
@@ -292,6 +352,270 @@ TDEF (lt_tag_convert_from_locale_string) {
 
 } TEND
 
+TDEF (lt_tag_get_key) {
+	lt_tag_t *t1, *t2, *t3;
+	lt_tag_key_t k1, k2;
+
+	t1 = lt_tag_new();
+	t2 = lt_tag_new();
+	fail_unless(lt_tag_parse(t1, "sr-Latn-RS", NULL), "should be valid tag");
+	fail_unless(lt_tag_parse(t2, "SR-latn-rs", NULL), "should be valid tag");
+	fail_unless(lt_tag_get_key(t1, &k1), "should be encoded completely");
+	fail_unless(lt_tag_get_key(t2, &k2), "should be encoded completely");
+	fail_unless(lt_tag_key_cmp(&k1, &k2) == 0, "should be the same key regardless of the case sensitivity");
+	fail_unless(lt_tag_key_hash(&k1) == lt_tag_key_hash(&k2), "should be the same hash");
+	fail_unless(lt_tag_cmp(t1, t2) == 0, "should be the same tag");
+
+	fail_unless(lt_tag_parse(t2, "sr-Latn", NULL), "should be valid tag");
+	fail_unless(lt_tag_cmp(t1, t2) > 0, "should be ordered by subtags");
+	fail_unless(lt_tag_cmp(t2, t1) < 0, "should be ordered by subtags");
+	fail_unless(lt_tag_parse(t2, "es-419", NULL), "should be valid tag");
+	fail_unless(lt_tag_cmp(t1, t2) > 0, "should be ordered by subtags");
+
+	fail_unless(lt_tag_parse(t1, "de-CH-1996", NULL), "should be valid tag");
+	fail_unless(lt_tag_get_key(t1, &k1), "should be encoded completely");
+	t3 = lt_tag_key_decode(&k1, NULL);
+	fail_unless(t3 != NULL, "should be decoded");
+	fail_unless(lt_strcmp0(lt_tag_get_string(t3), "de-CH-1996") == 0, "Unexpected decoded tag");
+	lt_tag_unref(t3);
+	fail_unless(lt_tag_parse(t1, "es-419", NULL), "should be valid tag");
+	fail_unless(lt_tag_get_key(t1, &k1), "should be encoded completely");
+	t3 = lt_tag_key_decode(&k1, NULL);
+	fail_unless(t3 != NULL, "should be decoded");
+	fail_unless(lt_strcmp0(lt_tag_get_string(t3), "es-419") == 0, "Unexpected decoded tag");
+	lt_tag_unref(t3);
+
+	fail_unless(lt_tag_parse(t1, "en-x-foo", NULL), "should be valid tag");
+	fail_unless(lt_tag_parse(t2, "en-x-bar", NULL), "should be valid tag");
+	fail_unless(!lt_tag_get_key(t1, &k1), "private use can't be encoded");
+	fail_unless(lt_tag_key_decode(&k1, NULL) == NULL, "partial key can't be decoded");
+	fail_unless(lt_tag_cmp(t1, t2) != 0, "should be different tags");
+	fail_unless(lt_tag_parse(t2, "EN-X-FOO", NULL), "should be valid tag");
+	fail_unless(lt_tag_cmp(t1, t2) == 0, "should be the same tag");
+	fail_unless(lt_tag_hash(t1) == lt_tag_hash(t2), "should be the same hash");
+	fail_unless(lt_tag_parse(t1, "i-klingon", NULL), "should be valid tag");
+	fail_unless(!lt_tag_get_key(t1, &k1), "grandfathered can't be encoded");
+
+	lt_tag_unref(t1);
+	lt_tag_unref(t2);
+} TEND
+
+TDEF (lt_tag_is_valid) {
+	const char *tags[] = {
+		"en", "en-US", "ja-JP", "zh-yue", "sr-Latn-RS", "de-CH-1996",
+		"sl-rozaj-biske", "i-klingon", "en-x-foo", "x-foo",
+		"en-US-u-ca-gregory", "", "en-", "-en", "en--US", "en_US",
+		"en-a", "de-1996-1996", "en-1996", "zh-yue-Hant-HK", "abcd",
+		"en-xyzzy", NULL
+	};
+	lt_tag_t *t1;
+	size_t offset;
+	int i;
+
+	t1 = lt_tag_new();
+	for (i = 0; tags[i] != NULL; i++) {
+		lt_error_t *err = NULL;
+		lt_bool_t valid = lt_tag_parse(t1, tags[i], &err);
+
+		if (err)
+			lt_error_unref(err);
+		fail_unless((lt_tag_is_valid(tags[i], strlen(tags[i]), LT_TAG_VALIDATE_DEFAULT, NULL) == LT_TAG_VALID) == valid,
+			    "Unexpected result for %s", tags[i]);
+	}
+	lt_tag_unref(t1);
+
+	fail_unless(lt_tag_is_valid("en-US-garbage", 5, LT_TAG_VALIDATE_DEFAULT, NULL) == LT_TAG_VALID, "should be valid tag");
+	fail_unless(lt_tag_is_valid("en_US", strlen("en_US"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_INVALID_SYNTAX, "should be a syntax error");
+	fail_unless(offset == 2, "Unexpected offset: %lu", (unsigned long)offset);
+	fail_unless(lt_tag_is_valid("en--US", strlen("en--US"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_INVALID_SYNTAX, "should be a syntax error");
+	fail_unless(offset == 3, "Unexpected offset: %lu", (unsigned long)offset);
+	fail_unless(lt_tag_is_valid("en-", strlen("en-"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_INVALID_SYNTAX, "should be a syntax error");
+	fail_unless(offset == 3, "Unexpected offset: %lu", (unsigned long)offset);
+	fail_unless(lt_tag_is_valid("abcd-US", strlen("abcd-US"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_INVALID_SUBTAG, "should be an invalid subtag");
+	fail_unless(offset == 0, "Unexpected offset: %lu", (unsigned long)offset);
+	/* not in UN M.49. XA..XZ are registered as the private use */
+	fail_unless(lt_tag_is_valid("en-999", strlen("en-999"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_UNKNOWN_SUBTAG, "should be an unknown subtag");
+	fail_unless(offset == 3, "Unexpected offset: %lu", (unsigned long)offset);
+	fail_unless(lt_tag_is_valid("en-1996", strlen("en-1996"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_INVALID_PREFIX, "should be an invalid prefix");
+	fail_unless(offset == 3, "Unexpected offset: %lu", (unsigned long)offset);
+	fail_unless(lt_tag_is_valid("ja-yue", strlen("ja-yue"), LT_TAG_VALIDATE_DEFAULT, &offset) == LT_TAG_INVALID_PREFIX, "should be an invalid prefix");
+	fail_unless(lt_tag_is_valid("de-1996-1996", strlen("de-1996-1996"), LT_TAG_VALIDATE_DEFAULT, &offset) != LT_TAG_VALID, "should be invalid tag");
+	fail_unless(offset == 8, "Unexpected offset: %lu", (unsigned long)offset);
+	fail_unless(lt_tag_is_valid("en-*", strlen("en-*"), LT_TAG_VALIDATE_DEFAULT, NULL) != LT_TAG_VALID, "wildcard isn't allowed");
+	fail_unless(lt_tag_is_valid("en-*", strlen("en-*"), LT_TAG_VALIDATE_WILDCARD, NULL) == LT_TAG_VALID, "wildcard should be allowed");
+} TEND
+
+TDEF (lt_tag_is_valid_with_parser) {
+	const char *subtags[] = {
+		"en", "de", "ja", "sl", "zh", "i", "x", "u", "t", "a",
+		"yue", "cmn", "Latn", "Hant", "US", "CH", "419", "1996", "1901",
+		"rozaj", "biske", "fonipa", "ca", "gregory", "klingon", "foo",
+		"abcd", "XY", "toolongsubtag", NULL
+	};
+	lt_tag_t *t1;
+	char s[256];
+	size_t i, j, k, n, n_subtags, n_combinations;
+	unsigned int seed = 1;
+
+	for (n_subtags = 0; subtags[n_subtags] != NULL; n_subtags++);
+	n_combinations = (n_subtags + 1) * (n_subtags + 1) * (n_subtags + 1);
+	t1 = lt_tag_new();
+	/* all the combinations of up to 3 subtags, then some longer ones */
+	for (n = 0; n < n_combinations + 2000; n++) {
+		lt_error_t *err = NULL;
+		lt_bool_t valid;
+		size_t len = 0, m = n < n_combinations ? 3 : 4 + n % 3;
+
+		for (i = 0, k = n; i < m; i++) {
+			if (n < n_combinations) {
+				j = k % (n_subtags + 1);
+				k /= n_subtags + 1;
+			} else {
+				seed = seed * 1103515245 + 12345;
+				j = (seed >> 16) % n_subtags;
+			}
+			if (j == n_subtags)
+				continue;
+			len += snprintf(&s[len], sizeof (s) - len, "%s%s", len > 0 ? "-" : "", subtags[j]);
+		}
+		if (len == 0)
+			continue;
+		valid = lt_tag_parse(t1, s, &err);
+		if (err)
+			lt_error_unref(err);
+		fail_unless((lt_tag_is_valid(s, strlen(s), LT_TAG_VALIDATE_DEFAULT, NULL) == LT_TAG_VALID) == valid,
+			    "Unexpected result for %s: %s", s, valid ? "valid" : "invalid");
+	}
+	lt_tag_unref(t1);
+} TEND
+
+TDEF (lt_tag_parse_len) {
+	const char *buffer = "en-US-u-ca-gregory,de-CH-1996,i-klingon,de-*";
+	lt_tag_t *t1;
+	char *s;
+
+	t1 = lt_tag_new();
+	fail_unless(t1 != NULL, "OOM");
+	fail_unless(lt_tag_parse_len(t1, buffer, 5, NULL), "should be valid langtag.");
+	fail_unless(lt_strcmp0(lt_tag_get_string(t1), "en-US") == 0, "Unexpected tag string: %s", lt_tag_get_string(t1));
+	fail_unless(lt_tag_parse_len(t1, buffer, 18, NULL), "should be valid langtag.");
+	fail_unless(lt_strcmp0(lt_tag_get_string(t1), "en-US-u-ca-gregory") == 0, "Unexpected tag string: %s", lt_tag_get_string(t1));
+	fail_unless(!lt_tag_parse_len(t1, buffer, 4, NULL), "should be invalid langtag.");
+	fail_unless(!lt_tag_parse_len(t1, buffer, 19, NULL), "should be invalid langtag.");
+	fail_unless(lt_tag_parse_len(t1, &buffer[30], 9, NULL), "should be valid langtag.");
+	fail_unless(lt_tag_get_grandfathered(t1) != NULL, "should be a grandfathered tag.");
+	fail_unless(lt_tag_parse_len(t1, &buffer[19], 10, NULL), "should be valid langtag.");
+	fail_unless(lt_tag_match_len(t1, &buffer[40], 4, NULL), "should match.");
+	fail_unless(!lt_tag_match_len(t1, buffer, 5, NULL), "shouldn't match.");
+	s = lt_tag_lookup_len(t1, &buffer[40], 4, NULL);
+	fail_unless(lt_strcmp0(s, "de-CH-1996") == 0, "Unexpected result: %s", s);
+	free(s);
+	/* the input is terminated at the nul byte as well */
+	fail_unless(lt_tag_parse_len(t1, "de-CH\0-1996", 11, NULL), "should be valid langtag.");
+	fail_unless(lt_strcmp0(lt_tag_get_string(t1), "de-CH") == 0, "Unexpected tag string: %s", lt_tag_get_string(t1));
+	lt_tag_unref(t1);
+} TEND
+
+TDEF (lt_tag_parse_batch) {
+	const char *buffer = "en-US,ja-JP,en_US,i-klingon";
+	lt_tag_span_t spans[] = {
+		{ &buffer[0], 5 }, { &buffer[6], 5 }, { &buffer[12], 5 }, { &buffer[18], 9 }
+	};
+	lt_tag_t *tags[4] = { NULL, NULL, NULL, NULL };
+	lt_error_type_t status[4];
+	size_t i;
+
+	tags[1] = lt_tag_new();
+	fail_unless(tags[1] != NULL, "OOM");
+	fail_unless(lt_tag_parse(tags[1], "de-DE", NULL), "should be valid langtag.");
+	fail_unless(lt_tag_parse_batch(tags, spans, 4, status) == 3, "Unexpected number of the tags parsed");
+	fail_unless(status[0] == LT_ERR_SUCCESS, "should be valid langtag.");
+	fail_unless(lt_strcmp0(lt_tag_get_string(tags[0]), "en-US") == 0, "Unexpected tag string: %s", lt_tag_get_string(tags[0]));
+	fail_unless(status[1] == LT_ERR_SUCCESS, "should be valid langtag.");
+	fail_unless(lt_strcmp0(lt_tag_get_string(tags[1]), "ja-JP") == 0, "Not re-used: %s", lt_tag_get_string(tags[1]));
+	fail_unless(status[2] == LT_ERR_FAIL_ON_SCANNER, "should be invalid langtag.");
+	fail_unless(status[3] == LT_ERR_SUCCESS, "should be valid langtag.");
+	fail_unless(lt_tag_get_grandfathered(tags[3]) != NULL, "should be a grandfathered tag.");
+	for (i = 0; i < 4; i++)
+		lt_tag_unref(tags[i]);
+} TEND
+
+TDEF (lt_tag_canonicalize_batch) {
+	const char *tags[] = {
+		"en-US", "zh-yue", "i-klingon", "en_US", "sl-rozaj-biske", NULL
+	};
+	lt_tag_span_t spans[5];
+	lt_error_type_t status[5];
+	char *results[5], *s;
+	lt_tag_t *t1;
+	size_t i, n = 0, ret;
+
+	for (i = 0; tags[i] != NULL; i++) {
+		spans[i].string = tags[i];
+		spans[i].length = strlen(tags[i]);
+	}
+	t1 = lt_tag_new();
+	ret = lt_tag_canonicalize_batch(spans, i, results, status);
+	for (i = 0; tags[i] != NULL; i++) {
+		s = NULL;
+		if (lt_tag_parse(t1, tags[i], NULL))
+			s = lt_tag_canonicalize(t1, NULL);
+		fail_unless(lt_strcmp0(s, results[i]) == 0, "Unexpected result for %s: %s", tags[i], results[i]);
+		fail_unless((status[i] == LT_ERR_SUCCESS) == (s != NULL), "Unexpected status for %s", tags[i]);
+		if (s)
+			n++;
+		free(s);
+		free(results[i]);
+	}
+	fail_unless(ret == n, "Unexpected number of the tags canonicalized");
+	lt_tag_unref(t1);
+} TEND
+
+TDEF (lt_tag_canonicalize_batch_parallel) {
+	const char *tags[] = {
+		"en-US", "zh-yue", "i-klingon", "en_US", "sl-rozaj-biske",
+		"en-US-u-ca-gregory", "sgn-BR", NULL
+	};
+	lt_tag_span_t *spans;
+	lt_error_type_t *status1, *status2;
+	char **results1, **results2;
+	size_t i, n, n_spans = 10000, ret1, ret2;
+	unsigned int threads[] = { 4, 0, 1 };
+
+	spans = malloc(sizeof (lt_tag_span_t) * n_spans);
+	status1 = malloc(sizeof (lt_error_type_t) * n_spans);
+	status2 = malloc(sizeof (lt_error_type_t) * n_spans);
+	results1 = malloc(sizeof (char *) * n_spans);
+	results2 = malloc(sizeof (char *) * n_spans);
+	fail_unless(spans && status1 && status2 && results1 && results2, "OOM");
+	for (n = 0; tags[n] != NULL; n++);
+	for (i = 0; i < n_spans; i++) {
+		/* make the cost of the chunks uneven */
+		const char *s = tags[(i / 1000) % 2 == 0 ? i % n : 5];
+
+		spans[i].string = s;
+		spans[i].length = strlen(s);
+	}
+	fail_unless(lt_db_freeze(), "Unable to freeze the database");
+	ret1 = lt_tag_canonicalize_batch(spans, n_spans, results1, status1);
+	for (n = 0; n < sizeof (threads) / sizeof (threads[0]); n++) {
+		ret2 = lt_tag_canonicalize_batch_parallel(spans, n_spans, results2, status2, threads[n]);
+		fail_unless(ret1 == ret2, "Unexpected number of the tags canonicalized: %u threads", threads[n]);
+		for (i = 0; i < n_spans; i++) {
+			fail_unless(lt_strcmp0(results1[i], results2[i]) == 0, "Unexpected result for %s: %s", spans[i].string, results2[i]);
+			fail_unless(status1[i] == status2[i], "Unexpected status for %s", spans[i].string);
+			free(results2[i]);
+		}
+	}
+	for (i = 0; i < n_spans; i++)
+		free(results1[i]);
+	free(results2);
+	free(results1);
+	free(status2);
+	free(status1);
+	free(spans);
+} TEND
+
 /************************************************************/
 Suite *
 tester_suite(void)
@@ -302,11 +626,19 @@ tester_suite(void)
 	tcase_add_checked_fixture(tc, setup, teardown);
 
 	T (lt_tag_parse);
+	T (lt_tag_new_with_arena);
 	T (lt_tag_parse_with_extra_token);
 	T (lt_tag_canonicalize);
 	T (lt_tag_match);
 	T (lt_tag_transform);
 	T (lt_tag_convert_from_locale_string);
+	T (lt_tag_get_key);
+	T (lt_tag_is_valid);
+	T (lt_tag_is_valid_with_parser);
+	T (lt_tag_parse_len);
+	T (lt_tag_parse_batch);
+	T (lt_tag_canonicalize_batch);
+	T (lt_tag_canonicalize_batch_parallel);
 
 	suite_add_tcase(s, tc);
 
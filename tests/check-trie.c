@@ -14,6 +14,7 @@
 #include "config.h"
 #endif
 
+#include <string.h>
 #include <liblangtag/langtag.h>
 #include "lt-mem.h"
 #include "lt-trie.h"
@@ -107,6 +108,105 @@ TDEF (lt_trie_lookup) {
 	lt_trie_unref(t);
 } TEND
 
+TDEF (lt_trie_iter) {
+	static const char *expected[] = {
+		"a", "b", "ba", "foo", "fooo", "z", NULL
+	};
+	lt_trie_t *t = lt_trie_new();
+	lt_iter_t *iter;
+	lt_pointer_t key, val;
+	char longkey[100];
+	int i = 0;
+
+	fail_unless(lt_trie_add(t, "fooo", "fooo", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "z", "z", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "foo", "foo", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "a", "a", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "ba", "ba", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "b", "b", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "bar", "bar", NULL), "Unable to add");
+	fail_unless(lt_trie_remove(t, "bar"), "Unable to remove");
+
+	iter = lt_iter_init((lt_iter_tmpl_t *)t);
+	while (lt_iter_next(iter, &key, &val)) {
+		fail_unless(expected[i] != NULL, "Too many keys");
+		fail_unless(strcmp(key, expected[i]) == 0, "Unexpected key: %s", (char *)key);
+		fail_unless(strcmp(val, expected[i]) == 0, "Unexpected value: %s", (char *)val);
+		i++;
+	}
+	lt_iter_finish(iter);
+	fail_unless(expected[i] == NULL, "Too few keys");
+
+	/* deeper than the stack in the iterator */
+	memset(longkey, 'x', sizeof (longkey) - 1);
+	longkey[sizeof (longkey) - 1] = 0;
+	fail_unless(lt_trie_add(t, longkey, "long", NULL), "Unable to add");
+	i = 0;
+	iter = lt_iter_init((lt_iter_tmpl_t *)t);
+	while (lt_iter_next(iter, &key, &val)) {
+		i++;
+		if (strcmp(val, "long") == 0)
+			fail_unless(strcmp(key, longkey) == 0, "Unexpected key for the long key");
+	}
+	lt_iter_finish(iter);
+	fail_unless(i == 7, "Unexpected number of keys: %d", i);
+
+	lt_trie_unref(t);
+} TEND
+
+TDEF (lt_trie_prefix_iter) {
+	static const char *expected[] = {
+		"foo", "foo-bar", "fooo", NULL
+	};
+	lt_trie_t *t = lt_trie_new();
+	lt_iter_t *iter;
+	lt_pointer_t key, val;
+	int i = 0;
+
+	fail_unless(lt_trie_add(t, "fo", "fo", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "foo", "foo", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "fooo", "fooo", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "foo-bar", "foo-bar", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "fop", "fop", NULL), "Unable to add");
+	fail_unless(lt_trie_add(t, "g", "g", NULL), "Unable to add");
+
+	iter = lt_trie_prefix_iter(t, "foo");
+	while (lt_iter_next(iter, &key, &val)) {
+		fail_unless(expected[i] != NULL, "Too many keys");
+		fail_unless(strcmp(key, expected[i]) == 0, "Unexpected key: %s", (char *)key);
+		fail_unless(strcmp(val, expected[i]) == 0, "Unexpected value: %s", (char *)val);
+		i++;
+	}
+	lt_iter_finish(iter);
+	fail_unless(expected[i] == NULL, "Too few keys");
+
+	iter = lt_trie_prefix_iter(t, "fox");
+	fail_unless(!lt_iter_next(iter, &key, &val), "No keys expected");
+	lt_iter_finish(iter);
+
+	i = 0;
+	iter = lt_trie_prefix_iter(t, "");
+	while (lt_iter_next(iter, &key, &val))
+		i++;
+	lt_iter_finish(iter);
+	fail_unless(i == 6, "Unexpected number of keys: %d", i);
+
+	/* the bytes above 0x7f */
+	fail_unless(lt_trie_add(t, "caf\xc3\xa9", "cafe", NULL), "Unable to add");
+	fail_unless(lt_trie_lookup(t, "caf\xc3\xa9") != NULL, "Unable to look up");
+	fail_unless(lt_trie_lookup(t, "\xc3\xa9") == NULL, "Unexpected value");
+	iter = lt_trie_prefix_iter(t, "caf\xc3");
+	fail_unless(lt_iter_next(iter, &key, &val), "No keys found");
+	fail_unless(strcmp(key, "caf\xc3\xa9") == 0, "Unexpected key: %s", (char *)key);
+	lt_iter_finish(iter);
+	iter = lt_trie_prefix_iter(t, "\xc3\xa9");
+	fail_unless(!lt_iter_next(iter, &key, &val), "No keys expected");
+	lt_iter_finish(iter);
+	fail_unless(lt_trie_remove(t, "caf\xc3\xa9"), "Unable to remove");
+
+	lt_trie_unref(t);
+} TEND
+
 /************************************************************/
 Suite *
 tester_suite(void)
@@ -122,6 +222,8 @@ tester_suite(void)
 	T (lt_trie_replace);
 	T (lt_trie_remove);
 	T (lt_trie_lookup);
+	T (lt_trie_iter);
+	T (lt_trie_prefix_iter);
 
 	suite_add_tcase(s, tc);
 
@@ -0,0 +1,153 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * fork-db.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "langtag.h"
+#include "lt-utils.h"
+
+/* the amount of the memory written by this process only in kB */
+static long
+get_private_dirty(void)
+{
+	FILE *fp;
+	char buf[256];
+	long retval = 0, n;
+
+	/* smaps_rollup is much faster but not available on the older kernel */
+	fp = fopen("/proc/self/smaps_rollup", "r");
+	if (!fp)
+		fp = fopen("/proc/self/smaps", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof (buf), fp)) {
+		if (sscanf(buf, "Private_Dirty: %ld kB", &n) == 1)
+			retval += n;
+	}
+	fclose(fp);
+
+	return retval;
+}
+
+static void
+run_child(int          id,
+	  char       **keys,
+	  size_t       n_keys,
+	  int          n_loops)
+{
+	const char *tags[] = {
+		"ja-JP", "en-Latn-US", "zh-yue", "i-klingon",
+		"de-CH-1901", "sr-Latn-RS-ekavsk", NULL
+	};
+	long before, after;
+	int i, j;
+
+	before = get_private_dirty();
+	for (i = 0; i < n_loops; i++) {
+		lt_lang_db_t *langdb = lt_db_get_lang();
+		lt_tag_t *tag = lt_tag_new();
+
+		for (j = 0; j < n_keys; j++)
+			lt_lang_unref(lt_lang_db_lookup(langdb, keys[j]));
+		for (j = 0; tags[j] != NULL; j++) {
+			if (lt_tag_parse(tag, tags[j], NULL)) {
+				char *s = lt_tag_canonicalize(tag, NULL);
+
+				free(s);
+			}
+		}
+		lt_tag_unref(tag);
+		lt_lang_db_unref(langdb);
+	}
+	after = get_private_dirty();
+	printf("child %d: Private_Dirty %ld kB -> %ld kB (+%ld kB)\n",
+	       id, before, after, after - before);
+}
+
+int
+main(int    argc,
+     char **argv)
+{
+	lt_bool_t freeze = FALSE;
+	int n_children = 4, i;
+	lt_lang_db_t *langdb;
+	lt_iter_t *iter;
+	const char *key;
+	char **keys = NULL;
+	size_t n_keys = 0, size = 0;
+
+	setlocale(LC_ALL, "");
+
+	if (argc > 1 && lt_strcmp0(argv[1], "help") == 0) {
+		printf("Usage: %s [freeze] [<number of children>]\n", argv[0]);
+		return 0;
+	}
+	for (i = 1; i < argc; i++) {
+		if (lt_strcmp0(argv[i], "freeze") == 0)
+			freeze = TRUE;
+		else
+			n_children = atoi(argv[i]);
+	}
+
+	lt_db_set_datadir(TEST_DATADIR);
+	lt_db_initialize();
+	if (freeze)
+		lt_db_freeze();
+
+	/* collect the keys here so that the children only do the lookups */
+	langdb = lt_db_get_lang();
+	iter = lt_iter_init((lt_iter_tmpl_t *)langdb);
+	while (lt_iter_next(iter, (lt_pointer_t *)&key, NULL)) {
+		if (n_keys == size) {
+			size += 1024;
+			keys = realloc(keys, sizeof (char *) * size);
+		}
+		keys[n_keys++] = strdup(key);
+	}
+	lt_iter_finish(iter);
+	lt_lang_db_unref(langdb);
+
+	printf("%s database, %lu keys, %d children\n",
+	       freeze ? "frozen" : "normal",
+	       (unsigned long)n_keys, n_children);
+	fflush(stdout);
+	for (i = 0; i < n_children; i++) {
+		pid_t pid = fork();
+
+		if (pid == 0) {
+			run_child(i, keys, n_keys, 3);
+
+			return 0;
+		} else if (pid < 0) {
+			perror("fork");
+			break;
+		}
+		/* run one by one to get the stable numbers */
+		waitpid(pid, NULL, 0);
+	}
+
+	for (i = 0; i < n_keys; i++)
+		free(keys[i]);
+	free(keys);
+	lt_db_finalize();
+
+	return 0;
+}
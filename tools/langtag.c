@@ -0,0 +1,477 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * langtag.c
+ * Copyright (C) 2011-2012 Akira TAGOH
+ *
+ * Authors:
+ *   Akira TAGOH  <akira@tagoh.org>
+ *
+ * You may distribute under the terms of either the GNU
+ * Lesser General Public License or the Mozilla Public
+ * License, as specified in the README file.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "langtag.h"
+
+/* the number of the tags processed and written at once */
+#define CLI_BLOCK_SIZE		65536
+/* the number of the tags that a thread takes at once */
+#define CLI_CHUNK_SIZE		256
+#define CLI_READ_SIZE		(1024 * 1024)
+/* the upper limit of -j for each processor */
+#define CLI_THREADS_PER_CPU	4
+
+typedef enum _cli_command_t {
+	CLI_VALIDATE,
+	CLI_CANONICALIZE,
+	CLI_TRANSFORM,
+	CLI_TO_LOCALE,
+	CLI_MATCH
+} cli_command_t;
+
+typedef struct _cli_t {
+	cli_command_t    command;
+	lt_tag_t        *range;
+	char             delimiter;
+	unsigned int     n_threads;
+#if HAVE_PTHREAD
+	pthread_t       *threads;
+#endif
+	lt_tag_span_t   *spans;
+	char           **results;
+	size_t           n_spans;
+	size_t           next;
+#if HAVE_PTHREAD
+	pthread_mutex_t  lock;
+#endif
+} cli_t;
+
+static const struct {
+	const char    *name;
+	cli_command_t  command;
+} commands[] = {
+	{ "validate", CLI_VALIDATE },
+	{ "canonicalize", CLI_CANONICALIZE },
+	{ "transform", CLI_TRANSFORM },
+	{ "to_locale", CLI_TO_LOCALE },
+	{ "match", CLI_MATCH },
+	{ NULL, 0 }
+};
+static const char *validity[] = {
+	"valid",
+	"invalid-syntax",
+	"invalid-subtag",
+	"unknown-subtag",
+	"invalid-prefix",
+	"duplicate-subtag",
+	"invalid-extension"
+};
+
+/*< private >*/
+static void
+cli_usage(const char *prog)
+{
+	printf("Usage: %s [options] <command> [<range>]\n"
+	       "\n"
+	       "Read the language tags from stdin, one per line, and write the result\n"
+	       "of <command> for each of them in the same order. the result of the tag\n"
+	       "that can't be processed is an empty line.\n"
+	       "\n"
+	       "Commands:\n"
+	       "  validate        the validity of the tag\n"
+	       "  canonicalize    the canonicalized tag\n"
+	       "  transform       the tag transformed with the extensions\n"
+	       "  to_locale       the locale converted from the tag\n"
+	       "  match <range>   yes or no whether the tag matches with <range>\n"
+	       "\n"
+	       "Options:\n"
+	       "  -0              the tags are separated by NUL instead of the newline\n"
+	       "  -d <directory>  the directory of the language subtag registry\n"
+	       "  -f <file>       read the tags from <file> instead of stdin\n"
+	       "  -j <number>     the number of the threads [default: the number of processors]\n"
+	       "  -h              show this message\n",
+	       prog);
+}
+
+/* the errors are ignored here. the result is empty for them. */
+static char *
+cli_process(cli_t               *cli,
+	    lt_tag_t            *tag,
+	    const lt_tag_span_t *span)
+{
+	lt_error_t *err = NULL;
+	lt_tag_t *t;
+	char *retval = NULL;
+
+	if (cli->command == CLI_VALIDATE)
+		return (char *)validity[lt_tag_is_valid(span->string, span->length, 0, NULL)];
+	if (!lt_tag_parse_len(tag, span->string, span->length, &err))
+		goto bail;
+	/* the grandfathered and privateuse-only tags can't be converted
+	 * nor compared. avoid the warnings on them.
+	 */
+	if (lt_tag_get_grandfathered(tag) || !lt_tag_get_language(tag)) {
+		if (cli->command == CLI_MATCH)
+			retval = (char *)"no";
+		if (cli->command != CLI_TRANSFORM)
+			goto bail;
+	}
+	switch (cli->command) {
+	    case CLI_TRANSFORM:
+		    t = lt_tag_transform(tag, &err);
+		    if (t) {
+			    retval = strdup(lt_tag_get_string(t));
+			    lt_tag_unref(t);
+		    }
+		    break;
+	    case CLI_TO_LOCALE:
+		    retval = lt_tag_convert_to_locale(tag, &err);
+		    break;
+	    case CLI_MATCH:
+		    retval = (char *)(lt_tag_match_range(tag, cli->range) ? "yes" : "no");
+		    break;
+	    default:
+		    break;
+	}
+  bail:
+	if (err)
+		lt_error_unref(err);
+
+	return retval;
+}
+
+static size_t
+cli_next_chunk(cli_t *cli)
+{
+	size_t retval;
+
+#if HAVE_PTHREAD
+	pthread_mutex_lock(&cli->lock);
+#endif
+	retval = cli->next;
+	cli->next += CLI_CHUNK_SIZE;
+#if HAVE_PTHREAD
+	pthread_mutex_unlock(&cli->lock);
+#endif
+
+	return retval;
+}
+
+static void *
+cli_worker(void *data)
+{
+	cli_t *cli = data;
+	lt_tag_t *tag = lt_tag_new();
+	size_t i, end;
+
+	while ((i = cli_next_chunk(cli)) < cli->n_spans) {
+		end = i + CLI_CHUNK_SIZE;
+		if (end > cli->n_spans)
+			end = cli->n_spans;
+		for (; i < end; i++)
+			cli->results[i] = cli_process(cli, tag, &cli->spans[i]);
+	}
+	lt_tag_unref(tag);
+
+	return NULL;
+}
+
+static void
+cli_flush(cli_t *cli)
+{
+	size_t i;
+
+	if (cli->n_spans == 0)
+		return;
+	if (cli->command == CLI_CANONICALIZE) {
+		lt_tag_canonicalize_batch_parallel(cli->spans, cli->n_spans,
+						   cli->results, NULL,
+						   cli->n_threads);
+	} else {
+#if HAVE_PTHREAD
+		unsigned int n, n_threads = 0;
+
+		cli->next = 0;
+		for (n = 1; n < cli->n_threads && n * CLI_CHUNK_SIZE < cli->n_spans; n++) {
+			if (pthread_create(&cli->threads[n_threads], NULL, cli_worker, cli) == 0)
+				n_threads++;
+		}
+		cli_worker(cli);
+		for (n = 0; n < n_threads; n++)
+			pthread_join(cli->threads[n], NULL);
+#else
+		cli->next = 0;
+		cli_worker(cli);
+#endif
+	}
+	for (i = 0; i < cli->n_spans; i++) {
+		if (cli->results[i])
+			fputs(cli->results[i], stdout);
+		putchar(cli->delimiter);
+		if (cli->command != CLI_VALIDATE && cli->command != CLI_MATCH)
+			free(cli->results[i]);
+	}
+	cli->n_spans = 0;
+}
+
+/* add the spans for the records in @buffer and process them. the last
+ * record without the delimiter is left unless @eof is true.
+ * Returns the number of bytes consumed.
+ */
+static size_t
+cli_split(cli_t      *cli,
+	  const char *buffer,
+	  size_t      length,
+	  int         eof)
+{
+	const char *p = buffer, *end = buffer + length, *e;
+	size_t len;
+
+	while (p < end) {
+		e = memchr(p, cli->delimiter, end - p);
+		if (!e) {
+			if (!eof)
+				break;
+			e = end;
+		}
+		len = e - p;
+		if (cli->delimiter == '\n' && len > 0 && p[len - 1] == '\r')
+			len--;
+		cli->spans[cli->n_spans].string = p;
+		cli->spans[cli->n_spans].length = len;
+		if (++cli->n_spans == CLI_BLOCK_SIZE)
+			cli_flush(cli);
+		p = e < end ? e + 1 : end;
+	}
+	/* the spans point to @buffer */
+	cli_flush(cli);
+
+	return p - buffer;
+}
+
+static int
+cli_read(cli_t *cli,
+	 int    fd)
+{
+	size_t size = CLI_READ_SIZE, length = 0, n;
+	char *buffer = malloc(size), *p;
+	ssize_t r;
+	int eof = 0;
+
+	if (!buffer) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	while (!eof) {
+		r = read(fd, buffer + length, size - length);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("read");
+			free(buffer);
+			return 1;
+		}
+		if (r == 0)
+			eof = 1;
+		length += r;
+		/* process the complete records as soon as they arrive so that
+		 * the results of the slow pipe aren't delayed.
+		 */
+		n = cli_split(cli, buffer, length, eof);
+		if (n > 0)
+			fflush(stdout);
+		memmove(buffer, buffer + n, length - n);
+		length -= n;
+		if (length == size) {
+			/* the record is longer than the buffer */
+			p = realloc(buffer, size * 2);
+			if (!p) {
+				fprintf(stderr, "Out of memory\n");
+				free(buffer);
+				return 1;
+			}
+			buffer = p;
+			size *= 2;
+		}
+	}
+	free(buffer);
+
+	return 0;
+}
+
+static int
+cli_read_file(cli_t      *cli,
+	      const char *filename)
+{
+	struct stat st;
+	void *map;
+	int fd, retval;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		perror(filename);
+		return 1;
+	}
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			cli_split(cli, map, st.st_size, 1);
+			munmap(map, st.st_size);
+			close(fd);
+
+			return 0;
+		}
+	}
+	/* not a regular file. read it as a stream */
+	retval = cli_read(cli, fd);
+	close(fd);
+
+	return retval;
+}
+
+/* the value of -j. 0 if it's invalid. */
+static unsigned int
+cli_parse_threads(const char *s)
+{
+	long n, max, ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	char *e;
+
+	errno = 0;
+	n = strtol(s, &e, 10);
+	if (errno != 0 || e == s || *e != 0 || n < 1)
+		return 0;
+	max = (ncpu > 0 ? ncpu : 1) * CLI_THREADS_PER_CPU;
+	if (n > max)
+		n = max;
+
+	return n;
+}
+
+/*< public >*/
+int
+main(int    argc,
+     char **argv)
+{
+	cli_t cli;
+	const char *filename = NULL, *command, *range = NULL;
+	lt_error_t *err = NULL;
+	int i, retval;
+
+	setlocale(LC_ALL, "");
+
+	memset(&cli, 0, sizeof (cli_t));
+	cli.delimiter = '\n';
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != 0; i++) {
+		if (strcmp(argv[i], "-0") == 0) {
+			cli.delimiter = 0;
+		} else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			lt_db_set_datadir(argv[++i]);
+		} else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			filename = argv[++i];
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			cli.n_threads = cli_parse_threads(argv[++i]);
+			if (cli.n_threads == 0) {
+				fprintf(stderr, "Invalid number of the threads: %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "-h") == 0) {
+			cli_usage(argv[0]);
+			return 0;
+		} else {
+			cli_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (i >= argc) {
+		cli_usage(argv[0]);
+		return 1;
+	}
+	command = argv[i++];
+	for (retval = 0; commands[retval].name != NULL; retval++) {
+		if (strcmp(commands[retval].name, command) == 0)
+			break;
+	}
+	if (commands[retval].name == NULL ||
+	    (commands[retval].command == CLI_MATCH && i >= argc)) {
+		cli_usage(argv[0]);
+		return 1;
+	}
+	cli.command = commands[retval].command;
+	if (cli.command == CLI_MATCH)
+		range = argv[i];
+	if (cli.n_threads == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		cli.n_threads = n > 0 ? n : 1;
+	}
+#if HAVE_PTHREAD
+	pthread_mutex_init(&cli.lock, NULL);
+#endif
+	cli.spans = malloc(sizeof (lt_tag_span_t) * CLI_BLOCK_SIZE);
+	cli.results = malloc(sizeof (char *) * CLI_BLOCK_SIZE);
+#if HAVE_PTHREAD
+	cli.threads = malloc(sizeof (pthread_t) * cli.n_threads);
+	if (!cli.threads) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+#endif
+	if (!cli.spans || !cli.results) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	lt_db_initialize();
+	/* the database is never reloaded here. keep the threads from
+	 * updating the reference counts of the entries.
+	 */
+	lt_db_freeze();
+	if (range) {
+		/* parse the range once for all the tags */
+		cli.range = lt_tag_new();
+		if (!lt_tag_parse_range(cli.range, range, &err)) {
+			fprintf(stderr, "Invalid language range: %s\n", range);
+			if (err)
+				lt_error_unref(err);
+			lt_tag_unref(cli.range);
+			lt_db_finalize();
+			return 1;
+		}
+	}
+	if (filename)
+		retval = cli_read_file(&cli, filename);
+	else
+		retval = cli_read(&cli, 0);
+	if (fflush(stdout) != 0) {
+		perror("write");
+		retval = 1;
+	}
+	if (cli.range)
+		lt_tag_unref(cli.range);
+	lt_db_finalize();
+
+	free(cli.results);
+	free(cli.spans);
+#if HAVE_PTHREAD
+	free(cli.threads);
+	pthread_mutex_destroy(&cli.lock);
+#endif
+
+	return retval;
+}